@@ -4,8 +4,8 @@
 package hnswlib
 
 /*
-#cgo CPPFLAGS: -I${SRCDIR} -I${SRCDIR}/hnswlib -DHNSWLIB_NO_MANUAL_VECTORIZATION
-#cgo CXXFLAGS: -std=c++17 -O2 -march=native
+#cgo CPPFLAGS: -I${SRCDIR} -I${SRCDIR}/hnswlib
+#cgo CXXFLAGS: -std=c++17 -O2
 #cgo linux LDFLAGS: -static-libgcc -static-libstdc++ -lm -lpthread -static
 #cgo darwin LDFLAGS: -framework Foundation
 
@@ -25,7 +25,7 @@ import (
 	"unsafe"
 )
 
-// InitHNSW function as declared in go-hnswlib/hnsw_wrapper.h:6
+// InitHNSW function as declared in go-hnswlib/hnsw_wrapper.h:14
 func InitHNSW(Dim int32, Max_elements uint64, M int32, Ef_construction int32, Rand_seed int32, Stype byte) *HNSW {
 	cDim, cDimAllocMap := (C.int)(Dim), cgoAllocsUnknown
 	cMax_elements, cMax_elementsAllocMap := (C.ulonglong)(Max_elements), cgoAllocsUnknown
@@ -44,7 +44,7 @@ func InitHNSW(Dim int32, Max_elements uint64, M int32, Ef_construction int32, Ra
 	return __v
 }
 
-// LoadHNSW function as declared in go-hnswlib/hnsw_wrapper.h:7
+// LoadHNSW function as declared in go-hnswlib/hnsw_wrapper.h:15
 func LoadHNSW(Location []byte, Dim int32, Stype byte) *HNSW {
 	cLocation, cLocationAllocMap := (*C.char)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Location)).Data)), cgoAllocsUnknown
 	cDim, cDimAllocMap := (C.int)(Dim), cgoAllocsUnknown
@@ -57,7 +57,43 @@ func LoadHNSW(Location []byte, Dim int32, Stype byte) *HNSW {
 	return __v
 }
 
-// LoadHNSWSafe function as declared in go-hnswlib/hnsw_wrapper.h:10
+// InitHNSWWithOptions function as declared in go-hnswlib/hnsw_wrapper.h:19
+func InitHNSWWithOptions(Dim int32, Max_elements uint64, M int32, Ef_construction int32, Rand_seed int32, Stype byte, Allow_replace_deleted int32) *HNSW {
+	cDim, cDimAllocMap := (C.int)(Dim), cgoAllocsUnknown
+	cMax_elements, cMax_elementsAllocMap := (C.ulonglong)(Max_elements), cgoAllocsUnknown
+	cM, cMAllocMap := (C.int)(M), cgoAllocsUnknown
+	cEf_construction, cEf_constructionAllocMap := (C.int)(Ef_construction), cgoAllocsUnknown
+	cRand_seed, cRand_seedAllocMap := (C.int)(Rand_seed), cgoAllocsUnknown
+	cStype, cStypeAllocMap := (C.char)(Stype), cgoAllocsUnknown
+	cAllow_replace_deleted, cAllow_replace_deletedAllocMap := (C.int)(Allow_replace_deleted), cgoAllocsUnknown
+	__ret := C.initHNSWWithOptions(cDim, cMax_elements, cM, cEf_construction, cRand_seed, cStype, cAllow_replace_deleted)
+	runtime.KeepAlive(cAllow_replace_deletedAllocMap)
+	runtime.KeepAlive(cStypeAllocMap)
+	runtime.KeepAlive(cRand_seedAllocMap)
+	runtime.KeepAlive(cEf_constructionAllocMap)
+	runtime.KeepAlive(cMAllocMap)
+	runtime.KeepAlive(cMax_elementsAllocMap)
+	runtime.KeepAlive(cDimAllocMap)
+	__v := *(**HNSW)(unsafe.Pointer(&__ret))
+	return __v
+}
+
+// LoadHNSWWithOptions function as declared in go-hnswlib/hnsw_wrapper.h:21
+func LoadHNSWWithOptions(Location []byte, Dim int32, Stype byte, Allow_replace_deleted int32) *HNSW {
+	cLocation, cLocationAllocMap := (*C.char)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Location)).Data)), cgoAllocsUnknown
+	cDim, cDimAllocMap := (C.int)(Dim), cgoAllocsUnknown
+	cStype, cStypeAllocMap := (C.char)(Stype), cgoAllocsUnknown
+	cAllow_replace_deleted, cAllow_replace_deletedAllocMap := (C.int)(Allow_replace_deleted), cgoAllocsUnknown
+	__ret := C.loadHNSWWithOptions(cLocation, cDim, cStype, cAllow_replace_deleted)
+	runtime.KeepAlive(cAllow_replace_deletedAllocMap)
+	runtime.KeepAlive(cStypeAllocMap)
+	runtime.KeepAlive(cDimAllocMap)
+	runtime.KeepAlive(cLocationAllocMap)
+	__v := *(**HNSW)(unsafe.Pointer(&__ret))
+	return __v
+}
+
+// LoadHNSWSafe function as declared in go-hnswlib/hnsw_wrapper.h:24
 func LoadHNSWSafe(Location []byte, Dim int32, Stype byte) *HNSW {
 	cLocation, cLocationAllocMap := (*C.char)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Location)).Data)), cgoAllocsUnknown
 	cDim, cDimAllocMap := (C.int)(Dim), cgoAllocsUnknown
@@ -70,7 +106,105 @@ func LoadHNSWSafe(Location []byte, Dim int32, Stype byte) *HNSW {
 	return __v
 }
 
-// SaveHNSW function as declared in go-hnswlib/hnsw_wrapper.h:11
+// LoadHNSWMmap function as declared in go-hnswlib/hnsw_wrapper.h:29
+func LoadHNSWMmap(Location []byte, Dim int32, Stype byte) *HNSW {
+	cLocation, cLocationAllocMap := (*C.char)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Location)).Data)), cgoAllocsUnknown
+	cDim, cDimAllocMap := (C.int)(Dim), cgoAllocsUnknown
+	cStype, cStypeAllocMap := (C.char)(Stype), cgoAllocsUnknown
+	__ret := C.loadHNSWMmap(cLocation, cDim, cStype)
+	runtime.KeepAlive(cStypeAllocMap)
+	runtime.KeepAlive(cDimAllocMap)
+	runtime.KeepAlive(cLocationAllocMap)
+	__v := *(**HNSW)(unsafe.Pointer(&__ret))
+	return __v
+}
+
+// InitFlat function as declared in go-hnswlib/hnsw_wrapper.h:38
+func InitFlat(Dim int32, Max_elements uint64, Stype byte, Switch_threshold uint64, M int32, Ef_construction int32, Rand_seed int32) *HNSW {
+	cDim, cDimAllocMap := (C.int)(Dim), cgoAllocsUnknown
+	cMax_elements, cMax_elementsAllocMap := (C.ulonglong)(Max_elements), cgoAllocsUnknown
+	cStype, cStypeAllocMap := (C.char)(Stype), cgoAllocsUnknown
+	cSwitch_threshold, cSwitch_thresholdAllocMap := (C.ulonglong)(Switch_threshold), cgoAllocsUnknown
+	cM, cMAllocMap := (C.int)(M), cgoAllocsUnknown
+	cEf_construction, cEf_constructionAllocMap := (C.int)(Ef_construction), cgoAllocsUnknown
+	cRand_seed, cRand_seedAllocMap := (C.int)(Rand_seed), cgoAllocsUnknown
+	__ret := C.initFlat(cDim, cMax_elements, cStype, cSwitch_threshold, cM, cEf_construction, cRand_seed)
+	runtime.KeepAlive(cRand_seedAllocMap)
+	runtime.KeepAlive(cEf_constructionAllocMap)
+	runtime.KeepAlive(cMAllocMap)
+	runtime.KeepAlive(cSwitch_thresholdAllocMap)
+	runtime.KeepAlive(cStypeAllocMap)
+	runtime.KeepAlive(cMax_elementsAllocMap)
+	runtime.KeepAlive(cDimAllocMap)
+	__v := *(**HNSW)(unsafe.Pointer(&__ret))
+	return __v
+}
+
+// LoadFlat function as declared in go-hnswlib/hnsw_wrapper.h:40
+func LoadFlat(Location []byte, Dim int32, Stype byte, Switch_threshold uint64, M int32, Ef_construction int32, Rand_seed int32) *HNSW {
+	cLocation, cLocationAllocMap := (*C.char)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Location)).Data)), cgoAllocsUnknown
+	cDim, cDimAllocMap := (C.int)(Dim), cgoAllocsUnknown
+	cStype, cStypeAllocMap := (C.char)(Stype), cgoAllocsUnknown
+	cSwitch_threshold, cSwitch_thresholdAllocMap := (C.ulonglong)(Switch_threshold), cgoAllocsUnknown
+	cM, cMAllocMap := (C.int)(M), cgoAllocsUnknown
+	cEf_construction, cEf_constructionAllocMap := (C.int)(Ef_construction), cgoAllocsUnknown
+	cRand_seed, cRand_seedAllocMap := (C.int)(Rand_seed), cgoAllocsUnknown
+	__ret := C.loadFlat(cLocation, cDim, cStype, cSwitch_threshold, cM, cEf_construction, cRand_seed)
+	runtime.KeepAlive(cRand_seedAllocMap)
+	runtime.KeepAlive(cEf_constructionAllocMap)
+	runtime.KeepAlive(cMAllocMap)
+	runtime.KeepAlive(cSwitch_thresholdAllocMap)
+	runtime.KeepAlive(cStypeAllocMap)
+	runtime.KeepAlive(cDimAllocMap)
+	runtime.KeepAlive(cLocationAllocMap)
+	__v := *(**HNSW)(unsafe.Pointer(&__ret))
+	return __v
+}
+
+// InitSharded function as declared in go-hnswlib/hnsw_wrapper.h:47
+func InitSharded(Dim int32, Max_elements uint64, M int32, Ef_construction int32, Rand_seed int32, Stype byte, Num_shards int32) *HNSW {
+	cDim, cDimAllocMap := (C.int)(Dim), cgoAllocsUnknown
+	cMax_elements, cMax_elementsAllocMap := (C.ulonglong)(Max_elements), cgoAllocsUnknown
+	cM, cMAllocMap := (C.int)(M), cgoAllocsUnknown
+	cEf_construction, cEf_constructionAllocMap := (C.int)(Ef_construction), cgoAllocsUnknown
+	cRand_seed, cRand_seedAllocMap := (C.int)(Rand_seed), cgoAllocsUnknown
+	cStype, cStypeAllocMap := (C.char)(Stype), cgoAllocsUnknown
+	cNum_shards, cNum_shardsAllocMap := (C.int)(Num_shards), cgoAllocsUnknown
+	__ret := C.initSharded(cDim, cMax_elements, cM, cEf_construction, cRand_seed, cStype, cNum_shards)
+	runtime.KeepAlive(cNum_shardsAllocMap)
+	runtime.KeepAlive(cStypeAllocMap)
+	runtime.KeepAlive(cRand_seedAllocMap)
+	runtime.KeepAlive(cEf_constructionAllocMap)
+	runtime.KeepAlive(cMAllocMap)
+	runtime.KeepAlive(cMax_elementsAllocMap)
+	runtime.KeepAlive(cDimAllocMap)
+	__v := *(**HNSW)(unsafe.Pointer(&__ret))
+	return __v
+}
+
+// LoadSharded function as declared in go-hnswlib/hnsw_wrapper.h:49
+func LoadSharded(Location []byte, Dim int32, Stype byte) *HNSW {
+	cLocation, cLocationAllocMap := (*C.char)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Location)).Data)), cgoAllocsUnknown
+	cDim, cDimAllocMap := (C.int)(Dim), cgoAllocsUnknown
+	cStype, cStypeAllocMap := (C.char)(Stype), cgoAllocsUnknown
+	__ret := C.loadSharded(cLocation, cDim, cStype)
+	runtime.KeepAlive(cStypeAllocMap)
+	runtime.KeepAlive(cDimAllocMap)
+	runtime.KeepAlive(cLocationAllocMap)
+	__v := *(**HNSW)(unsafe.Pointer(&__ret))
+	return __v
+}
+
+// GetIndexType function as declared in go-hnswlib/hnsw_wrapper.h:51
+func GetIndexType(Index *HNSW) int32 {
+	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
+	__ret := C.getIndexType(cIndex)
+	runtime.KeepAlive(cIndexAllocMap)
+	__v := (int32)(__ret)
+	return __v
+}
+
+// SaveHNSW function as declared in go-hnswlib/hnsw_wrapper.h:52
 func SaveHNSW(Index *HNSW, Location []byte) *HNSW {
 	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
 	cLocation, cLocationAllocMap := (*C.char)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Location)).Data)), cgoAllocsUnknown
@@ -81,14 +215,14 @@ func SaveHNSW(Index *HNSW, Location []byte) *HNSW {
 	return __v
 }
 
-// FreeHNSW function as declared in go-hnswlib/hnsw_wrapper.h:12
+// FreeHNSW function as declared in go-hnswlib/hnsw_wrapper.h:53
 func FreeHNSW(Index *HNSW) {
 	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
 	C.freeHNSW(cIndex)
 	runtime.KeepAlive(cIndexAllocMap)
 }
 
-// AddPoint function as declared in go-hnswlib/hnsw_wrapper.h:13
+// AddPoint function as declared in go-hnswlib/hnsw_wrapper.h:54
 func AddPoint(Index *HNSW, Vec []float32, Label uint64) {
 	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
 	cVec, cVecAllocMap := (*C.float)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Vec)).Data)), cgoAllocsUnknown
@@ -99,16 +233,45 @@ func AddPoint(Index *HNSW, Vec []float32, Label uint64) {
 	runtime.KeepAlive(cIndexAllocMap)
 }
 
-// SearchKnn function as declared in go-hnswlib/hnsw_wrapper.h:14
-func SearchKnn(Index *HNSW, Vec []float32, N int32, Label []uint64, Dist []float32) int32 {
+// SearchKnn function as declared in go-hnswlib/hnsw_wrapper.h:61
+func SearchKnn(Index *HNSW, Vec []float32, N int32, Ef int32, Label []uint64, Dist []float32, Stats []uint64) int32 {
+	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
+	cVec, cVecAllocMap := (*C.float)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Vec)).Data)), cgoAllocsUnknown
+	cN, cNAllocMap := (C.int)(N), cgoAllocsUnknown
+	cEf, cEfAllocMap := (C.int)(Ef), cgoAllocsUnknown
+	cLabel, cLabelAllocMap := (*C.ulonglong)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Label)).Data)), cgoAllocsUnknown
+	cDist, cDistAllocMap := (*C.float)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Dist)).Data)), cgoAllocsUnknown
+	cStats, cStatsAllocMap := (*C.ulonglong)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Stats)).Data)), cgoAllocsUnknown
+	__ret := C.searchKnn(cIndex, cVec, cN, cEf, cLabel, cDist, cStats)
+	runtime.KeepAlive(cStatsAllocMap)
+	runtime.KeepAlive(cDistAllocMap)
+	runtime.KeepAlive(cLabelAllocMap)
+	runtime.KeepAlive(cEfAllocMap)
+	runtime.KeepAlive(cNAllocMap)
+	runtime.KeepAlive(cVecAllocMap)
+	runtime.KeepAlive(cIndexAllocMap)
+	__v := (int32)(__ret)
+	return __v
+}
+
+// SearchKnnFiltered function as declared in go-hnswlib/hnsw_wrapper.h:69
+func SearchKnnFiltered(Index *HNSW, Vec []float32, N int32, Ef int32, Filter []uint64, Filter_len uint64, Filter_type int32, Label []uint64, Dist []float32) int32 {
 	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
 	cVec, cVecAllocMap := (*C.float)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Vec)).Data)), cgoAllocsUnknown
 	cN, cNAllocMap := (C.int)(N), cgoAllocsUnknown
+	cEf, cEfAllocMap := (C.int)(Ef), cgoAllocsUnknown
+	cFilter, cFilterAllocMap := (*C.ulonglong)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Filter)).Data)), cgoAllocsUnknown
+	cFilter_len, cFilter_lenAllocMap := (C.ulonglong)(Filter_len), cgoAllocsUnknown
+	cFilter_type, cFilter_typeAllocMap := (C.int)(Filter_type), cgoAllocsUnknown
 	cLabel, cLabelAllocMap := (*C.ulonglong)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Label)).Data)), cgoAllocsUnknown
 	cDist, cDistAllocMap := (*C.float)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Dist)).Data)), cgoAllocsUnknown
-	__ret := C.searchKnn(cIndex, cVec, cN, cLabel, cDist)
+	__ret := C.searchKnnFiltered(cIndex, cVec, cN, cEf, cFilter, cFilter_len, cFilter_type, cLabel, cDist)
 	runtime.KeepAlive(cDistAllocMap)
 	runtime.KeepAlive(cLabelAllocMap)
+	runtime.KeepAlive(cFilter_typeAllocMap)
+	runtime.KeepAlive(cFilter_lenAllocMap)
+	runtime.KeepAlive(cFilterAllocMap)
+	runtime.KeepAlive(cEfAllocMap)
 	runtime.KeepAlive(cNAllocMap)
 	runtime.KeepAlive(cVecAllocMap)
 	runtime.KeepAlive(cIndexAllocMap)
@@ -116,7 +279,49 @@ func SearchKnn(Index *HNSW, Vec []float32, N int32, Label []uint64, Dist []float
 	return __v
 }
 
-// SetEf function as declared in go-hnswlib/hnsw_wrapper.h:15
+// SearchRange function as declared in go-hnswlib/hnsw_wrapper.h:75
+func SearchRange(Index *HNSW, Vec []float32, Radius float32, Max_results int32, Ef int32, Label []uint64, Dist []float32) int32 {
+	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
+	cVec, cVecAllocMap := (*C.float)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Vec)).Data)), cgoAllocsUnknown
+	cRadius, cRadiusAllocMap := (C.float)(Radius), cgoAllocsUnknown
+	cMax_results, cMax_resultsAllocMap := (C.int)(Max_results), cgoAllocsUnknown
+	cEf, cEfAllocMap := (C.int)(Ef), cgoAllocsUnknown
+	cLabel, cLabelAllocMap := (*C.ulonglong)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Label)).Data)), cgoAllocsUnknown
+	cDist, cDistAllocMap := (*C.float)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Dist)).Data)), cgoAllocsUnknown
+	__ret := C.searchRange(cIndex, cVec, cRadius, cMax_results, cEf, cLabel, cDist)
+	runtime.KeepAlive(cDistAllocMap)
+	runtime.KeepAlive(cLabelAllocMap)
+	runtime.KeepAlive(cEfAllocMap)
+	runtime.KeepAlive(cMax_resultsAllocMap)
+	runtime.KeepAlive(cRadiusAllocMap)
+	runtime.KeepAlive(cVecAllocMap)
+	runtime.KeepAlive(cIndexAllocMap)
+	__v := (int32)(__ret)
+	return __v
+}
+
+// SearchDocuments function as declared in go-hnswlib/hnsw_wrapper.h:82
+func SearchDocuments(Index *HNSW, Vec []float32, Num_docs int32, Ef_collection int32, Doc_ids []uint64, Label []uint64, Dist []float32) int32 {
+	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
+	cVec, cVecAllocMap := (*C.float)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Vec)).Data)), cgoAllocsUnknown
+	cNum_docs, cNum_docsAllocMap := (C.int)(Num_docs), cgoAllocsUnknown
+	cEf_collection, cEf_collectionAllocMap := (C.int)(Ef_collection), cgoAllocsUnknown
+	cDoc_ids, cDoc_idsAllocMap := (*C.ulonglong)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Doc_ids)).Data)), cgoAllocsUnknown
+	cLabel, cLabelAllocMap := (*C.ulonglong)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Label)).Data)), cgoAllocsUnknown
+	cDist, cDistAllocMap := (*C.float)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Dist)).Data)), cgoAllocsUnknown
+	__ret := C.searchDocuments(cIndex, cVec, cNum_docs, cEf_collection, cDoc_ids, cLabel, cDist)
+	runtime.KeepAlive(cDistAllocMap)
+	runtime.KeepAlive(cLabelAllocMap)
+	runtime.KeepAlive(cDoc_idsAllocMap)
+	runtime.KeepAlive(cEf_collectionAllocMap)
+	runtime.KeepAlive(cNum_docsAllocMap)
+	runtime.KeepAlive(cVecAllocMap)
+	runtime.KeepAlive(cIndexAllocMap)
+	__v := (int32)(__ret)
+	return __v
+}
+
+// SetEf function as declared in go-hnswlib/hnsw_wrapper.h:84
 func SetEf(Index *HNSW, Ef int32) {
 	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
 	cEf, cEfAllocMap := (C.int)(Ef), cgoAllocsUnknown
@@ -125,7 +330,16 @@ func SetEf(Index *HNSW, Ef int32) {
 	runtime.KeepAlive(cIndexAllocMap)
 }
 
-// ResizeIndex function as declared in go-hnswlib/hnsw_wrapper.h:16
+// SetPrefetchDistance function as declared in go-hnswlib/hnsw_wrapper.h:86
+func SetPrefetchDistance(Index *HNSW, Distance int32) {
+	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
+	cDistance, cDistanceAllocMap := (C.int)(Distance), cgoAllocsUnknown
+	C.setPrefetchDistance(cIndex, cDistance)
+	runtime.KeepAlive(cDistanceAllocMap)
+	runtime.KeepAlive(cIndexAllocMap)
+}
+
+// ResizeIndex function as declared in go-hnswlib/hnsw_wrapper.h:87
 func ResizeIndex(Index *HNSW, New_max_elements uint64) {
 	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
 	cNew_max_elements, cNew_max_elementsAllocMap := (C.ulonglong)(New_max_elements), cgoAllocsUnknown
@@ -134,7 +348,7 @@ func ResizeIndex(Index *HNSW, New_max_elements uint64) {
 	runtime.KeepAlive(cIndexAllocMap)
 }
 
-// GetCurrentElementCount function as declared in go-hnswlib/hnsw_wrapper.h:19
+// GetCurrentElementCount function as declared in go-hnswlib/hnsw_wrapper.h:90
 func GetCurrentElementCount(Index *HNSW) uint64 {
 	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
 	__ret := C.getCurrentElementCount(cIndex)
@@ -143,7 +357,7 @@ func GetCurrentElementCount(Index *HNSW) uint64 {
 	return __v
 }
 
-// GetMaxElements function as declared in go-hnswlib/hnsw_wrapper.h:20
+// GetMaxElements function as declared in go-hnswlib/hnsw_wrapper.h:91
 func GetMaxElements(Index *HNSW) uint64 {
 	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
 	__ret := C.getMaxElements(cIndex)
@@ -152,7 +366,7 @@ func GetMaxElements(Index *HNSW) uint64 {
 	return __v
 }
 
-// GetDeletedCount function as declared in go-hnswlib/hnsw_wrapper.h:21
+// GetDeletedCount function as declared in go-hnswlib/hnsw_wrapper.h:92
 func GetDeletedCount(Index *HNSW) uint64 {
 	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
 	__ret := C.getDeletedCount(cIndex)
@@ -161,7 +375,31 @@ func GetDeletedCount(Index *HNSW) uint64 {
 	return __v
 }
 
-// MarkDeleted function as declared in go-hnswlib/hnsw_wrapper.h:24
+// GetVisitedListContention function as declared in go-hnswlib/hnsw_wrapper.h:94
+func GetVisitedListContention(Index *HNSW) uint64 {
+	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
+	__ret := C.getVisitedListContention(cIndex)
+	runtime.KeepAlive(cIndexAllocMap)
+	__v := (uint64)(__ret)
+	return __v
+}
+
+// GetIndexStats function as declared in go-hnswlib/hnsw_wrapper.h:101
+func GetIndexStats(Index *HNSW, Searches []uint64, Sums []uint64, Buckets []uint64) int32 {
+	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
+	cSearches, cSearchesAllocMap := (*C.ulonglong)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Searches)).Data)), cgoAllocsUnknown
+	cSums, cSumsAllocMap := (*C.ulonglong)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Sums)).Data)), cgoAllocsUnknown
+	cBuckets, cBucketsAllocMap := (*C.ulonglong)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Buckets)).Data)), cgoAllocsUnknown
+	__ret := C.getIndexStats(cIndex, cSearches, cSums, cBuckets)
+	runtime.KeepAlive(cBucketsAllocMap)
+	runtime.KeepAlive(cSumsAllocMap)
+	runtime.KeepAlive(cSearchesAllocMap)
+	runtime.KeepAlive(cIndexAllocMap)
+	__v := (int32)(__ret)
+	return __v
+}
+
+// MarkDeleted function as declared in go-hnswlib/hnsw_wrapper.h:104
 func MarkDeleted(Index *HNSW, Label uint64) {
 	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
 	cLabel, cLabelAllocMap := (C.ulonglong)(Label), cgoAllocsUnknown
@@ -170,7 +408,7 @@ func MarkDeleted(Index *HNSW, Label uint64) {
 	runtime.KeepAlive(cIndexAllocMap)
 }
 
-// UnmarkDeleted function as declared in go-hnswlib/hnsw_wrapper.h:25
+// UnmarkDeleted function as declared in go-hnswlib/hnsw_wrapper.h:105
 func UnmarkDeleted(Index *HNSW, Label uint64) {
 	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
 	cLabel, cLabelAllocMap := (C.ulonglong)(Label), cgoAllocsUnknown
@@ -179,7 +417,7 @@ func UnmarkDeleted(Index *HNSW, Label uint64) {
 	runtime.KeepAlive(cIndexAllocMap)
 }
 
-// AddPointSafe function as declared in go-hnswlib/hnsw_wrapper.h:28
+// AddPointSafe function as declared in go-hnswlib/hnsw_wrapper.h:108
 func AddPointSafe(Index *HNSW, Vec []float32, Label uint64) int32 {
 	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
 	cVec, cVecAllocMap := (*C.float)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Vec)).Data)), cgoAllocsUnknown
@@ -192,7 +430,35 @@ func AddPointSafe(Index *HNSW, Vec []float32, Label uint64) int32 {
 	return __v
 }
 
-// ResizeIndexSafe function as declared in go-hnswlib/hnsw_wrapper.h:29
+// AddPointReplaceSafe function as declared in go-hnswlib/hnsw_wrapper.h:111
+func AddPointReplaceSafe(Index *HNSW, Vec []float32, Label uint64) int32 {
+	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
+	cVec, cVecAllocMap := (*C.float)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Vec)).Data)), cgoAllocsUnknown
+	cLabel, cLabelAllocMap := (C.ulonglong)(Label), cgoAllocsUnknown
+	__ret := C.addPointReplaceSafe(cIndex, cVec, cLabel)
+	runtime.KeepAlive(cLabelAllocMap)
+	runtime.KeepAlive(cVecAllocMap)
+	runtime.KeepAlive(cIndexAllocMap)
+	__v := (int32)(__ret)
+	return __v
+}
+
+// AddDocumentChunkSafe function as declared in go-hnswlib/hnsw_wrapper.h:114
+func AddDocumentChunkSafe(Index *HNSW, Vec []float32, Label uint64, Doc_id uint64) int32 {
+	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
+	cVec, cVecAllocMap := (*C.float)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Vec)).Data)), cgoAllocsUnknown
+	cLabel, cLabelAllocMap := (C.ulonglong)(Label), cgoAllocsUnknown
+	cDoc_id, cDoc_idAllocMap := (C.ulonglong)(Doc_id), cgoAllocsUnknown
+	__ret := C.addDocumentChunkSafe(cIndex, cVec, cLabel, cDoc_id)
+	runtime.KeepAlive(cDoc_idAllocMap)
+	runtime.KeepAlive(cLabelAllocMap)
+	runtime.KeepAlive(cVecAllocMap)
+	runtime.KeepAlive(cIndexAllocMap)
+	__v := (int32)(__ret)
+	return __v
+}
+
+// ResizeIndexSafe function as declared in go-hnswlib/hnsw_wrapper.h:115
 func ResizeIndexSafe(Index *HNSW, New_max_elements uint64) int32 {
 	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
 	cNew_max_elements, cNew_max_elementsAllocMap := (C.ulonglong)(New_max_elements), cgoAllocsUnknown
@@ -203,7 +469,36 @@ func ResizeIndexSafe(Index *HNSW, New_max_elements uint64) int32 {
 	return __v
 }
 
-// SaveIndexSafe function as declared in go-hnswlib/hnsw_wrapper.h:30
+// ReorderIndexSafe function as declared in go-hnswlib/hnsw_wrapper.h:117
+func ReorderIndexSafe(Index *HNSW) int32 {
+	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
+	__ret := C.reorderIndexSafe(cIndex)
+	runtime.KeepAlive(cIndexAllocMap)
+	__v := (int32)(__ret)
+	return __v
+}
+
+// CompactStepSafe function as declared in go-hnswlib/hnsw_wrapper.h:120
+func CompactStepSafe(Index *HNSW, Max_elements uint64) int32 {
+	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
+	cMax_elements, cMax_elementsAllocMap := (C.ulonglong)(Max_elements), cgoAllocsUnknown
+	__ret := C.compactStepSafe(cIndex, cMax_elements)
+	runtime.KeepAlive(cMax_elementsAllocMap)
+	runtime.KeepAlive(cIndexAllocMap)
+	__v := (int32)(__ret)
+	return __v
+}
+
+// CompactIndexSafe function as declared in go-hnswlib/hnsw_wrapper.h:122
+func CompactIndexSafe(Index *HNSW) int32 {
+	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
+	__ret := C.compactIndexSafe(cIndex)
+	runtime.KeepAlive(cIndexAllocMap)
+	__v := (int32)(__ret)
+	return __v
+}
+
+// SaveIndexSafe function as declared in go-hnswlib/hnsw_wrapper.h:123
 func SaveIndexSafe(Index *HNSW, Location []byte) int32 {
 	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
 	cLocation, cLocationAllocMap := (*C.char)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Location)).Data)), cgoAllocsUnknown
@@ -214,7 +509,58 @@ func SaveIndexSafe(Index *HNSW, Location []byte) int32 {
 	return __v
 }
 
-// MarkDeletedSafe function as declared in go-hnswlib/hnsw_wrapper.h:31
+// SaveIndexMmapSafe function as declared in go-hnswlib/hnsw_wrapper.h:124
+func SaveIndexMmapSafe(Index *HNSW, Location []byte) int32 {
+	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
+	cLocation, cLocationAllocMap := (*C.char)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Location)).Data)), cgoAllocsUnknown
+	__ret := C.saveIndexMmapSafe(cIndex, cLocation)
+	runtime.KeepAlive(cLocationAllocMap)
+	runtime.KeepAlive(cIndexAllocMap)
+	__v := (int32)(__ret)
+	return __v
+}
+
+// SaveIndexMmapPackedSafe function as declared in go-hnswlib/hnsw_wrapper.h:128
+func SaveIndexMmapPackedSafe(Index *HNSW, Location []byte) int32 {
+	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
+	cLocation, cLocationAllocMap := (*C.char)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Location)).Data)), cgoAllocsUnknown
+	__ret := C.saveIndexMmapPackedSafe(cIndex, cLocation)
+	runtime.KeepAlive(cLocationAllocMap)
+	runtime.KeepAlive(cIndexAllocMap)
+	__v := (int32)(__ret)
+	return __v
+}
+
+// StartLog function as declared in go-hnswlib/hnsw_wrapper.h:137
+func StartLog(Index *HNSW, Location []byte, Sync int32) int32 {
+	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
+	cLocation, cLocationAllocMap := (*C.char)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Location)).Data)), cgoAllocsUnknown
+	cSync, cSyncAllocMap := (C.int)(Sync), cgoAllocsUnknown
+	__ret := C.startLog(cIndex, cLocation, cSync)
+	runtime.KeepAlive(cSyncAllocMap)
+	runtime.KeepAlive(cLocationAllocMap)
+	runtime.KeepAlive(cIndexAllocMap)
+	__v := (int32)(__ret)
+	return __v
+}
+
+// SaveCheckpoint function as declared in go-hnswlib/hnsw_wrapper.h:138
+func SaveCheckpoint(Index *HNSW) int32 {
+	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
+	__ret := C.saveCheckpoint(cIndex)
+	runtime.KeepAlive(cIndexAllocMap)
+	__v := (int32)(__ret)
+	return __v
+}
+
+// StopLog function as declared in go-hnswlib/hnsw_wrapper.h:139
+func StopLog(Index *HNSW) {
+	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
+	C.stopLog(cIndex)
+	runtime.KeepAlive(cIndexAllocMap)
+}
+
+// MarkDeletedSafe function as declared in go-hnswlib/hnsw_wrapper.h:140
 func MarkDeletedSafe(Index *HNSW, Label uint64) int32 {
 	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
 	cLabel, cLabelAllocMap := (C.ulonglong)(Label), cgoAllocsUnknown
@@ -225,7 +571,7 @@ func MarkDeletedSafe(Index *HNSW, Label uint64) int32 {
 	return __v
 }
 
-// UnmarkDeletedSafe function as declared in go-hnswlib/hnsw_wrapper.h:32
+// UnmarkDeletedSafe function as declared in go-hnswlib/hnsw_wrapper.h:141
 func UnmarkDeletedSafe(Index *HNSW, Label uint64) int32 {
 	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
 	cLabel, cLabelAllocMap := (C.ulonglong)(Label), cgoAllocsUnknown
@@ -236,7 +582,7 @@ func UnmarkDeletedSafe(Index *HNSW, Label uint64) int32 {
 	return __v
 }
 
-// GetDimension function as declared in go-hnswlib/hnsw_wrapper.h:36
+// GetDimension function as declared in go-hnswlib/hnsw_wrapper.h:145
 func GetDimension(Index *HNSW) int32 {
 	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
 	__ret := C.getDimension(cIndex)
@@ -245,7 +591,7 @@ func GetDimension(Index *HNSW) int32 {
 	return __v
 }
 
-// GetVectorByLabel function as declared in go-hnswlib/hnsw_wrapper.h:40
+// GetVectorByLabel function as declared in go-hnswlib/hnsw_wrapper.h:149
 func GetVectorByLabel(Index *HNSW, Label uint64, Vector []float32) int32 {
 	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
 	cLabel, cLabelAllocMap := (C.ulonglong)(Label), cgoAllocsUnknown
@@ -258,7 +604,7 @@ func GetVectorByLabel(Index *HNSW, Label uint64, Vector []float32) int32 {
 	return __v
 }
 
-// GetElementByInternalId function as declared in go-hnswlib/hnsw_wrapper.h:44
+// GetElementByInternalId function as declared in go-hnswlib/hnsw_wrapper.h:153
 func GetElementByInternalId(Index *HNSW, InternalId uint64, Label []uint64, IsDeleted []int32) int32 {
 	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
 	cInternalId, cInternalIdAllocMap := (C.ulonglong)(InternalId), cgoAllocsUnknown
@@ -273,7 +619,7 @@ func GetElementByInternalId(Index *HNSW, InternalId uint64, Label []uint64, IsDe
 	return __v
 }
 
-// GetVectorByInternalId function as declared in go-hnswlib/hnsw_wrapper.h:49
+// GetVectorByInternalId function as declared in go-hnswlib/hnsw_wrapper.h:158
 func GetVectorByInternalId(Index *HNSW, InternalId uint64, Vector []float32) int32 {
 	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
 	cInternalId, cInternalIdAllocMap := (C.ulonglong)(InternalId), cgoAllocsUnknown
@@ -285,3 +631,235 @@ func GetVectorByInternalId(Index *HNSW, InternalId uint64, Vector []float32) int
 	__v := (int32)(__ret)
 	return __v
 }
+
+// SetExecutorThreads function as declared in go-hnswlib/hnsw_wrapper.h:165
+func SetExecutorThreads(Num_threads int32, Pin_threads int32) int32 {
+	cNum_threads, cNum_threadsAllocMap := (C.int)(Num_threads), cgoAllocsUnknown
+	cPin_threads, cPin_threadsAllocMap := (C.int)(Pin_threads), cgoAllocsUnknown
+	__ret := C.setExecutorThreads(cNum_threads, cPin_threads)
+	runtime.KeepAlive(cPin_threadsAllocMap)
+	runtime.KeepAlive(cNum_threadsAllocMap)
+	__v := (int32)(__ret)
+	return __v
+}
+
+// GetExecutorThreads function as declared in go-hnswlib/hnsw_wrapper.h:166
+func GetExecutorThreads() int32 {
+	__ret := C.getExecutorThreads()
+	__v := (int32)(__ret)
+	return __v
+}
+
+// GetNumaNodes function as declared in go-hnswlib/hnsw_wrapper.h:174
+func GetNumaNodes() int32 {
+	__ret := C.getNumaNodes()
+	__v := (int32)(__ret)
+	return __v
+}
+
+// SetExecutorNodes function as declared in go-hnswlib/hnsw_wrapper.h:175
+func SetExecutorNodes(Num_threads int32, Node_mask uint64) int32 {
+	cNum_threads, cNum_threadsAllocMap := (C.int)(Num_threads), cgoAllocsUnknown
+	cNode_mask, cNode_maskAllocMap := (C.ulonglong)(Node_mask), cgoAllocsUnknown
+	__ret := C.setExecutorNodes(cNum_threads, cNode_mask)
+	runtime.KeepAlive(cNode_maskAllocMap)
+	runtime.KeepAlive(cNum_threadsAllocMap)
+	__v := (int32)(__ret)
+	return __v
+}
+
+// SetNumaInterleave function as declared in go-hnswlib/hnsw_wrapper.h:176
+func SetNumaInterleave(Enabled int32) {
+	cEnabled, cEnabledAllocMap := (C.int)(Enabled), cgoAllocsUnknown
+	C.setNumaInterleave(cEnabled)
+	runtime.KeepAlive(cEnabledAllocMap)
+}
+
+// ReplicateIndex function as declared in go-hnswlib/hnsw_wrapper.h:181
+func ReplicateIndex(Index *HNSW) int32 {
+	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
+	__ret := C.replicateIndex(cIndex)
+	runtime.KeepAlive(cIndexAllocMap)
+	__v := (int32)(__ret)
+	return __v
+}
+
+// SearchKnnBatch function as declared in go-hnswlib/hnsw_wrapper.h:187
+func SearchKnnBatch(Index *HNSW, Queries []float32, Nq int32, K int32, Ef int32, Label []uint64, Dist []float32, Counts []int32, Num_threads int32) int32 {
+	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
+	cQueries, cQueriesAllocMap := (*C.float)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Queries)).Data)), cgoAllocsUnknown
+	cNq, cNqAllocMap := (C.int)(Nq), cgoAllocsUnknown
+	cK, cKAllocMap := (C.int)(K), cgoAllocsUnknown
+	cEf, cEfAllocMap := (C.int)(Ef), cgoAllocsUnknown
+	cLabel, cLabelAllocMap := (*C.ulonglong)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Label)).Data)), cgoAllocsUnknown
+	cDist, cDistAllocMap := (*C.float)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Dist)).Data)), cgoAllocsUnknown
+	cCounts, cCountsAllocMap := (*C.int)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Counts)).Data)), cgoAllocsUnknown
+	cNum_threads, cNum_threadsAllocMap := (C.int)(Num_threads), cgoAllocsUnknown
+	__ret := C.searchKnnBatch(cIndex, cQueries, cNq, cK, cEf, cLabel, cDist, cCounts, cNum_threads)
+	runtime.KeepAlive(cNum_threadsAllocMap)
+	runtime.KeepAlive(cCountsAllocMap)
+	runtime.KeepAlive(cDistAllocMap)
+	runtime.KeepAlive(cLabelAllocMap)
+	runtime.KeepAlive(cEfAllocMap)
+	runtime.KeepAlive(cKAllocMap)
+	runtime.KeepAlive(cNqAllocMap)
+	runtime.KeepAlive(cQueriesAllocMap)
+	runtime.KeepAlive(cIndexAllocMap)
+	__v := (int32)(__ret)
+	return __v
+}
+
+// StartSearchQueue function as declared in go-hnswlib/hnsw_wrapper.h:193
+func StartSearchQueue(Index *HNSW, Num_threads int32, Capacity int32, Max_k int32) int32 {
+	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
+	cNum_threads, cNum_threadsAllocMap := (C.int)(Num_threads), cgoAllocsUnknown
+	cCapacity, cCapacityAllocMap := (C.int)(Capacity), cgoAllocsUnknown
+	cMax_k, cMax_kAllocMap := (C.int)(Max_k), cgoAllocsUnknown
+	__ret := C.startSearchQueue(cIndex, cNum_threads, cCapacity, cMax_k)
+	runtime.KeepAlive(cMax_kAllocMap)
+	runtime.KeepAlive(cCapacityAllocMap)
+	runtime.KeepAlive(cNum_threadsAllocMap)
+	runtime.KeepAlive(cIndexAllocMap)
+	__v := (int32)(__ret)
+	return __v
+}
+
+// StartSearchQueueOnNode function as declared in go-hnswlib/hnsw_wrapper.h:196
+func StartSearchQueueOnNode(Index *HNSW, Num_threads int32, Capacity int32, Max_k int32, Node int32) int32 {
+	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
+	cNum_threads, cNum_threadsAllocMap := (C.int)(Num_threads), cgoAllocsUnknown
+	cCapacity, cCapacityAllocMap := (C.int)(Capacity), cgoAllocsUnknown
+	cMax_k, cMax_kAllocMap := (C.int)(Max_k), cgoAllocsUnknown
+	cNode, cNodeAllocMap := (C.int)(Node), cgoAllocsUnknown
+	__ret := C.startSearchQueueOnNode(cIndex, cNum_threads, cCapacity, cMax_k, cNode)
+	runtime.KeepAlive(cNodeAllocMap)
+	runtime.KeepAlive(cMax_kAllocMap)
+	runtime.KeepAlive(cCapacityAllocMap)
+	runtime.KeepAlive(cNum_threadsAllocMap)
+	runtime.KeepAlive(cIndexAllocMap)
+	__v := (int32)(__ret)
+	return __v
+}
+
+// StopSearchQueue function as declared in go-hnswlib/hnsw_wrapper.h:199
+func StopSearchQueue(Index *HNSW) {
+	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
+	C.stopSearchQueue(cIndex)
+	runtime.KeepAlive(cIndexAllocMap)
+}
+
+// SubmitSearch function as declared in go-hnswlib/hnsw_wrapper.h:204
+func SubmitSearch(Index *HNSW, Queries []float32, Nq int32, K int32, Ef int32, Tickets []uint64) int32 {
+	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
+	cQueries, cQueriesAllocMap := (*C.float)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Queries)).Data)), cgoAllocsUnknown
+	cNq, cNqAllocMap := (C.int)(Nq), cgoAllocsUnknown
+	cK, cKAllocMap := (C.int)(K), cgoAllocsUnknown
+	cEf, cEfAllocMap := (C.int)(Ef), cgoAllocsUnknown
+	cTickets, cTicketsAllocMap := (*C.ulonglong)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Tickets)).Data)), cgoAllocsUnknown
+	__ret := C.submitSearch(cIndex, cQueries, cNq, cK, cEf, cTickets)
+	runtime.KeepAlive(cTicketsAllocMap)
+	runtime.KeepAlive(cEfAllocMap)
+	runtime.KeepAlive(cKAllocMap)
+	runtime.KeepAlive(cNqAllocMap)
+	runtime.KeepAlive(cQueriesAllocMap)
+	runtime.KeepAlive(cIndexAllocMap)
+	__v := (int32)(__ret)
+	return __v
+}
+
+// PollSearchResults function as declared in go-hnswlib/hnsw_wrapper.h:210
+func PollSearchResults(Index *HNSW, Tickets []uint64, Counts []int32, Label []uint64, Dist []float32, Max_results int32, Timeout_ms int32) int32 {
+	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
+	cTickets, cTicketsAllocMap := (*C.ulonglong)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Tickets)).Data)), cgoAllocsUnknown
+	cCounts, cCountsAllocMap := (*C.int)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Counts)).Data)), cgoAllocsUnknown
+	cLabel, cLabelAllocMap := (*C.ulonglong)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Label)).Data)), cgoAllocsUnknown
+	cDist, cDistAllocMap := (*C.float)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Dist)).Data)), cgoAllocsUnknown
+	cMax_results, cMax_resultsAllocMap := (C.int)(Max_results), cgoAllocsUnknown
+	cTimeout_ms, cTimeout_msAllocMap := (C.int)(Timeout_ms), cgoAllocsUnknown
+	__ret := C.pollSearchResults(cIndex, cTickets, cCounts, cLabel, cDist, cMax_results, cTimeout_ms)
+	runtime.KeepAlive(cTimeout_msAllocMap)
+	runtime.KeepAlive(cMax_resultsAllocMap)
+	runtime.KeepAlive(cDistAllocMap)
+	runtime.KeepAlive(cLabelAllocMap)
+	runtime.KeepAlive(cCountsAllocMap)
+	runtime.KeepAlive(cTicketsAllocMap)
+	runtime.KeepAlive(cIndexAllocMap)
+	__v := (int32)(__ret)
+	return __v
+}
+
+// AddPointsBatch function as declared in go-hnswlib/hnsw_wrapper.h:219
+func AddPointsBatch(Index *HNSW, Data []float32, Labels []uint64, N uint64, Num_threads int32, Errors []int32) int32 {
+	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
+	cData, cDataAllocMap := (*C.float)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Data)).Data)), cgoAllocsUnknown
+	cLabels, cLabelsAllocMap := (*C.ulonglong)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Labels)).Data)), cgoAllocsUnknown
+	cN, cNAllocMap := (C.ulonglong)(N), cgoAllocsUnknown
+	cNum_threads, cNum_threadsAllocMap := (C.int)(Num_threads), cgoAllocsUnknown
+	cErrors, cErrorsAllocMap := (*C.int)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Errors)).Data)), cgoAllocsUnknown
+	__ret := C.addPointsBatch(cIndex, cData, cLabels, cN, cNum_threads, cErrors)
+	runtime.KeepAlive(cErrorsAllocMap)
+	runtime.KeepAlive(cNum_threadsAllocMap)
+	runtime.KeepAlive(cNAllocMap)
+	runtime.KeepAlive(cLabelsAllocMap)
+	runtime.KeepAlive(cDataAllocMap)
+	runtime.KeepAlive(cIndexAllocMap)
+	__v := (int32)(__ret)
+	return __v
+}
+
+// BuildFromFile function as declared in go-hnswlib/hnsw_wrapper.h:226
+func BuildFromFile(Index *HNSW, Path []byte, Format byte, First_label uint64, Num_threads int32) int32 {
+	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
+	cPath, cPathAllocMap := (*C.char)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Path)).Data)), cgoAllocsUnknown
+	cFormat, cFormatAllocMap := (C.char)(Format), cgoAllocsUnknown
+	cFirst_label, cFirst_labelAllocMap := (C.ulonglong)(First_label), cgoAllocsUnknown
+	cNum_threads, cNum_threadsAllocMap := (C.int)(Num_threads), cgoAllocsUnknown
+	__ret := C.buildFromFile(cIndex, cPath, cFormat, cFirst_label, cNum_threads)
+	runtime.KeepAlive(cNum_threadsAllocMap)
+	runtime.KeepAlive(cFirst_labelAllocMap)
+	runtime.KeepAlive(cFormatAllocMap)
+	runtime.KeepAlive(cPathAllocMap)
+	runtime.KeepAlive(cIndexAllocMap)
+	__v := (int32)(__ret)
+	return __v
+}
+
+// GetBuildProgress function as declared in go-hnswlib/hnsw_wrapper.h:229
+func GetBuildProgress(Index *HNSW, Done []uint64, Total []uint64) {
+	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
+	cDone, cDoneAllocMap := (*C.ulonglong)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Done)).Data)), cgoAllocsUnknown
+	cTotal, cTotalAllocMap := (*C.ulonglong)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Total)).Data)), cgoAllocsUnknown
+	C.getBuildProgress(cIndex, cDone, cTotal)
+	runtime.KeepAlive(cTotalAllocMap)
+	runtime.KeepAlive(cDoneAllocMap)
+	runtime.KeepAlive(cIndexAllocMap)
+}
+
+// GetSimdLevel function as declared in go-hnswlib/hnsw_wrapper.h:234
+func GetSimdLevel() int32 {
+	__ret := C.getSimdLevel()
+	__v := (int32)(__ret)
+	return __v
+}
+
+// TrainQuantizer function as declared in go-hnswlib/hnsw_wrapper.h:239
+func TrainQuantizer(Index *HNSW, Data []float32, N uint64) int32 {
+	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
+	cData, cDataAllocMap := (*C.float)(unsafe.Pointer((*sliceHeader)(unsafe.Pointer(&Data)).Data)), cgoAllocsUnknown
+	cN, cNAllocMap := (C.ulonglong)(N), cgoAllocsUnknown
+	__ret := C.trainQuantizer(cIndex, cData, cN)
+	runtime.KeepAlive(cNAllocMap)
+	runtime.KeepAlive(cDataAllocMap)
+	runtime.KeepAlive(cIndexAllocMap)
+	__v := (int32)(__ret)
+	return __v
+}
+
+// SetRerank function as declared in go-hnswlib/hnsw_wrapper.h:243
+func SetRerank(Index *HNSW, Factor int32) {
+	cIndex, cIndexAllocMap := (C.HNSW)(unsafe.Pointer(Index)), cgoAllocsUnknown
+	cFactor, cFactorAllocMap := (C.int)(Factor), cgoAllocsUnknown
+	C.setRerank(cIndex, cFactor)
+	runtime.KeepAlive(cFactorAllocMap)
+	runtime.KeepAlive(cIndexAllocMap)
+}
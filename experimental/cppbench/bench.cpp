@@ -0,0 +1,401 @@
+// bench.cpp - native recall/latency benchmark of hnswlib, without the Go wrapper.
+//
+// Builds HierarchicalNSW indexes for every M x ef_construction combination on a
+// dataset, computes exact ground truth with BruteforceSearch, searches with every
+// prefetch distance and ef and prints one JSON document with recall@k, QPS, latency percentiles, search
+// work and build throughput. See README.md for usage.
+#include "hnswlib/hnswlib.h"
+#include "hnswlib/executor.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#ifdef HNSW_BENCH_HDF5
+#include <hdf5.h>
+#endif
+
+namespace {
+
+struct Options {
+    std::string base_path, query_path, hdf5_path;
+    size_t synthetic_n = 0, synthetic_queries = 1000, synthetic_dim = 0;
+    size_t max_base = 0, max_queries = 0;
+    std::string space = "l2";
+    size_t k = 10;
+    std::vector<size_t> M = {16};
+    std::vector<size_t> ef_construction = {200};
+    std::vector<size_t> ef = {10, 20, 40, 80, 160, 320};
+    std::vector<size_t> prefetch = {hnswlib::HierarchicalNSW<float>::DEFAULT_PREFETCH_DISTANCE};
+    int threads = 0;
+    int warmup = 1;
+    size_t seed = 100;
+    std::string out;
+};
+
+struct Dataset {
+    std::string name;
+    size_t dim = 0;
+    size_t num_base = 0, num_queries = 0;
+    std::vector<float> base, queries;  // row-major
+};
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+[[noreturn]] void usage(const char* error) {
+    if (error) fprintf(stderr, "error: %s\n\n", error);
+    fprintf(stderr,
+        "usage: bench (--base B.fvecs|.bvecs --query Q.fvecs|.bvecs | --hdf5 D.hdf5 | --synthetic N --dim D)\n"
+        "             [--space l2|ip|cosine] [--k 10] [--M 16,32] [--ef-construction 100,200]\n"
+        "             [--ef 10,20,40,...] [--prefetch 0,4,8] [--max-base N] [--max-queries N] [--queries N]\n"
+        "             [--threads T] [--warmup 1] [--seed S] [--out results.json]\n");
+    exit(2);
+}
+
+std::vector<size_t> parseList(const char* arg, bool allow_zero = false) {
+    std::vector<size_t> values;
+    for (const char* p = arg; *p;) {
+        char* end;
+        unsigned long long v = strtoull(p, &end, 10);
+        if (end == p || (v == 0 && !allow_zero)) usage("list values must be positive integers");
+        values.push_back(v);
+        p = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') usage("lists are comma separated");
+    }
+    return values;
+}
+
+Options parseOptions(int argc, char** argv) {
+    Options o;
+    for (int i = 1; i < argc; i++) {
+        std::string flag = argv[i];
+        if (i + 1 >= argc) usage(("missing value for " + flag).c_str());
+        const char* value = argv[++i];
+        if (flag == "--base") o.base_path = value;
+        else if (flag == "--query") o.query_path = value;
+        else if (flag == "--hdf5") o.hdf5_path = value;
+        else if (flag == "--synthetic") o.synthetic_n = strtoull(value, nullptr, 10);
+        else if (flag == "--queries") o.synthetic_queries = strtoull(value, nullptr, 10);
+        else if (flag == "--dim") o.synthetic_dim = strtoull(value, nullptr, 10);
+        else if (flag == "--max-base") o.max_base = strtoull(value, nullptr, 10);
+        else if (flag == "--max-queries") o.max_queries = strtoull(value, nullptr, 10);
+        else if (flag == "--space") o.space = value;
+        else if (flag == "--k") o.k = strtoull(value, nullptr, 10);
+        else if (flag == "--M") o.M = parseList(value);
+        else if (flag == "--ef-construction") o.ef_construction = parseList(value);
+        else if (flag == "--ef") o.ef = parseList(value);
+        else if (flag == "--prefetch") o.prefetch = parseList(value, true);
+        else if (flag == "--threads") o.threads = atoi(value);
+        else if (flag == "--warmup") o.warmup = atoi(value);
+        else if (flag == "--seed") o.seed = strtoull(value, nullptr, 10);
+        else if (flag == "--out") o.out = value;
+        else usage(("unknown flag " + flag).c_str());
+    }
+    int sources = !o.base_path.empty() + !o.hdf5_path.empty() + (o.synthetic_n > 0);
+    if (sources != 1) usage("give exactly one of --base/--query, --hdf5 or --synthetic");
+    if (!o.base_path.empty() && o.query_path.empty()) usage("--base needs --query");
+    if (o.synthetic_n > 0 && o.synthetic_dim == 0) usage("--synthetic needs --dim");
+    if (o.space != "l2" && o.space != "ip" && o.space != "cosine") usage("--space is l2, ip or cosine");
+    if (o.k == 0) usage("--k must be positive");
+    return o;
+}
+
+// Reads up to max_rows rows (0 = all) of an .fvecs or .bvecs file: each row is an
+// int32 dimension followed by that many float32 or uint8 values.
+std::vector<float> readVecs(const std::string& path, size_t max_rows, size_t& dim, size_t& rows) {
+    bool bytes = path.size() >= 6 && path.compare(path.size() - 6, 6, ".bvecs") == 0;
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) throw std::runtime_error("cannot open " + path);
+    int32_t d;
+    if (fread(&d, sizeof(d), 1, f) != 1 || d <= 0) {
+        fclose(f);
+        throw std::runtime_error("bad header in " + path);
+    }
+    dim = d;
+    fseek(f, 0, SEEK_END);
+    size_t row_bytes = sizeof(int32_t) + dim * (bytes ? 1 : sizeof(float));
+    rows = ftell(f) / row_bytes;
+    if (max_rows && rows > max_rows) rows = max_rows;
+    fseek(f, 0, SEEK_SET);
+
+    std::vector<float> data(rows * dim);
+    std::vector<uint8_t> row(row_bytes);
+    for (size_t r = 0; r < rows; r++) {
+        if (fread(row.data(), row_bytes, 1, f) != 1) {
+            fclose(f);
+            throw std::runtime_error("truncated " + path);
+        }
+        memcpy(&d, row.data(), sizeof(d));
+        if ((size_t) d != dim) {
+            fclose(f);
+            throw std::runtime_error("rows of " + path + " have different dimensions");
+        }
+        const uint8_t* values = row.data() + sizeof(int32_t);
+        if (bytes) {
+            for (size_t j = 0; j < dim; j++) data[r * dim + j] = values[j];
+        } else {
+            memcpy(&data[r * dim], values, dim * sizeof(float));
+        }
+    }
+    fclose(f);
+    return data;
+}
+
+#ifdef HNSW_BENCH_HDF5
+// Reads a 2-D dataset ("train" or "test" in the ann-benchmarks layout) as float32.
+std::vector<float> readHdf5(hid_t file, const char* name, size_t max_rows, size_t& dim, size_t& rows) {
+    hid_t dataset = H5Dopen2(file, name, H5P_DEFAULT);
+    if (dataset < 0) throw std::runtime_error(std::string("no dataset ") + name);
+    hid_t space = H5Dget_space(dataset);
+    hsize_t dims[2];
+    if (H5Sget_simple_extent_ndims(space) != 2) throw std::runtime_error(std::string(name) + " is not 2-D");
+    H5Sget_simple_extent_dims(space, dims, nullptr);
+    rows = dims[0];
+    dim = dims[1];
+    if (max_rows && rows > max_rows) rows = max_rows;
+
+    hsize_t offset[2] = {0, 0}, count[2] = {rows, dim};
+    H5Sselect_hyperslab(space, H5S_SELECT_SET, offset, nullptr, count, nullptr);
+    hid_t memspace = H5Screate_simple(2, count, nullptr);
+    std::vector<float> data(rows * dim);
+    herr_t status = H5Dread(dataset, H5T_NATIVE_FLOAT, memspace, space, H5P_DEFAULT, data.data());
+    H5Sclose(memspace);
+    H5Sclose(space);
+    H5Dclose(dataset);
+    if (status < 0) throw std::runtime_error(std::string("cannot read ") + name);
+    return data;
+}
+#endif
+
+// Gaussian vectors, e.g. --dim 1536 to stand in for text-embedding workloads
+// when no real dataset is at hand.
+std::vector<float> randomVectors(size_t n, size_t dim, std::mt19937_64& rng) {
+    std::normal_distribution<float> normal;
+    std::vector<float> data(n * dim);
+    for (auto& v : data) v = normal(rng);
+    return data;
+}
+
+Dataset loadDataset(const Options& o) {
+    Dataset ds;
+    if (!o.base_path.empty()) {
+        size_t query_dim;
+        ds.base = readVecs(o.base_path, o.max_base, ds.dim, ds.num_base);
+        ds.queries = readVecs(o.query_path, o.max_queries, query_dim, ds.num_queries);
+        if (query_dim != ds.dim) throw std::runtime_error("base and query dimensions differ");
+        ds.name = o.base_path;
+    } else if (!o.hdf5_path.empty()) {
+#ifdef HNSW_BENCH_HDF5
+        hid_t file = H5Fopen(o.hdf5_path.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+        if (file < 0) throw std::runtime_error("cannot open " + o.hdf5_path);
+        size_t query_dim;
+        ds.base = readHdf5(file, "train", o.max_base, ds.dim, ds.num_base);
+        ds.queries = readHdf5(file, "test", o.max_queries, query_dim, ds.num_queries);
+        H5Fclose(file);
+        if (query_dim != ds.dim) throw std::runtime_error("train and test dimensions differ");
+        ds.name = o.hdf5_path;
+#else
+        throw std::runtime_error("built without HDF5 support (make HDF5=1)");
+#endif
+    } else {
+        std::mt19937_64 rng(o.seed);
+        ds.dim = o.synthetic_dim;
+        ds.num_base = o.synthetic_n;
+        ds.num_queries = o.max_queries ? std::min(o.max_queries, o.synthetic_queries) : o.synthetic_queries;
+        ds.base = randomVectors(ds.num_base, ds.dim, rng);
+        ds.queries = randomVectors(ds.num_queries, ds.dim, rng);
+        ds.name = "synthetic-" + std::to_string(ds.num_base) + "x" + std::to_string(ds.dim);
+    }
+    if (ds.num_base == 0 || ds.num_queries == 0) throw std::runtime_error("empty dataset");
+    if (o.space == "cosine") {
+        hnswlib::NORMFUNC normalize = hnswlib::selectNormalizeFunc(ds.dim);
+        for (size_t r = 0; r < ds.num_base; r++) normalize(&ds.base[r * ds.dim], &ds.base[r * ds.dim], ds.dim);
+        for (size_t r = 0; r < ds.num_queries; r++)
+            normalize(&ds.queries[r * ds.dim], &ds.queries[r * ds.dim], ds.dim);
+    }
+    return ds;
+}
+
+// Exact k nearest labels of every query, closest first.
+std::vector<std::vector<hnswlib::labeltype>> groundTruth(const Dataset& ds, hnswlib::SpaceInterface<float>& space,
+                                                         size_t k, size_t threads) {
+    hnswlib::BruteforceSearch<float> exact(&space, ds.num_base);
+    for (size_t r = 0; r < ds.num_base; r++) exact.addPoint(&ds.base[r * ds.dim], r);
+    std::vector<float> dist(ds.num_queries * k);
+    std::vector<hnswlib::labeltype> labels(ds.num_queries * k);
+    std::vector<size_t> counts(ds.num_queries);
+    exact.searchKnnBatch(ds.queries.data(), ds.num_queries, k, dist.data(), labels.data(), counts.data(), threads);
+    std::vector<std::vector<hnswlib::labeltype>> truth(ds.num_queries);
+    for (size_t q = 0; q < ds.num_queries; q++)
+        truth[q].assign(labels.begin() + q * k, labels.begin() + q * k + counts[q]);
+    return truth;
+}
+
+struct SearchResult {
+    size_t ef, prefetch;
+    double recall, qps, mean_us, p50_us, p99_us;
+    double hops, distance_computations;
+};
+
+double percentile(std::vector<double>& sorted, double p) {
+    size_t i = (size_t) std::ceil(p * sorted.size());
+    return sorted[i > 0 ? i - 1 : 0];
+}
+
+// Runs every query once on the calling thread, timing each search.
+SearchResult runSearches(const hnswlib::HierarchicalNSW<float>& index, const Dataset& ds,
+                         const std::vector<std::vector<hnswlib::labeltype>>& truth, size_t k, size_t ef, int warmup) {
+    std::vector<float> dist(k);
+    std::vector<hnswlib::labeltype> labels(k);
+    for (int w = 0; w < warmup; w++)
+        for (size_t q = 0; q < ds.num_queries; q++)
+            index.searchKnnInto(&ds.queries[q * ds.dim], k, dist.data(), labels.data(), nullptr, nullptr, ef);
+
+    std::vector<double> latencies(ds.num_queries);
+    size_t hits = 0, expected = 0;
+    double hops = 0, distance_computations = 0;
+    Clock::time_point all = Clock::now();
+    for (size_t q = 0; q < ds.num_queries; q++) {
+        hnswlib::threadSearchStats() = hnswlib::SearchStats();
+        Clock::time_point start = Clock::now();
+        size_t n = index.searchKnnInto(&ds.queries[q * ds.dim], k, dist.data(), labels.data(), nullptr, nullptr, ef);
+        latencies[q] = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+        const hnswlib::SearchStats& stats = hnswlib::threadSearchStats();
+        hops += stats.hops;
+        distance_computations += stats.distance_computations;
+        std::unordered_set<hnswlib::labeltype> want(truth[q].begin(), truth[q].end());
+        for (size_t i = 0; i < n; i++) hits += want.count(labels[i]);
+        expected += truth[q].size();
+    }
+    double total = secondsSince(all);
+
+    SearchResult result;
+    result.ef = ef;
+    result.recall = expected ? (double) hits / expected : 0;
+    result.qps = ds.num_queries / total;
+    result.mean_us = total * 1e6 / ds.num_queries;
+    std::sort(latencies.begin(), latencies.end());
+    result.p50_us = percentile(latencies, 0.50);
+    result.p99_us = percentile(latencies, 0.99);
+    result.hops = hops / ds.num_queries;
+    result.distance_computations = distance_computations / ds.num_queries;
+    return result;
+}
+
+std::string jsonString(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if ((unsigned char) c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options o = parseOptions(argc, argv);
+    try {
+        hnswlib::Executor& executor = hnswlib::Executor::instance();
+        if (o.threads > 0) executor.resize(o.threads, false);
+        size_t threads = executor.size();
+
+        Clock::time_point start = Clock::now();
+        Dataset ds = loadDataset(o);
+        fprintf(stderr, "%s: %zu base, %zu queries, dim %zu (%.1fs)\n", ds.name.c_str(), ds.num_base,
+                ds.num_queries, ds.dim, secondsSince(start));
+
+        hnswlib::L2Space l2(ds.dim);
+        hnswlib::InnerProductSpace ip(ds.dim);
+        hnswlib::SpaceInterface<float>& space = o.space == "l2" ? (hnswlib::SpaceInterface<float>&) l2 : ip;
+        size_t k = std::min(o.k, ds.num_base);
+
+        start = Clock::now();
+        auto truth = groundTruth(ds, space, k, threads);
+        double truth_seconds = secondsSince(start);
+        fprintf(stderr, "ground truth: %.1fs\n", truth_seconds);
+
+        std::string json = "{\n  \"dataset\": " + jsonString(ds.name) + ",\n";
+        char buf[512];
+        snprintf(buf, sizeof(buf),
+                 "  \"space\": %s,\n  \"dim\": %zu,\n  \"num_base\": %zu,\n  \"num_queries\": %zu,\n"
+                 "  \"k\": %zu,\n  \"threads\": %zu,\n  \"simd_level\": %d,\n  \"ground_truth_seconds\": %.3f,\n"
+                 "  \"runs\": [",
+                 jsonString(o.space).c_str(), ds.dim, ds.num_base, ds.num_queries, k, threads,
+                 hnswlib::getSimdLevel(), truth_seconds);
+        json += buf;
+
+        bool first_run = true;
+        for (size_t M : o.M) {
+            for (size_t ef_construction : o.ef_construction) {
+                hnswlib::HierarchicalNSW<float> index(&space, ds.num_base, M, ef_construction, o.seed);
+                start = Clock::now();
+                executor.parallelFor(0, ds.num_base, threads, [&](size_t r, size_t) {
+                    index.addPoint(&ds.base[r * ds.dim], r);
+                });
+                double build_seconds = secondsSince(start);
+                fprintf(stderr, "M=%zu ef_construction=%zu: built in %.1fs\n", M, ef_construction, build_seconds);
+
+                snprintf(buf, sizeof(buf),
+                         "%s\n    {\n      \"M\": %zu,\n      \"ef_construction\": %zu,\n"
+                         "      \"build_seconds\": %.3f,\n      \"build_vectors_per_second\": %.1f,\n"
+                         "      \"searches\": [",
+                         first_run ? "" : ",", M, ef_construction, build_seconds, ds.num_base / build_seconds);
+                json += buf;
+                first_run = false;
+
+                bool first_search = true;
+                for (size_t prefetch : o.prefetch) {
+                    index.setPrefetchDistance(prefetch);
+                    for (size_t ef : o.ef) {
+                        SearchResult r = runSearches(index, ds, truth, k, ef, o.warmup);
+                        r.prefetch = prefetch;
+                        fprintf(stderr, "  prefetch=%-3zu ef=%-5zu recall=%.4f qps=%.0f p50=%.1fus p99=%.1fus\n",
+                                r.prefetch, r.ef, r.recall, r.qps, r.p50_us, r.p99_us);
+                        snprintf(buf, sizeof(buf),
+                                 "%s\n        {\"prefetch\": %zu, \"ef\": %zu, \"recall\": %.5f, \"qps\": %.1f, "
+                                 "\"mean_us\": %.2f, \"p50_us\": %.2f, \"p99_us\": %.2f, \"hops\": %.1f, "
+                                 "\"distance_computations\": %.1f}",
+                                 first_search ? "" : ",", r.prefetch, r.ef, r.recall, r.qps, r.mean_us, r.p50_us,
+                                 r.p99_us, r.hops, r.distance_computations);
+                        json += buf;
+                        first_search = false;
+                    }
+                }
+                json += "\n      ]\n    }";
+            }
+        }
+        json += "\n  ]\n}\n";
+
+        if (o.out.empty()) {
+            fputs(json.c_str(), stdout);
+        } else {
+            FILE* f = fopen(o.out.c_str(), "w");
+            if (!f || fputs(json.c_str(), f) < 0 || fclose(f) != 0)
+                throw std::runtime_error("cannot write " + o.out);
+        }
+    } catch (const std::exception& e) {
+        fprintf(stderr, "error: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
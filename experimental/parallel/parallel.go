@@ -3,7 +3,6 @@ package parallel
 import (
 	"errors"
 	"runtime"
-	"sync"
 
 	"github.com/viktordanov/go-hnswlib/hnsw"
 )
@@ -33,6 +32,9 @@ type SearchSimilarityResult struct {
 	Similarities []float32
 }
 
+// BatchAdd inserts all vectors through a single native batch insert.
+// MaxWorkers sets the number of C++ insert threads (default GOMAXPROCS).
+// The index is resized when the batch does not fit its current capacity.
 func BatchAdd(index *hnsw.Index, vectors []VectorData, options *BatchAddOptions) error {
 	if index == nil {
 		return errors.New("index cannot be nil")
@@ -43,38 +45,18 @@ func BatchAdd(index *hnsw.Index, vectors []VectorData, options *BatchAddOptions)
 		maxWorkers = options.MaxWorkers
 	}
 
-	jobs := make(chan VectorData, len(vectors))
-	results := make(chan error, len(vectors))
-
-	var wg sync.WaitGroup
-	for w := 0; w < maxWorkers; w++ {
-		wg.Add(1)
-		go func() {
-			defer wg.Done()
-			for vector := range jobs {
-				err := index.Add(vector.Vector, vector.Label)
-				results <- err
-			}
-		}()
+	vecs := make([][]float32, len(vectors))
+	labels := make([]uint64, len(vectors))
+	for i, vector := range vectors {
+		vecs[i] = vector.Vector
+		labels[i] = vector.Label
 	}
 
-	for _, vector := range vectors {
-		jobs <- vector
-	}
-	close(jobs)
-
-	wg.Wait()
-	close(results)
-
-	for err := range results {
-		if err != nil {
-			return err
-		}
-	}
-
-	return nil
+	return index.AddBatch(vecs, labels, maxWorkers)
 }
 
+// ParallelSearch runs all queries through a single native batch search.
+// MaxWorkers sets the number of C++ search threads (default GOMAXPROCS).
 func ParallelSearch(index *hnsw.Index, queries [][]float32, k int, options *ParallelSearchOptions) ([]SearchResult, error) {
 	if index == nil {
 		return nil, errors.New("index cannot be nil")
@@ -85,46 +67,24 @@ func ParallelSearch(index *hnsw.Index, queries [][]float32, k int, options *Para
 		maxWorkers = options.MaxWorkers
 	}
 
-	type job struct {
-		query []float32
-		index int
-	}
-
-	jobs := make(chan job, len(queries))
-	results := make(chan SearchResult, len(queries))
-
-	var wg sync.WaitGroup
-	for w := 0; w < maxWorkers; w++ {
-		wg.Add(1)
-		go func() {
-			defer wg.Done()
-			for j := range jobs {
-				labels, distances, _ := index.SearchK(j.query, k)
-				results <- SearchResult{
-					QueryIndex: j.index,
-					Labels:     labels,
-					Distances:  distances,
-				}
-			}
-		}()
-	}
-
-	for i, query := range queries {
-		jobs <- job{query: query, index: i}
+	labels, distances, err := index.SearchBatch(queries, k, maxWorkers)
+	if err != nil {
+		return nil, err
 	}
-	close(jobs)
-
-	wg.Wait()
-	close(results)
 
 	searchResults := make([]SearchResult, len(queries))
-	for result := range results {
-		searchResults[result.QueryIndex] = result
+	for i := range queries {
+		searchResults[i] = SearchResult{
+			QueryIndex: i,
+			Labels:     labels[i],
+			Distances:  distances[i],
+		}
 	}
 
 	return searchResults, nil
 }
 
+// ParallelSearchSimilarity is ParallelSearch returning similarities instead of distances.
 func ParallelSearchSimilarity(index *hnsw.Index, queries [][]float32, k int, options *ParallelSearchOptions) ([]SearchSimilarityResult, error) {
 	if index == nil {
 		return nil, errors.New("index cannot be nil")
@@ -135,41 +95,18 @@ func ParallelSearchSimilarity(index *hnsw.Index, queries [][]float32, k int, opt
 		maxWorkers = options.MaxWorkers
 	}
 
-	type job struct {
-		query []float32
-		index int
-	}
-
-	jobs := make(chan job, len(queries))
-	results := make(chan SearchSimilarityResult, len(queries))
-
-	var wg sync.WaitGroup
-	for w := 0; w < maxWorkers; w++ {
-		wg.Add(1)
-		go func() {
-			defer wg.Done()
-			for j := range jobs {
-				labels, similarities, _ := index.SearchKSimilarity(j.query, k)
-				results <- SearchSimilarityResult{
-					QueryIndex:   j.index,
-					Labels:       labels,
-					Similarities: similarities,
-				}
-			}
-		}()
-	}
-
-	for i, query := range queries {
-		jobs <- job{query: query, index: i}
+	labels, similarities, err := index.SearchBatchSimilarity(queries, k, maxWorkers)
+	if err != nil {
+		return nil, err
 	}
-	close(jobs)
-
-	wg.Wait()
-	close(results)
 
 	searchResults := make([]SearchSimilarityResult, len(queries))
-	for result := range results {
-		searchResults[result.QueryIndex] = result
+	for i := range queries {
+		searchResults[i] = SearchSimilarityResult{
+			QueryIndex:   i,
+			Labels:       labels[i],
+			Similarities: similarities[i],
+		}
 	}
 
 	return searchResults, nil
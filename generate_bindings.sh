@@ -42,8 +42,8 @@ if [ -f "bindings.go" ] && ! grep -q "#cgo CPPFLAGS" bindings.go; then
     sed -i.bak '/^package hnswlib$/a\
 \
 /*\
-#cgo CPPFLAGS: -I${SRCDIR} -I${SRCDIR}/hnswlib -DHNSWLIB_NO_MANUAL_VECTORIZATION\
-#cgo CXXFLAGS: -std=c++17 -O2 -march=native\
+#cgo CPPFLAGS: -I${SRCDIR} -I${SRCDIR}/hnswlib\
+#cgo CXXFLAGS: -std=c++17 -O2\
 #cgo linux LDFLAGS: -static-libgcc -static-libstdc++ -lm -lpthread -static\
 #cgo darwin LDFLAGS: -framework Foundation\
 \
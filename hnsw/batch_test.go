@@ -0,0 +1,297 @@
+package hnsw_test
+
+import (
+	"math/rand"
+	"sync"
+	"testing"
+
+	"github.com/viktordanov/go-hnswlib/hnsw"
+)
+
+func randomVectors(n, dim int, seed int64) [][]float32 {
+	rng := rand.New(rand.NewSource(seed))
+	vectors := make([][]float32, n)
+	for i := range vectors {
+		vectors[i] = make([]float32, dim)
+		for j := range vectors[i] {
+			vectors[i][j] = rng.Float32()
+		}
+	}
+	return vectors
+}
+
+func TestSearchBatchMatchesSearchK(t *testing.T) {
+	for _, space := range []hnsw.Space{hnsw.SpaceL2, hnsw.SpaceIP, hnsw.SpaceCosine} {
+		index := hnsw.New(space, 32, 1000, 16, 200, 42)
+		defer index.Close()
+
+		for i, vec := range randomVectors(500, 32, 1) {
+			if err := index.Add(vec, uint64(i)); err != nil {
+				t.Fatalf("Add failed: %v", err)
+			}
+		}
+
+		queries := randomVectors(100, 32, 2)
+		labels, distances, err := index.SearchBatch(queries, 5, 4)
+		if err != nil {
+			t.Fatalf("SearchBatch failed: %v", err)
+		}
+		if len(labels) != len(queries) || len(distances) != len(queries) {
+			t.Fatalf("expected %d result rows, got %d/%d", len(queries), len(labels), len(distances))
+		}
+
+		for q, query := range queries {
+			wantLabels, wantDistances, count := index.SearchK(query, 5)
+			if len(labels[q]) != count {
+				t.Fatalf("space %c query %d: expected %d results, got %d", space, q, count, len(labels[q]))
+			}
+			for j := 0; j < count; j++ {
+				if labels[q][j] != wantLabels[j] || distances[q][j] != wantDistances[j] {
+					t.Errorf("space %c query %d result %d: got (%d, %f), want (%d, %f)",
+						space, q, j, labels[q][j], distances[q][j], wantLabels[j], wantDistances[j])
+				}
+			}
+		}
+	}
+}
+
+func TestSearchBatchFewerThanK(t *testing.T) {
+	index := hnsw.NewL2(8, 100, 16, 200, 42)
+	defer index.Close()
+
+	for i, vec := range randomVectors(3, 8, 1) {
+		index.Add(vec, uint64(i))
+	}
+
+	labels, distances, err := index.SearchBatch(randomVectors(10, 8, 2), 5, 2)
+	if err != nil {
+		t.Fatalf("SearchBatch failed: %v", err)
+	}
+	for q := range labels {
+		if len(labels[q]) != 3 || len(distances[q]) != 3 {
+			t.Errorf("query %d: expected 3 results, got %d", q, len(labels[q]))
+		}
+	}
+}
+
+func TestSearchBatchDimensionMismatch(t *testing.T) {
+	index := hnsw.NewL2(8, 100, 16, 200, 42)
+	defer index.Close()
+
+	_, _, err := index.SearchBatch([][]float32{make([]float32, 4)}, 1, 1)
+	if err == nil {
+		t.Error("expected error for wrong query dimension, got nil")
+	}
+}
+
+func TestAddBatch(t *testing.T) {
+	index := hnsw.NewCosine(16, 10, 16, 200, 42)
+	defer index.Close()
+
+	vectors := randomVectors(200, 16, 3)
+	labels := make([]uint64, len(vectors))
+	for i := range labels {
+		labels[i] = uint64(i + 1000)
+	}
+
+	// Capacity is 10: the batch must grow the index once.
+	if err := index.AddBatch(vectors, labels, 4); err != nil {
+		t.Fatalf("AddBatch failed: %v", err)
+	}
+	if count := index.GetCurrentCount(); count != 200 {
+		t.Errorf("expected 200 elements, got %d", count)
+	}
+	if max := index.GetMaxElements(); max < 200 {
+		t.Errorf("expected capacity >= 200, got %d", max)
+	}
+
+	index.SetEf(100)
+	found := 0
+	for i, vec := range vectors {
+		got, _, count := index.SearchK(vec, 1)
+		if count == 1 && got[0] == labels[i] {
+			found++
+		}
+	}
+	if found < 190 {
+		t.Errorf("expected almost all vectors to find themselves, got %d/200", found)
+	}
+}
+
+func TestAddBatchLengthMismatch(t *testing.T) {
+	index := hnsw.NewL2(4, 10, 16, 200, 42)
+	defer index.Close()
+
+	if err := index.AddBatch(randomVectors(2, 4, 1), []uint64{1}, 1); err == nil {
+		t.Error("expected error for mismatched labels, got nil")
+	}
+	if err := index.AddBatch([][]float32{make([]float32, 3)}, []uint64{1}, 1); err == nil {
+		t.Error("expected error for wrong vector dimension, got nil")
+	}
+}
+
+func TestAddBatchDuplicateLabels(t *testing.T) {
+	index := hnsw.NewL2(4, 10, 16, 200, 42)
+	defer index.Close()
+
+	// every label four times over; the last row of each must win
+	vectors := randomVectors(40, 4, 4)
+	labels := make([]uint64, len(vectors))
+	for i := range labels {
+		labels[i] = uint64(i % 10)
+	}
+	if err := index.AddBatch(vectors, labels, 4); err != nil {
+		t.Fatalf("AddBatch failed: %v", err)
+	}
+	if count := index.GetCurrentCount(); count != 10 {
+		t.Errorf("expected 10 elements, got %d", count)
+	}
+	for label := 0; label < 10; label++ {
+		got, err := index.GetVector(uint64(label))
+		if err != nil {
+			t.Fatalf("GetVector(%d) failed: %v", label, err)
+		}
+		for j, want := range vectors[30+label] {
+			if got[j] != want {
+				t.Fatalf("label %d holds %v, want the last row's %v", label, got, vectors[30+label])
+			}
+		}
+	}
+}
+
+func TestVisitedListContention(t *testing.T) {
+	index := hnsw.NewL2(16, 1000, 16, 200, 42)
+	defer index.Close()
+	for i, vec := range randomVectors(300, 16, 1) {
+		index.Add(vec, uint64(i))
+	}
+
+	queries := randomVectors(200, 16, 2)
+	for round := 0; round < 5; round++ {
+		if _, _, err := index.SearchBatch(queries, 5, 8); err != nil {
+			t.Fatalf("SearchBatch failed: %v", err)
+		}
+		for _, query := range queries {
+			index.SearchK(query, 5)
+		}
+	}
+
+	// Lists are only allocated when every cached one is in use, so misses are
+	// bounded by peak concurrency (8 batch threads + the inserting thread), not
+	// by the 2000 searches run.
+	if got := index.GetVisitedListContention(); got > 9 {
+		t.Errorf("expected at most 9 pool misses, got %d", got)
+	}
+
+	// Growing the index keeps the pool; stale lists are replaced on acquire.
+	if err := index.Resize(2000); err != nil {
+		t.Fatalf("Resize failed: %v", err)
+	}
+	for i, vec := range randomVectors(1200, 16, 3) {
+		if err := index.Add(vec, uint64(1000+i)); err != nil {
+			t.Fatalf("Add after resize failed: %v", err)
+		}
+	}
+	if _, _, count := index.SearchK(queries[0], 5); count != 5 {
+		t.Errorf("expected 5 results after resize, got %d", count)
+	}
+}
+
+func TestAddGrowsWhileSearching(t *testing.T) {
+	index := hnsw.NewL2(16, 10, 16, 100, 42)
+	defer index.Close()
+	vectors := randomVectors(5000, 16, 4)
+	index.Add(vectors[0], 0)
+
+	done := make(chan struct{})
+	searched := make(chan int)
+	for g := 0; g < 4; g++ {
+		go func(seed int64) {
+			n := 0
+			queries := randomVectors(50, 16, seed)
+			for {
+				select {
+				case <-done:
+					searched <- n
+					return
+				default:
+				}
+				index.SearchK(queries[n%len(queries)], 5)
+				n++
+			}
+		}(int64(10 + g))
+	}
+
+	// Capacity starts at 10: every chunk boundary is crossed with searches in flight.
+	for i := 1; i < len(vectors); i++ {
+		if err := index.Add(vectors[i], uint64(i)); err != nil {
+			close(done)
+			t.Fatalf("Add %d failed: %v", i, err)
+		}
+	}
+	close(done)
+	for g := 0; g < 4; g++ {
+		<-searched
+	}
+
+	if count := index.GetCurrentCount(); count != len(vectors) {
+		t.Errorf("expected %d elements, got %d", len(vectors), count)
+	}
+	index.SetEf(100)
+	found := 0
+	for i, vec := range vectors {
+		if labels, _, count := index.SearchK(vec, 1); count == 1 && labels[0] == uint64(i) {
+			found++
+		}
+	}
+	if found < len(vectors)*99/100 {
+		t.Errorf("expected almost all vectors to find themselves, got %d/%d", found, len(vectors))
+	}
+}
+
+func TestExecutorSharedAcrossIndexes(t *testing.T) {
+	if err := hnsw.SetExecutorThreads(3, false); err != nil {
+		t.Fatalf("SetExecutorThreads failed: %v", err)
+	}
+	defer hnsw.SetExecutorThreads(0, false)
+	if n := hnsw.ExecutorThreads(); n != 3 {
+		t.Fatalf("expected 3 executor threads, got %d", n)
+	}
+
+	vectors := randomVectors(2000, 16, 7)
+	labels := make([]uint64, len(vectors))
+	for i := range labels {
+		labels[i] = uint64(i)
+	}
+	var wg sync.WaitGroup
+	indexes := make([]*hnsw.Index, 3)
+	for n := range indexes {
+		indexes[n] = hnsw.NewL2(16, 100, 16, 100, 42)
+		defer indexes[n].Close()
+		wg.Add(1)
+		go func(index *hnsw.Index) {
+			defer wg.Done()
+			if err := index.AddBatch(vectors, labels, 0); err != nil {
+				t.Errorf("AddBatch failed: %v", err)
+			}
+		}(indexes[n])
+	}
+	// Resizing while batches run drops their queued work; callers finish it.
+	hnsw.SetExecutorThreads(2, false)
+	wg.Wait()
+
+	for n, index := range indexes {
+		if count := index.GetCurrentCount(); count != len(vectors) {
+			t.Errorf("index %d: expected %d elements, got %d", n, len(vectors), count)
+		}
+		found, _, err := index.SearchBatch(vectors[:50], 1, 0)
+		if err != nil {
+			t.Fatalf("index %d: SearchBatch failed: %v", n, err)
+		}
+		for q := range found {
+			if len(found[q]) != 1 || found[q][0] != uint64(q) {
+				t.Errorf("index %d query %d: expected label %d, got %v", n, q, q, found[q])
+			}
+		}
+	}
+}
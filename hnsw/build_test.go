@@ -0,0 +1,157 @@
+package hnsw_test
+
+import (
+	"encoding/binary"
+	"fmt"
+	"math"
+	"os"
+	"path/filepath"
+	"testing"
+
+	"github.com/viktordanov/go-hnswlib/hnsw"
+)
+
+func writeFvecs(t *testing.T, path string, vectors [][]float32) {
+	t.Helper()
+	var buf []byte
+	for _, vec := range vectors {
+		buf = binary.LittleEndian.AppendUint32(buf, uint32(len(vec)))
+		for _, v := range vec {
+			buf = binary.LittleEndian.AppendUint32(buf, math.Float32bits(v))
+		}
+	}
+	if err := os.WriteFile(path, buf, 0o644); err != nil {
+		t.Fatal(err)
+	}
+}
+
+func writeNpy(t *testing.T, path, descr string, rows, dim int, data []byte) {
+	t.Helper()
+	header := fmt.Sprintf("{'descr': '%s', 'fortran_order': False, 'shape': (%d, %d), }", descr, rows, dim)
+	// pad so that the data starts on a 64-byte boundary, ending with a newline
+	for (10+len(header)+1)%64 != 0 {
+		header += " "
+	}
+	header += "\n"
+	buf := append([]byte("\x93NUMPY\x01\x00"), byte(len(header)), byte(len(header)>>8))
+	buf = append(buf, header...)
+	buf = append(buf, data...)
+	if err := os.WriteFile(path, buf, 0o644); err != nil {
+		t.Fatal(err)
+	}
+}
+
+func TestBuildFromFile(t *testing.T) {
+	vectors := randomVectors(3000, 12, 1)
+	dir := t.TempDir()
+	fvecs := filepath.Join(dir, "base.fvecs")
+	writeFvecs(t, fvecs, vectors)
+	var raw []byte
+	for _, vec := range vectors {
+		for _, v := range vec {
+			raw = binary.LittleEndian.AppendUint32(raw, math.Float32bits(v))
+		}
+	}
+	npy := filepath.Join(dir, "base.npy")
+	writeNpy(t, npy, "<f4", len(vectors), 12, raw)
+
+	for _, c := range []struct {
+		path   string
+		format hnsw.FileFormat
+	}{{fvecs, hnsw.FormatFvecs}, {npy, hnsw.FormatNpy}} {
+		index := hnsw.NewL2(12, 100, 16, 100, 42)
+		defer index.Close()
+		if err := index.BuildFromFile(c.path, c.format, 1000, 4); err != nil {
+			t.Fatalf("format %c: BuildFromFile failed: %v", c.format, err)
+		}
+		if done, total := index.BuildProgress(); done != 3000 || total != 3000 {
+			t.Errorf("format %c: expected progress 3000/3000, got %d/%d", c.format, done, total)
+		}
+		if count := index.GetCurrentCount(); count != 3000 {
+			t.Errorf("format %c: expected 3000 elements, got %d", c.format, count)
+		}
+		got, err := index.GetVector(1000 + 17)
+		if err != nil {
+			t.Fatalf("format %c: GetVector failed: %v", c.format, err)
+		}
+		for j := range got {
+			if got[j] != vectors[17][j] {
+				t.Fatalf("format %c: component %d: got %f, want %f", c.format, j, got[j], vectors[17][j])
+			}
+		}
+		if labels, _, count := index.SearchK(vectors[42], 1); count != 1 || labels[0] != 1042 {
+			t.Errorf("format %c: expected label 1042, got %v", c.format, labels)
+		}
+	}
+}
+
+func TestBuildFromFileBytesAndCosine(t *testing.T) {
+	dir := t.TempDir()
+	rows := [][]byte{{3, 4, 0}, {0, 0, 7}, {1, 0, 0}}
+	var bvecs, npy []byte
+	for _, row := range rows {
+		bvecs = binary.LittleEndian.AppendUint32(bvecs, 3)
+		bvecs = append(bvecs, row...)
+		npy = append(npy, row...)
+	}
+	bpath := filepath.Join(dir, "base.bvecs")
+	if err := os.WriteFile(bpath, bvecs, 0o644); err != nil {
+		t.Fatal(err)
+	}
+	npath := filepath.Join(dir, "base.npy")
+	writeNpy(t, npath, "|u1", 3, 3, npy)
+
+	for _, c := range []struct {
+		path   string
+		format hnsw.FileFormat
+	}{{bpath, hnsw.FormatBvecs}, {npath, hnsw.FormatNpy}} {
+		index := hnsw.NewCosine(3, 10, 16, 100, 42)
+		defer index.Close()
+		if err := index.BuildFromFile(c.path, c.format, 0, 1); err != nil {
+			t.Fatalf("format %c: BuildFromFile failed: %v", c.format, err)
+		}
+		// Rows are normalized natively for cosine spaces.
+		got, _ := index.GetVector(0)
+		if math.Abs(float64(got[0])-0.6) > 1e-6 || math.Abs(float64(got[1])-0.8) > 1e-6 {
+			t.Errorf("format %c: expected (0.6, 0.8, 0), got %v", c.format, got)
+		}
+	}
+}
+
+func TestBuildFromFileErrors(t *testing.T) {
+	dir := t.TempDir()
+	fvecs := filepath.Join(dir, "base.fvecs")
+	writeFvecs(t, fvecs, randomVectors(10, 8, 1))
+	f64 := filepath.Join(dir, "f64.npy")
+	writeNpy(t, f64, "<f8", 1, 4, make([]byte, 32))
+
+	index := hnsw.NewL2(4, 10, 16, 100, 42)
+	defer index.Close()
+	if err := index.BuildFromFile(fvecs, hnsw.FormatFvecs, 0, 1); err == nil {
+		t.Error("expected error for a dimension mismatch")
+	}
+	if err := index.BuildFromFile(f64, hnsw.FormatNpy, 0, 1); err == nil {
+		t.Error("expected error for an unsupported dtype")
+	}
+	if err := index.BuildFromFile(filepath.Join(dir, "missing"), hnsw.FormatFvecs, 0, 1); err == nil {
+		t.Error("expected error for a missing file")
+	}
+	if index.GetCurrentCount() != 0 {
+		t.Errorf("expected nothing to be added, got %d elements", index.GetCurrentCount())
+	}
+}
+
+func TestBuildFromFileTrainsQuantizer(t *testing.T) {
+	vectors := randomVectors(500, 16, 2)
+	path := filepath.Join(t.TempDir(), "base.fvecs")
+	writeFvecs(t, path, vectors)
+
+	index := hnsw.New(hnsw.SpaceL2SQ8, 16, 500, 16, 100, 42)
+	defer index.Close()
+	if err := index.BuildFromFile(path, hnsw.FormatFvecs, 0, 2); err != nil {
+		t.Fatalf("BuildFromFile failed: %v", err)
+	}
+	if labels, _, count := index.SearchK(vectors[5], 1); count != 1 || labels[0] != 5 {
+		t.Errorf("expected label 5, got %v", labels)
+	}
+}
@@ -0,0 +1,49 @@
+package hnsw
+
+import (
+	"errors"
+
+	bindings "github.com/viktordanov/go-hnswlib"
+)
+
+// AddChunk inserts vec under label as a chunk of document docID. The index must
+// use a document space (SpaceL2Docs, SpaceIPDocs or SpaceCosineDocs); Add and
+// AddBatch on such an index make every element its own document, with docID = label.
+func (i *Index) AddChunk(vec []float32, label, docID uint64) error {
+	if i == nil || i.h == nil {
+		return errors.New("index is closed")
+	}
+	if i.readOnly {
+		return errReadOnly
+	}
+	if bindings.AddDocumentChunkSafe(i.h, vec, label, docID) != 0 {
+		return errors.New("failed to add chunk (check the index uses a document space, vector dimensions and label uniqueness)")
+	}
+	return nil
+}
+
+// SearchDocuments returns the numDocs documents with the closest chunks, closest
+// first: document docIDs[j] has its closest chunk labels[j] at distances[j].
+// Chunks are deduplicated by document during the graph search, which keeps
+// candidate chunks of up to max(efCollection, numDocs) documents, so no
+// over-fetching is needed. Raise efCollection for better recall.
+func (i *Index) SearchDocuments(query []float32, numDocs, efCollection int) (docIDs, labels []uint64, distances []float32, err error) {
+	if i == nil || i.h == nil {
+		return nil, nil, nil, errors.New("index is closed")
+	}
+	if numDocs <= 0 {
+		return nil, nil, nil, errors.New("numDocs must be positive")
+	}
+	if len(query) != i.GetDimension() {
+		return nil, nil, nil, errors.New("query dimension does not match index dimension")
+	}
+
+	docIDs = make([]uint64, numDocs)
+	labels = make([]uint64, numDocs)
+	distances = make([]float32, numDocs)
+	count := bindings.SearchDocuments(i.h, query, int32(numDocs), int32(efCollection), docIDs, labels, distances)
+	if count < 0 {
+		return nil, nil, nil, errors.New("document search failed (check the index uses a document space)")
+	}
+	return docIDs[:count], labels[:count], distances[:count], nil
+}
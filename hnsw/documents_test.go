@@ -0,0 +1,125 @@
+package hnsw_test
+
+import (
+	"path/filepath"
+	"sort"
+	"testing"
+
+	"github.com/viktordanov/go-hnswlib/hnsw"
+)
+
+// bruteForceDocuments returns the numDocs documents whose closest chunk is nearest to query.
+func bruteForceDocuments(chunks [][]float32, docOf func(int) uint64, query []float32, numDocs int) []uint64 {
+	best := make(map[uint64]float32)
+	for c, chunk := range chunks {
+		var d float32
+		for j := range chunk {
+			diff := chunk[j] - query[j]
+			d += diff * diff
+		}
+		doc := docOf(c)
+		if cur, ok := best[doc]; !ok || d < cur {
+			best[doc] = d
+		}
+	}
+	docs := make([]uint64, 0, len(best))
+	for doc := range best {
+		docs = append(docs, doc)
+	}
+	sort.Slice(docs, func(a, b int) bool { return best[docs[a]] < best[docs[b]] })
+	return docs[:numDocs]
+}
+
+func TestSearchDocuments(t *testing.T) {
+	const chunksPerDoc = 8
+	chunks := randomVectors(4000, 16, 1)
+	docOf := func(c int) uint64 { return uint64(c/chunksPerDoc) + 1000 }
+
+	index := hnsw.New(hnsw.SpaceL2Docs, 16, len(chunks), 16, 200, 42)
+	defer index.Close()
+	for c, chunk := range chunks {
+		if err := index.AddChunk(chunk, uint64(c), docOf(c)); err != nil {
+			t.Fatalf("AddChunk failed: %v", err)
+		}
+	}
+
+	hits, total := 0, 0
+	for q, query := range randomVectors(20, 16, 2) {
+		docIDs, labels, distances, err := index.SearchDocuments(query, 10, 50)
+		if err != nil {
+			t.Fatalf("SearchDocuments failed: %v", err)
+		}
+		if len(docIDs) != 10 {
+			t.Fatalf("query %d: expected 10 documents, got %d", q, len(docIDs))
+		}
+		seen := make(map[uint64]bool)
+		for j, doc := range docIDs {
+			if seen[doc] {
+				t.Fatalf("query %d: document %d returned twice", q, doc)
+			}
+			seen[doc] = true
+			if docOf(int(labels[j])) != doc {
+				t.Errorf("query %d: chunk %d does not belong to document %d", q, labels[j], doc)
+			}
+			if j > 0 && distances[j] < distances[j-1] {
+				t.Errorf("query %d: documents are not sorted by distance", q)
+			}
+		}
+		for _, doc := range bruteForceDocuments(chunks, docOf, query, 10) {
+			if seen[doc] {
+				hits++
+			}
+			total++
+		}
+	}
+	if recall := float64(hits) / float64(total); recall < 0.9 {
+		t.Errorf("document recall %.2f is below 0.9", recall)
+	}
+}
+
+func TestSearchDocumentsCosineAndPersistence(t *testing.T) {
+	index := hnsw.New(hnsw.SpaceCosineDocs, 3, 10, 16, 200, 42)
+	defer index.Close()
+	index.AddChunk([]float32{1, 0, 0}, 1, 7)
+	index.AddChunk([]float32{5, 0.5, 0}, 2, 7)
+	index.AddChunk([]float32{0, 3, 0}, 3, 8)
+
+	docIDs, labels, distances, err := index.SearchDocuments([]float32{2, 0, 0}, 2, 0)
+	if err != nil {
+		t.Fatalf("SearchDocuments failed: %v", err)
+	}
+	if len(docIDs) != 2 || docIDs[0] != 7 || labels[0] != 1 || docIDs[1] != 8 {
+		t.Fatalf("expected documents [7 8] with best chunk 1, got %v %v", docIDs, labels)
+	}
+	if distances[0] > 1e-6 {
+		t.Errorf("expected a cosine distance of 0 for the identical direction, got %f", distances[0])
+	}
+	if vec, err := index.GetVector(2); err != nil || len(vec) != 3 {
+		t.Errorf("GetVector on a document index: %v %v", vec, err)
+	}
+
+	path := filepath.Join(t.TempDir(), "docs.bin")
+	if err := index.Save(path); err != nil {
+		t.Fatalf("Save failed: %v", err)
+	}
+	loaded, err := hnsw.Load(hnsw.SpaceCosineDocs, 3, path)
+	if err != nil {
+		t.Fatalf("Load failed: %v", err)
+	}
+	defer loaded.Close()
+	if docIDs, _, _, _ := loaded.SearchDocuments([]float32{0, 1, 0}, 1, 0); len(docIDs) != 1 || docIDs[0] != 8 {
+		t.Errorf("expected document 8 after reload, got %v", docIDs)
+	}
+}
+
+func TestSearchDocumentsRequiresDocumentSpace(t *testing.T) {
+	index := hnsw.NewL2(3, 10, 16, 200, 42)
+	defer index.Close()
+	index.Add([]float32{1, 2, 3}, 1)
+	if err := index.AddChunk([]float32{1, 2, 3}, 2, 1); err == nil {
+		t.Error("expected AddChunk to fail on a plain L2 index")
+	}
+	if _, _, _, err := index.SearchDocuments([]float32{1, 2, 3}, 1, 0); err == nil {
+		t.Error("expected SearchDocuments to fail on a plain L2 index")
+	}
+}
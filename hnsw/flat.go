@@ -0,0 +1,81 @@
+package hnsw
+
+import (
+	"errors"
+	"runtime"
+
+	bindings "github.com/viktordanov/go-hnswlib"
+)
+
+// FlatOptions configures a flat index and the graph it turns into.
+type FlatOptions struct {
+	// SwitchThreshold is the number of elements past which an insert rebuilds
+	// the index as an HNSW graph; 0 keeps it flat for good.
+	SwitchThreshold int
+	// M, EfConstruction and Seed are the parameters of that graph, as in New;
+	// zero values use 16, 200 and 100.
+	M, EfConstruction, Seed int
+}
+
+func (o FlatOptions) graphParams() (m, efConstruction, seed int32) {
+	m, efConstruction, seed = 16, 200, 100
+	if o.M > 0 {
+		m = int32(o.M)
+	}
+	if o.EfConstruction > 0 {
+		efConstruction = int32(o.EfConstruction)
+	}
+	if o.Seed != 0 {
+		seed = int32(o.Seed)
+	}
+	return m, efConstruction, seed
+}
+
+// NewFlat creates an index that searches by comparing the query with every
+// element, so results are exact; SearchBatch scans many queries per pass over
+// the elements. For small collections this is as fast as a graph and needs no
+// build. Once an insert takes it past opts.SwitchThreshold elements, the index
+// is rebuilt in place as an HNSW graph; other calls wait while that runs.
+//
+// While flat, SearchRange, SearchDocuments and SaveMmap return an error, deletes
+// remove elements outright (UnmarkDeleted fails) and Compact does nothing.
+func NewFlat(space Space, dim, maxElements int, opts FlatOptions) (*Index, error) {
+	m, efConstruction, seed := opts.graphParams()
+	h := bindings.InitFlat(int32(dim), uint64(maxElements), byte(space), uint64(opts.SwitchThreshold), m,
+		efConstruction, seed)
+	if h == nil {
+		return nil, errors.New("failed to create flat index")
+	}
+	idx := &Index{
+		h:      h,
+		cosine: space.isCosine(),
+	}
+	runtime.SetFinalizer(idx, (*Index).Close)
+	return idx, nil
+}
+
+// LoadFlat loads a file saved from a flat index. If it holds more than
+// opts.SwitchThreshold elements, it is rebuilt as a graph right away.
+func LoadFlat(space Space, dim int, path string, opts FlatOptions) (*Index, error) {
+	m, efConstruction, seed := opts.graphParams()
+	pathBytes := []byte(path + "\x00") // null terminate
+	h := bindings.LoadFlat(pathBytes, int32(dim), byte(space), uint64(opts.SwitchThreshold), m, efConstruction, seed)
+	if h == nil {
+		return nil, errors.New("failed to load flat index (check file exists and was saved from a flat index)")
+	}
+	idx := &Index{
+		h:      h,
+		cosine: space.isCosine(),
+	}
+	runtime.SetFinalizer(idx, (*Index).Close)
+	return idx, nil
+}
+
+// IsFlat reports whether the index is still flat, i.e. created by NewFlat or
+// LoadFlat and not yet switched to a graph.
+func (i *Index) IsFlat() bool {
+	if i == nil || i.h == nil {
+		return false
+	}
+	return bindings.GetIndexType(i.h) == 1
+}
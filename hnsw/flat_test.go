@@ -0,0 +1,155 @@
+package hnsw_test
+
+import (
+	"path/filepath"
+	"sort"
+	"testing"
+
+	"github.com/viktordanov/go-hnswlib/hnsw"
+)
+
+// exactNeighbors returns the labels of the k vectors closest to query in squared L2.
+func exactNeighbors(vectors [][]float32, query []float32, k int) []uint64 {
+	type scored struct {
+		label uint64
+		dist  float32
+	}
+	all := make([]scored, len(vectors))
+	for i, vec := range vectors {
+		var d float32
+		for j := range vec {
+			diff := vec[j] - query[j]
+			d += diff * diff
+		}
+		all[i] = scored{uint64(i), d}
+	}
+	sort.Slice(all, func(a, b int) bool { return all[a].dist < all[b].dist })
+	labels := make([]uint64, k)
+	for i := range labels {
+		labels[i] = all[i].label
+	}
+	return labels
+}
+
+func sequentialLabels(n int) []uint64 {
+	labels := make([]uint64, n)
+	for i := range labels {
+		labels[i] = uint64(i)
+	}
+	return labels
+}
+
+func TestFlatSearchIsExact(t *testing.T) {
+	index, err := hnsw.NewFlat(hnsw.SpaceL2, 37, 100, hnsw.FlatOptions{})
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer index.Close()
+	vectors := randomVectors(3000, 37, 1)
+	if err := index.AddBatch(vectors, sequentialLabels(len(vectors)), 0); err != nil {
+		t.Fatalf("AddBatch failed: %v", err)
+	}
+	if !index.IsFlat() || index.GetCurrentCount() != 3000 {
+		t.Fatalf("expected a flat index of 3000 elements, got flat=%v count=%d", index.IsFlat(), index.GetCurrentCount())
+	}
+
+	queries := randomVectors(70, 37, 2)
+	batchLabels, _, err := index.SearchBatch(queries, 10, 4)
+	if err != nil {
+		t.Fatalf("SearchBatch failed: %v", err)
+	}
+	for q, query := range queries {
+		want := exactNeighbors(vectors, query, 10)
+		labels, _, count := index.SearchK(query, 10)
+		if count != 10 {
+			t.Fatalf("query %d: expected 10 results, got %d", q, count)
+		}
+		for j := range want {
+			if labels[j] != want[j] || batchLabels[q][j] != want[j] {
+				t.Fatalf("query %d result %d: SearchK %d, SearchBatch %d, want %d", q, j, labels[j], batchLabels[q][j], want[j])
+			}
+		}
+	}
+}
+
+func TestFlatSwitchesToGraph(t *testing.T) {
+	index, err := hnsw.NewFlat(hnsw.SpaceCosine, 16, 10, hnsw.FlatOptions{SwitchThreshold: 500})
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer index.Close()
+	vectors := randomVectors(1000, 16, 3)
+	for i, vec := range vectors[:500] {
+		index.Add(vec, uint64(i))
+	}
+	if !index.IsFlat() {
+		t.Fatal("index switched before passing the threshold")
+	}
+	for i, vec := range vectors[500:] {
+		index.Add(vec, uint64(500+i))
+	}
+	if index.IsFlat() {
+		t.Fatal("index is still flat past the threshold")
+	}
+	if index.GetCurrentCount() != 1000 {
+		t.Fatalf("expected 1000 elements after the switch, got %d", index.GetCurrentCount())
+	}
+	for i := 0; i < 1000; i += 97 {
+		labels, _, count := index.SearchK(vectors[i], 1)
+		if count != 1 || labels[0] != uint64(i) {
+			t.Errorf("element %d is not its own nearest neighbor after the switch: %v", i, labels[:count])
+		}
+	}
+}
+
+func TestFlatSaveLoadAndDelete(t *testing.T) {
+	index, err := hnsw.NewFlat(hnsw.SpaceL2SQ8, 8, 50, hnsw.FlatOptions{})
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer index.Close()
+	vectors := randomVectors(200, 8, 4)
+	if err := index.Train(vectors); err != nil {
+		t.Fatalf("Train failed: %v", err)
+	}
+	for i, vec := range vectors {
+		index.Add(vec, uint64(i))
+	}
+	if err := index.MarkDeleted(7); err != nil {
+		t.Fatalf("MarkDeleted failed: %v", err)
+	}
+	if err := index.MarkDeleted(7); err == nil {
+		t.Error("deleting a removed label succeeded")
+	}
+	if _, err := index.GetVector(7); err == nil {
+		t.Error("GetVector returned a removed label")
+	}
+	if err := index.SaveMmap(filepath.Join(t.TempDir(), "flat.mmap")); err == nil {
+		t.Error("SaveMmap succeeded on a flat index")
+	}
+
+	path := filepath.Join(t.TempDir(), "flat.bin")
+	if err := index.Save(path); err != nil {
+		t.Fatalf("Save failed: %v", err)
+	}
+	loaded, err := hnsw.LoadFlat(hnsw.SpaceL2SQ8, 8, path, hnsw.FlatOptions{SwitchThreshold: 100})
+	if err != nil {
+		t.Fatalf("LoadFlat failed: %v", err)
+	}
+	defer loaded.Close()
+	if loaded.IsFlat() {
+		t.Error("index over the threshold stayed flat on load")
+	}
+	if loaded.GetCurrentCount() != 199 {
+		t.Fatalf("expected 199 elements after load, got %d", loaded.GetCurrentCount())
+	}
+	vec, err := loaded.GetVector(42)
+	if err != nil {
+		t.Fatalf("GetVector failed: %v", err)
+	}
+	for j := range vec {
+		if d := vec[j] - vectors[42][j]; d > 0.01 || d < -0.01 {
+			t.Fatalf("component %d: got %f, want %f", j, vec[j], vectors[42][j])
+		}
+	}
+}
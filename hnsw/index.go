@@ -2,7 +2,7 @@ package hnsw
 
 import (
 	"errors"
-	"math"
+	"fmt"
 	"runtime"
 
 	bindings "github.com/viktordanov/go-hnswlib"
@@ -14,22 +14,87 @@ const (
 	SpaceL2     Space = 'l' // L2 (Euclidean) distance
 	SpaceIP     Space = 'i' // Inner product
 	SpaceCosine Space = 'c' // Cosine similarity
+
+	// 8-bit scalar-quantized storage (4x smaller vectors). Call Train before adding vectors.
+	SpaceL2SQ8     Space = 'L'
+	SpaceIPSQ8     Space = 'I'
+	SpaceCosineSQ8 Space = 'C'
+
+	// Half-precision storage (2x smaller vectors), no training needed.
+	SpaceL2FP16     Space = 'e'
+	SpaceIPFP16     Space = 'p'
+	SpaceCosineFP16 Space = 'a'
+
+	// Chunks of multi-vector documents (float32): every element also records the
+	// document it belongs to, see AddChunk and SearchDocuments.
+	SpaceL2Docs     Space = 'm'
+	SpaceIPDocs     Space = 'n'
+	SpaceCosineDocs Space = 'o'
 )
 
+// isCosine reports whether vectors in this space are normalized before indexing.
+func (s Space) isCosine() bool {
+	return s == SpaceCosine || s == SpaceCosineSQ8 || s == SpaceCosineFP16 || s == SpaceCosineDocs
+}
+
 type Index struct {
 	h         *bindings.HNSW
-	normalize bool // true for cosine space
+	cosine    bool // vectors are normalized natively, distances are 1 - cosine similarity
+	readOnly  bool // true when served from a memory-mapped file
+	queueMaxK int  // result stride of the search queue, set by StartSearchQueue
 }
 
+var errReadOnly = errors.New("index is memory-mapped read-only")
+
 func New(space Space, dim, maxElements, M, efConstruction, seed int) *Index {
 	idx := &Index{
-		normalize: space == SpaceCosine,
+		cosine: space.isCosine(),
 	}
 	idx.h = bindings.InitHNSW(int32(dim), uint64(maxElements), int32(M), int32(efConstruction), int32(seed), byte(space))
 	runtime.SetFinalizer(idx, (*Index).Close)
 	return idx
 }
 
+// Options holds construction settings that New and Load leave at their defaults.
+type Options struct {
+	// AllowReplaceDeleted lets AddReplace store new vectors in the slots of
+	// deleted elements, so the index does not grow under steady churn.
+	AllowReplaceDeleted bool
+}
+
+func (o Options) replaceDeleted() int32 {
+	if o.AllowReplaceDeleted {
+		return 1
+	}
+	return 0
+}
+
+// NewWithOptions is New with additional construction options.
+func NewWithOptions(space Space, dim, maxElements, M, efConstruction, seed int, opts Options) *Index {
+	idx := &Index{
+		cosine: space.isCosine(),
+	}
+	idx.h = bindings.InitHNSWWithOptions(int32(dim), uint64(maxElements), int32(M), int32(efConstruction), int32(seed),
+		byte(space), opts.replaceDeleted())
+	runtime.SetFinalizer(idx, (*Index).Close)
+	return idx
+}
+
+// LoadWithOptions is Load with additional construction options.
+func LoadWithOptions(space Space, dim int, path string, opts Options) (*Index, error) {
+	pathBytes := []byte(path + "\x00") // null terminate
+	h := bindings.LoadHNSWWithOptions(pathBytes, int32(dim), byte(space), opts.replaceDeleted())
+	if h == nil {
+		return nil, errors.New("failed to load index (check file exists and is valid)")
+	}
+	idx := &Index{
+		h:      h,
+		cosine: space.isCosine(),
+	}
+	runtime.SetFinalizer(idx, (*Index).Close)
+	return idx, nil
+}
+
 func Load(space Space, dim int, path string) (*Index, error) {
 	pathBytes := []byte(path + "\x00") // null terminate
 	h := bindings.LoadHNSWSafe(pathBytes, int32(dim), byte(space))
@@ -37,8 +102,27 @@ func Load(space Space, dim int, path string) (*Index, error) {
 		return nil, errors.New("failed to load index (check file exists and is valid)")
 	}
 	idx := &Index{
-		h:         h,
-		normalize: space == SpaceCosine,
+		h:      h,
+		cosine: space.isCosine(),
+	}
+	runtime.SetFinalizer(idx, (*Index).Close)
+	return idx, nil
+}
+
+// LoadMmap opens an index written by SaveMmap without copying it into memory: the
+// file is mapped read-only and searched in place, so startup is fast and processes
+// mapping the same file share the OS page cache. Add, AddBatch, Resize, Train and
+// the delete operations return an error on the loaded index.
+func LoadMmap(space Space, dim int, path string) (*Index, error) {
+	pathBytes := []byte(path + "\x00") // null terminate
+	h := bindings.LoadHNSWMmap(pathBytes, int32(dim), byte(space))
+	if h == nil {
+		return nil, errors.New("failed to map index (check file exists and was written by SaveMmap)")
+	}
+	idx := &Index{
+		h:        h,
+		cosine:   space.isCosine(),
+		readOnly: true,
 	}
 	runtime.SetFinalizer(idx, (*Index).Close)
 	return idx, nil
@@ -53,62 +137,162 @@ func (i *Index) Close() {
 	runtime.SetFinalizer(i, nil)
 }
 
-// normalizeVector normalizes a vector to unit length
-// Creates a copy to avoid race conditions when used concurrently
-func normalizeVector(vector []float32) []float32 {
-	// Calculate norm
-	var norm float32
-	for i := 0; i < len(vector); i++ {
-		norm += vector[i] * vector[i]
+// Add inserts vec under label, or updates the vector if label already exists.
+// A full index grows automatically; growing never moves existing vectors, so
+// concurrent searches are not blocked.
+func (i *Index) Add(vec []float32, label uint64) error {
+	if i == nil || i.h == nil {
+		return errors.New("index is closed")
+	}
+	if i.readOnly {
+		return errReadOnly
 	}
-	norm = 1.0 / (float32(math.Sqrt(float64(norm))) + 1e-15)
 
-	// Create normalized copy (thread-safe)
-	normalized := make([]float32, len(vector))
-	for i := 0; i < len(vector); i++ {
-		normalized[i] = vector[i] * norm
+	result := bindings.AddPointSafe(i.h, vec, label)
+	if result != 0 {
+		return errors.New("failed to add point (check vector dimensions and label uniqueness)")
 	}
-	return normalized
+	return nil
 }
-func (i *Index) Add(vec []float32, label uint64) error {
+
+// AddReplace inserts or updates label like Add, but stores a new label in the
+// slot of a deleted element when one is free instead of growing the index.
+// An existing label, even a deleted one, is updated in place. The index must be
+// created or loaded with Options.AllowReplaceDeleted; on such an index, use
+// AddReplace rather than Add to re-add deleted labels.
+func (i *Index) AddReplace(vec []float32, label uint64) error {
 	if i == nil || i.h == nil {
 		return errors.New("index is closed")
 	}
+	if i.readOnly {
+		return errReadOnly
+	}
 
-	// Check if index is at capacity
-	currentCount := i.GetCurrentCount()
-	maxElements := i.GetMaxElements()
-	if currentCount >= maxElements {
-		return errors.New("index is at maximum capacity - use Resize() to increase capacity")
+	result := bindings.AddPointReplaceSafe(i.h, vec, label)
+	if result != 0 {
+		return errors.New("failed to add point (check vector dimensions, capacity and that AllowReplaceDeleted is set)")
 	}
+	return nil
+}
+
+// BatchAddError reports the rows of an AddBatch call that could not be added.
+type BatchAddError struct {
+	Rows []int // indices into the vectors passed to AddBatch
+}
 
-	// Normalize vector for cosine space
-	vecToAdd := vec
-	if i.normalize {
-		vecToAdd = normalizeVector(vec)
+func (e *BatchAddError) Error() string {
+	return fmt.Sprintf("failed to add %d of the batch rows (listed in Rows)", len(e.Rows))
+}
+
+// AddBatch adds many vectors in a single native call. When the batch does not
+// fit, the index is grown once up front rather than chunk by chunk. Rows are inserted on
+// numThreads C++ threads (numThreads <= 0 uses the whole shared pool). If some rows
+// fail, the others are still added and a *BatchAddError listing the failed rows is returned.
+// Labels need not be unique: as with Add, a label already in the index is updated,
+// and when several rows share a label, the later rows update the earlier ones, so
+// the last row's vector is stored.
+func (i *Index) AddBatch(vectors [][]float32, labels []uint64, numThreads int) error {
+	if i == nil || i.h == nil {
+		return errors.New("index is closed")
+	}
+	if i.readOnly {
+		return errReadOnly
+	}
+	if len(vectors) != len(labels) {
+		return errors.New("vectors and labels must have the same length")
+	}
+	n := len(vectors)
+	if n == 0 {
+		return nil
 	}
 
-	result := bindings.AddPointSafe(i.h, vecToAdd, label)
-	if result != 0 {
-		return errors.New("failed to add point (check vector dimensions and label uniqueness)")
+	dim := i.GetDimension()
+	flat := make([]float32, n*dim)
+	for r, vec := range vectors {
+		if len(vec) != dim {
+			return errors.New("vector dimension does not match index dimension")
+		}
+		row := flat[r*dim : (r+1)*dim]
+		copy(row, vec)
+	}
+
+	rowErrors := make([]int32, n)
+	failed := bindings.AddPointsBatch(i.h, flat, labels, uint64(n), int32(numThreads), rowErrors)
+	if failed < 0 {
+		return errors.New("failed to add batch (memory allocation for resize failed)")
+	}
+	if failed > 0 {
+		rows := make([]int, 0, failed)
+		for r, code := range rowErrors {
+			if code != 0 {
+				rows = append(rows, r)
+			}
+		}
+		return &BatchAddError{Rows: rows}
 	}
 	return nil
 }
 
-func (i *Index) SearchK(query []float32, k int) (labels []uint64, distances []float32, count int) {
+// FileFormat selects the row layout read by BuildFromFile.
+type FileFormat byte
+
+const (
+	FormatFvecs FileFormat = 'f' // int32 dimension followed by float32 components, per row
+	FormatBvecs FileFormat = 'b' // int32 dimension followed by uint8 components, per row
+	FormatNpy   FileFormat = 'n' // C-ordered 2-D NumPy array of float32 or uint8
+)
+
+// BuildFromFile inserts every row of a vector file, giving row r the label
+// firstLabel+r. Rows are streamed from a read-only mapping of the file and
+// converted, normalized for cosine spaces and inserted natively on numThreads
+// threads (numThreads <= 0 uses the whole shared pool), so the dataset is never
+// copied into Go memory. An untrained quantized index is first trained on rows
+// sampled from the file. Progress can be polled from another goroutine with
+// BuildProgress.
+func (i *Index) BuildFromFile(path string, format FileFormat, firstLabel uint64, numThreads int) error {
 	if i == nil || i.h == nil {
-		return nil, nil, 0
+		return errors.New("index is closed")
+	}
+	if i.readOnly {
+		return errReadOnly
+	}
+	pathBytes := []byte(path + "\x00") // null terminate
+	failed := bindings.BuildFromFile(i.h, pathBytes, byte(format), firstLabel, int32(numThreads))
+	if failed < 0 {
+		return errors.New("failed to build from file (check path, format and that the dimension matches the index)")
+	}
+	if failed > 0 {
+		return fmt.Errorf("failed to add %d rows from %s", failed, path)
 	}
+	return nil
+}
 
-	// Normalize query vector for cosine space
-	queryToSearch := query
-	if i.normalize {
-		queryToSearch = normalizeVector(query)
+// BuildProgress reports how many rows the running or last BuildFromFile call
+// has inserted so far, out of total.
+func (i *Index) BuildProgress() (done, total uint64) {
+	if i == nil || i.h == nil {
+		return 0, 0
+	}
+	var d, t [1]uint64
+	bindings.GetBuildProgress(i.h, d[:], t[:])
+	return d[0], t[0]
+}
+
+func (i *Index) SearchK(query []float32, k int) (labels []uint64, distances []float32, count int) {
+	return i.SearchKWithEf(query, k, 0)
+}
+
+// SearchKWithEf is SearchK with the size of the dynamic candidate list set for
+// this search only (ef <= 0 uses the SetEf value). Unlike SetEf it changes no
+// shared state, so concurrent searches on one index may use different ef values.
+func (i *Index) SearchKWithEf(query []float32, k, ef int) (labels []uint64, distances []float32, count int) {
+	if i == nil || i.h == nil {
+		return nil, nil, 0
 	}
 
 	labels = make([]uint64, k)
 	distances = make([]float32, k)
-	count = int(bindings.SearchKnn(i.h, queryToSearch, int32(k), labels, distances))
+	count = int(bindings.SearchKnn(i.h, query, int32(k), int32(ef), labels, distances, nil))
 	if count < k {
 		labels = labels[:count]
 		distances = distances[:count]
@@ -116,6 +300,121 @@ func (i *Index) SearchK(query []float32, k int) (labels []uint64, distances []fl
 	return labels, distances, count
 }
 
+// SearchKInto is SearchK writing into caller-provided buffers, which must hold at
+// least k elements. Results are written closest first and their number is returned.
+// It does not allocate, so hot paths can reuse the same buffers across calls.
+func (i *Index) SearchKInto(query []float32, k int, labels []uint64, distances []float32) (int, error) {
+	return i.SearchKIntoWithEf(query, k, 0, labels, distances)
+}
+
+// SearchKIntoWithEf is SearchKInto with a per-search ef, as in SearchKWithEf.
+func (i *Index) SearchKIntoWithEf(query []float32, k, ef int, labels []uint64, distances []float32) (int, error) {
+	return i.searchKInto(query, k, ef, labels, distances, nil)
+}
+
+// searchKInto backs the SearchKInto variants; stats, if non-nil, receives the
+// four counters of SearchStats.
+func (i *Index) searchKInto(query []float32, k, ef int, labels []uint64, distances []float32, stats []uint64) (int, error) {
+	if i == nil || i.h == nil {
+		return 0, errors.New("index is closed")
+	}
+	if k <= 0 {
+		return 0, errors.New("k must be positive")
+	}
+	if len(labels) < k || len(distances) < k {
+		return 0, errors.New("result buffers are shorter than k")
+	}
+	if len(query) != i.GetDimension() {
+		return 0, errors.New("query dimension does not match index dimension")
+	}
+	return int(bindings.SearchKnn(i.h, query, int32(k), int32(ef), labels, distances, stats)), nil
+}
+
+// SearchRange finds the labels within distance radius of query in a single graph
+// search, closest first, writing them to labels and distances and returning how
+// many were found. At most min(len(labels), len(distances)) results are kept, so
+// the buffers bound the result size. Radius is in the index's distance: squared
+// L2, or 1 - similarity for inner product and cosine spaces. The search explores
+// at least SetEf candidates before stopping at the radius.
+func (i *Index) SearchRange(query []float32, radius float32, labels []uint64, distances []float32) (int, error) {
+	if i == nil || i.h == nil {
+		return 0, errors.New("index is closed")
+	}
+	maxResults := min(len(labels), len(distances))
+	if maxResults == 0 {
+		return 0, errors.New("result buffers are empty")
+	}
+	if len(query) != i.GetDimension() {
+		return 0, errors.New("query dimension does not match index dimension")
+	}
+	count := bindings.SearchRange(i.h, query, radius, int32(maxResults), 0, labels, distances)
+	if count < 0 {
+		return 0, errors.New("range search failed")
+	}
+	return int(count), nil
+}
+
+// Filter selects the labels a filtered search may return. It is evaluated natively
+// for every candidate, without calling back into Go.
+type Filter interface {
+	filterData() (data []uint64, kind int32)
+}
+
+// LabelBitmap allows label l when bit l%64 of word l/64 is set. Labels past the
+// end of the bitmap are not allowed.
+type LabelBitmap []uint64
+
+// NewLabelBitmap returns an empty bitmap that can hold labels up to maxLabel.
+func NewLabelBitmap(maxLabel uint64) LabelBitmap {
+	return make(LabelBitmap, maxLabel/64+1)
+}
+
+// Set allows label, which must be below 64*len(b).
+func (b LabelBitmap) Set(label uint64) {
+	b[label/64] |= 1 << (label % 64)
+}
+
+// Has reports whether label is allowed.
+func (b LabelBitmap) Has(label uint64) bool {
+	return label/64 < uint64(len(b)) && b[label/64]&(1<<(label%64)) != 0
+}
+
+func (b LabelBitmap) filterData() ([]uint64, int32) { return b, 0 }
+
+// LabelList allows the labels it contains. It must be sorted in ascending order
+// (see sort.Slice); membership is checked by binary search.
+type LabelList []uint64
+
+func (l LabelList) filterData() ([]uint64, int32) { return l, 1 }
+
+// SearchKFiltered searches for the k nearest neighbors among the labels allowed by
+// filter. Disallowed elements are skipped during the graph search itself, so up to
+// k allowed results are returned without over-fetching. A nil filter searches everything.
+func (i *Index) SearchKFiltered(query []float32, k int, filter Filter) (labels []uint64, distances []float32, count int, err error) {
+	if i == nil || i.h == nil {
+		return nil, nil, 0, errors.New("index is closed")
+	}
+	if k <= 0 {
+		return nil, nil, 0, errors.New("k must be positive")
+	}
+	if len(query) != i.GetDimension() {
+		return nil, nil, 0, errors.New("query dimension does not match index dimension")
+	}
+	if filter == nil {
+		labels, distances, count = i.SearchK(query, k)
+		return labels, distances, count, nil
+	}
+
+	data, kind := filter.filterData()
+	labels = make([]uint64, k)
+	distances = make([]float32, k)
+	count = int(bindings.SearchKnnFiltered(i.h, query, int32(k), 0, data, uint64(len(data)), kind, labels, distances))
+	if count < 0 {
+		return nil, nil, 0, errors.New("filtered search failed")
+	}
+	return labels[:count], distances[:count], count, nil
+}
+
 // SearchKSimilarity searches for k nearest neighbors and returns cosine similarities (0-1)
 // instead of distances when using cosine space. For other spaces, returns 1-distance.
 func (i *Index) SearchKSimilarity(query []float32, k int) (labels []uint64, similarities []float32, count int) {
@@ -125,23 +424,133 @@ func (i *Index) SearchKSimilarity(query []float32, k int) (labels []uint64, simi
 		return labels, nil, 0
 	}
 
-	similarities = make([]float32, count)
-	if i.normalize {
+	similarities = i.toSimilarities(distances)
+	return labels, similarities, count
+}
+
+// toSimilarities converts search distances into similarities for this index's space.
+func (i *Index) toSimilarities(distances []float32) []float32 {
+	similarities := make([]float32, len(distances))
+	if i.cosine {
 		// For cosine space: similarity = 1 - distance
 		// Since cosine distance = 1 - cosine_similarity
-		for j := 0; j < count; j++ {
+		for j := range distances {
 			similarities[j] = 1.0 - distances[j]
 		}
 	} else {
 		// For other spaces, convert distance to similarity (arbitrary but consistent)
 		// Using simple 1/(1+distance) transformation
-		for j := 0; j < count; j++ {
+		for j := range distances {
 			similarities[j] = 1.0 / (1.0 + distances[j])
 		}
 	}
-	return labels, similarities, count
+	return similarities
+}
+
+// SearchBatch searches the k nearest neighbors of every query in a single native call.
+// Queries are copied into one contiguous matrix and searched on numThreads C++ threads
+// (numThreads <= 0 uses the whole shared pool). labels[q] and distances[q] hold the
+// results for queries[q], closest first.
+func (i *Index) SearchBatch(queries [][]float32, k, numThreads int) (labels [][]uint64, distances [][]float32, err error) {
+	return i.SearchBatchWithEf(queries, k, 0, numThreads)
+}
+
+// SearchBatchWithEf is SearchBatch with a per-call ef, as in SearchKWithEf.
+func (i *Index) SearchBatchWithEf(queries [][]float32, k, ef, numThreads int) (labels [][]uint64, distances [][]float32, err error) {
+	if i == nil || i.h == nil {
+		return nil, nil, errors.New("index is closed")
+	}
+	if k <= 0 {
+		return nil, nil, errors.New("k must be positive")
+	}
+	nq := len(queries)
+	if nq == 0 {
+		return [][]uint64{}, [][]float32{}, nil
+	}
+
+	dim := i.GetDimension()
+	flat := make([]float32, nq*dim)
+	for q, query := range queries {
+		if len(query) != dim {
+			return nil, nil, errors.New("query dimension does not match index dimension")
+		}
+		row := flat[q*dim : (q+1)*dim]
+		copy(row, query)
+	}
+
+	flatLabels := make([]uint64, nq*k)
+	flatDistances := make([]float32, nq*k)
+	counts := make([]int32, nq)
+	if bindings.SearchKnnBatch(i.h, flat, int32(nq), int32(k), int32(ef), flatLabels, flatDistances, counts, int32(numThreads)) != 0 {
+		return nil, nil, errors.New("batch search failed")
+	}
+
+	labels = make([][]uint64, nq)
+	distances = make([][]float32, nq)
+	for q := 0; q < nq; q++ {
+		n := int(counts[q])
+		labels[q] = flatLabels[q*k : q*k+n : q*k+n]
+		distances[q] = flatDistances[q*k : q*k+n : q*k+n]
+	}
+	return labels, distances, nil
+}
+
+// SearchBatchSimilarity is SearchBatch returning similarities instead of distances,
+// using the same conversion as SearchKSimilarity.
+func (i *Index) SearchBatchSimilarity(queries [][]float32, k, numThreads int) (labels [][]uint64, similarities [][]float32, err error) {
+	labels, distances, err := i.SearchBatch(queries, k, numThreads)
+	if err != nil {
+		return nil, nil, err
+	}
+	similarities = make([][]float32, len(distances))
+	for q := range distances {
+		similarities[q] = i.toSimilarities(distances[q])
+	}
+	return labels, similarities, nil
+}
+
+// Train fits the scalar quantizer of an SQ8 index to a representative sample of
+// vectors. It must be called before the first vector is added; for other spaces it is a no-op.
+func (i *Index) Train(sample [][]float32) error {
+	if i == nil || i.h == nil {
+		return errors.New("index is closed")
+	}
+	if i.readOnly {
+		return errReadOnly
+	}
+	if len(sample) == 0 {
+		return errors.New("training sample is empty")
+	}
+
+	dim := i.GetDimension()
+	flat := make([]float32, len(sample)*dim)
+	for r, vec := range sample {
+		if len(vec) != dim {
+			return errors.New("vector dimension does not match index dimension")
+		}
+		row := flat[r*dim : (r+1)*dim]
+		copy(row, vec)
+	}
+
+	if bindings.TrainQuantizer(i.h, flat, uint64(len(sample))) != 0 {
+		return errors.New("failed to train quantizer (index must be empty)")
+	}
+	return nil
+}
+
+// SetRerank makes searches on a quantized index fetch factor*k candidates and reorder
+// them by their distance to the unquantized query, trading speed for accuracy.
+// factor <= 1 disables reranking. It has no effect on float32 indexes.
+func (i *Index) SetRerank(factor int) {
+	if i == nil || i.h == nil {
+		return
+	}
+	bindings.SetRerank(i.h, int32(factor))
 }
 
+// SetEf sets the default size of the dynamic candidate list used by searches.
+// It writes state shared by all searches, so do not call it while searches run;
+// use SearchKWithEf and the other WithEf variants to vary ef per search.
 func (i *Index) SetEf(ef int) {
 	if i == nil || i.h == nil {
 		return
@@ -149,10 +558,23 @@ func (i *Index) SetEf(ef int) {
 	bindings.SetEf(i.h, int32(ef))
 }
 
+// SetPrefetchDistance sets how many neighbors ahead the base-layer search prefetches
+// vectors while computing distances. Larger values hide more memory latency on
+// high-dimensional data with large ef; 0 disables prefetching. The default is 4.
+func (i *Index) SetPrefetchDistance(distance int) {
+	if i == nil || i.h == nil {
+		return
+	}
+	bindings.SetPrefetchDistance(i.h, int32(distance))
+}
+
 func (i *Index) Resize(newMaxElements int) error {
 	if i == nil || i.h == nil {
 		return errors.New("index is closed")
 	}
+	if i.readOnly {
+		return errReadOnly
+	}
 	result := bindings.ResizeIndexSafe(i.h, uint64(newMaxElements))
 	if result != 0 {
 		return errors.New("failed to resize index (new size may be smaller than current count or memory allocation failed)")
@@ -160,6 +582,71 @@ func (i *Index) Resize(newMaxElements int) error {
 	return nil
 }
 
+// Reorder renumbers the stored elements in graph traversal order so that
+// neighbors sit close together in memory, which speeds up searches on indexes
+// larger than the CPU cache. Call it once after bulk loading and before Save;
+// it must not run concurrently with other operations, and invalidates open
+// iterators. Search results are unchanged.
+func (i *Index) Reorder() error {
+	if i == nil || i.h == nil {
+		return errors.New("index is closed")
+	}
+	if i.readOnly {
+		return errReadOnly
+	}
+	if bindings.ReorderIndexSafe(i.h) != 0 {
+		return errors.New("failed to reorder index (memory allocation failed)")
+	}
+	return nil
+}
+
+// CompactStep repairs the graph links of up to batch elements so that they stop
+// routing through deleted elements, and reports whether more work remains. It
+// may run while other goroutines search, but not concurrently with Add,
+// MarkDeleted or other compaction calls. Call it repeatedly until done, then
+// call Compact to remove the deleted elements.
+func (i *Index) CompactStep(batch int) (done bool, err error) {
+	if i == nil || i.h == nil {
+		return false, errors.New("index is closed")
+	}
+	if i.readOnly {
+		return false, errReadOnly
+	}
+	if batch <= 0 {
+		return false, errors.New("batch must be positive")
+	}
+	switch bindings.CompactStepSafe(i.h, uint64(batch)) {
+	case 0:
+		return true, nil
+	case 1:
+		return false, nil
+	default:
+		return false, errors.New("failed to repair links")
+	}
+}
+
+// Compact removes deleted elements from the index, finishing any link repair
+// CompactStep has not done yet. Remaining elements are renumbered and the
+// capacity shrinks to their count. It must not run concurrently with any other operation, and invalidates open
+// iterators.
+func (i *Index) Compact() error {
+	if i == nil || i.h == nil {
+		return errors.New("index is closed")
+	}
+	if i.readOnly {
+		return errReadOnly
+	}
+	if bindings.CompactIndexSafe(i.h) != 0 {
+		return errors.New("failed to compact index")
+	}
+	return nil
+}
+
+// Save writes the index to path. Adds, updates and deletes may continue while it
+// runs: inserts are paused only for the instant the element count is taken, and
+// the file holds the elements present at that instant. The data is written to
+// a uniquely named temporary file next to path, synced and renamed over path,
+// so a crash or a concurrent reader never sees a partially written file.
 func (i *Index) Save(path string) error {
 	if i == nil || i.h == nil {
 		return errors.New("index is closed")
@@ -172,6 +659,35 @@ func (i *Index) Save(path string) error {
 	return nil
 }
 
+// SaveMmap saves the index in the page-aligned layout read by LoadMmap.
+func (i *Index) SaveMmap(path string) error {
+	if i == nil || i.h == nil {
+		return errors.New("index is closed")
+	}
+	pathBytes := []byte(path + "\x00") // null terminate
+	result := bindings.SaveIndexMmapSafe(i.h, pathBytes)
+	if result != 0 {
+		return errors.New("failed to save index (check file permissions and disk space)")
+	}
+	return nil
+}
+
+// SaveMmapPacked is SaveMmap with the neighbor lists sorted and bit-packed, so
+// a mapped index needs less memory; each search decodes the lists it visits.
+// Lists pack tightest after Reorder. An index loaded from such a file cannot be
+// saved again.
+func (i *Index) SaveMmapPacked(path string) error {
+	if i == nil || i.h == nil {
+		return errors.New("index is closed")
+	}
+	pathBytes := []byte(path + "\x00") // null terminate
+	result := bindings.SaveIndexMmapPackedSafe(i.h, pathBytes)
+	if result != 0 {
+		return errors.New("failed to save index (check file permissions and disk space)")
+	}
+	return nil
+}
+
 // Introspection functions
 func (i *Index) GetCurrentCount() int {
 	if i == nil || i.h == nil {
@@ -194,9 +710,24 @@ func (i *Index) GetDeletedCount() int {
 	return int(bindings.GetDeletedCount(i.h))
 }
 
+// GetVisitedListContention returns how many searches had to fall back to the
+// locked path to get a visited list. It should stay near the number of threads
+// that have searched concurrently; steady growth means the pool is contended.
+func (i *Index) GetVisitedListContention() uint64 {
+	if i == nil || i.h == nil {
+		return 0
+	}
+	return bindings.GetVisitedListContention(i.h)
+}
+
+// IsReadOnly returns true if this index was opened with LoadMmap
+func (i *Index) IsReadOnly() bool {
+	return i.readOnly
+}
+
 // IsCosineSpace returns true if this index uses cosine similarity
 func (i *Index) IsCosineSpace() bool {
-	return i.normalize
+	return i.cosine
 }
 
 // Delete management functions
@@ -204,6 +735,9 @@ func (i *Index) MarkDeleted(label uint64) error {
 	if i == nil || i.h == nil {
 		return errors.New("index is closed")
 	}
+	if i.readOnly {
+		return errReadOnly
+	}
 	result := bindings.MarkDeletedSafe(i.h, label)
 	if result != 0 {
 		return errors.New("failed to mark label as deleted (label may not exist)")
@@ -215,6 +749,9 @@ func (i *Index) UnmarkDeleted(label uint64) error {
 	if i == nil || i.h == nil {
 		return errors.New("index is closed")
 	}
+	if i.readOnly {
+		return errReadOnly
+	}
 	result := bindings.UnmarkDeletedSafe(i.h, label)
 	if result != 0 {
 		return errors.New("failed to unmark label as deleted (label may not exist)")
@@ -222,6 +759,45 @@ func (i *Index) UnmarkDeleted(label uint64) error {
 	return nil
 }
 
+// SetExecutorThreads resizes the native thread pool that AddBatch, SearchBatch,
+// BuildFromFile and Compact of every index in the process schedule onto, so
+// several indexes can work in parallel without oversubscribing the cores.
+// numThreads <= 0 uses all hardware threads (the default). With pinThreads,
+// worker i is pinned to core i (Linux only). Calls in progress are not affected.
+func SetExecutorThreads(numThreads int, pinThreads bool) error {
+	var pin int32
+	if pinThreads {
+		pin = 1
+	}
+	if bindings.SetExecutorThreads(int32(numThreads), pin) != 0 {
+		return errors.New("failed to resize the thread pool")
+	}
+	return nil
+}
+
+// ExecutorThreads returns the number of threads of the native thread pool.
+func ExecutorThreads() int {
+	return int(bindings.GetExecutorThreads())
+}
+
+// SIMDLevel reports the instruction set of the distance kernels selected at runtime
+// on this CPU: "avx512", "avx2+fma", "sse", "neon", or "scalar" when SIMD is disabled.
+// Indexes with fewer than 4 dimensions always use the scalar kernel.
+func SIMDLevel() string {
+	switch bindings.GetSimdLevel() {
+	case 1:
+		return "sse"
+	case 2:
+		return "avx2+fma"
+	case 3:
+		return "avx512"
+	case 4:
+		return "neon"
+	default:
+		return "scalar"
+	}
+}
+
 // Helper constructors for common use cases
 func NewL2(dim, maxElements, M, efConstruction, seed int) *Index {
 	return New(SpaceL2, dim, maxElements, M, efConstruction, seed)
@@ -0,0 +1,241 @@
+package hnsw_test
+
+import (
+	"os"
+	"path/filepath"
+	"sync"
+	"sync/atomic"
+	"testing"
+
+	"github.com/viktordanov/go-hnswlib/hnsw"
+)
+
+func TestLoadMmapMatchesIndex(t *testing.T) {
+	vectors := randomVectors(2000, 24, 1)
+	index := hnsw.New(hnsw.SpaceCosine, 24, 2000, 16, 200, 42)
+	defer index.Close()
+	for i, vec := range vectors {
+		index.Add(vec, uint64(i))
+	}
+	index.MarkDeleted(7)
+
+	path := filepath.Join(t.TempDir(), "index.mmap")
+	if err := index.SaveMmap(path); err != nil {
+		t.Fatalf("SaveMmap failed: %v", err)
+	}
+	mapped, err := hnsw.LoadMmap(hnsw.SpaceCosine, 24, path)
+	if err != nil {
+		t.Fatalf("LoadMmap failed: %v", err)
+	}
+	defer mapped.Close()
+
+	if !mapped.IsReadOnly() {
+		t.Error("expected mapped index to be read-only")
+	}
+	if mapped.GetCurrentCount() != 2000 || mapped.GetDeletedCount() != 1 {
+		t.Errorf("expected 2000 elements with 1 deleted, got %d/%d", mapped.GetCurrentCount(), mapped.GetDeletedCount())
+	}
+
+	index.SetEf(50)
+	mapped.SetEf(50)
+	for _, query := range randomVectors(50, 24, 2) {
+		wantLabels, wantDistances, wantCount := index.SearchK(query, 10)
+		gotLabels, gotDistances, count := mapped.SearchK(query, 10)
+		if count != wantCount {
+			t.Fatalf("expected %d results, got %d", wantCount, count)
+		}
+		for j := 0; j < count; j++ {
+			if gotLabels[j] != wantLabels[j] || gotDistances[j] != wantDistances[j] {
+				t.Fatalf("result %d differs: (%d, %f) vs (%d, %f)", j, gotLabels[j], gotDistances[j], wantLabels[j], wantDistances[j])
+			}
+		}
+	}
+
+	want, _ := index.GetVector(3)
+	got, err := mapped.GetVector(3)
+	if err != nil {
+		t.Fatalf("GetVector failed: %v", err)
+	}
+	for j := range want {
+		if got[j] != want[j] {
+			t.Fatalf("component %d: got %f, want %f", j, got[j], want[j])
+		}
+	}
+}
+
+func TestLoadMmapIsReadOnly(t *testing.T) {
+	index := hnsw.NewL2(4, 10, 16, 200, 42)
+	defer index.Close()
+	index.Add([]float32{1, 2, 3, 4}, 1)
+
+	path := filepath.Join(t.TempDir(), "index.mmap")
+	if err := index.SaveMmap(path); err != nil {
+		t.Fatalf("SaveMmap failed: %v", err)
+	}
+	mapped, err := hnsw.LoadMmap(hnsw.SpaceL2, 4, path)
+	if err != nil {
+		t.Fatalf("LoadMmap failed: %v", err)
+	}
+	defer mapped.Close()
+
+	if err := mapped.Add([]float32{1, 1, 1, 1}, 2); err == nil {
+		t.Error("expected Add to fail on a mapped index")
+	}
+	if err := mapped.MarkDeleted(1); err == nil {
+		t.Error("expected MarkDeleted to fail on a mapped index")
+	}
+	if err := mapped.Resize(100); err == nil {
+		t.Error("expected Resize to fail on a mapped index")
+	}
+	if _, err := hnsw.LoadMmap(hnsw.SpaceL2, 8, path); err == nil {
+		t.Error("expected LoadMmap to reject a dimension mismatch")
+	}
+}
+
+func TestLoadMmapRejectsRegularFormat(t *testing.T) {
+	index := hnsw.NewL2(4, 10, 16, 200, 42)
+	defer index.Close()
+	index.Add([]float32{1, 2, 3, 4}, 1)
+
+	path := filepath.Join(t.TempDir(), "index.bin")
+	index.Save(path)
+	if _, err := hnsw.LoadMmap(hnsw.SpaceL2, 4, path); err == nil {
+		t.Error("expected LoadMmap to reject a file written by Save")
+	}
+}
+
+func TestLoadMmapPackedLinks(t *testing.T) {
+	const n, dim = 5000, 8
+	vectors := randomVectors(n, dim, 3)
+	index := hnsw.New(hnsw.SpaceL2, dim, n, 16, 200, 42)
+	defer index.Close()
+	if err := index.AddBatch(vectors, sequentialLabels(n), 0); err != nil {
+		t.Fatal(err)
+	}
+	index.MarkDeleted(11)
+	if err := index.Reorder(); err != nil {
+		t.Fatal(err)
+	}
+
+	dir := t.TempDir()
+	plainPath, packedPath := filepath.Join(dir, "plain.mmap"), filepath.Join(dir, "packed.mmap")
+	if err := index.SaveMmap(plainPath); err != nil {
+		t.Fatalf("SaveMmap failed: %v", err)
+	}
+	if err := index.SaveMmapPacked(packedPath); err != nil {
+		t.Fatalf("SaveMmapPacked failed: %v", err)
+	}
+	plainInfo, _ := os.Stat(plainPath)
+	packedInfo, _ := os.Stat(packedPath)
+	if packedInfo.Size() >= plainInfo.Size()*3/4 {
+		t.Errorf("packed file has %d bytes, plain %d", packedInfo.Size(), plainInfo.Size())
+	}
+
+	mapped, err := hnsw.LoadMmap(hnsw.SpaceL2, dim, packedPath)
+	if err != nil {
+		t.Fatalf("LoadMmap failed: %v", err)
+	}
+	defer mapped.Close()
+	if mapped.GetCurrentCount() != n || mapped.GetDeletedCount() != 1 {
+		t.Errorf("expected %d elements with 1 deleted, got %d/%d", n, mapped.GetCurrentCount(), mapped.GetDeletedCount())
+	}
+	if err := mapped.SaveMmap(filepath.Join(dir, "again.mmap")); err == nil {
+		t.Error("expected saving an index loaded from packed lists to fail")
+	}
+
+	// lists are visited in another order, so ties may resolve differently
+	index.SetEf(64)
+	mapped.SetEf(64)
+	same, total := 0, 0
+	for _, query := range randomVectors(100, dim, 4) {
+		wantLabels, _, _ := index.SearchK(query, 10)
+		gotLabels, _, count := mapped.SearchK(query, 10)
+		if count != 10 {
+			t.Fatalf("expected 10 results, got %d", count)
+		}
+		want := make(map[uint64]bool)
+		for _, label := range wantLabels {
+			want[label] = true
+		}
+		for _, label := range gotLabels {
+			if label == 11 {
+				t.Fatal("deleted label returned")
+			}
+			if want[label] {
+				same++
+			}
+			total++
+		}
+	}
+	if float64(same) < 0.98*float64(total) {
+		t.Errorf("packed index agrees on %d of %d results", same, total)
+	}
+}
+
+func TestSaveMmapOverMappedFileUnderInserts(t *testing.T) {
+	const dim, total, writers = 8, 4000, 4
+	index := hnsw.New(hnsw.SpaceL2, dim, total, 8, 40, 42)
+	defer index.Close()
+	vectors := randomVectors(total, dim, 1)
+	for i := 0; i < total/2; i++ {
+		index.Add(vectors[i], uint64(i))
+	}
+	path := filepath.Join(t.TempDir(), "index.mmap")
+	if err := index.SaveMmap(path); err != nil {
+		t.Fatalf("SaveMmap failed: %v", err)
+	}
+	mapped, err := hnsw.LoadMmap(hnsw.SpaceL2, dim, path)
+	if err != nil {
+		t.Fatalf("LoadMmap failed: %v", err)
+	}
+	defer mapped.Close()
+
+	var stop atomic.Bool
+	var wg sync.WaitGroup
+	for w := 0; w < writers; w++ {
+		wg.Add(1)
+		go func(w int) {
+			defer wg.Done()
+			for n := total/2 + w; !stop.Load(); n += writers {
+				index.Add(vectors[n%total], uint64(n%total))
+			}
+		}(w)
+	}
+	defer func() {
+		stop.Store(true)
+		wg.Wait()
+	}()
+
+	queries := randomVectors(20, dim, 2)
+	for s := 0; s < 4; s++ {
+		save := index.SaveMmap
+		if s%2 == 1 {
+			save = index.SaveMmapPacked
+		}
+		if err := save(path); err != nil {
+			t.Fatalf("save %d failed: %v", s, err)
+		}
+		// the mapping still reads the file it was opened on
+		for _, query := range queries {
+			if _, _, count := mapped.SearchK(query, 10); count != 10 {
+				t.Fatalf("mapped search after save %d returned %d results", s, count)
+			}
+		}
+		loaded, err := hnsw.LoadMmap(hnsw.SpaceL2, dim, path)
+		if err != nil {
+			t.Fatalf("loading save %d failed: %v", s, err)
+		}
+		if count := loaded.GetCurrentCount(); count < total/2 || count > total {
+			t.Errorf("save %d holds %d elements", s, count)
+		}
+		for _, query := range queries {
+			if _, _, count := loaded.SearchK(query, 10); count != 10 {
+				t.Errorf("search of save %d returned %d results", s, count)
+			}
+		}
+		loaded.Close()
+	}
+	if matches, _ := filepath.Glob(path + ".tmp*"); len(matches) != 0 {
+		t.Errorf("temporary files left behind: %v", matches)
+	}
+}
@@ -0,0 +1,76 @@
+package hnsw
+
+import (
+	"errors"
+
+	bindings "github.com/viktordanov/go-hnswlib"
+)
+
+// NumaNodes returns the number of NUMA nodes with cpus, 1 on hosts without NUMA
+// (and on platforms other than Linux).
+func NumaNodes() int {
+	return int(bindings.GetNumaNodes())
+}
+
+// SetExecutorNodes is SetExecutorThreads with the workers spread round-robin over
+// the given NUMA nodes (nil means all nodes) and pinned to their cpus, so batch
+// calls stay on those sockets. numThreads <= 0 uses every cpu of the nodes.
+func SetExecutorNodes(numThreads int, nodes []int) error {
+	var mask uint64
+	for _, node := range nodes {
+		if node < 0 || node >= NumaNodes() || node >= 64 {
+			return errors.New("no such NUMA node")
+		}
+		mask |= 1 << uint(node)
+	}
+	if bindings.SetExecutorNodes(int32(numThreads), mask) != 0 {
+		return errors.New("failed to resize the thread pool")
+	}
+	return nil
+}
+
+// SetNumaInterleave controls whether index storage allocated from now on is
+// interleaved across all NUMA nodes, so a graph searched from every socket is
+// not served from the memory of one. It is on by default and only has an
+// effect on hosts with several nodes.
+func SetNumaInterleave(enabled bool) {
+	var flag int32
+	if enabled {
+		flag = 1
+	}
+	bindings.SetNumaInterleave(flag)
+}
+
+// Replicate gives an index opened with LoadMmap a private copy of its file in
+// the memory of each NUMA node; searches then read the copy of the node they
+// run on instead of crossing the interconnect. It costs one file's size of
+// memory per node. Call it before searching from other goroutines.
+func (i *Index) Replicate() error {
+	if i == nil || i.h == nil {
+		return errors.New("index is closed")
+	}
+	if bindings.ReplicateIndex(i.h) < 0 {
+		return errors.New("failed to replicate index (was it opened with LoadMmap, and only once replicated?)")
+	}
+	return nil
+}
+
+// StartSearchQueueOnNode is StartSearchQueue with the workers pinned to the cpus
+// of one NUMA node; workers <= 0 starts one per cpu of the node. Together with
+// Replicate, a queue per node keeps its searches in local memory.
+func (i *Index) StartSearchQueueOnNode(workers, capacity, maxK, node int) error {
+	if i == nil || i.h == nil {
+		return errors.New("index is closed")
+	}
+	if capacity <= 0 || maxK <= 0 {
+		return errors.New("capacity and maxK must be positive")
+	}
+	if node < 0 || node >= NumaNodes() {
+		return errors.New("no such NUMA node")
+	}
+	if bindings.StartSearchQueueOnNode(i.h, int32(workers), int32(capacity), int32(maxK), int32(node)) != 0 {
+		return errors.New("failed to start search queue (is it already running?)")
+	}
+	i.queueMaxK = maxK
+	return nil
+}
@@ -0,0 +1,104 @@
+package hnsw_test
+
+import (
+	"path/filepath"
+	"testing"
+	"time"
+
+	"github.com/viktordanov/go-hnswlib/hnsw"
+)
+
+func TestReplicateMatchesMapped(t *testing.T) {
+	if hnsw.NumaNodes() < 1 {
+		t.Fatalf("expected at least one NUMA node, got %d", hnsw.NumaNodes())
+	}
+	vectors := randomVectors(2000, 16, 1)
+	index := hnsw.NewL2(16, 2000, 16, 200, 42)
+	defer index.Close()
+	for i, vec := range vectors {
+		index.Add(vec, uint64(i))
+	}
+	if err := index.Replicate(); err == nil {
+		t.Error("expected Replicate to fail on an index that is not mapped")
+	}
+
+	path := filepath.Join(t.TempDir(), "index.mmap")
+	if err := index.SaveMmap(path); err != nil {
+		t.Fatalf("SaveMmap failed: %v", err)
+	}
+	mapped, err := hnsw.LoadMmap(hnsw.SpaceL2, 16, path)
+	if err != nil {
+		t.Fatalf("LoadMmap failed: %v", err)
+	}
+	defer mapped.Close()
+	mapped.SetEf(50)
+	queries := randomVectors(50, 16, 2)
+	want := make([][]uint64, len(queries))
+	for q, query := range queries {
+		want[q], _, _ = mapped.SearchK(query, 10)
+	}
+
+	if err := mapped.Replicate(); err != nil {
+		t.Fatalf("Replicate failed: %v", err)
+	}
+	if err := mapped.Replicate(); err == nil {
+		t.Error("expected a second Replicate to fail")
+	}
+	for q, query := range queries {
+		got, _, count := mapped.SearchK(query, 10)
+		if count != len(want[q]) {
+			t.Fatalf("query %d: expected %d results, got %d", q, len(want[q]), count)
+		}
+		for j := range got {
+			if got[j] != want[q][j] {
+				t.Fatalf("query %d result %d: got label %d, want %d", q, j, got[j], want[q][j])
+			}
+		}
+	}
+
+	if err := mapped.StartSearchQueueOnNode(2, 16, 10, 0); err != nil {
+		t.Fatalf("StartSearchQueueOnNode failed: %v", err)
+	}
+	defer mapped.StopSearchQueue()
+	if n, err := mapped.SubmitSearch(queries[:1], 10, []uint64{0}); err != nil || n != 1 {
+		t.Fatalf("SubmitSearch failed: %d, %v", n, err)
+	}
+	results, err := mapped.PollSearchResults(1, time.Second)
+	if err != nil || len(results) != 1 || results[0].Err != nil {
+		t.Fatalf("PollSearchResults failed: %v, %v", results, err)
+	}
+	for j, label := range results[0].Labels {
+		if label != want[0][j] {
+			t.Fatalf("queued result %d: got label %d, want %d", j, label, want[0][j])
+		}
+	}
+}
+
+func TestSetExecutorNodes(t *testing.T) {
+	if err := hnsw.SetExecutorNodes(2, nil); err != nil {
+		t.Fatalf("SetExecutorNodes failed: %v", err)
+	}
+	defer hnsw.SetExecutorThreads(0, false)
+	if n := hnsw.ExecutorThreads(); n != 2 {
+		t.Fatalf("expected 2 executor threads, got %d", n)
+	}
+	if err := hnsw.SetExecutorNodes(0, []int{hnsw.NumaNodes()}); err == nil {
+		t.Error("expected SetExecutorNodes to reject a missing node")
+	}
+
+	vectors := randomVectors(500, 8, 3)
+	index := hnsw.NewL2(8, 500, 16, 100, 42)
+	defer index.Close()
+	for i, vec := range vectors {
+		index.Add(vec, uint64(i))
+	}
+	found, _, err := index.SearchBatch(vectors[:20], 1, 0)
+	if err != nil {
+		t.Fatalf("SearchBatch failed: %v", err)
+	}
+	for q := range found {
+		if len(found[q]) != 1 || found[q][0] != uint64(q) {
+			t.Errorf("query %d: expected label %d, got %v", q, q, found[q])
+		}
+	}
+}
@@ -0,0 +1,176 @@
+package hnsw_test
+
+import (
+	"math"
+	"path/filepath"
+	"testing"
+
+	"github.com/viktordanov/go-hnswlib/hnsw"
+)
+
+// recallAt1 returns the fraction of queries whose top result matches the exact float32 index.
+func recallAt1(t *testing.T, index, exact *hnsw.Index, queries [][]float32) float64 {
+	t.Helper()
+	hits := 0
+	for _, query := range queries {
+		got, _, count := index.SearchK(query, 1)
+		want, _, _ := exact.SearchK(query, 1)
+		if count == 1 && got[0] == want[0] {
+			hits++
+		}
+	}
+	return float64(hits) / float64(len(queries))
+}
+
+func TestQuantizedSpacesRecall(t *testing.T) {
+	vectors := randomVectors(1000, 64, 1)
+	queries := randomVectors(100, 64, 2)
+
+	cases := []struct {
+		space, exact hnsw.Space
+		minRecall    float64
+	}{
+		{hnsw.SpaceL2SQ8, hnsw.SpaceL2, 0.8},
+		{hnsw.SpaceIPSQ8, hnsw.SpaceIP, 0.8},
+		{hnsw.SpaceCosineSQ8, hnsw.SpaceCosine, 0.8},
+		{hnsw.SpaceL2FP16, hnsw.SpaceL2, 0.95},
+		{hnsw.SpaceIPFP16, hnsw.SpaceIP, 0.95},
+		{hnsw.SpaceCosineFP16, hnsw.SpaceCosine, 0.95},
+	}
+	for _, c := range cases {
+		exact := hnsw.New(c.exact, 64, 1000, 16, 200, 42)
+		defer exact.Close()
+		index := hnsw.New(c.space, 64, 1000, 16, 200, 42)
+		defer index.Close()
+
+		if err := index.Train(vectors); err != nil {
+			t.Fatalf("space %c: Train failed: %v", c.space, err)
+		}
+		for i, vec := range vectors {
+			exact.Add(vec, uint64(i))
+			if err := index.Add(vec, uint64(i)); err != nil {
+				t.Fatalf("space %c: Add failed: %v", c.space, err)
+			}
+		}
+		exact.SetEf(200)
+		index.SetEf(200)
+
+		if recall := recallAt1(t, index, exact, queries); recall < c.minRecall {
+			t.Errorf("space %c: recall@1 %.2f below %.2f", c.space, recall, c.minRecall)
+		}
+	}
+}
+
+func TestSQ8RequiresTraining(t *testing.T) {
+	index := hnsw.New(hnsw.SpaceL2SQ8, 8, 100, 16, 200, 42)
+	defer index.Close()
+
+	if err := index.Add(make([]float32, 8), 1); err == nil {
+		t.Error("expected error adding to an untrained SQ8 index, got nil")
+	}
+
+	vectors := randomVectors(10, 8, 1)
+	if err := index.Train(vectors); err != nil {
+		t.Fatalf("Train failed: %v", err)
+	}
+	if err := index.Add(vectors[0], 1); err != nil {
+		t.Fatalf("Add failed after training: %v", err)
+	}
+	if err := index.Train(vectors); err == nil {
+		t.Error("expected error retraining a non-empty index, got nil")
+	}
+}
+
+func TestQuantizedGetVector(t *testing.T) {
+	vectors := randomVectors(50, 20, 3)
+	for _, c := range []struct {
+		space     hnsw.Space
+		tolerance float64
+	}{
+		{hnsw.SpaceL2SQ8, 1.0 / 255},
+		{hnsw.SpaceL2FP16, 1e-3},
+	} {
+		index := hnsw.New(c.space, 20, 100, 16, 200, 42)
+		defer index.Close()
+		index.Train(vectors)
+		for i, vec := range vectors {
+			index.Add(vec, uint64(i))
+		}
+
+		for i, vec := range vectors {
+			got, err := index.GetVector(uint64(i))
+			if err != nil {
+				t.Fatalf("space %c: GetVector failed: %v", c.space, err)
+			}
+			for j := range vec {
+				if diff := math.Abs(float64(got[j] - vec[j])); diff > c.tolerance {
+					t.Fatalf("space %c: vector %d component %d decoded as %f, want %f", c.space, i, j, got[j], vec[j])
+				}
+			}
+		}
+	}
+}
+
+func TestSQ8Rerank(t *testing.T) {
+	vectors := randomVectors(500, 32, 4)
+	query := randomVectors(1, 32, 5)[0]
+
+	index := hnsw.New(hnsw.SpaceL2SQ8, 32, 500, 16, 200, 42)
+	defer index.Close()
+	index.Train(vectors)
+	for i, vec := range vectors {
+		index.Add(vec, uint64(i))
+	}
+
+	index.SetRerank(4)
+	labels, distances, count := index.SearchK(query, 10)
+	if count != 10 {
+		t.Fatalf("expected 10 results, got %d", count)
+	}
+	for j := 0; j < count; j++ {
+		if j > 0 && distances[j] < distances[j-1] {
+			t.Errorf("reranked results not sorted at %d", j)
+		}
+		// Reranked distances are computed from the float query to the decoded vector.
+		decoded, _ := index.GetVector(labels[j])
+		var want float32
+		for d := range query {
+			diff := query[d] - decoded[d]
+			want += diff * diff
+		}
+		if math.Abs(float64(want-distances[j])) > 1e-4 {
+			t.Errorf("result %d: distance %f, want %f", j, distances[j], want)
+		}
+	}
+}
+
+func TestSQ8SaveLoad(t *testing.T) {
+	vectors := randomVectors(200, 16, 6)
+	index := hnsw.New(hnsw.SpaceCosineSQ8, 16, 200, 16, 200, 42)
+	defer index.Close()
+	index.Train(vectors)
+	for i, vec := range vectors {
+		index.Add(vec, uint64(i))
+	}
+
+	path := filepath.Join(t.TempDir(), "sq8.bin")
+	if err := index.Save(path); err != nil {
+		t.Fatalf("Save failed: %v", err)
+	}
+	loaded, err := hnsw.Load(hnsw.SpaceCosineSQ8, 16, path)
+	if err != nil {
+		t.Fatalf("Load failed: %v", err)
+	}
+	defer loaded.Close()
+
+	for _, query := range vectors[:20] {
+		wantLabels, wantDistances, _ := index.SearchK(query, 5)
+		gotLabels, gotDistances, count := loaded.SearchK(query, 5)
+		for j := 0; j < count; j++ {
+			if gotLabels[j] != wantLabels[j] || gotDistances[j] != wantDistances[j] {
+				t.Fatalf("loaded index result %d differs: (%d, %f) vs (%d, %f)",
+					j, gotLabels[j], gotDistances[j], wantLabels[j], wantDistances[j])
+			}
+		}
+	}
+}
@@ -0,0 +1,133 @@
+package hnsw
+
+import (
+	"errors"
+	"time"
+
+	bindings "github.com/viktordanov/go-hnswlib"
+)
+
+// SearchResult is a search completed by the search queue.
+type SearchResult struct {
+	Ticket    uint64 // ticket the query was submitted with
+	Labels    []uint64
+	Distances []float32
+	Err       error // set if the search failed
+}
+
+// StartSearchQueue starts a fixed pool of workers (workers <= 0 uses all hardware
+// threads) that serve searches queued by SubmitSearch, so bursts of concurrent
+// requests do not each pin an OS thread inside a native call. Up to capacity
+// searches of at most maxK results each can be queued or waiting to be polled.
+func (i *Index) StartSearchQueue(workers, capacity, maxK int) error {
+	if i == nil || i.h == nil {
+		return errors.New("index is closed")
+	}
+	if capacity <= 0 || maxK <= 0 {
+		return errors.New("capacity and maxK must be positive")
+	}
+	if bindings.StartSearchQueue(i.h, int32(workers), int32(capacity), int32(maxK)) != 0 {
+		return errors.New("failed to start search queue (is it already running?)")
+	}
+	i.queueMaxK = maxK
+	return nil
+}
+
+// StopSearchQueue stops the workers, drops searches that are still queued and
+// wakes goroutines blocked in PollSearchResults. Close stops the queue as well.
+func (i *Index) StopSearchQueue() {
+	if i == nil || i.h == nil {
+		return
+	}
+	bindings.StopSearchQueue(i.h)
+}
+
+// SubmitSearch queues a search of the k nearest neighbors of each query, to be
+// reported by PollSearchResults under the matching ticket. It does not wait for
+// the searches and queries may be reused as soon as it returns. It returns how
+// many leading queries were accepted; fewer than len(queries) means the queue is full.
+func (i *Index) SubmitSearch(queries [][]float32, k int, tickets []uint64) (int, error) {
+	return i.SubmitSearchWithEf(queries, k, 0, tickets)
+}
+
+// SubmitSearchWithEf is SubmitSearch with a per-search ef, as in SearchKWithEf.
+// The ef in effect is the one given here, not SetEf at the time the search runs.
+func (i *Index) SubmitSearchWithEf(queries [][]float32, k, ef int, tickets []uint64) (int, error) {
+	if i == nil || i.h == nil {
+		return 0, errors.New("index is closed")
+	}
+	if len(queries) != len(tickets) {
+		return 0, errors.New("queries and tickets must have the same length")
+	}
+	if k <= 0 || k > i.queueMaxK {
+		return 0, errors.New("k must be positive and at most the queue's maxK")
+	}
+	if len(queries) == 0 {
+		return 0, nil
+	}
+
+	dim := i.GetDimension()
+	var flat []float32
+	if len(queries) == 1 {
+		flat = queries[0]
+		if len(flat) != dim {
+			return 0, errors.New("query dimension does not match index dimension")
+		}
+	} else {
+		flat = make([]float32, len(queries)*dim)
+		for q, query := range queries {
+			if len(query) != dim {
+				return 0, errors.New("query dimension does not match index dimension")
+			}
+			copy(flat[q*dim:(q+1)*dim], query)
+		}
+	}
+
+	accepted := bindings.SubmitSearch(i.h, flat, int32(len(queries)), int32(k), int32(ef), tickets)
+	if accepted < 0 {
+		return 0, errors.New("search queue is not running")
+	}
+	return int(accepted), nil
+}
+
+// PollSearchResults returns up to maxResults completed searches in completion
+// order, waiting up to timeout for the first one (timeout < 0 waits until a
+// search completes or the queue is stopped). An empty result means none completed
+// in time. A single goroutine draining results in batches keeps the number of
+// threads blocked in native code at one.
+func (i *Index) PollSearchResults(maxResults int, timeout time.Duration) ([]SearchResult, error) {
+	if i == nil || i.h == nil {
+		return nil, errors.New("index is closed")
+	}
+	if maxResults <= 0 {
+		return nil, errors.New("maxResults must be positive")
+	}
+	timeoutMs := int32(-1)
+	if timeout >= 0 {
+		timeoutMs = int32(timeout / time.Millisecond)
+	}
+
+	maxK := i.queueMaxK
+	tickets := make([]uint64, maxResults)
+	counts := make([]int32, maxResults)
+	labels := make([]uint64, maxResults*maxK)
+	distances := make([]float32, maxResults*maxK)
+	n := bindings.PollSearchResults(i.h, tickets, counts, labels, distances, int32(maxResults), timeoutMs)
+	if n < 0 {
+		return nil, errors.New("search queue is not running")
+	}
+
+	results := make([]SearchResult, n)
+	for r := range results {
+		results[r].Ticket = tickets[r]
+		count := int(counts[r])
+		if count < 0 {
+			results[r].Err = errors.New("search failed")
+			continue
+		}
+		base := r * maxK
+		results[r].Labels = labels[base : base+count : base+count]
+		results[r].Distances = distances[base : base+count : base+count]
+	}
+	return results, nil
+}
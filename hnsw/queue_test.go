@@ -0,0 +1,147 @@
+package hnsw_test
+
+import (
+	"sync"
+	"testing"
+	"time"
+
+	"github.com/viktordanov/go-hnswlib/hnsw"
+)
+
+func TestSearchQueueMatchesSearchK(t *testing.T) {
+	index := hnsw.NewCosine(16, 1000, 16, 200, 42)
+	defer index.Close()
+	for i, vec := range randomVectors(1000, 16, 1) {
+		index.Add(vec, uint64(i))
+	}
+	if err := index.StartSearchQueue(3, 64, 10); err != nil {
+		t.Fatalf("StartSearchQueue failed: %v", err)
+	}
+	defer index.StopSearchQueue()
+
+	queries := randomVectors(200, 16, 2)
+	var wg sync.WaitGroup
+	for g := 0; g < 4; g++ {
+		wg.Add(1)
+		go func(g int) {
+			defer wg.Done()
+			for q := g; q < len(queries); q += 4 {
+				for {
+					n, err := index.SubmitSearch(queries[q:q+1], 10, []uint64{uint64(q)})
+					if err != nil {
+						t.Errorf("SubmitSearch failed: %v", err)
+						return
+					}
+					if n == 1 {
+						break
+					}
+					time.Sleep(time.Millisecond) // queue full, wait for the poller
+				}
+			}
+		}(g)
+	}
+
+	seen := make(map[uint64]bool)
+	for len(seen) < len(queries) {
+		results, err := index.PollSearchResults(16, time.Second)
+		if err != nil {
+			t.Fatalf("PollSearchResults failed: %v", err)
+		}
+		if len(results) == 0 {
+			t.Fatalf("timed out with %d of %d results", len(seen), len(queries))
+		}
+		for _, r := range results {
+			if r.Err != nil || seen[r.Ticket] {
+				t.Fatalf("ticket %d: unexpected result (err %v, duplicate %v)", r.Ticket, r.Err, seen[r.Ticket])
+			}
+			seen[r.Ticket] = true
+			labels, distances, count := index.SearchK(queries[r.Ticket], 10)
+			if len(r.Labels) != count {
+				t.Fatalf("ticket %d: expected %d results, got %d", r.Ticket, count, len(r.Labels))
+			}
+			for j := range labels {
+				if r.Labels[j] != labels[j] || r.Distances[j] != distances[j] {
+					t.Errorf("ticket %d result %d: got (%d, %f), want (%d, %f)",
+						r.Ticket, j, r.Labels[j], r.Distances[j], labels[j], distances[j])
+				}
+			}
+		}
+	}
+	wg.Wait()
+}
+
+func TestSearchQueueBackpressure(t *testing.T) {
+	index := hnsw.NewL2(4, 100, 16, 200, 42)
+	defer index.Close()
+	for i, vec := range randomVectors(100, 4, 1) {
+		index.Add(vec, uint64(i))
+	}
+	if err := index.StartSearchQueue(1, 4, 5); err != nil {
+		t.Fatalf("StartSearchQueue failed: %v", err)
+	}
+	if err := index.StartSearchQueue(1, 4, 5); err == nil {
+		t.Error("expected error when starting a running queue")
+	}
+
+	// Slots are only freed by polling, so the batch is cut at the capacity.
+	queries := randomVectors(10, 4, 2)
+	tickets := []uint64{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}
+	n, err := index.SubmitSearch(queries, 5, tickets)
+	if err != nil || n != 4 {
+		t.Fatalf("expected 4 accepted queries, got %d (%v)", n, err)
+	}
+	if _, err := index.SubmitSearch(queries[:1], 6, tickets[:1]); err == nil {
+		t.Error("expected error for k above maxK")
+	}
+
+	got := 0
+	for got < 4 {
+		results, err := index.PollSearchResults(10, time.Second)
+		if err != nil || len(results) == 0 {
+			t.Fatalf("PollSearchResults failed after %d results: %v", got, err)
+		}
+		for _, r := range results {
+			if len(r.Labels) != 5 {
+				t.Errorf("ticket %d: expected 5 results, got %d", r.Ticket, len(r.Labels))
+			}
+		}
+		got += len(results)
+	}
+	if results, _ := index.PollSearchResults(10, 0); len(results) != 0 {
+		t.Errorf("expected no more results, got %d", len(results))
+	}
+	if n, _ := index.SubmitSearch(queries[4:], 5, tickets[4:]); n != 4 {
+		t.Errorf("expected freed slots to accept 4 queries, got %d", n)
+	}
+}
+
+func TestSearchQueueStopWakesPoller(t *testing.T) {
+	index := hnsw.NewL2(4, 10, 16, 200, 42)
+	defer index.Close()
+	if _, err := index.PollSearchResults(1, 0); err == nil {
+		t.Error("expected error when polling without a queue")
+	}
+	if err := index.StartSearchQueue(2, 8, 5); err != nil {
+		t.Fatalf("StartSearchQueue failed: %v", err)
+	}
+
+	done := make(chan struct{})
+	go func() {
+		index.PollSearchResults(1, -1)
+		close(done)
+	}()
+	time.Sleep(20 * time.Millisecond)
+	index.StopSearchQueue()
+	select {
+	case <-done:
+	case <-time.After(5 * time.Second):
+		t.Fatal("StopSearchQueue did not wake the poller")
+	}
+
+	if _, err := index.SubmitSearch(randomVectors(1, 4, 1), 5, []uint64{1}); err == nil {
+		t.Error("expected error when submitting to a stopped queue")
+	}
+	if err := index.StartSearchQueue(1, 8, 5); err != nil {
+		t.Errorf("expected a stopped queue to restart: %v", err)
+	}
+}
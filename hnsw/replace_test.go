@@ -0,0 +1,104 @@
+package hnsw_test
+
+import (
+	"path/filepath"
+	"testing"
+
+	"github.com/viktordanov/go-hnswlib/hnsw"
+)
+
+func TestAddReplaceKeepsSizeUnderChurn(t *testing.T) {
+	index := hnsw.NewWithOptions(hnsw.SpaceL2, 16, 100, 16, 200, 42, hnsw.Options{AllowReplaceDeleted: true})
+	defer index.Close()
+	vectors := randomVectors(400, 16, 1)
+	for i := 0; i < 100; i++ {
+		if err := index.AddReplace(vectors[i], uint64(i)); err != nil {
+			t.Fatalf("AddReplace failed: %v", err)
+		}
+	}
+
+	// Replace every element three times over without ever resizing.
+	for i := 100; i < len(vectors); i++ {
+		if err := index.MarkDeleted(uint64(i - 100)); err != nil {
+			t.Fatalf("MarkDeleted failed: %v", err)
+		}
+		if err := index.AddReplace(vectors[i], uint64(i)); err != nil {
+			t.Fatalf("AddReplace %d failed: %v", i, err)
+		}
+	}
+	if index.GetCurrentCount() != 100 || index.GetMaxElements() != 100 || index.GetDeletedCount() != 0 {
+		t.Errorf("expected 100/100 elements with none deleted, got %d/%d with %d deleted",
+			index.GetCurrentCount(), index.GetMaxElements(), index.GetDeletedCount())
+	}
+
+	index.SetEf(100)
+	for i := 300; i < len(vectors); i++ {
+		if labels, _, count := index.SearchK(vectors[i], 1); count != 1 || labels[0] != uint64(i) {
+			t.Fatalf("expected label %d to find itself, got %v", i, labels)
+		}
+	}
+	if _, err := index.GetVector(0); err == nil {
+		t.Error("expected replaced label 0 to be gone")
+	}
+}
+
+func TestAddReplaceUpdatesExistingLabel(t *testing.T) {
+	index := hnsw.NewWithOptions(hnsw.SpaceL2, 4, 10, 16, 200, 42, hnsw.Options{AllowReplaceDeleted: true})
+	defer index.Close()
+	index.AddReplace([]float32{1, 0, 0, 0}, 1)
+	index.AddReplace([]float32{0, 1, 0, 0}, 2)
+
+	// A live label is updated in place, a deleted one revived in its own slot.
+	index.AddReplace([]float32{0, 0, 1, 0}, 1)
+	index.MarkDeleted(2)
+	if err := index.AddReplace([]float32{0, 0, 0, 1}, 2); err != nil {
+		t.Fatalf("AddReplace of a deleted label failed: %v", err)
+	}
+	if index.GetCurrentCount() != 2 || index.GetDeletedCount() != 0 {
+		t.Errorf("expected 2 live elements, got %d with %d deleted", index.GetCurrentCount(), index.GetDeletedCount())
+	}
+	if got, _ := index.GetVector(1); got[2] != 1 {
+		t.Errorf("expected label 1 to be updated, got %v", got)
+	}
+	if got, _ := index.GetVector(2); got[3] != 1 {
+		t.Errorf("expected label 2 to be updated, got %v", got)
+	}
+}
+
+func TestAddReplaceRequiresOption(t *testing.T) {
+	index := hnsw.NewL2(4, 10, 16, 200, 42)
+	defer index.Close()
+	if err := index.AddReplace([]float32{1, 2, 3, 4}, 1); err == nil {
+		t.Error("expected AddReplace to fail without AllowReplaceDeleted")
+	}
+}
+
+func TestLoadWithOptionsReusesDeletedSlots(t *testing.T) {
+	index := hnsw.NewL2(8, 20, 16, 200, 42)
+	defer index.Close()
+	vectors := randomVectors(25, 8, 2)
+	for i := 0; i < 20; i++ {
+		index.Add(vectors[i], uint64(i))
+	}
+	for i := 0; i < 5; i++ {
+		index.MarkDeleted(uint64(i))
+	}
+	path := filepath.Join(t.TempDir(), "index.bin")
+	if err := index.Save(path); err != nil {
+		t.Fatalf("Save failed: %v", err)
+	}
+
+	loaded, err := hnsw.LoadWithOptions(hnsw.SpaceL2, 8, path, hnsw.Options{AllowReplaceDeleted: true})
+	if err != nil {
+		t.Fatalf("LoadWithOptions failed: %v", err)
+	}
+	defer loaded.Close()
+	for i := 20; i < 25; i++ {
+		if err := loaded.AddReplace(vectors[i], uint64(i)); err != nil {
+			t.Fatalf("AddReplace into loaded index failed: %v", err)
+		}
+	}
+	if loaded.GetCurrentCount() != 20 || loaded.GetDeletedCount() != 0 {
+		t.Errorf("expected 20 live elements, got %d with %d deleted", loaded.GetCurrentCount(), loaded.GetDeletedCount())
+	}
+}
@@ -0,0 +1,157 @@
+package hnsw_test
+
+import (
+	"os"
+	"path/filepath"
+	"sync"
+	"sync/atomic"
+	"testing"
+	"time"
+
+	"github.com/viktordanov/go-hnswlib/hnsw"
+)
+
+func TestSaveDuringInserts(t *testing.T) {
+	const dim, initial, total = 16, 2000, 8000
+	index := hnsw.New(hnsw.SpaceL2, dim, total, 16, 100, 42)
+	defer index.Close()
+	vectors := randomVectors(total, dim, 1)
+	for i, vec := range vectors[:initial] {
+		index.Add(vec, uint64(i))
+	}
+
+	var wg sync.WaitGroup
+	for w := 0; w < 4; w++ {
+		wg.Add(1)
+		go func(w int) {
+			defer wg.Done()
+			for i := initial + w; i < total; i += 4 {
+				index.Add(vectors[i], uint64(i))
+			}
+		}(w)
+	}
+
+	path := filepath.Join(t.TempDir(), "index.bin")
+	for s := 0; s < 3; s++ {
+		if err := index.Save(path); err != nil {
+			t.Fatalf("Save %d failed: %v", s, err)
+		}
+		if leftovers, _ := filepath.Glob(path + ".tmp*"); len(leftovers) != 0 {
+			t.Fatalf("Save %d left its temporary file behind: %v", s, leftovers)
+		}
+		loaded, err := hnsw.Load(hnsw.SpaceL2, dim, path)
+		if err != nil {
+			t.Fatalf("loading save %d failed: %v", s, err)
+		}
+		count := loaded.GetCurrentCount()
+		if count < initial || count > total {
+			t.Fatalf("save %d holds %d elements", s, count)
+		}
+		for i := 0; i < initial; i += 101 {
+			labels, _, n := loaded.SearchK(vectors[i], 1)
+			if n != 1 || labels[0] != uint64(i) {
+				t.Errorf("save %d: element %d is not its own nearest neighbor: %v", s, i, labels[:n])
+			}
+		}
+		loaded.Close()
+	}
+	wg.Wait()
+}
+
+func TestSaveUnderContinuousInserts(t *testing.T) {
+	const dim, total, writers = 8, 4000, 8
+	index := hnsw.New(hnsw.SpaceL2, dim, total, 8, 40, 42)
+	defer index.Close()
+	vectors := randomVectors(total, dim, 1)
+
+	// writers never pause: once every label is in, they keep re-adding them
+	var stop atomic.Bool
+	var wg sync.WaitGroup
+	for w := 0; w < writers; w++ {
+		wg.Add(1)
+		go func(w int) {
+			defer wg.Done()
+			for n := w; !stop.Load(); n += writers {
+				index.Add(vectors[n%total], uint64(n%total))
+			}
+		}(w)
+	}
+	defer func() {
+		stop.Store(true)
+		wg.Wait()
+	}()
+	for index.GetCurrentCount() < total/2 {
+		time.Sleep(time.Millisecond)
+	}
+
+	path := filepath.Join(t.TempDir(), "index.bin")
+	for s := 0; s < 3; s++ {
+		saved := make(chan error, 1)
+		go func() { saved <- index.Save(path) }()
+		select {
+		case err := <-saved:
+			if err != nil {
+				t.Fatalf("Save %d failed: %v", s, err)
+			}
+		case <-time.After(30 * time.Second):
+			t.Fatalf("Save %d did not get past the running inserts", s)
+		}
+		loaded, err := hnsw.Load(hnsw.SpaceL2, dim, path)
+		if err != nil {
+			t.Fatalf("loading save %d failed: %v", s, err)
+		}
+		if count := loaded.GetCurrentCount(); count > total {
+			t.Errorf("save %d holds %d elements", s, count)
+		}
+		loaded.Close()
+	}
+}
+
+func TestLoadDetectsCorruption(t *testing.T) {
+	const dim = 16
+	index := hnsw.New(hnsw.SpaceL2, dim, 3000, 16, 100, 42)
+	defer index.Close()
+	vectors := randomVectors(3000, dim, 1)
+	for i, vec := range vectors {
+		index.Add(vec, uint64(i))
+	}
+	path := filepath.Join(t.TempDir(), "index.bin")
+	if err := index.Save(path); err != nil {
+		t.Fatalf("Save failed: %v", err)
+	}
+	loaded, err := hnsw.Load(hnsw.SpaceL2, dim, path)
+	if err != nil {
+		t.Fatalf("Load failed: %v", err)
+	}
+	if loaded.GetCurrentCount() != 3000 {
+		t.Errorf("expected 3000 elements, got %d", loaded.GetCurrentCount())
+	}
+	for i := 0; i < 3000; i += 97 {
+		labels, _, n := loaded.SearchK(vectors[i], 1)
+		if n != 1 || labels[0] != uint64(i) {
+			t.Errorf("element %d is not its own nearest neighbor: %v", i, labels[:n])
+		}
+	}
+	loaded.Close()
+
+	data, err := os.ReadFile(path)
+	if err != nil {
+		t.Fatal(err)
+	}
+	for _, pos := range []int{10, len(data) / 3, len(data) - 200, len(data) - 2} {
+		corrupt := append([]byte(nil), data...)
+		corrupt[pos] ^= 0x40
+		corruptPath := filepath.Join(t.TempDir(), "corrupt.bin")
+		if err := os.WriteFile(corruptPath, corrupt, 0o644); err != nil {
+			t.Fatal(err)
+		}
+		if bad, err := hnsw.Load(hnsw.SpaceL2, dim, corruptPath); err == nil {
+			bad.Close()
+			t.Errorf("expected Load to reject a file with byte %d flipped", pos)
+		}
+	}
+	if bad, err := hnsw.Load(hnsw.SpaceL2, dim, path+".missing"); err == nil {
+		bad.Close()
+		t.Error("expected Load to fail on a missing file")
+	}
+}
@@ -0,0 +1,516 @@
+package hnsw_test
+
+import (
+	"fmt"
+	"math"
+	"path/filepath"
+	"sort"
+	"sync"
+	"testing"
+
+	"github.com/viktordanov/go-hnswlib/hnsw"
+)
+
+func TestSearchKIntoMatchesSearchK(t *testing.T) {
+	for _, space := range []hnsw.Space{hnsw.SpaceL2, hnsw.SpaceCosine, hnsw.SpaceL2SQ8} {
+		index := hnsw.New(space, 32, 500, 16, 200, 42)
+		defer index.Close()
+		vectors := randomVectors(500, 32, 1)
+		index.Train(vectors)
+		for i, vec := range vectors {
+			index.Add(vec, uint64(i))
+		}
+		index.SetRerank(3)
+
+		labels := make([]uint64, 10)
+		distances := make([]float32, 10)
+		for q, query := range randomVectors(20, 32, 2) {
+			count, err := index.SearchKInto(query, 10, labels, distances)
+			if err != nil {
+				t.Fatalf("SearchKInto failed: %v", err)
+			}
+			wantLabels, wantDistances, wantCount := index.SearchK(query, 10)
+			if count != wantCount {
+				t.Fatalf("space %c query %d: expected %d results, got %d", space, q, wantCount, count)
+			}
+			for j := 0; j < count; j++ {
+				if labels[j] != wantLabels[j] || distances[j] != wantDistances[j] {
+					t.Errorf("space %c query %d result %d: got (%d, %f), want (%d, %f)",
+						space, q, j, labels[j], distances[j], wantLabels[j], wantDistances[j])
+				}
+			}
+		}
+	}
+}
+
+func TestSearchKIntoDoesNotAllocate(t *testing.T) {
+	for _, space := range []hnsw.Space{hnsw.SpaceL2, hnsw.SpaceCosine} {
+		index := hnsw.New(space, 64, 1000, 16, 200, 42)
+		defer index.Close()
+		for i, vec := range randomVectors(1000, 64, 3) {
+			index.Add(vec, uint64(i))
+		}
+
+		query := randomVectors(1, 64, 4)[0]
+		labels := make([]uint64, 10)
+		distances := make([]float32, 10)
+		allocs := testing.AllocsPerRun(200, func() {
+			index.SearchKInto(query, 10, labels, distances)
+		})
+		if allocs != 0 {
+			t.Errorf("space %c: SearchKInto allocated %.1f times per call", space, allocs)
+		}
+	}
+}
+
+func TestCosineNormalizesNatively(t *testing.T) {
+	// 37 dimensions exercise both the vector and the scalar tail of the kernels.
+	for _, space := range []hnsw.Space{hnsw.SpaceCosine, hnsw.SpaceCosineSQ8, hnsw.SpaceCosineFP16} {
+		index := hnsw.New(space, 37, 300, 16, 200, 42)
+		defer index.Close()
+		vectors := randomVectors(300, 37, 5)
+		for _, vec := range vectors {
+			for j := range vec {
+				vec[j] *= 10
+			}
+		}
+		index.Train(vectors)
+		original := append([]float32(nil), vectors[0]...)
+		for i, vec := range vectors {
+			if err := index.Add(vec, uint64(i)); err != nil {
+				t.Fatalf("space %c: Add failed: %v", space, err)
+			}
+		}
+		for j := range original {
+			if vectors[0][j] != original[j] {
+				t.Fatalf("space %c: Add modified the caller's vector", space)
+			}
+		}
+
+		stored, _ := index.GetVector(7)
+		var norm float64
+		for _, v := range stored {
+			norm += float64(v) * float64(v)
+		}
+		if math.Abs(math.Sqrt(norm)-1) > 0.02 {
+			t.Errorf("space %c: stored vector has norm %f, want 1", space, math.Sqrt(norm))
+		}
+
+		// Scaling a query does not change cosine distances.
+		query := randomVectors(1, 37, 6)[0]
+		scaled := make([]float32, len(query))
+		for j := range query {
+			scaled[j] = query[j] * 0.01
+		}
+		labels, distances, _ := index.SearchK(query, 5)
+		scaledLabels, scaledDistances, _ := index.SearchK(scaled, 5)
+		for j := range labels {
+			if labels[j] != scaledLabels[j] || math.Abs(float64(distances[j]-scaledDistances[j])) > 1e-5 {
+				t.Errorf("space %c result %d: got (%d, %f) for the scaled query, want (%d, %f)",
+					space, j, scaledLabels[j], scaledDistances[j], labels[j], distances[j])
+			}
+		}
+	}
+}
+
+func TestSearchKIntoValidation(t *testing.T) {
+	index := hnsw.NewL2(4, 10, 16, 200, 42)
+	defer index.Close()
+	index.Add([]float32{1, 2, 3, 4}, 1)
+
+	labels := make([]uint64, 2)
+	distances := make([]float32, 2)
+	if _, err := index.SearchKInto([]float32{1, 2, 3, 4}, 3, labels, distances); err == nil {
+		t.Error("expected error for buffers shorter than k, got nil")
+	}
+	if _, err := index.SearchKInto([]float32{1, 2}, 1, labels, distances); err == nil {
+		t.Error("expected error for wrong query dimension, got nil")
+	}
+	count, err := index.SearchKInto([]float32{1, 2, 3, 4}, 2, labels, distances)
+	if err != nil || count != 1 || labels[0] != 1 {
+		t.Errorf("expected the single element, got count=%d labels=%v err=%v", count, labels[:count], err)
+	}
+}
+
+func TestSearchKFiltered(t *testing.T) {
+	for _, space := range []hnsw.Space{hnsw.SpaceL2, hnsw.SpaceCosine} {
+		index := hnsw.New(space, 16, 1000, 16, 200, 42)
+		defer index.Close()
+		for i, vec := range randomVectors(1000, 16, 5) {
+			index.Add(vec, uint64(i))
+		}
+		index.SetEf(100)
+
+		// One tenant in ten: labels divisible by 10.
+		bitmap := hnsw.NewLabelBitmap(999)
+		var list hnsw.LabelList
+		for l := uint64(0); l < 1000; l += 10 {
+			bitmap.Set(l)
+			list = append(list, l)
+		}
+
+		for _, filter := range []hnsw.Filter{bitmap, list} {
+			for _, query := range randomVectors(20, 16, 6) {
+				labels, distances, count, err := index.SearchKFiltered(query, 10, filter)
+				if err != nil {
+					t.Fatalf("space %c: SearchKFiltered failed: %v", space, err)
+				}
+				if count != 10 {
+					t.Fatalf("space %c: expected 10 filtered results, got %d", space, count)
+				}
+				for j, label := range labels {
+					if label%10 != 0 {
+						t.Errorf("space %c: result %d has disallowed label %d", space, j, label)
+					}
+					if j > 0 && distances[j] < distances[j-1] {
+						t.Errorf("space %c: results not sorted at %d", space, j)
+					}
+				}
+			}
+		}
+	}
+}
+
+func TestSearchKFilteredEdgeCases(t *testing.T) {
+	index := hnsw.NewL2(4, 10, 16, 200, 42)
+	defer index.Close()
+	for i, vec := range randomVectors(5, 4, 7) {
+		index.Add(vec, uint64(i))
+	}
+	query := []float32{0.5, 0.5, 0.5, 0.5}
+
+	if _, _, count, _ := index.SearchKFiltered(query, 3, hnsw.LabelList{}); count != 0 {
+		t.Errorf("expected no results for an empty allow-list, got %d", count)
+	}
+	if labels, _, count, _ := index.SearchKFiltered(query, 3, hnsw.LabelList{2, 4}); count != 2 || labels[0]+labels[1] != 6 {
+		t.Errorf("expected labels 2 and 4, got %v", labels)
+	}
+	if _, _, count, _ := index.SearchKFiltered(query, 3, nil); count != 3 {
+		t.Errorf("expected nil filter to search everything, got %d results", count)
+	}
+	small := hnsw.NewLabelBitmap(0)
+	small.Set(0)
+	if labels, _, count, _ := index.SearchKFiltered(query, 3, small); count != 1 || labels[0] != 0 || small.Has(1) {
+		t.Errorf("expected only label 0, got %v", labels)
+	}
+	if _, _, _, err := index.SearchKFiltered(query, 0, small); err == nil {
+		t.Error("expected an error for k = 0")
+	}
+	if _, _, _, err := index.SearchKFiltered(query[:3], 3, small); err == nil {
+		t.Error("expected an error for a query of the wrong dimension")
+	}
+}
+
+func TestPrefetchDistanceDoesNotChangeResults(t *testing.T) {
+	index := hnsw.NewL2(48, 1000, 16, 200, 42)
+	defer index.Close()
+	for i, vec := range randomVectors(1000, 48, 8) {
+		index.Add(vec, uint64(i))
+	}
+	index.SetEf(200)
+
+	queries := randomVectors(20, 48, 9)
+	want, _, err := index.SearchBatch(queries, 10, 1)
+	if err != nil {
+		t.Fatalf("SearchBatch failed: %v", err)
+	}
+	for _, distance := range []int{0, 1, 16, 1000} {
+		index.SetPrefetchDistance(distance)
+		got, _, _ := index.SearchBatch(queries, 10, 1)
+		for q := range queries {
+			for j := range want[q] {
+				if got[q][j] != want[q][j] {
+					t.Fatalf("prefetch distance %d changed result %d of query %d", distance, j, q)
+				}
+			}
+		}
+	}
+}
+
+func TestReorderPreservesResults(t *testing.T) {
+	vectors := randomVectors(1500, 32, 10)
+	index := hnsw.NewL2(32, 2000, 16, 200, 42)
+	defer index.Close()
+	for i, vec := range vectors {
+		index.Add(vec, uint64(i))
+	}
+	index.MarkDeleted(3)
+	index.MarkDeleted(700)
+	index.SetEf(100)
+
+	queries := randomVectors(50, 32, 11)
+	wantLabels, wantDistances, err := index.SearchBatch(queries, 10, 1)
+	if err != nil {
+		t.Fatalf("SearchBatch failed: %v", err)
+	}
+	if err := index.Reorder(); err != nil {
+		t.Fatalf("Reorder failed: %v", err)
+	}
+
+	gotLabels, gotDistances, _ := index.SearchBatch(queries, 10, 1)
+	for q := range queries {
+		for j := range wantLabels[q] {
+			if gotLabels[q][j] != wantLabels[q][j] || gotDistances[q][j] != wantDistances[q][j] {
+				t.Fatalf("query %d result %d: got (%d, %f), want (%d, %f)",
+					q, j, gotLabels[q][j], gotDistances[q][j], wantLabels[q][j], wantDistances[q][j])
+			}
+		}
+	}
+	if deleted := index.GetDeletedCount(); deleted != 2 {
+		t.Errorf("expected 2 deleted elements, got %d", deleted)
+	}
+	if _, err := index.GetVector(3); err == nil {
+		t.Error("expected deleted label 3 to stay deleted")
+	}
+	got, err := index.GetVector(42)
+	if err != nil {
+		t.Fatalf("GetVector failed: %v", err)
+	}
+	for j := range got {
+		if got[j] != vectors[42][j] {
+			t.Fatalf("component %d: got %f, want %f", j, got[j], vectors[42][j])
+		}
+	}
+
+	// The reordered index keeps accepting inserts and survives a save/load round trip.
+	extra := randomVectors(1, 32, 12)[0]
+	if err := index.Add(extra, 5000); err != nil {
+		t.Fatalf("Add after Reorder failed: %v", err)
+	}
+	path := filepath.Join(t.TempDir(), "reordered.bin")
+	if err := index.Save(path); err != nil {
+		t.Fatalf("Save failed: %v", err)
+	}
+	loaded, err := hnsw.Load(hnsw.SpaceL2, 32, path)
+	if err != nil {
+		t.Fatalf("Load failed: %v", err)
+	}
+	defer loaded.Close()
+	if labels, _, count := loaded.SearchK(extra, 1); count != 1 || labels[0] != 5000 {
+		t.Errorf("expected label 5000 as nearest neighbor of itself, got %v", labels)
+	}
+}
+
+func TestCompactRemovesDeleted(t *testing.T) {
+	vectors := randomVectors(2000, 24, 13)
+	index := hnsw.NewL2(24, 2000, 16, 200, 42)
+	defer index.Close()
+	for i, vec := range vectors {
+		index.Add(vec, uint64(i))
+	}
+	// Delete 30% of the elements, including the first inserted one.
+	for i := 0; i < len(vectors); i += 3 {
+		index.MarkDeleted(uint64(i))
+	}
+	index.SetEf(100)
+
+	queries := randomVectors(50, 24, 14)
+	for {
+		done, err := index.CompactStep(300)
+		if err != nil {
+			t.Fatalf("CompactStep failed: %v", err)
+		}
+		// Searches keep working between steps.
+		if labels, _, count := index.SearchK(queries[0], 5); count != 5 || labels[0]%3 == 0 {
+			t.Fatalf("search during compaction returned %v", labels)
+		}
+		if done {
+			break
+		}
+	}
+	if err := index.Compact(); err != nil {
+		t.Fatalf("Compact failed: %v", err)
+	}
+
+	live := len(vectors) - (len(vectors)+2)/3
+	if count := index.GetCurrentCount(); count != live {
+		t.Errorf("expected %d elements, got %d", live, count)
+	}
+	if index.GetDeletedCount() != 0 || index.GetMaxElements() != live {
+		t.Errorf("expected no deleted elements and capacity %d, got %d/%d",
+			live, index.GetDeletedCount(), index.GetMaxElements())
+	}
+	if _, err := index.GetVector(0); err == nil {
+		t.Error("expected removed label 0 to be gone")
+	}
+	got, err := index.GetVector(1)
+	if err != nil {
+		t.Fatalf("GetVector failed: %v", err)
+	}
+	for j := range got {
+		if got[j] != vectors[1][j] {
+			t.Fatalf("component %d: got %f, want %f", j, got[j], vectors[1][j])
+		}
+	}
+
+	// Every surviving element is still reachable as its own nearest neighbor.
+	found := 0
+	for i, vec := range vectors {
+		if i%3 == 0 {
+			continue
+		}
+		if labels, _, count := index.SearchK(vec, 1); count == 1 && labels[0] == uint64(i) {
+			found++
+		}
+	}
+	if found < live*99/100 {
+		t.Errorf("expected almost all survivors to find themselves, got %d/%d", found, live)
+	}
+
+	if err := index.Add(vectors[0], 0); err != nil {
+		t.Fatalf("Add after Compact failed: %v", err)
+	}
+	if max := index.GetMaxElements(); max <= live {
+		t.Errorf("expected Add to grow capacity beyond %d, got %d", live, max)
+	}
+}
+
+func TestCompactAllDeleted(t *testing.T) {
+	index := hnsw.NewL2(8, 100, 16, 200, 42)
+	defer index.Close()
+	vectors := randomVectors(50, 8, 15)
+	for i, vec := range vectors {
+		index.Add(vec, uint64(i))
+		index.MarkDeleted(uint64(i))
+	}
+	if err := index.Compact(); err != nil {
+		t.Fatalf("Compact failed: %v", err)
+	}
+	if _, _, count := index.SearchK(vectors[0], 5); count != 0 {
+		t.Errorf("expected no results from an empty index, got %d", count)
+	}
+	if err := index.Add(vectors[0], 7); err != nil {
+		t.Fatalf("Add after Compact failed: %v", err)
+	}
+	if labels, _, count := index.SearchK(vectors[0], 1); count != 1 || labels[0] != 7 {
+		t.Errorf("expected label 7, got %v", labels)
+	}
+}
+
+func TestSearchRange(t *testing.T) {
+	const dim, n = 16, 1000
+	index := hnsw.New(hnsw.SpaceL2, dim, n, 16, 200, 42)
+	defer index.Close()
+	vectors := randomVectors(n, dim, 5)
+	for i, vec := range vectors {
+		index.Add(vec, uint64(i))
+	}
+	index.SetEf(50)
+
+	labels := make([]uint64, 100)
+	distances := make([]float32, 100)
+	found, total := 0, 0
+	for q, query := range randomVectors(20, dim, 6) {
+		// radius that holds the 20 nearest neighbors
+		all := make([]float32, n)
+		for i, vec := range vectors {
+			for d := range vec {
+				diff := vec[d] - query[d]
+				all[i] += diff * diff
+			}
+		}
+		sorted := append([]float32(nil), all...)
+		sort.Slice(sorted, func(a, b int) bool { return sorted[a] < sorted[b] })
+		radius := sorted[19]
+
+		count, err := index.SearchRange(query, radius, labels, distances)
+		if err != nil {
+			t.Fatalf("SearchRange failed: %v", err)
+		}
+		for j := 0; j < count; j++ {
+			if distances[j] > radius {
+				t.Errorf("query %d: result %d at distance %f is outside radius %f", q, labels[j], distances[j], radius)
+			}
+			if j > 0 && distances[j] < distances[j-1] {
+				t.Errorf("query %d: results are not sorted by distance", q)
+			}
+		}
+		found += count
+		total += 20
+	}
+	if recall := float64(found) / float64(total); recall < 0.9 {
+		t.Errorf("range search recall %.2f, want >= 0.9", recall)
+	}
+
+	// the buffers cap the number of results
+	query := vectors[0]
+	count, err := index.SearchRange(query, 1e9, labels[:5], distances)
+	if err != nil || count != 5 {
+		t.Fatalf("expected 5 capped results, got %d (%v)", count, err)
+	}
+	if labels[0] != 0 || distances[0] != 0 {
+		t.Errorf("expected the query's own vector first, got (%d, %f)", labels[0], distances[0])
+	}
+
+	if _, err := index.SearchRange(query, 1, nil, nil); err == nil {
+		t.Error("expected an error for empty result buffers")
+	}
+	if _, err := index.SearchRange(query[:3], 1, labels, distances); err == nil {
+		t.Error("expected an error for a dimension mismatch")
+	}
+}
+
+func TestSearchWithEfIsPerQuery(t *testing.T) {
+	const dim, n, k = 16, 2000, 10
+	index := hnsw.New(hnsw.SpaceL2, dim, n, 8, 100, 42)
+	defer index.Close()
+	for i, vec := range randomVectors(n, dim, 7) {
+		index.Add(vec, uint64(i))
+	}
+	queries := randomVectors(50, dim, 8)
+
+	// reference results with the shared ef set to each value in turn
+	want := map[int][][]uint64{}
+	for _, ef := range []int{10, 200} {
+		index.SetEf(ef)
+		for _, query := range queries {
+			labels, _, _ := index.SearchK(query, k)
+			want[ef] = append(want[ef], labels)
+		}
+	}
+	index.SetEf(10)
+
+	// both ef values served concurrently by one index, without SetEf
+	var wg sync.WaitGroup
+	errs := make(chan string, 2*len(queries))
+	for _, ef := range []int{10, 200} {
+		wg.Add(1)
+		go func(ef int) {
+			defer wg.Done()
+			labels := make([]uint64, k)
+			distances := make([]float32, k)
+			for round := 0; round < 5; round++ {
+				for q, query := range queries {
+					count, err := index.SearchKIntoWithEf(query, k, ef, labels, distances)
+					if err != nil || count != len(want[ef][q]) {
+						errs <- fmt.Sprintf("ef %d query %d: got %d results (%v)", ef, q, count, err)
+						return
+					}
+					for j := 0; j < count; j++ {
+						if labels[j] != want[ef][q][j] {
+							errs <- fmt.Sprintf("ef %d query %d: results differ from SetEf(%d)", ef, q, ef)
+							return
+						}
+					}
+				}
+			}
+		}(ef)
+	}
+	wg.Wait()
+	close(errs)
+	for err := range errs {
+		t.Error(err)
+	}
+
+	batchLabels, _, err := index.SearchBatchWithEf(queries, k, 200, 0)
+	if err != nil {
+		t.Fatalf("SearchBatchWithEf failed: %v", err)
+	}
+	for q := range queries {
+		for j := range batchLabels[q] {
+			if batchLabels[q][j] != want[200][q][j] {
+				t.Fatalf("batch query %d: results differ from SetEf(200)", q)
+			}
+		}
+	}
+}
@@ -0,0 +1,56 @@
+package hnsw
+
+import (
+	"errors"
+	"runtime"
+
+	bindings "github.com/viktordanov/go-hnswlib"
+)
+
+// NewSharded creates an index spread over numShards HNSW graphs, each element
+// stored in the graph picked by a hash of its label. Concurrent inserts mostly
+// land on different graphs and so do not contend, and each search runs on all
+// graphs in parallel on the shared thread pool and merges their results.
+// maxElements, M, efConstruction and seed are as in New, maxElements split
+// evenly between the graphs and each seeded differently.
+//
+// Save writes a directory holding a file per graph, which LoadSharded reads.
+// The files of each save are new and a manifest written last switches to them,
+// so a save that fails or crashes leaves the previous one loadable.
+// AddReplace and SaveMmap return an error on a sharded index.
+func NewSharded(space Space, dim, maxElements, M, efConstruction, seed, numShards int) (*Index, error) {
+	h := bindings.InitSharded(int32(dim), uint64(maxElements), int32(M), int32(efConstruction), int32(seed),
+		byte(space), int32(numShards))
+	if h == nil {
+		return nil, errors.New("failed to create sharded index")
+	}
+	idx := &Index{
+		h:      h,
+		cosine: space.isCosine(),
+	}
+	runtime.SetFinalizer(idx, (*Index).Close)
+	return idx, nil
+}
+
+// LoadSharded loads a directory saved from a sharded index.
+func LoadSharded(space Space, dim int, dir string) (*Index, error) {
+	pathBytes := []byte(dir + "\x00") // null terminate
+	h := bindings.LoadSharded(pathBytes, int32(dim), byte(space))
+	if h == nil {
+		return nil, errors.New("failed to load sharded index (check directory exists and was saved from a sharded index)")
+	}
+	idx := &Index{
+		h:      h,
+		cosine: space.isCosine(),
+	}
+	runtime.SetFinalizer(idx, (*Index).Close)
+	return idx, nil
+}
+
+// IsSharded reports whether the index was created by NewSharded or LoadSharded.
+func (i *Index) IsSharded() bool {
+	if i == nil || i.h == nil {
+		return false
+	}
+	return bindings.GetIndexType(i.h) == 2
+}
@@ -0,0 +1,184 @@
+package hnsw_test
+
+import (
+	"os"
+	"path/filepath"
+	"sync"
+	"testing"
+
+	"github.com/viktordanov/go-hnswlib/hnsw"
+)
+
+func TestShardedMatchesSingleGraph(t *testing.T) {
+	const n, dim = 4000, 24
+	index, err := hnsw.NewSharded(hnsw.SpaceL2, dim, n, 16, 200, 100, 4)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer index.Close()
+	vectors := randomVectors(n, dim, 5)
+	if err := index.AddBatch(vectors, sequentialLabels(n), 0); err != nil {
+		t.Fatalf("AddBatch failed: %v", err)
+	}
+	if !index.IsSharded() || index.GetCurrentCount() != n {
+		t.Fatalf("expected a sharded index of %d elements, got sharded=%v count=%d", n, index.IsSharded(),
+			index.GetCurrentCount())
+	}
+	index.SetEf(100)
+
+	queries := randomVectors(50, dim, 6)
+	batchLabels, _, err := index.SearchBatch(queries, 10, 0)
+	if err != nil {
+		t.Fatalf("SearchBatch failed: %v", err)
+	}
+	hits := 0
+	for q, query := range queries {
+		labels, distances, count := index.SearchK(query, 10)
+		if count != 10 {
+			t.Fatalf("query %d: expected 10 results, got %d", q, count)
+		}
+		for j := 1; j < count; j++ {
+			if distances[j] < distances[j-1] {
+				t.Fatalf("query %d: results not sorted by distance: %v", q, distances)
+			}
+		}
+		for j := range labels {
+			if labels[j] != batchLabels[q][j] {
+				t.Fatalf("query %d: SearchBatch returned %v, SearchK %v", q, batchLabels[q], labels)
+			}
+		}
+		exact := make(map[uint64]bool)
+		for _, label := range exactNeighbors(vectors, query, 10) {
+			exact[label] = true
+		}
+		for _, label := range labels {
+			if exact[label] {
+				hits++
+			}
+		}
+	}
+	if recall := float64(hits) / float64(10*len(queries)); recall < 0.95 {
+		t.Fatalf("recall %.3f below 0.95", recall)
+	}
+
+	// range results of all shards are merged closest first
+	_, distances, _ := index.SearchK(queries[0], 10)
+	rangeLabels, rangeDistances := make([]uint64, 50), make([]float32, 50)
+	found, err := index.SearchRange(queries[0], distances[9], rangeLabels, rangeDistances)
+	if err != nil || found == 0 {
+		t.Fatalf("SearchRange found %d, err %v", found, err)
+	}
+	for j := 0; j < found; j++ {
+		if rangeDistances[j] > distances[9] || (j > 0 && rangeDistances[j] < rangeDistances[j-1]) {
+			t.Fatalf("SearchRange returned %v for radius %v", rangeDistances[:found], distances[9])
+		}
+	}
+
+	// labels route to their shard
+	vec, err := index.GetVector(1234)
+	if err != nil || vec[0] != vectors[1234][0] {
+		t.Fatalf("GetVector returned %v, %v", vec, err)
+	}
+	if err := index.MarkDeleted(1234); err != nil {
+		t.Fatal(err)
+	}
+	if labels, _, _ := index.SearchK(vectors[1234], 1); labels[0] == 1234 {
+		t.Fatal("deleted label still found")
+	}
+	if index.GetDeletedCount() != 1 {
+		t.Fatalf("expected 1 deleted element, got %d", index.GetDeletedCount())
+	}
+}
+
+func TestShardedSaveLoad(t *testing.T) {
+	const n, dim = 2000, 16
+	index, err := hnsw.NewSharded(hnsw.SpaceCosine, dim, n, 16, 100, 7, 3)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer index.Close()
+	vectors := randomVectors(n, dim, 8)
+	var wg sync.WaitGroup
+	for w := 0; w < 4; w++ {
+		wg.Add(1)
+		go func(w int) {
+			defer wg.Done()
+			for row := w; row < n; row += 4 {
+				if err := index.Add(vectors[row], uint64(row)); err != nil {
+					t.Error(err)
+					return
+				}
+			}
+		}(w)
+	}
+	wg.Wait()
+
+	dir := filepath.Join(t.TempDir(), "sharded")
+	if err := index.Save(dir); err != nil {
+		t.Fatalf("Save failed: %v", err)
+	}
+	if err := index.SaveMmap(filepath.Join(t.TempDir(), "mapped")); err == nil {
+		t.Fatal("SaveMmap of a sharded index succeeded")
+	}
+	loaded, err := hnsw.LoadSharded(hnsw.SpaceCosine, dim, dir)
+	if err != nil {
+		t.Fatalf("LoadSharded failed: %v", err)
+	}
+	defer loaded.Close()
+	if !loaded.IsSharded() || loaded.GetCurrentCount() != n {
+		t.Fatalf("loaded sharded=%v count=%d", loaded.IsSharded(), loaded.GetCurrentCount())
+	}
+	for _, row := range []int{0, 777, n - 1} {
+		want, _, _ := index.SearchK(vectors[row], 5)
+		got, _, _ := loaded.SearchK(vectors[row], 5)
+		for j := range want {
+			if want[j] != got[j] {
+				t.Fatalf("row %d: loaded index returned %v, original %v", row, got, want)
+			}
+		}
+	}
+	if _, err := hnsw.Load(hnsw.SpaceCosine, dim, dir); err == nil {
+		t.Fatal("Load accepted a sharded directory")
+	}
+}
+
+func TestShardedSaveReplacesEarlierSave(t *testing.T) {
+	const dim = 8
+	dir := filepath.Join(t.TempDir(), "sharded")
+	vectors := randomVectors(600, dim, 9)
+	for _, save := range []struct{ shards, n int }{{4, 600}, {2, 300}} {
+		index, err := hnsw.NewSharded(hnsw.SpaceL2, dim, save.n, 16, 100, 7, save.shards)
+		if err != nil {
+			t.Fatal(err)
+		}
+		for row, vec := range vectors[:save.n] {
+			index.Add(vec, uint64(row))
+		}
+		err = index.Save(dir)
+		index.Close()
+		if err != nil {
+			t.Fatalf("Save of %d shards failed: %v", save.shards, err)
+		}
+	}
+
+	// the second save's shards and manifest, and nothing left of the first
+	entries, err := os.ReadDir(dir)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if len(entries) != 3 {
+		var names []string
+		for _, entry := range entries {
+			names = append(names, entry.Name())
+		}
+		t.Errorf("directory holds %v, want a manifest and 2 shards", names)
+	}
+	loaded, err := hnsw.LoadSharded(hnsw.SpaceL2, dim, dir)
+	if err != nil {
+		t.Fatalf("LoadSharded failed: %v", err)
+	}
+	defer loaded.Close()
+	if loaded.GetCurrentCount() != 300 {
+		t.Errorf("loaded %d elements, want the 300 of the last save", loaded.GetCurrentCount())
+	}
+}
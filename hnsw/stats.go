@@ -0,0 +1,99 @@
+package hnsw
+
+import (
+	"errors"
+	"math"
+
+	bindings "github.com/viktordanov/go-hnswlib"
+)
+
+// SearchStats is the work done by one search.
+type SearchStats struct {
+	Hops                 uint64 // nodes whose neighbor lists were expanded, on all layers
+	DistanceComputations uint64
+	Visited              uint64 // base-layer nodes reached
+	DeletedSkipped       uint64 // deleted nodes reached but kept out of the results
+}
+
+// HistogramBuckets is the number of buckets of a Histogram.
+const HistogramBuckets = 32
+
+// Histogram counts searches by the value of one SearchStats counter. Buckets[b]
+// holds the searches whose value has b significant bits: 0 in bucket 0 and
+// [2^(b-1), 2^b) in bucket b, with larger values in the last bucket.
+type Histogram struct {
+	Sum     uint64 // total of the counter over all searches
+	Buckets [HistogramBuckets]uint64
+}
+
+// Quantile returns an upper bound of the q-quantile (0 < q <= 1) of the counter:
+// the largest value of the bucket in which the cumulative count reaches q of all
+// searches. Values in the last bucket are reported as its bound, 2^31 - 1.
+func (h Histogram) Quantile(q float64) uint64 {
+	var total uint64
+	for _, n := range h.Buckets {
+		total += n
+	}
+	target := uint64(math.Ceil(q * float64(total)))
+	if target == 0 {
+		target = 1
+	}
+	var seen uint64
+	for b, n := range h.Buckets {
+		seen += n
+		if seen >= target {
+			return 1<<b - 1
+		}
+	}
+	return 0
+}
+
+// IndexStats aggregates the SearchStats of every search run on an index since it
+// was created or loaded.
+type IndexStats struct {
+	Searches             uint64
+	Hops                 Histogram
+	DistanceComputations Histogram
+	Visited              Histogram
+	DeletedSkipped       Histogram
+}
+
+// SearchKIntoWithStats is SearchKIntoWithEf that also reports the work of the
+// search, e.g. to correlate slow queries with how much of the graph they walked.
+// The counters are kept per thread while the search runs, so collecting them
+// adds no shared writes to the search loop.
+func (i *Index) SearchKIntoWithStats(query []float32, k, ef int, labels []uint64, distances []float32) (int, SearchStats, error) {
+	var counters [4]uint64
+	count, err := i.searchKInto(query, k, ef, labels, distances, counters[:])
+	if err != nil {
+		return 0, SearchStats{}, err
+	}
+	return count, SearchStats{
+		Hops:                 counters[0],
+		DistanceComputations: counters[1],
+		Visited:              counters[2],
+		DeletedSkipped:       counters[3],
+	}, nil
+}
+
+// Stats returns histograms of the SearchStats of all k-NN, batch, queued, range
+// and document searches run on the index. Each search adds to them once, when it
+// finishes, on one of several shards so concurrent searches rarely contend.
+func (i *Index) Stats() (IndexStats, error) {
+	if i == nil || i.h == nil {
+		return IndexStats{}, errors.New("index is closed")
+	}
+	var searches [1]uint64
+	var sums [4]uint64
+	var buckets [4 * HistogramBuckets]uint64
+	if bindings.GetIndexStats(i.h, searches[:], sums[:], buckets[:]) != HistogramBuckets {
+		return IndexStats{}, errors.New("unexpected native histogram layout")
+	}
+
+	stats := IndexStats{Searches: searches[0]}
+	for m, h := range []*Histogram{&stats.Hops, &stats.DistanceComputations, &stats.Visited, &stats.DeletedSkipped} {
+		h.Sum = sums[m]
+		copy(h.Buckets[:], buckets[m*HistogramBuckets:(m+1)*HistogramBuckets])
+	}
+	return stats, nil
+}
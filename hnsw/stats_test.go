@@ -0,0 +1,95 @@
+package hnsw_test
+
+import (
+	"testing"
+
+	"github.com/viktordanov/go-hnswlib/hnsw"
+)
+
+func TestSearchStats(t *testing.T) {
+	const dim, n, k = 16, 1000, 10
+	index := hnsw.New(hnsw.SpaceL2, dim, n, 16, 200, 42)
+	defer index.Close()
+	for i, vec := range randomVectors(n, dim, 9) {
+		index.Add(vec, uint64(i))
+	}
+	queries := randomVectors(20, dim, 10)
+
+	labels := make([]uint64, k)
+	distances := make([]float32, k)
+	var want hnsw.SearchStats
+	for _, query := range queries {
+		_, stats, err := index.SearchKIntoWithStats(query, k, 50, labels, distances)
+		if err != nil {
+			t.Fatalf("SearchKIntoWithStats failed: %v", err)
+		}
+		if stats.Hops == 0 || stats.Visited < k || stats.DistanceComputations < stats.Visited {
+			t.Errorf("implausible stats %+v", stats)
+		}
+		if stats.DeletedSkipped != 0 {
+			t.Errorf("expected no deleted nodes skipped, got %d", stats.DeletedSkipped)
+		}
+		want.Hops += stats.Hops
+		want.DistanceComputations += stats.DistanceComputations
+		want.Visited += stats.Visited
+	}
+
+	stats, err := index.Stats()
+	if err != nil {
+		t.Fatalf("Stats failed: %v", err)
+	}
+	if stats.Searches != uint64(len(queries)) {
+		t.Fatalf("expected %d searches, got %d", len(queries), stats.Searches)
+	}
+	if stats.Hops.Sum != want.Hops || stats.DistanceComputations.Sum != want.DistanceComputations ||
+		stats.Visited.Sum != want.Visited {
+		t.Errorf("histogram sums %d/%d/%d do not match per-query totals %+v",
+			stats.Hops.Sum, stats.DistanceComputations.Sum, stats.Visited.Sum, want)
+	}
+	var counted uint64
+	for _, c := range stats.Hops.Buckets {
+		counted += c
+	}
+	if counted != stats.Searches {
+		t.Errorf("hops histogram counts %d searches, want %d", counted, stats.Searches)
+	}
+	if q := stats.Hops.Quantile(1); q < want.Hops/uint64(len(queries)) {
+		t.Errorf("max hops bound %d is below the mean", q)
+	}
+	if stats.DeletedSkipped.Quantile(0.99) != 0 {
+		t.Error("expected no deleted nodes skipped")
+	}
+
+	// batch searches are counted too, and deleted elements show up as skipped
+	for label := uint64(0); label < n/2; label++ {
+		index.MarkDeleted(label)
+	}
+	if _, _, err := index.SearchBatch(queries, k, 0); err != nil {
+		t.Fatalf("SearchBatch failed: %v", err)
+	}
+	after, _ := index.Stats()
+	if after.Searches != stats.Searches+uint64(len(queries)) {
+		t.Errorf("expected %d searches after the batch, got %d", stats.Searches+uint64(len(queries)), after.Searches)
+	}
+	if after.DeletedSkipped.Sum == 0 {
+		t.Error("expected deleted nodes to be skipped after deleting half the index")
+	}
+}
+
+func TestHistogramQuantile(t *testing.T) {
+	var h hnsw.Histogram
+	if h.Quantile(0.5) != 0 {
+		t.Error("expected 0 for an empty histogram")
+	}
+	h.Buckets[0] = 1 // one search at 0
+	h.Buckets[3] = 8 // eight in [4, 8)
+	h.Buckets[5] = 1 // one in [16, 32)
+	for _, c := range []struct {
+		q    float64
+		want uint64
+	}{{0.1, 0}, {0.5, 7}, {0.9, 7}, {1, 31}} {
+		if got := h.Quantile(c.q); got != c.want {
+			t.Errorf("Quantile(%v) = %d, want %d", c.q, got, c.want)
+		}
+	}
+}
@@ -0,0 +1,66 @@
+package hnsw
+
+import (
+	"errors"
+
+	bindings "github.com/viktordanov/go-hnswlib"
+)
+
+// StartLog attaches a write-ahead log at path+".wal" to the index, so that
+// modifications are durable without saving the whole index after each of them.
+// Records already in the log are first replayed onto the index, which should be
+// the one last saved at path (or a new index if none was saved yet); their
+// number is returned. From then on every Add, AddReplace, AddBatch, AddChunk,
+// BuildFromFile row, MarkDeleted and UnmarkDeleted appends a record holding
+// the vector before it is applied. With syncEachWrite, each of them also waits
+// for the record to reach the disk; otherwise a crash of the process loses
+// nothing but a crash of the machine may lose the last writes.
+//
+// A quantized index must be trained before its first Checkpoint, which saves
+// the quantizer parameters the log replay depends on. Do not call StartLog or
+// StopLog while other goroutines modify the index.
+//
+// Typical recovery: Load(space, dim, path) (or New when path does not exist yet),
+// then StartLog(path, ...), and Checkpoint periodically.
+func (i *Index) StartLog(path string, syncEachWrite bool) (int, error) {
+	if i == nil || i.h == nil {
+		return 0, errors.New("index is closed")
+	}
+	if i.readOnly {
+		return 0, errReadOnly
+	}
+	sync := int32(0)
+	if syncEachWrite {
+		sync = 1
+	}
+	pathBytes := []byte(path + "\x00") // null terminate
+	replayed := bindings.StartLog(i.h, pathBytes, sync)
+	if replayed < 0 {
+		return 0, errors.New("failed to start log (check the log is not already started and the file is a log of this dimension)")
+	}
+	return int(replayed), nil
+}
+
+// Checkpoint saves the index to the path given to StartLog, like Save, and then
+// drops the log records the saved file contains, folding the log into the base
+// file. Modifications may continue while it runs; those made meanwhile stay in
+// the log.
+func (i *Index) Checkpoint() error {
+	if i == nil || i.h == nil {
+		return errors.New("index is closed")
+	}
+	if bindings.SaveCheckpoint(i.h) != 0 {
+		return errors.New("failed to checkpoint (check the log is started, file permissions and disk space)")
+	}
+	return nil
+}
+
+// StopLog detaches the write-ahead log; later modifications are not logged.
+// The log file is kept, so records since the last Checkpoint are replayed by
+// the next StartLog.
+func (i *Index) StopLog() {
+	if i == nil || i.h == nil {
+		return
+	}
+	bindings.StopLog(i.h)
+}
@@ -0,0 +1,162 @@
+package hnsw_test
+
+import (
+	"os"
+	"path/filepath"
+	"testing"
+
+	"github.com/viktordanov/go-hnswlib/hnsw"
+)
+
+func TestLogReplaysOntoSnapshot(t *testing.T) {
+	const dim = 16
+	path := filepath.Join(t.TempDir(), "index.bin")
+	vectors := randomVectors(600, dim, 1)
+
+	index := hnsw.New(hnsw.SpaceL2, dim, 100, 16, 100, 42)
+	if replayed, err := index.StartLog(path, false); err != nil || replayed != 0 {
+		t.Fatalf("StartLog on a new index: replayed %d, err %v", replayed, err)
+	}
+	for i, vec := range vectors[:300] {
+		index.Add(vec, uint64(i))
+	}
+	if err := index.Checkpoint(); err != nil {
+		t.Fatalf("Checkpoint failed: %v", err)
+	}
+	// after the checkpoint: more adds, an update, deletes and an undelete
+	for i, vec := range vectors[300:] {
+		index.Add(vec, uint64(300+i))
+	}
+	index.Add(vectors[0], 5)
+	for _, label := range []uint64{10, 20, 310} {
+		if err := index.MarkDeleted(label); err != nil {
+			t.Fatalf("MarkDeleted(%d) failed: %v", label, err)
+		}
+	}
+	index.UnmarkDeleted(20)
+	index.Close() // a crash: the last checkpoint plus the log is all that is left
+
+	recovered, err := hnsw.Load(hnsw.SpaceL2, dim, path)
+	if err != nil {
+		t.Fatalf("Load failed: %v", err)
+	}
+	defer recovered.Close()
+	if recovered.GetCurrentCount() != 300 {
+		t.Fatalf("checkpoint holds %d elements, want 300", recovered.GetCurrentCount())
+	}
+	replayed, err := recovered.StartLog(path, false)
+	if err != nil {
+		t.Fatalf("StartLog failed: %v", err)
+	}
+	if replayed != 300+1+3+1 {
+		t.Errorf("replayed %d records, want 305", replayed)
+	}
+	if recovered.GetCurrentCount() != 600 || recovered.GetDeletedCount() != 2 {
+		t.Fatalf("recovered %d elements, %d deleted; want 600, 2", recovered.GetCurrentCount(), recovered.GetDeletedCount())
+	}
+	if vec, _ := recovered.GetVector(5); vec[0] != vectors[0][0] {
+		t.Error("the update of label 5 was not replayed")
+	}
+	for _, label := range []uint64{10, 310} {
+		if _, err := recovered.GetVector(label); err == nil {
+			t.Errorf("label %d is not deleted after replay", label)
+		}
+	}
+	if _, err := recovered.GetVector(20); err != nil {
+		t.Error("label 20 is still deleted after replay")
+	}
+
+	// folding the log into the base file leaves nothing to replay
+	if err := recovered.Checkpoint(); err != nil {
+		t.Fatalf("Checkpoint failed: %v", err)
+	}
+	recovered.StopLog()
+	again, err := hnsw.Load(hnsw.SpaceL2, dim, path)
+	if err != nil {
+		t.Fatalf("Load failed: %v", err)
+	}
+	defer again.Close()
+	if replayed, err := again.StartLog(path, false); err != nil || replayed != 0 {
+		t.Fatalf("StartLog after compaction: replayed %d, err %v", replayed, err)
+	}
+	if again.GetCurrentCount() != 600 || again.GetDeletedCount() != 2 {
+		t.Fatalf("compacted index has %d elements, %d deleted", again.GetCurrentCount(), again.GetDeletedCount())
+	}
+}
+
+func TestLogReplaysReplacementsInOrder(t *testing.T) {
+	const dim, size = 8, 100
+	path := filepath.Join(t.TempDir(), "index.bin")
+	vectors := randomVectors(4*size, dim, 3)
+	options := hnsw.Options{AllowReplaceDeleted: true}
+
+	// every AddReplace past the first size needs the slot the delete before it freed
+	index := hnsw.NewWithOptions(hnsw.SpaceL2, dim, size, 16, 100, 42, options)
+	if _, err := index.StartLog(path, false); err != nil {
+		t.Fatal(err)
+	}
+	for i := range vectors {
+		if i >= size {
+			if err := index.MarkDeleted(uint64(i - size)); err != nil {
+				t.Fatalf("MarkDeleted(%d) failed: %v", i-size, err)
+			}
+		}
+		if err := index.AddReplace(vectors[i], uint64(i)); err != nil {
+			t.Fatalf("AddReplace(%d) failed: %v", i, err)
+		}
+	}
+	index.Close()
+
+	recovered := hnsw.NewWithOptions(hnsw.SpaceL2, dim, size, 16, 100, 42, options)
+	defer recovered.Close()
+	if _, err := recovered.StartLog(path, false); err != nil {
+		t.Fatalf("StartLog failed: %v", err)
+	}
+	if recovered.GetCurrentCount() != size || recovered.GetDeletedCount() != 0 {
+		t.Fatalf("recovered %d elements, %d deleted; want %d, 0",
+			recovered.GetCurrentCount(), recovered.GetDeletedCount(), size)
+	}
+	for i := 3 * size; i < 4*size; i++ {
+		if vec, err := recovered.GetVector(uint64(i)); err != nil || vec[0] != vectors[i][0] {
+			t.Fatalf("label %d was not replayed (err %v)", i, err)
+		}
+	}
+	recovered.StopLog()
+}
+
+func TestLogStopsAtTornRecord(t *testing.T) {
+	const dim = 8
+	path := filepath.Join(t.TempDir(), "index.bin")
+	index := hnsw.New(hnsw.SpaceL2, dim, 100, 16, 100, 42)
+	if _, err := index.StartLog(path, true); err != nil {
+		t.Fatal(err)
+	}
+	for i, vec := range randomVectors(10, dim, 2) {
+		index.Add(vec, uint64(i))
+	}
+	index.Close()
+
+	// cut the last record in half, as a crash in the middle of a write would
+	info, err := os.Stat(path + ".wal")
+	if err != nil {
+		t.Fatal(err)
+	}
+	if err := os.Truncate(path+".wal", info.Size()-20); err != nil {
+		t.Fatal(err)
+	}
+
+	recovered := hnsw.New(hnsw.SpaceL2, dim, 100, 16, 100, 42)
+	defer recovered.Close()
+	replayed, err := recovered.StartLog(path, false)
+	if err != nil || replayed != 9 || recovered.GetCurrentCount() != 9 {
+		t.Fatalf("replayed %d records into %d elements (err %v), want 9", replayed, recovered.GetCurrentCount(), err)
+	}
+	// appends continue after the last intact record
+	recovered.Add(make([]float32, dim), 100)
+	recovered.StopLog()
+	onceMore := hnsw.New(hnsw.SpaceL2, dim, 100, 16, 100, 42)
+	defer onceMore.Close()
+	if replayed, err := onceMore.StartLog(path, false); err != nil || replayed != 10 {
+		t.Fatalf("replayed %d records after appending past a torn tail (err %v), want 10", replayed, err)
+	}
+}
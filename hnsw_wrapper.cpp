@@ -1,117 +1,1544 @@
 //hnsw_wrapper.cpp
 #include <iostream>
 #include "hnswlib/hnswlib.h"
+#include "hnswlib/executor.h"
 #include "hnsw_wrapper.h"
 #include <thread>
 #include <atomic>
 #include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <unordered_set>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <sstream>
+#include <tuple>
+#if !defined(_WIN32)
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Runs fn(id, threadId) for every id in [start, end) on numThreads threads of
+// the process-wide executor, the calling thread included, so concurrent batch
+// calls on any number of indexes share one pool instead of spawning threads.
+// The first exception thrown by fn stops the loop and is rethrown to the caller.
+template<class Function>
+inline void ParallelFor(size_t start, size_t end, size_t numThreads, Function fn) {
+    hnswlib::Executor::instance().parallelFor(start, end, numThreads, fn);
+}
+
+// Resolves the thread count for a batch of rows; small batches are not worth
+// the cost of spawning threads.
+static size_t batchThreads(int num_threads, size_t rows) {
+    size_t n = num_threads > 0 ? (size_t)num_threads : hnswlib::Executor::instance().size();
+    if (rows <= n * 4) n = 1;
+    return n;
+}
+
+class SearchQueue;
+
+// for_each of the compaction functions, running on the whole executor.
+static void parallelForEach(size_t begin, size_t end, const std::function<void(size_t)>& fn) {
+    ParallelFor(begin, end, batchThreads(0, end - begin), [&](size_t id, size_t /*threadId*/) { fn(id); });
+}
+
+// Histograms of the per-search counters of an index (hnswlib::SearchStats). A
+// search records into one of a few cache-line aligned shards picked per thread,
+// so concurrent searches rarely write the same lines; read() sums the shards.
+// Bucket b counts searches whose value has b significant bits, i.e. 0 in bucket
+// 0 and [2^(b-1), 2^b) in bucket b; the last bucket also takes larger values.
+class SearchHistograms {
+ public:
+    static const int NUM_METRICS = 4;  // hops, distance computations, visited, deleted skipped
+    static const int NUM_BUCKETS = 32;
+
+ private:
+    static const int NUM_SHARDS = 16;
+    struct alignas(64) Shard {
+        std::atomic<unsigned long long> searches;
+        std::atomic<unsigned long long> sums[NUM_METRICS];
+        std::atomic<unsigned long long> buckets[NUM_METRICS][NUM_BUCKETS];
+    };
+    Shard shards_[NUM_SHARDS];
+
+    static int bucketOf(size_t value) {
+        int bits = 0;
+        while (value) {
+            bits++;
+            value >>= 1;
+        }
+        return std::min(bits, NUM_BUCKETS - 1);
+    }
+
+    static Shard& threadShard(Shard* shards) {
+        static std::atomic<unsigned> next_shard{0};
+        static thread_local unsigned shard = next_shard++ % NUM_SHARDS;
+        return shards[shard];
+    }
+
+ public:
+    SearchHistograms() {
+        for (auto& shard : shards_) {
+            shard.searches = 0;
+            for (int m = 0; m < NUM_METRICS; m++) {
+                shard.sums[m] = 0;
+                for (int b = 0; b < NUM_BUCKETS; b++) shard.buckets[m][b] = 0;
+            }
+        }
+    }
+
+    void record(const hnswlib::SearchStats& stats) {
+        Shard& shard = threadShard(shards_);
+        size_t values[NUM_METRICS] = {stats.hops, stats.distance_computations, stats.visited,
+                                      stats.deleted_skipped};
+        shard.searches.fetch_add(1, std::memory_order_relaxed);
+        for (int m = 0; m < NUM_METRICS; m++) {
+            shard.sums[m].fetch_add(values[m], std::memory_order_relaxed);
+            shard.buckets[m][bucketOf(values[m])].fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // sums has NUM_METRICS entries and buckets NUM_METRICS * NUM_BUCKETS (metric-major)
+    void read(unsigned long long* searches, unsigned long long* sums, unsigned long long* buckets) const {
+        *searches = 0;
+        std::fill(sums, sums + NUM_METRICS, 0);
+        std::fill(buckets, buckets + NUM_METRICS * NUM_BUCKETS, 0);
+        for (const auto& shard : shards_) {
+            *searches += shard.searches.load(std::memory_order_relaxed);
+            for (int m = 0; m < NUM_METRICS; m++) {
+                sums[m] += shard.sums[m].load(std::memory_order_relaxed);
+                for (int b = 0; b < NUM_BUCKETS; b++)
+                    buckets[m * NUM_BUCKETS + b] += shard.buckets[m][b].load(std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+// Append-only log of the modifications of an index since its last checkpoint,
+// at <index path>.wal, so modifications are durable without rewriting the index.
+// A record holds one add, delete or undelete with its float32 vector and a
+// CRC-32C; replay stops at the first record that fails it, i.e. one torn by a
+// crash, and the log is cut there. A record sets the final state of its label,
+// so replaying records a snapshot already contains is harmless; checkpoints rely
+// on this to save while writers continue. Modifications hold gate shared from
+// logging to applying (and a per-label stripe, so records and the index agree
+// on the order of operations on a label); checkpoints hold it exclusively, but
+// only for the instants they mark the log and swap in its shortened copy.
+class OpLog {
+ public:
+    enum Type : uint32_t { ADD = 1, ADD_REPLACE = 2, DELETE = 3, UNDELETE = 4 };
+
+    struct Record {
+        uint32_t crc;  // of the rest of the record and the vector
+        uint32_t type;
+        uint64_t label;
+        uint64_t doc_id;
+        uint32_t dim;  // floats following the record, 0 for deletes
+        uint32_t reserved;
+    };
+
+    std::shared_mutex gate;
+    // Serializes checkpoints
+    std::mutex checkpoint_lock;
+
+ private:
+    static const uint64_t MAGIC = 0x004c415757534e48ULL;  // "HNSWWAL"
+    static const uint32_t VERSION = 1;
+    static const size_t NUM_STRIPES = 1024;
+
+    struct Header {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t dim;
+    };
+
+    std::string index_path_;
+    std::string path_;
+    size_t dim_;
+    bool sync_;
+    int fd_ = -1;
+    std::mutex append_lock_;
+    std::unique_ptr<std::mutex[]> stripes_{new std::mutex[NUM_STRIPES]};
+
+    // Appends bytes [begin, end) of the current log to output.
+    void copyRange(hnswlib::AtomicFileWriter& output, size_t begin, size_t end) const {
+        std::ifstream input(path_, std::ios::binary);
+        input.seekg(begin);
+        std::vector<char> chunk(std::min<size_t>(end - begin, size_t(1) << 20));
+        while (begin < end) {
+            size_t size = std::min(chunk.size(), end - begin);
+            if (!input.read(chunk.data(), size)) throw std::runtime_error("Cannot read log");
+            output.write(chunk.data(), size);
+            begin += size;
+        }
+    }
+
+    static void writeAll(int fd, const char* data, size_t size) {
+#if !defined(_WIN32)
+        while (size > 0) {
+            ssize_t written = ::write(fd, data, size);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error("Cannot write log");
+            }
+            data += written;
+            size -= written;
+        }
+#endif
+    }
+
+    void open() {
+#if defined(_WIN32)
+        throw std::runtime_error("Write-ahead logs are not supported on this platform");
+#else
+        fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd_ < 0) throw std::runtime_error("Cannot open log");
+        struct stat st;
+        if (fstat(fd_, &st) != 0) throw std::runtime_error("Cannot open log");
+        if (st.st_size == 0) {
+            Header header = {MAGIC, VERSION, (uint32_t)dim_};
+            writeAll(fd_, (const char*)&header, sizeof(header));
+            if (fsync(fd_) != 0) throw std::runtime_error("Cannot write log");
+        }
+#endif
+    }
+
+ public:
+    static std::string logPath(const std::string& index_path) {
+        return index_path + ".wal";
+    }
+
+    // Opens the log of the index saved at index_path for appending, first cutting
+    // off from valid_size on the torn tail replay found (0 starts a new log).
+    // sync makes every append wait for the disk.
+    OpLog(const std::string& index_path, size_t dim, bool sync, size_t valid_size)
+        : index_path_(index_path), path_(logPath(index_path)), dim_(dim), sync_(sync) {
+#if !defined(_WIN32)
+        if (truncate(path_.c_str(), valid_size) != 0 && errno != ENOENT) throw std::runtime_error("Cannot open log");
+#endif
+        open();
+    }
+
+    ~OpLog() {
+#if !defined(_WIN32)
+        if (fd_ >= 0) close(fd_);
+#endif
+    }
+
+    const std::string& indexPath() const {
+        return index_path_;
+    }
+
+    // Serializes the logging and applying of operations on label.
+    std::mutex& stripe(unsigned long long label) {
+        return stripes_[label % NUM_STRIPES];
+    }
+
+    void append(Type type, unsigned long long label, unsigned long long doc_id, const float* vec) {
+        static thread_local std::vector<char> buffer;
+        Record record = {0, type, label, doc_id, vec ? (uint32_t)dim_ : 0, 0};
+        size_t vector_size = record.dim * sizeof(float);
+        buffer.resize(sizeof(record) + vector_size);
+        memcpy(buffer.data(), &record, sizeof(record));
+        if (vec) memcpy(buffer.data() + sizeof(record), vec, vector_size);
+        record.crc = hnswlib::crc32c(buffer.data() + sizeof(uint32_t), buffer.size() - sizeof(uint32_t));
+        memcpy(buffer.data(), &record.crc, sizeof(record.crc));
+        {
+            std::lock_guard<std::mutex> lock(append_lock_);
+            writeAll(fd_, buffer.data(), buffer.size());
+        }
+#if !defined(_WIN32)
+        if (sync_ && fdatasync(fd_) != 0) throw std::runtime_error("Cannot sync log");
+#endif
+    }
+
+    // Current end of the log, always at a record boundary.
+    size_t size() {
+#if defined(_WIN32)
+        return 0;
+#else
+        std::lock_guard<std::mutex> lock(append_lock_);
+        struct stat st;
+        if (fstat(fd_, &st) != 0) throw std::runtime_error("Cannot read log");
+        return st.st_size;
+#endif
+    }
+
+    // Drops the records before offset, which a checkpoint has saved, by writing
+    // the rest to a new log and renaming it over the old one. The rest is copied
+    // while writers keep appending; gate is taken exclusively only to copy the
+    // records appended meanwhile and to swap the files. The caller must not
+    // hold gate.
+    void dropBefore(size_t offset) {
+#if !defined(_WIN32)
+        hnswlib::AtomicFileWriter output(path_);
+        Header header = {MAGIC, VERSION, (uint32_t)dim_};
+        output.writePOD(header);
+        size_t copied = size();
+        copyRange(output, offset, copied);
+        std::unique_lock<std::shared_mutex> lock(gate);
+        copyRange(output, copied, size());
+        output.commit();
+        close(fd_);
+        fd_ = -1;
+        open();
+#endif
+    }
+
+    // Calls fn(record, vector) for every intact record of the log at path, in
+    // order, and returns the size of the intact prefix of the file (0 if there is
+    // no log). Throws if the file is not a log of dim-dimensional vectors.
+    template<class Function>
+    static size_t replay(const std::string& path, size_t dim, Function fn, size_t* records) {
+        *records = 0;
+        std::ifstream input(path, std::ios::binary);
+        if (!input.is_open()) return 0;
+        Header header;
+        if (!input.read((char*)&header, sizeof(header))) return 0;  // torn while being created
+        if (header.magic != MAGIC || header.version != VERSION) throw std::runtime_error("Not a write-ahead log");
+        if (header.dim != dim) throw std::runtime_error("Log dimension does not match the index");
+        size_t valid = sizeof(header);
+        Record record;
+        std::vector<float> vec(dim);
+        while (input.read((char*)&record, sizeof(record))) {
+            if (record.dim != 0 && record.dim != dim) break;
+            if (record.dim && !input.read((char*)vec.data(), dim * sizeof(float))) break;
+            uint32_t crc = hnswlib::crc32c((const char*)&record + sizeof(uint32_t), sizeof(record) - sizeof(uint32_t));
+            if (record.dim) crc = hnswlib::crc32c(vec.data(), dim * sizeof(float), crc);
+            if (crc != record.crc) break;
+            fn(record, record.dim ? vec.data() : nullptr);
+            valid += sizeof(record) + record.dim * sizeof(float);
+            (*records)++;
+        }
+        return valid;
+    }
+};
+
+// Native state behind an HNSW handle. The index points into the space's
+// distance parameters, so the space is owned here and freed with it.
+struct HNSWIndex {
+    hnswlib::HierarchicalNSW<float>* alg = nullptr;
+    hnswlib::SpaceInterface<float>* space = nullptr;
+    // Set when the space stores vectors compressed (same object as space);
+    // vectors and queries are encoded before they reach alg.
+    hnswlib::QuantizedSpace* quant = nullptr;
+    // Set for document spaces, whose elements are chunks tagged with a document id
+    // (same object as space).
+    hnswlib::BaseMultiVectorSpace<hnswlib::labeltype>* docs = nullptr;
+    // Set for cosine spaces: vectors and queries are scaled to unit length on entry.
+    hnswlib::NORMFUNC normalize = nullptr;
+    // Candidates fetched per result and reranked against the float32 query; <= 1 disables.
+    int rerank = 0;
+    // Rows inserted so far and rows in total of the running or last buildFromFile.
+    std::atomic<unsigned long long> build_done{0};
+    std::atomic<unsigned long long> build_total{0};
+    // Worker pool of submitSearch, created by startSearchQueue.
+    SearchQueue* queue = nullptr;
+    // Work counters of all searches run on this index.
+    SearchHistograms search_stats;
+    // Set while the handle is a flat index, whose searches scan every element;
+    // alg is null until switchToGraph replaces it by a graph for good.
+    std::atomic<hnswlib::BruteforceSearch<float>*> flat{nullptr};
+    // Held shared by operations on flat and exclusively by switchToGraph.
+    std::shared_mutex flat_lock;
+    // Element count above which an insert switches a flat index to a graph (0 = never),
+    // and the parameters of that graph; ef is kept here by setEf while flat.
+    size_t flat_switch = 0;
+    int graph_M = 16;
+    int graph_ef_construction = 200;
+    int graph_seed = 100;
+    size_t graph_ef = 10;
+    // Write-ahead log of modifications, set by startLog.
+    OpLog* wal = nullptr;
+    // Set for a sharded index, whose elements are spread over these indexes by a
+    // hash of their label; alg and flat stay null. Functions taking a label act on
+    // its shard, others on every shard, and searches merge the shards' results.
+    std::vector<HNSWIndex*> shards;
+    // File a read-only index was mapped from, and its per-NUMA-node copies made
+    // by replicateIndex; searches use the copy of the node they run on.
+    std::string mapped_path;
+    std::vector<hnswlib::HierarchicalNSW<float>*> replicas;
+
+    ~HNSWIndex();
+};
+
+static inline HNSWIndex* handle(HNSW index) {
+    return (HNSWIndex*)index;
+}
+
+static inline hnswlib::HierarchicalNSW<float>* algOf(HNSW index) {
+    return ((HNSWIndex*)index)->alg;
+}
+
+// Graph that searches on the calling thread read: the copy on the thread's
+// NUMA node when the index is replicated, otherwise alg.
+static inline hnswlib::HierarchicalNSW<float>* searchGraph(HNSWIndex* h) {
+    if (h->replicas.empty()) return h->alg;
+    return h->replicas[hnswlib::NumaTopology::instance().currentNode() % h->replicas.size()];
+}
+
+static inline bool isSharded(HNSWIndex* h) {
+    return !h->shards.empty();
+}
+
+// Shard holding label. Labels are mixed first (splitmix64's finalizer), so
+// sequential labels spread evenly.
+static HNSWIndex* shardOf(HNSWIndex* h, unsigned long long label) {
+    uint64_t x = label + 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return h->shards[x % h->shards.size()];
+}
+
+// Shard holding the element with internal id id of a sharded index, whose ids
+// number the elements of shard 0 first, then those of shard 1 and so on; id is
+// made relative to the shard. Null if id is out of range.
+static HNSWIndex* shardOfInternalId(HNSWIndex* h, unsigned long long& id) {
+    for (auto* shard : h->shards) {
+        unsigned long long count = getCurrentElementCount(shard);
+        if (id < count) return shard;
+        id -= count;
+    }
+    return nullptr;
+}
+
+template<class Function>
+static unsigned long long sumShards(HNSWIndex* h, Function fn) {
+    unsigned long long sum = 0;
+    for (auto* shard : h->shards) sum += fn(shard);
+    return sum;
+}
+
+// Creates a handle with the space for stype but no index yet.
+static HNSWIndex* newHandle(int dim, char stype) {
+    HNSWIndex* h = new HNSWIndex();
+    switch (stype) {
+    case 'i':
+    case 'c':
+        // Cosine is inner product between normalized vectors
+        h->space = new hnswlib::InnerProductSpace(dim);
+        break;
+    case 'L':
+        h->quant = new hnswlib::SQ8Space(dim, false);
+        break;
+    case 'I':
+    case 'C':
+        h->quant = new hnswlib::SQ8Space(dim, true);
+        break;
+    case 'e':
+        h->quant = new hnswlib::FP16Space(dim, false);
+        break;
+    case 'p':
+    case 'a':
+        h->quant = new hnswlib::FP16Space(dim, true);
+        break;
+    case 'm':
+        h->docs = new hnswlib::MultiVectorL2Space<hnswlib::labeltype>(dim);
+        break;
+    case 'n':
+    case 'o':
+        h->docs = new hnswlib::MultiVectorInnerProductSpace<hnswlib::labeltype>(dim);
+        break;
+    default:
+        h->space = new hnswlib::L2Space(dim);
+    }
+    if (h->quant) h->space = h->quant;
+    if (h->docs) h->space = h->docs;
+    if (stype == 'c' || stype == 'C' || stype == 'a' || stype == 'o') h->normalize = hnswlib::selectNormalizeFunc(dim);
+    return h;
+}
+
+// Quantizer parameters are stored next to the index file.
+static std::string quantParamsPath(const std::string& location) {
+    return location + ".sq8";
+}
+
+static void loadQuantParams(HNSWIndex* h, const std::string& location) {
+    if (!h->quant || !h->quant->has_params()) return;
+    std::ifstream input(quantParamsPath(location), std::ios::binary);
+    if (!input.is_open()) throw std::runtime_error("Cannot open quantizer parameters");
+    h->quant->load_params(input);
+}
+
+// Loads an index written by saveHandle; mapped selects the read-only
+// memory-mapped format of saveIndexMmap.
+static HNSWIndex* loadHandle(const std::string& location, int dim, char stype, bool mapped,
+                             bool allow_replace_deleted = false) {
+    std::unique_ptr<HNSWIndex> h(newHandle(dim, stype));
+    loadQuantParams(h.get(), location);
+    if (mapped) {
+        h->alg = new hnswlib::HierarchicalNSW<float>(h->space);
+        h->alg->loadIndexMmap(location, h->space);
+        h->mapped_path = location;
+    } else {
+        h->alg = new hnswlib::HierarchicalNSW<float>(h->space, location, false, 0, allow_replace_deleted);
+        h->alg->setAutoGrow(true);
+    }
+    return h.release();
+}
+
+// Runs fn(flat) with the flat lock held shared and returns true while h is a
+// flat index; returns false once it is a graph, so the caller uses alg instead.
+template<class Function>
+static bool withFlat(HNSWIndex* h, Function fn) {
+    if (!h->flat.load(std::memory_order_acquire)) return false;
+    std::shared_lock<std::shared_mutex> lock(h->flat_lock);
+    hnswlib::BruteforceSearch<float>* flat = h->flat.load(std::memory_order_acquire);
+    if (!flat) return false;
+    fn(*flat);
+    return true;
+}
+
+static bool isFlat(HNSWIndex* h) {
+    return h->flat.load(std::memory_order_acquire) != nullptr;
+}
+
+// Replaces a flat index that holds more than flat_switch elements by an HNSW
+// graph of the same elements. Other operations on the index wait for the graph
+// to be built; the elements are stored encoded, so they are inserted as they are.
+static void switchToGraph(HNSWIndex* h) {
+    size_t count = 0;
+    if (h->flat_switch == 0) return;
+    if (!withFlat(h, [&](hnswlib::BruteforceSearch<float>& flat) { count = flat.getCurrentElementCount(); }) ||
+        count <= h->flat_switch)
+        return;
+    std::unique_lock<std::shared_mutex> lock(h->flat_lock);
+    hnswlib::BruteforceSearch<float>* flat = h->flat.load(std::memory_order_relaxed);
+    if (!flat || flat->getCurrentElementCount() <= h->flat_switch) return;
+    size_t n = flat->getCurrentElementCount();
+    std::unique_ptr<hnswlib::HierarchicalNSW<float>> alg(new hnswlib::HierarchicalNSW<float>(
+        h->space, std::max(n, flat->getMaxElements()), h->graph_M, h->graph_ef_construction, h->graph_seed));
+    alg->setAutoGrow(true);
+    alg->ef_ = h->graph_ef;
+    ParallelFor(0, n, batchThreads(0, n), [&](size_t id, size_t /*threadId*/) {
+        static thread_local std::vector<char> point;
+        point.resize(h->space->get_data_size());
+        hnswlib::labeltype label = 0;
+        // the flat index stays in place if the switch fails
+        if (!flat->getElement(id, &label, point.data()))
+            throw std::runtime_error("Flat index changed while switching to a graph");
+        alg->addPoint(point.data(), label);
+    });
+    h->alg = alg.release();
+    h->flat.store(nullptr, std::memory_order_release);
+    lock.unlock();
+    delete flat;
+}
+
+// A sharded index is saved as a directory holding shard-<generation>-<i> for
+// each shard, in the format of saveHandle, and a manifest naming the generation,
+// written last. Each save writes a new generation beside the files of the last
+// one, so until its manifest replaces the old one, a crash or a failed save
+// leaves the previous save whole, whatever the shard counts of either; the
+// files of the previous generation are removed once the new manifest is in
+// place. Version 1 manifests, without a generation, name shard-<i>.
+static const uint64_t SHARDS_MAGIC = 0x5344524148535748ULL;  // "HWSHARDS"
+static const uint32_t SHARDS_VERSION = 2;
+
+struct ShardsManifest {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t num_shards;
+    uint64_t generation;  // version 2 on
+};
+
+static std::string shardPath(const std::string& location, const ShardsManifest& manifest, size_t shard) {
+    if (manifest.version < 2) return location + "/shard-" + std::to_string(shard);
+    return location + "/shard-" + std::to_string(manifest.generation) + "-" + std::to_string(shard);
+}
+
+static std::string manifestPath(const std::string& location) {
+    return location + "/manifest";
+}
+
+// Reads the manifest of the sharded index at location; false if there is none
+// or it is not one.
+static bool readManifest(const std::string& location, ShardsManifest* manifest) {
+    std::ifstream input(manifestPath(location), std::ios::binary);
+    *manifest = ShardsManifest{};
+    size_t fixed = offsetof(ShardsManifest, generation);
+    if (!input.read((char*)manifest, fixed) || manifest->magic != SHARDS_MAGIC || manifest->num_shards == 0)
+        return false;
+    if (manifest->version == 1) return true;
+    return manifest->version == SHARDS_VERSION &&
+           input.read((char*)manifest + fixed, sizeof(*manifest) - fixed);
+}
+
+// packed selects the packed link lists of saveIndexMmap; mapped must be set.
+static void saveHandle(HNSWIndex* h, const std::string& location, bool mapped, bool packed = false) {
+    if (isSharded(h)) {
+        if (mapped) throw std::runtime_error("Sharded indexes have no memory-mapped format");
+#if defined(_WIN32)
+        throw std::runtime_error("Sharded indexes are not supported on this platform");
+#else
+        if (mkdir(location.c_str(), 0755) != 0 && errno != EEXIST) throw std::runtime_error("Cannot create directory");
+#endif
+        ShardsManifest previous;
+        bool replacing = readManifest(location, &previous);
+        // above every generation saved before, even by a save that failed after
+        // writing some of its shards
+        uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::system_clock::now().time_since_epoch()).count();
+        ShardsManifest manifest{SHARDS_MAGIC, SHARDS_VERSION, (uint32_t)h->shards.size(),
+                                std::max(now, replacing ? previous.generation + 1 : 0)};
+        ParallelFor(0, h->shards.size(), h->shards.size(), [&](size_t shard, size_t /*threadId*/) {
+            saveHandle(h->shards[shard], shardPath(location, manifest, shard), false);
+        });
+        hnswlib::AtomicFileWriter output(manifestPath(location));
+        output.writePOD(manifest);
+        output.commit();
+        if (replacing && previous.generation != manifest.generation) {
+            for (size_t shard = 0; shard < previous.num_shards; shard++) {
+                std::string path = shardPath(location, previous, shard);
+                std::remove(path.c_str());
+                std::remove(quantParamsPath(path).c_str());
+            }
+        }
+        return;
+    }
+    bool flat = withFlat(h, [&](hnswlib::BruteforceSearch<float>& flat) {
+        if (mapped) throw std::runtime_error("Flat indexes have no memory-mapped format");
+        flat.saveIndex(location);
+    });
+    if (!flat) {
+        if (mapped) {
+            h->alg->saveIndexMmap(location, packed);
+        } else {
+            h->alg->saveIndex(location);
+        }
+    }
+    if (h->quant && h->quant->has_params()) {
+        std::ofstream output(quantParamsPath(location), std::ios::binary);
+        h->quant->save_params(output);
+        if (!output) throw std::runtime_error("Cannot write quantizer parameters");
+    }
+}
+
+// Returns vec scaled to unit length for cosine spaces, in a per-thread buffer
+// that stays valid until the next call, and vec itself otherwise.
+static const float* normalizeVector(HNSWIndex* h, const float* vec) {
+    if (!h->normalize) return vec;
+    static thread_local std::vector<float> scratch;
+    size_t dim = *((size_t*)h->space->get_dist_func_param());
+    scratch.resize(dim);
+    h->normalize(vec, scratch.data(), dim);
+    return scratch.data();
+}
+
+// Returns vec as stored by the index: vec itself for float32 spaces, otherwise
+// its encoding in a per-thread buffer that stays valid until the next call.
+// Cosine vectors are normalized first, and document spaces store doc_id after
+// the vector (queries can leave it 0, distances only read the vector).
+static const void* encodeVector(HNSWIndex* h, const float* vec, unsigned long long doc_id = 0) {
+    vec = normalizeVector(h, vec);
+    if (h->docs) {
+        static thread_local std::vector<char> point;
+        point.resize(h->docs->get_data_size());
+        memcpy(point.data(), vec, *((size_t*)h->docs->get_dist_func_param()) * sizeof(float));
+        h->docs->set_doc_id(point.data(), doc_id);
+        return point.data();
+    }
+    if (!h->quant) return vec;
+    if (!h->quant->is_trained()) throw std::runtime_error("Quantizer is not trained");
+    static thread_local std::vector<char> scratch;
+    scratch.resize(h->quant->get_data_size());
+    h->quant->encode(vec, scratch.data());
+    return scratch.data();
+}
+
+static void decodeVector(HNSWIndex* h, const char* stored, float* vector) {
+    if (h->quant) {
+        h->quant->decode(stored, vector);
+    } else {
+        memcpy(vector, stored, *((size_t*)h->space->get_dist_func_param()) * sizeof(float));
+    }
+}
+
+static_assert(sizeof(unsigned long long) == sizeof(hnswlib::labeltype), "labels are written in place");
+
+// Trains the quantizer of h on n rows of data; the shards of a sharded index
+// get the same parameters, so all of them encode alike.
+static void trainQuantizers(HNSWIndex* h, const float* data, size_t n) {
+    h->quant->train(data, n);
+    if (!isSharded(h)) return;
+    std::stringstream params;
+    h->quant->save_params(params);
+    for (auto* shard : h->shards) {
+        params.seekg(0);
+        shard->quant->load_params(params);
+    }
+}
+
+// Loads a directory written by saveHandle for a sharded index.
+static HNSWIndex* loadShardedHandle(const std::string& location, int dim, char stype) {
+    ShardsManifest manifest;
+    if (!readManifest(location, &manifest)) throw std::runtime_error("Not a sharded index");
+    std::unique_ptr<HNSWIndex> h(newHandle(dim, stype));
+    std::vector<std::unique_ptr<HNSWIndex>> shards(manifest.num_shards);
+    ParallelFor(0, shards.size(), shards.size(), [&](size_t shard, size_t /*threadId*/) {
+        shards[shard].reset(loadHandle(shardPath(location, manifest, shard), dim, stype, false));
+    });
+    for (auto& shard : shards) h->shards.push_back(shard.release());
+    // the parameters of every shard are the same (see trainQuantizers)
+    loadQuantParams(h.get(), shardPath(location, manifest, 0));
+    return h.release();
+}
+
+// Runs apply, logging the operation first when the index has a write-ahead log.
+template<class Function>
+static void logged(HNSWIndex* h, OpLog::Type type, unsigned long long label, unsigned long long doc_id,
+                   const float* vec, Function apply) {
+    if (!h->wal) {
+        apply();
+        return;
+    }
+    std::shared_lock<std::shared_mutex> gate(h->wal->gate);
+    std::lock_guard<std::mutex> stripe(h->wal->stripe(label));
+    h->wal->append(type, label, doc_id, vec);
+    apply();
+}
+
+// Adds vec under label (document spaces tag it with doc_id), switching a flat
+// index that has grown past its threshold to a graph. A sharded index logs the
+// insert itself and adds the vector to the label's shard.
+static void insertVector(HNSWIndex* h, const float* vec, unsigned long long label, unsigned long long doc_id,
+                         bool replace_deleted = false) {
+    OpLog::Type type = replace_deleted ? OpLog::ADD_REPLACE : OpLog::ADD;
+    logged(h, type, label, doc_id, vec, [&] {
+        HNSWIndex* target = isSharded(h) ? shardOf(h, label) : h;
+        const void* point = encodeVector(target, vec, doc_id);
+        if (withFlat(target, [&](hnswlib::BruteforceSearch<float>& flat) { flat.addPoint(point, label); })) {
+            switchToGraph(target);
+        } else {
+            target->alg->addPoint(point, label, replace_deleted);
+        }
+    });
+}
+
+// Clears the calling thread's search counters; endSearchStats records the
+// counters of the search run since into the index's histograms and, when out is
+// non-null, copies them to out[0..4): hops, distance computations, visited nodes
+// and deleted nodes skipped.
+static inline void beginSearchStats() {
+    hnswlib::threadSearchStats() = hnswlib::SearchStats();
+}
+
+static void addSearchStats(hnswlib::SearchStats& total, const hnswlib::SearchStats& stats) {
+    total.hops += stats.hops;
+    total.distance_computations += stats.distance_computations;
+    total.visited += stats.visited;
+    total.deleted_skipped += stats.deleted_skipped;
+}
+
+static void endSearchStats(HNSWIndex* h, unsigned long long* out) {
+    const hnswlib::SearchStats& stats = hnswlib::threadSearchStats();
+    h->search_stats.record(stats);
+    if (out) {
+        out[0] = stats.hops;
+        out[1] = stats.distance_computations;
+        out[2] = stats.visited;
+        out[3] = stats.deleted_skipped;
+    }
+}
+
+// Merges the closest-first result lists of n shards, list i holding count[i]
+// pairs from label[i * k] and dist[i * k], into the k closest overall. A heap of
+// the best k so far is kept, its worst on top, and a list is left as soon as
+// its next pair is no better than that worst, which is all of it on later
+// lists once the heap holds the true top-k.
+static int mergeShardResults(size_t n, int k, const int* count, const unsigned long long* label, const float* dist,
+                             unsigned long long* out_label, float* out_dist) {
+    static thread_local std::vector<std::pair<float, unsigned long long>> heap;
+    heap.clear();
+    for (size_t i = 0; i < n; i++) {
+        for (int j = 0; j < count[i]; j++) {
+            std::pair<float, unsigned long long> pair(dist[i * k + j], label[i * k + j]);
+            if ((int)heap.size() < k) {
+                heap.push_back(pair);
+                std::push_heap(heap.begin(), heap.end());
+            } else if (pair < heap.front()) {
+                std::pop_heap(heap.begin(), heap.end());
+                heap.back() = pair;
+                std::push_heap(heap.begin(), heap.end());
+            } else {
+                break;
+            }
+        }
+    }
+    std::sort_heap(heap.begin(), heap.end());
+    for (size_t i = 0; i < heap.size(); i++) {
+        out_dist[i] = heap[i].first;
+        out_label[i] = heap[i].second;
+    }
+    return heap.size();
+}
+
+static int searchInto(HNSWIndex* h, const float* vec, int k, int ef, unsigned long long* label, float* dist,
+                      hnswlib::BaseFilterFunctor* filter = nullptr, unsigned long long* stats = nullptr);
+
+// searchInto of a sharded index: every shard is searched for k on the shared
+// pool, and their counters are summed.
+static int searchShards(HNSWIndex* h, const float* vec, int k, int ef, unsigned long long* label, float* dist,
+                        hnswlib::BaseFilterFunctor* filter, unsigned long long* stats) {
+    size_t n = h->shards.size();
+    std::vector<int> count(n);
+    std::vector<unsigned long long> shard_label(n * k);
+    std::vector<float> shard_dist(n * k);
+    std::vector<hnswlib::SearchStats> shard_stats(n);
+    ParallelFor(0, n, n, [&](size_t i, size_t /*threadId*/) {
+        count[i] = searchInto(h->shards[i], vec, k, ef, &shard_label[i * k], &shard_dist[i * k], filter);
+        shard_stats[i] = hnswlib::threadSearchStats();
+    });
+    beginSearchStats();
+    hnswlib::SearchStats& total = hnswlib::threadSearchStats();
+    for (const auto& shard : shard_stats) addSearchStats(total, shard);
+    endSearchStats(h, stats);
+    return mergeShardResults(n, k, count.data(), shard_label.data(), shard_dist.data(), label, dist);
+}
+
+// Writes the k nearest neighbors of vec to label/dist, closest first, and
+// returns how many were found; its counters go to stats as in endSearchStats.
+// Working storage is per-thread and reused, so warm searches do not allocate.
+// When reranking a quantized index, rerank * k candidates are fetched with the
+// encoded query and reordered by their distance to the float32 query.
+static int searchInto(HNSWIndex* h, const float* vec, int k, int ef, unsigned long long* label, float* dist,
+                      hnswlib::BaseFilterFunctor* filter, unsigned long long* stats) {
+    if (isSharded(h)) return searchShards(h, vec, k, ef, label, dist, filter, stats);
+    const void* query = encodeVector(h, vec);
+    size_t search_ef = ef > 0 ? ef : 0;  // 0 uses the index's ef
+    beginSearchStats();
+    int found_flat = 0;
+    if (withFlat(h, [&](hnswlib::BruteforceSearch<float>& flat) {
+            found_flat = flat.searchKnnInto(query, k, dist, (hnswlib::labeltype*)label, filter);
+            hnswlib::threadSearchStats().distance_computations += flat.getCurrentElementCount();
+        })) {
+        endSearchStats(h, stats);
+        return found_flat;
+    }
+    hnswlib::HierarchicalNSW<float>* alg = searchGraph(h);
+    if (!h->quant || h->rerank <= 1) {
+        int n = alg->searchKnnInto(query, k, dist, (hnswlib::labeltype*)label, filter, nullptr, search_ef);
+        endSearchStats(h, stats);
+        return n;
+    }
+
+    static thread_local std::vector<float> candidate_dist;
+    static thread_local std::vector<hnswlib::tableint> candidate_ids;
+    static thread_local std::vector<std::pair<float, hnswlib::tableint>> found;
+    size_t fetch = (size_t)k * h->rerank;
+    candidate_dist.resize(fetch);
+    candidate_ids.resize(fetch);
+    size_t n = alg->searchKnnInto(query, fetch, candidate_dist.data(), nullptr, filter, candidate_ids.data(),
+                                          search_ef);
+
+    vec = normalizeVector(h, vec);
+    found.clear();
+    for (size_t i = 0; i < n; i++) {
+        hnswlib::tableint id = candidate_ids[i];
+        found.emplace_back(h->quant->asymmetric_dist(vec, alg->getDataByInternalId(id)), id);
+    }
+    size_t m = std::min(n, (size_t)k);
+    std::partial_sort(found.begin(), found.begin() + m, found.end());
+    for (size_t i = 0; i < m; i++) {
+        dist[i] = found[i].first;
+        label[i] = alg->getExternalLabel(found[i].second);
+    }
+    hnswlib::threadSearchStats().distance_computations += n;
+    endSearchStats(h, stats);
+    return m;
+}
+
+// Allows label l when bit l % 64 of words[l / 64] is set.
+class BitmapFilter : public hnswlib::BaseFilterFunctor {
+    const unsigned long long* words_;
+    size_t num_words_;
+
+ public:
+    BitmapFilter(const unsigned long long* words, size_t num_words) : words_(words), num_words_(num_words) {}
+
+    bool operator()(hnswlib::labeltype id) {
+        size_t word = id >> 6;
+        return word < num_words_ && ((words_[word] >> (id & 63)) & 1);
+    }
+};
+
+// Allows the labels of an ascending list.
+class SortedListFilter : public hnswlib::BaseFilterFunctor {
+    const unsigned long long* begin_;
+    const unsigned long long* end_;
+
+ public:
+    SortedListFilter(const unsigned long long* labels, size_t n) : begin_(labels), end_(labels + n) {}
+
+    bool operator()(hnswlib::labeltype id) {
+        return std::binary_search(begin_, end_, (unsigned long long)id);
+    }
+};
+
+// Bounded lock-free multi-producer multi-consumer ring of slot numbers, after
+// Dmitry Vyukov's design: each cell's sequence number tells producers and
+// consumers whose turn it is, so push and pop are a single CAS when uncontended.
+// It never holds more slots than it was sized for, so a push cannot find it
+// full; it can only find its cell still being vacated by a pop that has claimed
+// it but not yet released it, and then waits for that pop.
+class SlotRing {
+    struct Cell {
+        std::atomic<size_t> seq;
+        uint32_t slot = 0;
+    };
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+
+ public:
+    // capacity is rounded up to a power of two
+    explicit SlotRing(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        cells_.reset(new Cell[size]);
+        for (size_t i = 0; i < size; i++) cells_[i].seq.store(i, std::memory_order_relaxed);
+        mask_ = size - 1;
+    }
+
+    void push(uint32_t slot) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                std::this_thread::yield();  // a pop of this cell is in progress
+                pos = tail_.load(std::memory_order_relaxed);
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->slot = slot;
+        cell->seq.store(pos + 1, std::memory_order_release);
+    }
+
+    bool pop(uint32_t& slot) {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false;  // empty
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+        slot = cell->slot;
+        cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+// Fixed pool of worker threads serving searches submitted without blocking the
+// caller. A submitted query is copied into a free slot, whose number travels
+// through the submitted ring to a worker and then through the completed ring
+// to pollers, which copy the results out and free the slot. The queue is full
+// when the free ring is empty. Threads only take
+// the mutex to sleep when their ring is empty, and producers only take it to
+// wake a sleeper.
+class SearchQueue {
+    HNSWIndex* h_;
+    size_t dim_;
+    size_t max_k_;
+    std::vector<float> queries_;
+    std::vector<unsigned long long> labels_;
+    std::vector<float> dists_;
+    std::vector<unsigned long long> tickets_;
+    std::vector<int> ks_;
+    std::vector<int> efs_;
+    std::vector<int> counts_;
+    SlotRing free_;
+    SlotRing submitted_;
+    SlotRing completed_;
+
+    std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+    std::atomic<int> idle_workers_{0};
+    std::atomic<int> waiting_pollers_{0};
+    std::atomic<int> polling_{0};
+    std::atomic<bool> stop_{false};
+    std::vector<std::thread> workers_;
+
+    void work() {
+        uint32_t slot = 0;
+        for (;;) {
+            if (!submitted_.pop(slot)) {
+                std::unique_lock<std::mutex> lock(mutex_);
+                idle_workers_++;
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                work_cv_.wait(lock, [&] { return stop_ || submitted_.pop(slot); });
+                idle_workers_--;
+                if (stop_) return;
+            }
+            try {
+                counts_[slot] = searchInto(h_, queries_.data() + slot * dim_, ks_[slot], efs_[slot],
+                                           labels_.data() + slot * max_k_, dists_.data() + slot * max_k_);
+            } catch (...) {
+                counts_[slot] = -1;
+            }
+            completed_.push(slot);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (waiting_pollers_ > 0) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                done_cv_.notify_one();
+            }
+        }
+    }
+
+ public:
+    // node >= 0 keeps the workers on the cpus of that NUMA node.
+    SearchQueue(HNSWIndex* h, size_t num_threads, size_t capacity, size_t max_k, int node = -1)
+        : h_(h), dim_(*((size_t*)h->space->get_dist_func_param())), max_k_(max_k),
+          queries_(capacity * dim_), labels_(capacity * max_k), dists_(capacity * max_k),
+          tickets_(capacity), ks_(capacity), efs_(capacity), counts_(capacity),
+          free_(capacity), submitted_(capacity), completed_(capacity) {
+        for (uint32_t slot = 0; slot < capacity; slot++) free_.push(slot);
+        for (size_t i = 0; i < num_threads; i++) {
+            workers_.emplace_back([this] { work(); });
+            if (node >= 0) hnswlib::pinThreadToNode(workers_.back(), node);
+        }
+    }
+
+    ~SearchQueue() {
+        stop();
+    }
+
+    bool stopped() const {
+        return stop_;
+    }
+
+    // Joins the workers and wakes blocked pollers; queued searches are dropped.
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+            work_cv_.notify_all();
+            done_cv_.notify_all();
+        }
+        for (auto& worker : workers_) worker.join();
+        workers_.clear();
+        while (polling_ > 0) std::this_thread::yield();
+    }
+
+    bool submit(const float* query, int k, int ef, unsigned long long ticket) {
+        uint32_t slot = 0;
+        if (stop_ || k <= 0 || (size_t)k > max_k_ || !free_.pop(slot)) return false;
+        memcpy(queries_.data() + slot * dim_, query, dim_ * sizeof(float));
+        ks_[slot] = k;
+        efs_[slot] = ef;
+        tickets_[slot] = ticket;
+        submitted_.push(slot);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (idle_workers_ > 0) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            work_cv_.notify_one();
+        }
+        return true;
+    }
+
+    // Copies up to max_results completed searches out, waiting up to timeout_ms
+    // (< 0 waits forever) for the first one. Returns how many were copied.
+    int poll(unsigned long long* tickets, int* counts, unsigned long long* labels, float* dists,
+             int max_results, int timeout_ms) {
+        polling_++;
+        int n = 0;
+        uint32_t slot = 0;
+        while (n < max_results && !stop_) {
+            if (!completed_.pop(slot)) {
+                if (n > 0 || timeout_ms == 0) break;
+                std::unique_lock<std::mutex> lock(mutex_);
+                waiting_pollers_++;
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                auto ready = [&] { return stop_ || completed_.pop(slot); };
+                bool found;
+                if (timeout_ms < 0) {
+                    done_cv_.wait(lock, ready);
+                    found = !stop_;
+                } else {
+                    found = done_cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready) && !stop_;
+                }
+                waiting_pollers_--;
+                if (!found) break;
+            }
+            tickets[n] = tickets_[slot];
+            counts[n] = counts_[slot];
+            if (counts_[slot] > 0) {
+                memcpy(labels + n * max_k_, labels_.data() + slot * max_k_, counts_[slot] * sizeof(unsigned long long));
+                memcpy(dists + n * max_k_, dists_.data() + slot * max_k_, counts_[slot] * sizeof(float));
+            }
+            free_.push(slot);
+            n++;
+        }
+        polling_--;
+        return n;
+    }
+};
+
+HNSWIndex::~HNSWIndex() {
+    delete queue;
+    delete wal;
+    delete flat.load();
+    for (auto* shard : shards) delete shard;
+    for (auto* replica : replicas) delete replica;
+    delete alg;
+    delete space;
+}
 
 HNSW initHNSW(int dim, unsigned long long int max_elements, int M, int ef_construction, int rand_seed, char stype) {
-  hnswlib::SpaceInterface<float> *space;
-  if (stype == 'i' || stype == 'c') {
-    // Both inner product and cosine use inner product space
-    // For cosine, vectors will be normalized at the Go level
-    space = new hnswlib::InnerProductSpace(dim);
-  } else {
-    space = new hnswlib::L2Space(dim);
+  return initHNSWWithOptions(dim, max_elements, M, ef_construction, rand_seed, stype, 0);
+}
+
+HNSW initHNSWWithOptions(int dim, unsigned long long int max_elements, int M, int ef_construction, int rand_seed,
+                         char stype, int allow_replace_deleted) {
+  HNSWIndex *h = newHandle(dim, stype);
+  h->alg = new hnswlib::HierarchicalNSW<float>(h->space, max_elements, M, ef_construction, rand_seed,
+                                               allow_replace_deleted != 0);
+  h->alg->setAutoGrow(true);
+  return (void*)h;
+}
+
+// Flat handle over an exact index of max_elements (grown as needed) that
+// switch_threshold > 0 elements turn into a graph of the given parameters.
+static HNSWIndex* newFlatHandle(int dim, char stype, unsigned long long switch_threshold, int M,
+                                int ef_construction, int rand_seed) {
+    std::unique_ptr<HNSWIndex> h(newHandle(dim, stype));
+    h->flat_switch = switch_threshold;
+    h->graph_M = M;
+    h->graph_ef_construction = ef_construction;
+    h->graph_seed = rand_seed;
+    return h.release();
+}
+
+HNSW initFlat(int dim, unsigned long long max_elements, char stype, unsigned long long switch_threshold, int M,
+              int ef_construction, int rand_seed) {
+  try {
+    std::unique_ptr<HNSWIndex> h(newFlatHandle(dim, stype, switch_threshold, M, ef_construction, rand_seed));
+    auto* flat = new hnswlib::BruteforceSearch<float>(h->space, max_elements);
+    flat->setAutoGrow(true);
+    h->flat = flat;
+    return (void*)h.release();
+  } catch (const std::exception& e) {
+    return nullptr;
   }
-  hnswlib::HierarchicalNSW<float> *appr_alg = new hnswlib::HierarchicalNSW<float>(space, max_elements, M, ef_construction, rand_seed);
-  return (void*)appr_alg;
 }
 
-HNSW loadHNSW(char *location, int dim, char stype) {
-  hnswlib::SpaceInterface<float> *space;
-  if (stype == 'i' || stype == 'c') {
-    space = new hnswlib::InnerProductSpace(dim);
-  } else {
-    space = new hnswlib::L2Space(dim);
+HNSW loadFlat(char *location, int dim, char stype, unsigned long long switch_threshold, int M,
+              int ef_construction, int rand_seed) {
+  try {
+    std::unique_ptr<HNSWIndex> h(newFlatHandle(dim, stype, switch_threshold, M, ef_construction, rand_seed));
+    loadQuantParams(h.get(), location);
+    auto* flat = new hnswlib::BruteforceSearch<float>(h->space, std::string(location));
+    flat->setAutoGrow(true);
+    h->flat = flat;
+    switchToGraph(h.get());
+    return (void*)h.release();
+  } catch (const std::exception& e) {
+    return nullptr;
+  }
+}
+
+int getIndexType(HNSW index) {
+    auto* h = handle(index);
+    return isSharded(h) ? 2 : isFlat(h) ? 1 : 0;
+}
+
+// Each shard is a graph of max_elements / num_shards elements (grown as
+// needed) seeded rand_seed + its number.
+HNSW initSharded(int dim, unsigned long long max_elements, int M, int ef_construction, int rand_seed, char stype,
+                 int num_shards) {
+  try {
+    if (num_shards <= 0) return nullptr;
+    std::unique_ptr<HNSWIndex> h(newHandle(dim, stype));
+    unsigned long long part = (max_elements + num_shards - 1) / num_shards;
+    h->shards.reserve(num_shards);
+    for (int i = 0; i < num_shards; i++)
+      h->shards.push_back((HNSWIndex*)initHNSW(dim, part, M, ef_construction, rand_seed + i, stype));
+    return (void*)h.release();
+  } catch (const std::exception& e) {
+    return nullptr;
+  }
+}
+
+HNSW loadSharded(char *location, int dim, char stype) {
+  try {
+    return (void*)loadShardedHandle(std::string(location), dim, stype);
+  } catch (const std::exception& e) {
+    return nullptr;
   }
-  hnswlib::HierarchicalNSW<float> *appr_alg = new hnswlib::HierarchicalNSW<float>(space, std::string(location), false, 0);
-  return (void*)appr_alg;
+}
+
+HNSW loadHNSW(char *location, int dim, char stype) {
+  return (void*)loadHandle(std::string(location), dim, stype, false);
 }
 
 HNSW loadHNSWSafe(char *location, int dim, char stype) {
   try {
-    hnswlib::SpaceInterface<float> *space;
-    if (stype == 'i' || stype == 'c') {
-      space = new hnswlib::InnerProductSpace(dim);
-    } else {
-      space = new hnswlib::L2Space(dim);
-    }
-    hnswlib::HierarchicalNSW<float> *appr_alg = new hnswlib::HierarchicalNSW<float>(space, std::string(location), false, 0);
-    return (void*)appr_alg;
+    return (void*)loadHandle(std::string(location), dim, stype, false);
+  } catch (const std::exception& e) {
+    return nullptr;
+  }
+}
+
+HNSW loadHNSWWithOptions(char *location, int dim, char stype, int allow_replace_deleted) {
+  try {
+    return (void*)loadHandle(std::string(location), dim, stype, false, allow_replace_deleted != 0);
+  } catch (const std::exception& e) {
+    return nullptr;
+  }
+}
+
+HNSW loadHNSWMmap(char *location, int dim, char stype) {
+  try {
+    return (void*)loadHandle(std::string(location), dim, stype, true);
   } catch (const std::exception& e) {
     return nullptr;
   }
 }
 
+int startSearchQueue(HNSW index, int num_threads, int capacity, int max_k) {
+    return startSearchQueueOnNode(index, num_threads, capacity, max_k, -1);
+}
+
+int startSearchQueueOnNode(HNSW index, int num_threads, int capacity, int max_k, int node) {
+    try {
+        auto* h = handle(index);
+        const hnswlib::NumaTopology& topology = hnswlib::NumaTopology::instance();
+        if (capacity <= 0 || max_k <= 0 || node >= (int)topology.numNodes()) return -1;
+        if (h->queue && !h->queue->stopped()) return -1;
+        if (num_threads <= 0)
+            num_threads = node >= 0 ? topology.cpus(node).size() : std::max(1u, std::thread::hardware_concurrency());
+        delete h->queue;
+        h->queue = nullptr;
+        h->queue = new SearchQueue(h, num_threads, capacity, max_k, node);
+        return 0;
+    } catch (...) {
+        return -1;
+    }
+}
+
+void stopSearchQueue(HNSW index) {
+    auto* h = handle(index);
+    if (h->queue) h->queue->stop();
+}
+
+int submitSearch(HNSW index, float *queries, int nq, int k, int ef, unsigned long long *tickets) {
+    auto* h = handle(index);
+    if (!h->queue || h->queue->stopped()) return -1;
+    size_t dim = *((size_t*)h->space->get_dist_func_param());
+    int accepted = 0;
+    while (accepted < nq && h->queue->submit(queries + accepted * dim, k, ef, tickets[accepted])) accepted++;
+    return accepted;
+}
+
+int pollSearchResults(HNSW index, unsigned long long *tickets, int *counts, unsigned long long *label,
+                      float *dist, int max_results, int timeout_ms) {
+    auto* h = handle(index);
+    if (!h->queue || h->queue->stopped()) return -1;
+    return h->queue->poll(tickets, counts, label, dist, max_results, timeout_ms);
+}
+
 HNSW saveHNSW(HNSW index, char *location) {
-  ((hnswlib::HierarchicalNSW<float>*)index)->saveIndex(location);
-  return ((hnswlib::HierarchicalNSW<float>*)index);
+  saveHandle(handle(index), std::string(location), false);
+  return index;
 }
 
 void freeHNSW(HNSW index) {
-  hnswlib::HierarchicalNSW<float>* ptr = (hnswlib::HierarchicalNSW<float>*) index;
-  delete ptr;
+  delete handle(index);
 }
 
 void addPoint(HNSW index, float *vec, unsigned long long int label) {
-        ((hnswlib::HierarchicalNSW<float>*)index)->addPoint(vec, label);
+        insertVector(handle(index), vec, label, label);
 }
 
-int searchKnn(HNSW index, float *vec, int N, unsigned long long int *label, float *dist) {
-  std::priority_queue<std::pair<float, hnswlib::labeltype>> gt;
+int searchKnn(HNSW index, float *vec, int N, int ef, unsigned long long int *label, float *dist,
+              unsigned long long *stats) {
   try {
-    gt = ((hnswlib::HierarchicalNSW<float>*)index)->searchKnn(vec, N);
+    return searchInto(handle(index), vec, N, ef, label, dist, nullptr, stats);
   } catch (const std::exception& e) { 
     return 0;
   }
+}
 
-  int n = gt.size();
-  std::pair<float, hnswlib::labeltype> pair;
-  for (int i = n - 1; i >= 0; i--) {
-    pair = gt.top();
-    *(dist+i) = pair.first;
-    *(label+i) = pair.second;
-    gt.pop();
+int searchKnnFiltered(HNSW index, float *vec, int N, int ef, unsigned long long *filter, unsigned long long filter_len,
+                      int filter_type, unsigned long long *label, float *dist) {
+  try {
+    if (filter_type == 0) {
+      BitmapFilter bitmap(filter, filter_len);
+      return searchInto(handle(index), vec, N, ef, label, dist, &bitmap);
+    } else if (filter_type == 1) {
+      SortedListFilter list(filter, filter_len);
+      return searchInto(handle(index), vec, N, ef, label, dist, &list);
+    }
+    return -1;
+  } catch (const std::exception& e) {
+    return 0;
   }
-  return n;
+}
+
+// Sharded searchRange and searchDocuments run on every shard; fn(shard, label,
+// dist, extra) searches one and returns its result count, or -1 to fail. Returns
+// the results of all shards as (dist, label, extra) closest first, where extra
+// is what fn wrote to its extra array.
+template<class Function>
+static std::vector<std::tuple<float, unsigned long long, unsigned long long>> searchEachShard(
+        HNSWIndex* h, int max_results, Function fn) {
+    size_t n = h->shards.size();
+    std::vector<int> count(n);
+    std::vector<unsigned long long> label(n * max_results), extra(n * max_results);
+    std::vector<float> dist(n * max_results);
+    ParallelFor(0, n, n, [&](size_t i, size_t /*threadId*/) {
+        size_t offset = i * max_results;
+        count[i] = fn(h->shards[i], &label[offset], &dist[offset], &extra[offset]);
+    });
+    std::vector<std::tuple<float, unsigned long long, unsigned long long>> found;
+    for (size_t i = 0; i < n; i++) {
+        if (count[i] < 0) throw std::runtime_error("Shard search failed");
+        for (int j = 0; j < count[i]; j++) {
+            size_t offset = i * max_results + j;
+            found.emplace_back(dist[offset], label[offset], extra[offset]);
+        }
+    }
+    std::sort(found.begin(), found.end());
+    return found;
+}
+
+int searchRange(HNSW index, float *vec, float radius, int max_results, int ef, unsigned long long *label,
+                float *dist) {
+  try {
+    auto* h = handle(index);
+    if (max_results <= 0 || isFlat(h)) return -1;
+    if (isSharded(h)) {
+      auto found = searchEachShard(h, max_results, [&](HNSWIndex* shard, unsigned long long* shard_label,
+                                                       float* shard_dist, unsigned long long*) {
+        return searchRange(shard, vec, radius, max_results, ef, shard_label, shard_dist);
+      });
+      int n = std::min(found.size(), (size_t) max_results);
+      for (int i = 0; i < n; i++) {
+        dist[i] = std::get<0>(found[i]);
+        label[i] = std::get<1>(found[i]);
+      }
+      return n;
+    }
+    // Explore at least ef candidates before leaving the radius, so a query whose
+    // entry point lands just outside it still finds the neighbors within it.
+    size_t min_candidates = std::min((size_t) max_results, ef > 0 ? (size_t) ef : h->alg->ef_);
+    hnswlib::EpsilonSearchStopCondition<float> stop_condition(radius, min_candidates, max_results);
+    beginSearchStats();
+    auto found = searchGraph(h)->searchStopConditionClosest(encodeVector(h, vec), stop_condition);
+    endSearchStats(h, nullptr);
+    int n = 0;
+    for (const auto& item : found) {
+      label[n] = item.second;
+      dist[n] = item.first;
+      n++;
+    }
+    return n;
+  } catch (const std::exception& e) {
+    return -1;
+  }
+}
+
+int searchDocuments(HNSW index, float *vec, int num_docs, int ef_collection,
+                    unsigned long long *doc_ids, unsigned long long *label, float *dist) {
+    try {
+        auto* h = handle(index);
+        if (!h->docs || num_docs <= 0 || isFlat(h)) return -1;
+        if (isSharded(h)) {
+            // a document's chunks can be on several shards, each reporting its best
+            auto found = searchEachShard(h, num_docs, [&](HNSWIndex* shard, unsigned long long* shard_label,
+                                                          float* shard_dist, unsigned long long* shard_docs) {
+                return searchDocuments(shard, vec, num_docs, ef_collection, shard_docs, shard_label, shard_dist);
+            });
+            int n = 0;
+            std::unordered_set<unsigned long long> seen;
+            for (const auto& chunk : found) {
+                if (n == num_docs) break;
+                if (!seen.insert(std::get<2>(chunk)).second) continue;
+                dist[n] = std::get<0>(chunk);
+                label[n] = std::get<1>(chunk);
+                doc_ids[n] = std::get<2>(chunk);
+                n++;
+            }
+            return n;
+        }
+        hnswlib::MultiVectorSearchStopCondition<hnswlib::labeltype, float> stop_condition(
+            *h->docs, num_docs, ef_collection > 0 ? ef_collection : 0);
+        beginSearchStats();
+        auto* alg = searchGraph(h);
+        auto chunks = alg->searchStopConditionClosest(encodeVector(h, vec), stop_condition);
+        endSearchStats(h, nullptr);
+
+        // chunks are closest first, so the first chunk seen of a document is its best
+        int n = 0;
+        std::unordered_set<hnswlib::labeltype> seen;
+        for (const auto& chunk : chunks) {
+            if (n == num_docs) break;
+            hnswlib::labeltype doc_id;
+            try {
+                doc_id = h->docs->get_doc_id(alg->getDataByInternalId(alg->getInternalIdByLabel(chunk.second)));
+            } catch (const std::exception& e) {
+                continue;  // deleted after the search found it
+            }
+            if (!seen.insert(doc_id).second) continue;
+            doc_ids[n] = doc_id;
+            label[n] = chunk.second;
+            dist[n] = chunk.first;
+            n++;
+        }
+        return n;
+    } catch (const std::exception& e) {
+        return -1;
+    }
 }
 
 void setEf(HNSW index, int ef) {
-    ((hnswlib::HierarchicalNSW<float>*)index)->ef_ = ef;
+    auto* h = handle(index);
+    for (auto* shard : h->shards) setEf(shard, ef);
+    if (isSharded(h)) return;
+    if (!withFlat(h, [&](hnswlib::BruteforceSearch<float>&) { h->graph_ef = ef; })) h->alg->ef_ = ef;
+    for (auto* replica : h->replicas) replica->ef_ = ef;
+}
+
+void setPrefetchDistance(HNSW index, int distance) {
+    auto* h = handle(index);
+    for (auto* shard : h->shards) setPrefetchDistance(shard, distance);
+    if (isFlat(h) || isSharded(h)) return;  // scans prefetch sequentially on their own
+    h->alg->setPrefetchDistance(distance < 0 ? 0 : distance);
+    for (auto* replica : h->replicas) replica->setPrefetchDistance(distance < 0 ? 0 : distance);
+}
+
+// A sharded index splits the capacity evenly; shards already fuller than their
+// part of it keep what they hold.
+static void resizeHandle(HNSWIndex* h, size_t new_max_elements) {
+    if (isSharded(h)) {
+        if (new_max_elements < getCurrentElementCount(h))
+            throw std::runtime_error("Cannot resize, max element is less than the current number of elements");
+        size_t part = (new_max_elements + h->shards.size() - 1) / h->shards.size();
+        for (auto* shard : h->shards)
+            resizeHandle(shard, std::max(part, (size_t)getCurrentElementCount(shard)));
+        return;
+    }
+    if (!withFlat(h, [&](hnswlib::BruteforceSearch<float>& flat) { flat.resizeIndex(new_max_elements); }))
+        h->alg->resizeIndex(new_max_elements);
 }
 
 void resizeIndex(HNSW index, unsigned long long int new_max_elements) {
-    ((hnswlib::HierarchicalNSW<float>*)index)->resizeIndex(new_max_elements);
+    resizeHandle(handle(index), new_max_elements);
 }
 
 // Introspection functions (safe)
 unsigned long long getCurrentElementCount(HNSW index) {
-    return ((hnswlib::HierarchicalNSW<float>*)index)->getCurrentElementCount();
+    auto* h = handle(index);
+    if (isSharded(h)) return sumShards(h, getCurrentElementCount);
+    size_t count = 0;
+    if (!withFlat(h, [&](hnswlib::BruteforceSearch<float>& flat) { count = flat.getCurrentElementCount(); }))
+        count = h->alg->getCurrentElementCount();
+    return count;
 }
 
 unsigned long long getMaxElements(HNSW index) {
-    return ((hnswlib::HierarchicalNSW<float>*)index)->getMaxElements();
+    auto* h = handle(index);
+    if (isSharded(h)) return sumShards(h, getMaxElements);
+    size_t count = 0;
+    if (!withFlat(h, [&](hnswlib::BruteforceSearch<float>& flat) { count = flat.getMaxElements(); }))
+        count = h->alg->getMaxElements();
+    return count;
 }
 
+// Flat indexes remove elements outright, so they never hold deleted ones.
 unsigned long long getDeletedCount(HNSW index) {
-    return ((hnswlib::HierarchicalNSW<float>*)index)->getDeletedCount();
+    auto* h = handle(index);
+    if (isSharded(h)) return sumShards(h, getDeletedCount);
+    return isFlat(h) ? 0 : h->alg->getDeletedCount();
+}
+
+unsigned long long getVisitedListContention(HNSW index) {
+    auto* h = handle(index);
+    if (isSharded(h)) return sumShards(h, getVisitedListContention);
+    return isFlat(h) ? 0 : h->alg->visited_list_pool_->getContention();
+}
+
+int getIndexStats(HNSW index, unsigned long long *searches, unsigned long long *sums, unsigned long long *buckets) {
+    handle(index)->search_stats.read(searches, sums, buckets);
+    return SearchHistograms::NUM_BUCKETS;
+}
+
+// Marks label deleted; flat indexes remove it instead, so it cannot be unmarked.
+static void deleteLabel(HNSWIndex* h, unsigned long long label) {
+    logged(h, OpLog::DELETE, label, 0, nullptr, [&] {
+        HNSWIndex* target = isSharded(h) ? shardOf(h, label) : h;
+        bool found = true;
+        if (!withFlat(target, [&](hnswlib::BruteforceSearch<float>& flat) { found = flat.removePoint(label); }))
+            target->alg->markDelete(label);
+        if (!found) throw std::runtime_error("Label not found");
+    });
+}
+
+static void undeleteLabel(HNSWIndex* h, unsigned long long label) {
+    if (isFlat(h)) throw std::runtime_error("Flat indexes do not keep deleted elements");
+    logged(h, OpLog::UNDELETE, label, 0, nullptr, [&] {
+        HNSWIndex* target = isSharded(h) ? shardOf(h, label) : h;
+        target->alg->unmarkDelete(label);
+    });
 }
 
 // Delete management functions
 void markDeleted(HNSW index, unsigned long long label) {
-    ((hnswlib::HierarchicalNSW<float>*)index)->markDelete(label);
+    deleteLabel(handle(index), label);
 }
 
 void unmarkDeleted(HNSW index, unsigned long long label) {
-    ((hnswlib::HierarchicalNSW<float>*)index)->unmarkDelete(label);
+    undeleteLabel(handle(index), label);
 }
 
 // Safe versions with error handling
 int addPointSafe(HNSW index, float *vec, unsigned long long label) {
     try {
-        ((hnswlib::HierarchicalNSW<float>*)index)->addPoint(vec, label);
+        insertVector(handle(index), vec, label, label);
+        return 0;
+    } catch (const std::exception& e) {
+        return -1;
+    }
+}
+
+int addDocumentChunkSafe(HNSW index, float *vec, unsigned long long label, unsigned long long doc_id) {
+    try {
+        auto* h = handle(index);
+        if (!h->docs) return -1;
+        insertVector(h, vec, label, doc_id);
+        return 0;
+    } catch (const std::exception& e) {
+        return -1;
+    }
+}
+
+int addPointReplaceSafe(HNSW index, float *vec, unsigned long long label) {
+    try {
+        insertVector(handle(index), vec, label, label, true);
         return 0;
     } catch (const std::exception& e) {
         return -1;
@@ -120,7 +1547,49 @@ int addPointSafe(HNSW index, float *vec, unsigned long long label) {
 
 int resizeIndexSafe(HNSW index, unsigned long long new_max_elements) {
     try {
-        ((hnswlib::HierarchicalNSW<float>*)index)->resizeIndex(new_max_elements);
+        resizeHandle(handle(index), new_max_elements);
+        return 0;
+    } catch (const std::exception& e) {
+        return -1;
+    }
+}
+
+int reorderIndexSafe(HNSW index) {
+    try {
+        for (auto* shard : handle(index)->shards)
+            if (reorderIndexSafe(shard) != 0) return -1;
+        if (isFlat(handle(index)) || isSharded(handle(index))) return 0;  // elements are already scanned in order
+        algOf(index)->reorderIndex();
+        return 0;
+    } catch (const std::exception& e) {
+        return -1;
+    }
+}
+
+int compactStepSafe(HNSW index, unsigned long long max_elements) {
+    try {
+        if (isSharded(handle(index))) {
+            int more = 0;
+            for (auto* shard : handle(index)->shards) {
+                int result = compactStepSafe(shard, max_elements);
+                if (result < 0) return -1;
+                more |= result;
+            }
+            return more;
+        }
+        if (isFlat(handle(index))) return 0;
+        return algOf(index)->repairDeletedLinks(max_elements, parallelForEach) > 0 ? 1 : 0;
+    } catch (const std::exception& e) {
+        return -1;
+    }
+}
+
+int compactIndexSafe(HNSW index) {
+    try {
+        for (auto* shard : handle(index)->shards)
+            if (compactIndexSafe(shard) != 0) return -1;
+        if (isFlat(handle(index)) || isSharded(handle(index))) return 0;
+        algOf(index)->compactIndex(parallelForEach);
         return 0;
     } catch (const std::exception& e) {
         return -1;
@@ -129,7 +1598,110 @@ int resizeIndexSafe(HNSW index, unsigned long long new_max_elements) {
 
 int saveIndexSafe(HNSW index, char *location) {
     try {
-        ((hnswlib::HierarchicalNSW<float>*)index)->saveIndex(std::string(location));
+        saveHandle(handle(index), std::string(location), false);
+        return 0;
+    } catch (const std::exception& e) {
+        return -1;
+    }
+}
+
+int startLog(HNSW index, char *location, int sync) {
+    try {
+        auto* h = handle(index);
+        if (h->wal || (h->alg && h->alg->isReadOnly())) return -1;
+        std::string index_path(location);
+        size_t dim = getDimension(index);
+
+        // Records of different labels commute, except that an ADD_REPLACE takes
+        // the slot of an element deleted earlier in the log, whatever its label.
+        // So the log is replayed in runs between ADD_REPLACE records, the labels
+        // of each run split between threads that apply their records in log
+        // order, and then each ADD_REPLACE on its own, once all before it are.
+        struct Entry {
+            OpLog::Record record;
+            size_t vector;  // offset in vectors, if record.dim
+        };
+        std::vector<Entry> entries;
+        std::vector<float> vectors;
+        size_t records;
+        size_t valid = OpLog::replay(OpLog::logPath(index_path), dim, [&](const OpLog::Record& record, const float* vec) {
+            entries.push_back({record, vectors.size()});
+            if (vec) vectors.insert(vectors.end(), vec, vec + dim);
+        }, &records);
+        auto apply = [&](const Entry& entry) {
+            const OpLog::Record& record = entry.record;
+            try {
+                if (record.type == OpLog::ADD || record.type == OpLog::ADD_REPLACE) {
+                    if (record.dim)
+                        insertVector(h, vectors.data() + entry.vector, record.label, record.doc_id,
+                                     record.type == OpLog::ADD_REPLACE);
+                } else if (record.type == OpLog::DELETE) {
+                    deleteLabel(h, record.label);
+                } else if (record.type == OpLog::UNDELETE) {
+                    undeleteLabel(h, record.label);
+                }
+            } catch (const std::exception& e) {
+                // the operation failed the same way when it was logged
+            }
+        };
+        for (size_t begin = 0; begin < entries.size();) {
+            if (entries[begin].record.type == OpLog::ADD_REPLACE) {
+                apply(entries[begin++]);
+                continue;
+            }
+            size_t end = begin;
+            while (end < entries.size() && entries[end].record.type != OpLog::ADD_REPLACE) end++;
+            size_t threads = batchThreads(0, end - begin);
+            ParallelFor(0, threads, threads, [&](size_t part, size_t /*threadId*/) {
+                for (size_t e = begin; e < end; e++)
+                    if (entries[e].record.label % threads == part) apply(entries[e]);
+            });
+            begin = end;
+        }
+        h->wal = new OpLog(index_path, dim, sync != 0, valid);
+        return std::min(records, (size_t)INT32_MAX);
+    } catch (...) {
+        return -1;
+    }
+}
+
+int saveCheckpoint(HNSW index) {
+    try {
+        auto* h = handle(index);
+        if (!h->wal) return -1;
+        std::lock_guard<std::mutex> checkpoint(h->wal->checkpoint_lock);
+        // every record before mark has been applied once the gate is taken
+        size_t mark;
+        {
+            std::unique_lock<std::shared_mutex> gate(h->wal->gate);
+            mark = h->wal->size();
+        }
+        saveHandle(h, h->wal->indexPath(), false);
+        h->wal->dropBefore(mark);
+        return 0;
+    } catch (...) {
+        return -1;
+    }
+}
+
+void stopLog(HNSW index) {
+    auto* h = handle(index);
+    delete h->wal;
+    h->wal = nullptr;
+}
+
+int saveIndexMmapSafe(HNSW index, char *location) {
+    try {
+        saveHandle(handle(index), std::string(location), true);
+        return 0;
+    } catch (const std::exception& e) {
+        return -1;
+    }
+}
+
+int saveIndexMmapPackedSafe(HNSW index, char *location) {
+    try {
+        saveHandle(handle(index), std::string(location), true, true);
         return 0;
     } catch (const std::exception& e) {
         return -1;
@@ -138,7 +1710,7 @@ int saveIndexSafe(HNSW index, char *location) {
 
 int markDeletedSafe(HNSW index, unsigned long long label) {
     try {
-        ((hnswlib::HierarchicalNSW<float>*)index)->markDelete(label);
+        deleteLabel(handle(index), label);
         return 0;
     } catch (const std::exception& e) {
         return -1;
@@ -147,7 +1719,7 @@ int markDeletedSafe(HNSW index, unsigned long long label) {
 
 int unmarkDeletedSafe(HNSW index, unsigned long long label) {
     try {
-        ((hnswlib::HierarchicalNSW<float>*)index)->unmarkDelete(label);
+        undeleteLabel(handle(index), label);
         return 0;
     } catch (const std::exception& e) {
         return -1;
@@ -157,15 +1729,31 @@ int unmarkDeletedSafe(HNSW index, unsigned long long label) {
 // Vector export functions for data migration
 
 int getDimension(HNSW index) {
-    auto* alg = (hnswlib::HierarchicalNSW<float>*)index;
-    return *((size_t*)alg->dist_func_param_);
+    return *((size_t*)handle(index)->space->get_dist_func_param());
 }
 
 int getVectorByLabel(HNSW index, unsigned long long label, float* vector) {
     try {
-        auto* alg = (hnswlib::HierarchicalNSW<float>*)index;
+        auto* h = handle(index);
+        if (isSharded(h)) return getVectorByLabel(shardOf(h, label), label, vector);
+        int dim = getDimension(index);
+        bool found = true;
+        if (withFlat(h, [&](hnswlib::BruteforceSearch<float>& flat) {
+                static thread_local std::vector<char> point;
+                point.resize(h->space->get_data_size());
+                found = flat.getDataByLabel(label, point.data());
+                if (found) decodeVector(h, point.data(), vector);
+            })) {
+            return found ? dim : -1;
+        }
+        if (h->quant) {
+            // getInternalIdByLabel throws if label not found or deleted
+            hnswlib::tableint internalId = h->alg->getInternalIdByLabel(label);
+            h->quant->decode(h->alg->getDataByInternalId(internalId), vector);
+            return h->quant->get_dim();
+        }
         // getDataByLabel throws if label not found or deleted
-        std::vector<float> data = alg->getDataByLabel<float>(label);
+        std::vector<float> data = h->alg->getDataByLabel<float>(label);
         memcpy(vector, data.data(), data.size() * sizeof(float));
         return data.size();
     } catch (...) {
@@ -175,7 +1763,19 @@ int getVectorByLabel(HNSW index, unsigned long long label, float* vector) {
 
 int getElementByInternalId(HNSW index, unsigned long long internalId, 
                            unsigned long long* label, int* isDeleted) {
-    auto* alg = (hnswlib::HierarchicalNSW<float>*)index;
+    auto* h = handle(index);
+    if (isSharded(h)) {
+        HNSWIndex* shard = shardOfInternalId(h, internalId);
+        return shard ? getElementByInternalId(shard, internalId, label, isDeleted) : -1;
+    }
+    bool found = false;
+    if (withFlat(h, [&](hnswlib::BruteforceSearch<float>& flat) {
+            found = flat.getElement(internalId, (hnswlib::labeltype*)label, nullptr);
+        })) {
+        *isDeleted = 0;
+        return found ? 0 : -1;
+    }
+    auto* alg = h->alg;
     if (internalId >= alg->cur_element_count) return -1;
     *label = alg->getExternalLabel(internalId);
     *isDeleted = alg->isMarkedDeleted(internalId) ? 1 : 0;
@@ -183,10 +1783,446 @@ int getElementByInternalId(HNSW index, unsigned long long internalId,
 }
 
 int getVectorByInternalId(HNSW index, unsigned long long internalId, float* vector) {
-    auto* alg = (hnswlib::HierarchicalNSW<float>*)index;
-    if (internalId >= alg->cur_element_count) return -1;
-    size_t dim = *((size_t*)alg->dist_func_param_);
-    char* data_ptr = alg->getDataByInternalId(internalId);
-    memcpy(vector, data_ptr, dim * sizeof(float));
+    auto* h = handle(index);
+    if (isSharded(h)) {
+        HNSWIndex* shard = shardOfInternalId(h, internalId);
+        return shard ? getVectorByInternalId(shard, internalId, vector) : -1;
+    }
+    bool found = false;
+    if (withFlat(h, [&](hnswlib::BruteforceSearch<float>& flat) {
+            static thread_local std::vector<char> point;
+            point.resize(h->space->get_data_size());
+            hnswlib::labeltype label;
+            found = flat.getElement(internalId, &label, point.data());
+            if (found) decodeVector(h, point.data(), vector);
+        })) {
+        return found ? getDimension(index) : -1;
+    }
+    if (internalId >= h->alg->cur_element_count) return -1;
+    size_t dim = *((size_t*)h->alg->dist_func_param_);
+    decodeVector(h, h->alg->getDataByInternalId(internalId), vector);
     return dim;
 }
+
+int setExecutorThreads(int num_threads, int pin_threads) {
+    try {
+        hnswlib::Executor::instance().resize(num_threads, pin_threads != 0);
+        return 0;
+    } catch (...) {
+        return -1;
+    }
+}
+
+int getExecutorThreads(void) {
+    return hnswlib::Executor::instance().size();
+}
+
+int setExecutorNodes(int num_threads, unsigned long long node_mask) {
+    try {
+        size_t num_nodes = hnswlib::NumaTopology::instance().numNodes();
+        std::vector<size_t> nodes;
+        for (size_t node = 0; node < num_nodes && node < 64; node++) {
+            if (node_mask == 0 || (node_mask >> node) & 1) nodes.push_back(node);
+        }
+        if (num_nodes < 64 && node_mask >> num_nodes != 0) return -1;
+        hnswlib::Executor::instance().resizeOnNodes(num_threads, nodes);
+        return 0;
+    } catch (...) {
+        return -1;
+    }
+}
+
+int getNumaNodes(void) {
+    return hnswlib::NumaTopology::instance().numNodes();
+}
+
+void setNumaInterleave(int enabled) {
+    hnswlib::numaInterleave() = enabled != 0;
+}
+
+int replicateIndex(HNSW index) {
+    try {
+        auto* h = handle(index);
+        if (h->mapped_path.empty() || !h->replicas.empty()) return -1;
+        size_t num_nodes = hnswlib::NumaTopology::instance().numNodes();
+        std::vector<std::unique_ptr<hnswlib::HierarchicalNSW<float>>> replicas(num_nodes);
+        // each copy is read on its own node, so its label table and visited lists land there too
+        std::vector<std::thread> loaders;
+        std::vector<std::exception_ptr> errors(num_nodes);
+        for (size_t node = 0; node < num_nodes; node++) {
+            loaders.emplace_back([&, node] {
+                try {
+                    replicas[node].reset(new hnswlib::HierarchicalNSW<float>(h->space));
+                    replicas[node]->loadIndexMmap(h->mapped_path, h->space, node);
+                    replicas[node]->ef_ = h->alg->ef_;
+                    replicas[node]->setPrefetchDistance(h->alg->prefetch_distance_);
+                } catch (...) {
+                    errors[node] = std::current_exception();
+                }
+            });
+            hnswlib::pinThreadToNode(loaders.back(), node);
+        }
+        for (auto& loader : loaders) loader.join();
+        for (auto& error : errors)
+            if (error) std::rethrow_exception(error);
+        for (auto& replica : replicas) h->replicas.push_back(replica.release());
+        return num_nodes;
+    } catch (...) {
+        return -1;
+    }
+}
+
+// searchKnnBatch of a flat index: the queries are encoded up front and scanned
+// together, which reads the elements once per group of queries instead of once
+// per query, and a small batch splits the elements between threads instead.
+static void searchFlatBatch(HNSWIndex* h, hnswlib::BruteforceSearch<float>& flat, const float* queries, int nq,
+                            int k, unsigned long long* label, float* dist, int* counts, int num_threads) {
+    size_t dim = *((size_t*)h->space->get_dist_func_param());
+    const void* rows = queries;
+    std::vector<char> encoded;
+    if (h->normalize || h->quant || h->docs) {
+        size_t size = h->space->get_data_size();
+        encoded.resize(nq * size);
+        for (int q = 0; q < nq; q++) memcpy(encoded.data() + q * size, encodeVector(h, queries + q * dim), size);
+        rows = encoded.data();
+    }
+    std::vector<size_t> found(nq);
+    size_t threads = num_threads > 0 ? num_threads : hnswlib::Executor::instance().size();
+    flat.searchKnnBatch(rows, nq, k, dist, (hnswlib::labeltype*)label, found.data(), threads);
+    hnswlib::SearchStats stats;
+    stats.distance_computations = flat.getCurrentElementCount();
+    for (int q = 0; q < nq; q++) {
+        counts[q] = found[q];
+        h->search_stats.record(stats);
+    }
+}
+
+// searchKnnBatch of a sharded index: each query is searched on each shard as a
+// separate task, so a batch smaller than the pool still keeps it busy, and the
+// shards' results of each query are merged afterwards.
+static void searchShardsBatch(HNSWIndex* h, const float* queries, int nq, int k, int ef, unsigned long long* label,
+                              float* dist, int* counts, int num_threads) {
+    size_t dim = getDimension(h);
+    size_t n = h->shards.size();
+    size_t tasks = nq * n;
+    std::vector<int> count(tasks);
+    std::vector<unsigned long long> shard_label(tasks * k);
+    std::vector<float> shard_dist(tasks * k);
+    std::vector<hnswlib::SearchStats> stats(tasks);
+    ParallelFor(0, tasks, batchThreads(num_threads, tasks), [&](size_t task, size_t /*threadId*/) {
+        size_t q = task / n, shard = task % n;
+        try {
+            count[task] = searchInto(h->shards[shard], queries + q * dim, k, ef, &shard_label[task * k],
+                                     &shard_dist[task * k]);
+        } catch (const std::exception& e) {
+            count[task] = 0;
+        }
+        stats[task] = hnswlib::threadSearchStats();
+    });
+    for (int q = 0; q < nq; q++) {
+        size_t first = q * n;
+        counts[q] = mergeShardResults(n, k, &count[first], &shard_label[first * k], &shard_dist[first * k],
+                                      label + q * k, dist + q * k);
+        hnswlib::SearchStats total;
+        for (size_t task = first; task < first + n; task++) addSearchStats(total, stats[task]);
+        h->search_stats.record(total);
+    }
+}
+
+int searchKnnBatch(HNSW index, float *queries, int nq, int k, int ef,
+                   unsigned long long *label, float *dist, int *counts, int num_threads) {
+    if (nq < 0 || k <= 0) return -1;
+    try {
+        auto* h = handle(index);
+        size_t dim = getDimension(index);
+        bool flat = withFlat(h, [&](hnswlib::BruteforceSearch<float>& flat) {
+            searchFlatBatch(h, flat, queries, nq, k, label, dist, counts, num_threads);
+        });
+        if (flat) return 0;
+        if (isSharded(h)) {
+            searchShardsBatch(h, queries, nq, k, ef, label, dist, counts, num_threads);
+            return 0;
+        }
+        ParallelFor(0, nq, batchThreads(num_threads, nq), [&](size_t q, size_t /*threadId*/) {
+            try {
+                counts[q] = searchInto(h, queries + q * dim, k, ef, label + q * k, dist + q * k);
+            } catch (const std::exception& e) {
+                counts[q] = 0;
+            }
+        });
+        return 0;
+    } catch (...) {
+        return -1;
+    }
+}
+
+int addPointsBatch(HNSW index, float *data, unsigned long long *labels, unsigned long long n,
+                   int num_threads, int *errors) {
+    try {
+        auto* h = handle(index);
+        size_t dim = getDimension(index);
+        // Rows run in parallel, so of the rows sharing a label only the last is
+        // inserted, as if each had updated the one before it in order.
+        std::vector<char> superseded(n, 0);
+        {
+            hnswlib::StripedHashMap<unsigned long long, uint64_t> last_row;
+            last_row.reserve(n);
+            for (size_t row = 0; row < n; row++) {
+                uint64_t earlier;
+                if (last_row.find(labels[row], earlier)) superseded[earlier] = 1;
+                last_row.insert(labels[row], row);
+            }
+        }
+        size_t required = getCurrentElementCount(index) + n;
+        if (required > getMaxElements(index)) {
+            resizeHandle(h, required);
+        }
+
+        std::atomic<int> failed(0);
+        ParallelFor(0, n, batchThreads(num_threads, n), [&](size_t row, size_t /*threadId*/) {
+            errors[row] = 0;
+            if (superseded[row]) return;
+            try {
+                insertVector(h, data + row * dim, labels[row], labels[row]);
+            } catch (const std::exception& e) {
+                errors[row] = -1;
+                failed++;
+            }
+        });
+        return failed;
+    } catch (...) {
+        return -1;
+    }
+}
+
+// Read-only mapping of a file of dim-dimensional rows stored as float32 or uint8:
+// 'f' fvecs and 'b' bvecs (each row prefixed by its int32 dimension) or 'n' a
+// C-ordered 2-D .npy array of dtype <f4 or u1.
+class VectorFile {
+    char* base_ = nullptr;
+    size_t size_ = 0;
+    size_t data_offset_ = 0;
+    size_t row_stride_ = 0;
+    bool prefixed_ = false;  // rows start with their int32 dimension
+    bool bytes_ = false;     // uint8 components instead of float32
+
+    void parseLayout(char format) {
+        if (format == 'f' || format == 'b') {
+            int32_t d;
+            if (size_ < sizeof(d)) throw std::runtime_error("Truncated file");
+            memcpy(&d, base_, sizeof(d));
+            if (d <= 0) throw std::runtime_error("Invalid row dimension");
+            prefixed_ = true;
+            bytes_ = format == 'b';
+            dim = d;
+            row_stride_ = sizeof(int32_t) + dim * (bytes_ ? 1 : sizeof(float));
+            if (size_ % row_stride_ != 0) throw std::runtime_error("File size is not a multiple of the row size");
+            rows = size_ / row_stride_;
+        } else if (format == 'n') {
+            parseNpyHeader();
+        } else {
+            throw std::runtime_error("Unknown vector file format");
+        }
+    }
+
+    // Parses the header dict of a .npy file, e.g. {'descr': '<f4', 'fortran_order': False, 'shape': (10, 4), }
+    void parseNpyHeader() {
+        if (size_ < 10 || memcmp(base_, "\x93NUMPY", 6) != 0)
+            throw std::runtime_error("Not a .npy file");
+        unsigned char major = base_[6];
+        size_t header_len, header_start;
+        if (major == 1) {
+            uint16_t len;
+            memcpy(&len, base_ + 8, sizeof(len));
+            header_len = len;
+            header_start = 10;
+        } else {
+            uint32_t len;
+            if (size_ < 12) throw std::runtime_error("Not a .npy file");
+            memcpy(&len, base_ + 8, sizeof(len));
+            header_len = len;
+            header_start = 12;
+        }
+        if (header_start + header_len > size_) throw std::runtime_error("Truncated .npy header");
+        std::string header(base_ + header_start, header_len);
+        data_offset_ = header_start + header_len;
+
+        // text after "key:" with leading spaces removed
+        auto value = [&header](const char* key) {
+            size_t pos = header.find(key);
+            if (pos == std::string::npos || (pos = header.find(':', pos)) == std::string::npos)
+                throw std::runtime_error("Malformed .npy header");
+            pos = header.find_first_not_of(' ', pos + 1);
+            return pos == std::string::npos ? std::string() : header.substr(pos);
+        };
+        std::string descr = value("'descr'");
+        descr = descr.substr(0, descr.find(','));
+        if (descr == "'<f4'") {
+            bytes_ = false;
+        } else if (descr == "'|u1'" || descr == "'<u1'" || descr == "'u1'") {
+            bytes_ = true;
+        } else {
+            throw std::runtime_error("Unsupported .npy dtype (expected <f4 or u1)");
+        }
+        if (value("'fortran_order'").compare(0, 5, "False") != 0)
+            throw std::runtime_error("Fortran-ordered .npy arrays are not supported");
+        std::string shape = value("'shape'");
+        unsigned long long shape_rows = 0, shape_dim = 0;
+        if (sscanf(shape.c_str(), "(%llu, %llu)", &shape_rows, &shape_dim) != 2)
+            throw std::runtime_error("Only 2-D .npy arrays are supported");
+        rows = shape_rows;
+        dim = shape_dim;
+        row_stride_ = dim * (bytes_ ? 1 : sizeof(float));
+        if (data_offset_ + rows * row_stride_ > size_) throw std::runtime_error("Truncated .npy data");
+    }
+
+ public:
+    size_t rows = 0;
+    size_t dim = 0;
+
+    VectorFile(const std::string& path, char format) {
+#if defined(_WIN32)
+        throw std::runtime_error("Building from files is not supported on this platform");
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("Cannot open file");
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            close(fd);
+            throw std::runtime_error("Cannot read file");
+        }
+        void* base = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (base == MAP_FAILED) throw std::runtime_error("Cannot map file");
+        base_ = (char*)base;
+        size_ = st.st_size;
+        madvise(base_, size_, MADV_SEQUENTIAL);
+        try {
+            parseLayout(format);
+        } catch (...) {
+            munmap(base_, size_);
+            throw;
+        }
+#endif
+    }
+
+    ~VectorFile() {
+#if !defined(_WIN32)
+        if (base_) munmap(base_, size_);
+#endif
+    }
+
+    // Converts row i to float32.
+    void readRow(size_t i, float* out) const {
+        const char* row = base_ + data_offset_ + i * row_stride_;
+        if (prefixed_) {
+            int32_t d;
+            memcpy(&d, row, sizeof(d));
+            if ((size_t)d != dim) throw std::runtime_error("Row dimension differs from the first row");
+            row += sizeof(d);
+        }
+        if (bytes_) {
+            for (size_t j = 0; j < dim; j++) out[j] = (unsigned char)row[j];
+        } else {
+            memcpy(out, row, dim * sizeof(float));
+        }
+    }
+
+    // Drops rows [start, end) from this process's resident memory once they are inserted.
+    void release(size_t start, size_t end) const {
+#if !defined(_WIN32)
+        size_t page = sysconf(_SC_PAGESIZE);
+        size_t from = (data_offset_ + start * row_stride_) / page * page;
+        size_t to = (data_offset_ + end * row_stride_) / page * page;
+        if (to > from) madvise(base_ + from, to - from, MADV_DONTNEED);
+#endif
+    }
+};
+
+int buildFromFile(HNSW index, char *path, char format, unsigned long long first_label,
+                  int num_threads) {
+    // Rows inserted between progress updates and page releases
+    const size_t CHUNK_ROWS = 65536;
+    // Rows an untrained quantizer is trained on
+    const size_t TRAIN_ROWS = 20000;
+    try {
+        auto* h = handle(index);
+        VectorFile file{std::string(path), format};
+        size_t dim = getDimension(index);
+        if (file.dim != dim) return -1;
+        h->build_done = 0;
+        h->build_total = file.rows;
+
+        if (h->quant && !h->quant->is_trained()) {
+            if (getCurrentElementCount(index) > 0) return -1;
+            size_t sample = std::min(file.rows, TRAIN_ROWS);
+            std::vector<float> rows(sample * dim);
+            for (size_t r = 0; r < sample; r++) {
+                float* row = rows.data() + r * dim;
+                file.readRow(r * file.rows / sample, row);
+                if (h->normalize) h->normalize(row, row, dim);
+            }
+            trainQuantizers(h, rows.data(), sample);
+        }
+
+        size_t required = getCurrentElementCount(index) + file.rows;
+        if (required > getMaxElements(index)) {
+            resizeHandle(h, required);
+        }
+
+        std::atomic<int> failed(0);
+        size_t threads = batchThreads(num_threads, file.rows);
+        for (size_t start = 0; start < file.rows; start += CHUNK_ROWS) {
+            size_t end = std::min(file.rows, start + CHUNK_ROWS);
+            ParallelFor(start, end, threads, [&](size_t row, size_t /*threadId*/) {
+                static thread_local std::vector<float> vec;
+                vec.resize(dim);
+                try {
+                    file.readRow(row, vec.data());
+                    insertVector(h, vec.data(), first_label + row, first_label + row);
+                } catch (const std::exception& e) {
+                    failed++;
+                }
+                h->build_done.fetch_add(1, std::memory_order_relaxed);
+            });
+            file.release(start, end);
+        }
+        return failed;
+    } catch (...) {
+        return -1;
+    }
+}
+
+void getBuildProgress(HNSW index, unsigned long long *done, unsigned long long *total) {
+    *done = handle(index)->build_done.load(std::memory_order_relaxed);
+    *total = handle(index)->build_total.load(std::memory_order_relaxed);
+}
+
+int getSimdLevel(void) {
+    return hnswlib::getSimdLevel();
+}
+
+int trainQuantizer(HNSW index, float *data, unsigned long long n) {
+    try {
+        auto* h = handle(index);
+        if (!h->quant) return 0;
+        // Codes already in the graph were produced with the old parameters.
+        if (getCurrentElementCount(index) > 0) return -1;
+        std::vector<float> normalized;
+        if (h->normalize) {
+            size_t dim = h->quant->get_dim();
+            normalized.resize(n * dim);
+            for (size_t r = 0; r < n; r++) h->normalize(data + r * dim, normalized.data() + r * dim, dim);
+            data = normalized.data();
+        }
+        trainQuantizers(h, data, n);
+        return 0;
+    } catch (...) {
+        return -1;
+    }
+}
+
+void setRerank(HNSW index, int factor) {
+    handle(index)->rerank = factor;
+    for (auto* shard : handle(index)->shards) shard->rerank = factor;
+}
@@ -3,22 +3,102 @@
 extern "C" {
 #endif
   typedef void* HNSW;
+  // stype selects the metric and vector storage:
+  //   'l' L2, 'i' inner product, 'c' cosine (float32)
+  //   'L', 'I', 'C' the same metrics on 8-bit scalar-quantized vectors (train first)
+  //   'e', 'p', 'a' the same metrics on half-precision vectors
+  //   'm', 'n', 'o' the same metrics on float32 chunks of multi-vector documents:
+  //   each element also stores a document id (see addDocumentChunkSafe)
+  // Cosine indexes normalize vectors and queries natively, so callers pass them as is.
+  // Indexes grow automatically when an insert exceeds max_elements.
   HNSW initHNSW(int dim, unsigned long long int max_elements, int M, int ef_construction, int rand_seed, char stype);
   HNSW loadHNSW(char *location, int dim, char stype);
+
+  // Same as initHNSW / loadHNSWSafe; allow_replace_deleted != 0 lets
+  // addPointReplaceSafe reuse the slots of deleted elements
+  HNSW initHNSWWithOptions(int dim, unsigned long long int max_elements, int M, int ef_construction, int rand_seed,
+                           char stype, int allow_replace_deleted);
+  HNSW loadHNSWWithOptions(char *location, int dim, char stype, int allow_replace_deleted);
   
   // Safe loading (returns NULL on failure)
   HNSW loadHNSWSafe(char *location, int dim, char stype);
+  
+  // Read-only load of a file written by saveIndexMmapSafe: vectors and graph are
+  // used in place from a shared file mapping instead of being copied to the heap.
+  // Adds, deletes and resizes fail on the returned index. Returns NULL on failure.
+  HNSW loadHNSWMmap(char *location, int dim, char stype);
+
+  // Flat index: searches compare the query with every element, so results are
+  // exact, and batches of queries are scanned together. Once an insert takes it
+  // past switch_threshold elements (0 = never) it is rebuilt in place as an HNSW
+  // graph with M, ef_construction and rand_seed; operations wait while that runs.
+  // Until then searchRange, searchDocuments and saveIndexMmapSafe fail, deletes
+  // remove elements outright (unmarkDeleted fails) and reorder/compact do nothing.
+  // loadFlat reads a file saved from a flat index. Both return NULL on failure.
+  HNSW initFlat(int dim, unsigned long long max_elements, char stype, unsigned long long switch_threshold, int M,
+                int ef_construction, int rand_seed);
+  HNSW loadFlat(char *location, int dim, char stype, unsigned long long switch_threshold, int M,
+                int ef_construction, int rand_seed);
+  // Sharded index: elements are spread over num_shards graphs by a hash of their
+  // label. Inserts to different shards never contend, searches run on every shard
+  // in parallel and merge the results, and saves write a directory holding a file
+  // per shard. Replacing deleted elements and saveIndexMmapSafe are not
+  // supported. loadSharded reads such a directory. Both return NULL on failure.
+  HNSW initSharded(int dim, unsigned long long max_elements, int M, int ef_construction, int rand_seed, char stype,
+                   int num_shards);
+  HNSW loadSharded(char *location, int dim, char stype);
+  // 1 while the index is flat, 2 if sharded, 0 for a graph
+  int getIndexType(HNSW index);
   HNSW saveHNSW(HNSW index, char *location);
   void freeHNSW(HNSW index);
   void addPoint(HNSW index, float *vec, unsigned long long int label);
-  int searchKnn(HNSW index, float *vec, int N, unsigned long long int *label, float *dist);
+  // Search functions taking ef use it as the size of the dynamic candidate list for
+  // that call only (ef <= 0 uses the value of setEf), so concurrent searches can use
+  // different recall/latency tradeoffs on one index.
+  // If stats is non-null, the work of the search is written to stats[0..4): nodes
+  // expanded on all layers (hops), distance computations, base-layer nodes visited
+  // and deleted nodes skipped.
+  int searchKnn(HNSW index, float *vec, int N, int ef, unsigned long long int *label, float *dist,
+                unsigned long long *stats);
+  
+  // searchKnn restricted to labels allowed by a native filter, so no over-fetching
+  // is needed. filter_type 0: filter is a bitmap of filter_len 64-bit words, and
+  // label l is allowed when bit l % 64 of word l / 64 is set. filter_type 1: filter
+  // is an ascending list of filter_len allowed labels. Returns -1 for an unknown
+  // filter_type.
+  int searchKnnFiltered(HNSW index, float *vec, int N, int ef, unsigned long long *filter, unsigned long long filter_len,
+                        int filter_type, unsigned long long *label, float *dist);
+  // Finds the labels within distance radius of vec, up to max_results of them,
+  // in one graph search bounded by the radius instead of a fixed k; it explores at
+  // least min(ef, max_results) candidates. Results go to label/dist[0 .. n),
+  // closest first. Returns n, or -1 on error.
+  int searchRange(HNSW index, float *vec, float radius, int max_results, int ef, unsigned long long *label,
+                  float *dist);
+  // Finds the num_docs documents of an 'm'/'n'/'o' index with the closest chunks,
+  // deduplicating by document id during the graph search. The search keeps the
+  // chunks of up to max(ef_collection, num_docs) documents as candidates. Result i
+  // is document doc_ids[i], whose closest chunk is label[i] at distance dist[i],
+  // closest first. Returns the number of documents, or -1 on error.
+  int searchDocuments(HNSW index, float *vec, int num_docs, int ef_collection,
+                      unsigned long long *doc_ids, unsigned long long *label, float *dist);
   void setEf(HNSW index, int ef);
+  // How many neighbors ahead the base-layer search prefetches vectors (0 disables)
+  void setPrefetchDistance(HNSW index, int distance);
   void resizeIndex(HNSW index, unsigned long long int new_max_elements);
   
   // Introspection functions (safe)
   unsigned long long getCurrentElementCount(HNSW index);
   unsigned long long getMaxElements(HNSW index);
   unsigned long long getDeletedCount(HNSW index);
+  // Searches that found no free visited list in the lock-free pool slots
+  unsigned long long getVisitedListContention(HNSW index);
+  // Histograms of the work of every search run on the index so far, for the four
+  // counters of searchKnn's stats. searches gets the number of searches, sums[m]
+  // the total of counter m and buckets[m * 32 + b] the number of searches whose
+  // counter m has b significant bits (bucket 0 holds zeros, the last bucket also
+  // larger values). Counters are kept per thread during a search and added to the
+  // histograms once at its end. Returns the number of buckets per counter (32).
+  int getIndexStats(HNSW index, unsigned long long *searches, unsigned long long *sums, unsigned long long *buckets);
   
   // Delete management functions
   void markDeleted(HNSW index, unsigned long long label);
@@ -26,8 +106,37 @@ extern "C" {
   
   // Safe versions with error handling (return 0 on success, non-zero on error)
   int addPointSafe(HNSW index, float *vec, unsigned long long label);
+  // Inserts or updates label, reusing a deleted slot when one is free
+  // (requires allow_replace_deleted)
+  int addPointReplaceSafe(HNSW index, float *vec, unsigned long long label);
+  // Adds a chunk of document doc_id to an 'm'/'n'/'o' index (other inserts use
+  // the label as document id). Fails on other spaces.
+  int addDocumentChunkSafe(HNSW index, float *vec, unsigned long long label, unsigned long long doc_id);
   int resizeIndexSafe(HNSW index, unsigned long long new_max_elements);
+  // Renumbers elements in graph traversal order for better memory locality
+  int reorderIndexSafe(HNSW index);
+  // Repairs links around deleted elements for up to max_elements elements;
+  // returns 1 while work remains, 0 when done, -1 on error
+  int compactStepSafe(HNSW index, unsigned long long max_elements);
+  // Removes deleted elements and renumbers the rest densely
+  int compactIndexSafe(HNSW index);
   int saveIndexSafe(HNSW index, char *location);
+  int saveIndexMmapSafe(HNSW index, char *location);
+  // saveIndexMmapSafe with the link lists sorted and bit-packed, for
+  // memory-bound read-only serving; loadHNSWMmap reads either layout, but an
+  // index loaded from a packed file cannot be saved again
+  int saveIndexMmapPackedSafe(HNSW index, char *location);
+
+  // Write-ahead log: startLog replays the log at <location>.wal onto the index
+  // (normally the one last saved at location), then appends every add, update,
+  // delete and undelete to it, vectors included, before applying it; sync != 0
+  // makes each one wait for the disk. Returns the number of records replayed, or
+  // -1. saveCheckpoint saves the index to location, writers continuing, and drops
+  // the records the saved file contains. stopLog detaches the log; neither
+  // startLog nor stopLog may run concurrently with modifications.
+  int startLog(HNSW index, char *location, int sync);
+  int saveCheckpoint(HNSW index);
+  void stopLog(HNSW index);
   int markDeletedSafe(HNSW index, unsigned long long label);
   int unmarkDeletedSafe(HNSW index, unsigned long long label);
   
@@ -47,6 +156,91 @@ extern "C" {
   // Get vector by internal ID (more efficient for bulk export)
   // Returns dimension on success, -1 on error
   int getVectorByInternalId(HNSW index, unsigned long long internalId, float* vector);
+  
+  // Batch search, batch insert, file builds and compaction run on one thread pool
+  // shared by all indexes of the process, sized to the hardware threads by default.
+  // setExecutorThreads replaces its workers with num_threads new ones (<= 0 uses
+  // all hardware threads), pinned to cores 0, 1, ... if pin_threads != 0 (Linux
+  // only). Calls in progress finish on their calling threads. Returns 0 on success.
+  int setExecutorThreads(int num_threads, int pin_threads);
+  int getExecutorThreads(void);
+
+  // NUMA placement (Linux). getNumaNodes is the number of nodes with cpus, 1 on
+  // hosts without NUMA. setExecutorNodes is setExecutorThreads with the workers
+  // spread round-robin over the nodes set in node_mask (bit i = node i, 0 = all)
+  // and pinned to their cpus; num_threads <= 0 uses every cpu of those nodes.
+  // setNumaInterleave(0) stops new index storage from being interleaved across
+  // nodes, which is the default on hosts with several.
+  int getNumaNodes(void);
+  int setExecutorNodes(int num_threads, unsigned long long node_mask);
+  void setNumaInterleave(int enabled);
+  // Gives an index opened with loadIndexMmap one private copy of its file per
+  // node, placed in that node's memory; searches then read the copy of the node
+  // they run on. Returns the number of copies, or -1 on error. Must not run
+  // concurrently with other calls on the index.
+  int replicateIndex(HNSW index);
+  
+  // Batched search over a row-major nq x dim query matrix in a single call.
+  // Results for query q go to label/dist[q*k .. q*k+k), closest first, and the
+  // number found to counts[q]. num_threads <= 0 uses all executor threads.
+  // Returns 0 on success, -1 on error.
+  int searchKnnBatch(HNSW index, float *queries, int nq, int k, int ef,
+                     unsigned long long *label, float *dist, int *counts, int num_threads);
+  
+  // Asynchronous search. startSearchQueue starts num_threads workers (<= 0 uses all
+  // hardware threads) serving up to capacity queued searches of at most max_k
+  // results each; it fails if the queue is already running.
+  int startSearchQueue(HNSW index, int num_threads, int capacity, int max_k);
+  // Same, with the workers pinned to the cpus of one NUMA node (<= 0 threads uses
+  // all of them).
+  int startSearchQueueOnNode(HNSW index, int num_threads, int capacity, int max_k, int node);
+  // Stops the workers, drops queued searches and wakes blocked pollers. Do not
+  // restart the queue while another thread may still be polling it.
+  void stopSearchQueue(HNSW index);
+  // Queues searches of the k nearest neighbors of each row of a row-major nq x dim
+  // matrix, identified by tickets[i]; queries are copied, so the caller may reuse
+  // them at once. Returns how many leading rows were accepted (fewer when the
+  // queue is full or k > max_k), or -1 if no queue is running.
+  int submitSearch(HNSW index, float *queries, int nq, int k, int ef, unsigned long long *tickets);
+  // Moves up to max_results completed searches out of the queue, waiting up to
+  // timeout_ms (< 0 forever) for the first one. Result i has ticket tickets[i]
+  // and counts[i] results at label/dist[i*max_k .. i*max_k+counts[i]), closest
+  // first; counts[i] is -1 if that search failed. Returns the number of results,
+  // or -1 if no queue is running.
+  int pollSearchResults(HNSW index, unsigned long long *tickets, int *counts, unsigned long long *label,
+                        float *dist, int max_results, int timeout_ms);
+  
+  // Batched insert of a row-major n x dim matrix. Capacity is checked once and
+  // the index is resized if the batch does not fit. errors[i] is set to 0 if
+  // row i was added and -1 otherwise. Of rows sharing a label only the last is
+  // inserted; the others count as added, as if updated by it in order.
+  // num_threads <= 0 uses all executor threads.
+  // Returns the number of failed rows, or -1 if the batch could not be started.
+  int addPointsBatch(HNSW index, float *data, unsigned long long *labels, unsigned long long n,
+                     int num_threads, int *errors);
+  
+  // Inserts every row of a vector file, streamed from a read-only mapping: format
+  // 'f' fvecs, 'b' bvecs or 'n' a 2-D .npy array of float32 or uint8. Row r gets
+  // label first_label + r. An untrained quantizer is trained on rows sampled from
+  // the file. Returns the number of rows that failed, or -1 if the file cannot be used.
+  int buildFromFile(HNSW index, char *path, char format, unsigned long long first_label,
+                    int num_threads);
+  // Rows inserted so far and in total by the running or last buildFromFile
+  void getBuildProgress(HNSW index, unsigned long long *done, unsigned long long *total);
+  
+  // Instruction set of the distance kernels selected at runtime on this CPU:
+  // 0 = scalar, 1 = SSE, 2 = AVX2+FMA, 3 = AVX-512, 4 = NEON.
+  // Dimensions below 4 always use the scalar kernel.
+  int getSimdLevel(void);
+  
+  // Trains the scalar quantizer of an 'L'/'I'/'C' index on a row-major n x dim
+  // sample; must be called before the first vector is added. No-op for other
+  // spaces. Returns 0 on success, -1 on error.
+  int trainQuantizer(HNSW index, float *data, unsigned long long n);
+  
+  // For quantized indexes, fetch factor * k candidates per search and rerank
+  // them by distance to the unquantized query. factor <= 1 disables reranking.
+  void setRerank(HNSW index, int factor);
 #ifdef __cplusplus
 }
 #endif
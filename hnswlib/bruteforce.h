@@ -2,13 +2,21 @@
 #include <unordered_map>
 #include <fstream>
 #include <mutex>
+#include <shared_mutex>
 #include <algorithm>
+#include <limits>
+#include <type_traits>
 #include <assert.h>
+#include "executor.h"
 
 namespace hnswlib {
 template<typename dist_t>
 class BruteforceSearch : public AlgorithmInterface<dist_t> {
  public:
+    static constexpr size_t QUERY_GROUP = 32;    // queries scanned together against a block
+    static constexpr size_t SCAN_BLOCK = 256;    // elements per block, reused by a query group while cached
+    static constexpr size_t MIN_SCAN_RANGE = 16384;  // smallest element range worth its own thread
+
     char *data_;
     size_t maxelements_;
     size_t cur_element_count;
@@ -17,7 +25,12 @@ class BruteforceSearch : public AlgorithmInterface<dist_t> {
     size_t data_size_;
     DISTFUNC <dist_t> fstdistfunc_;
     void *dist_func_param_;
-    std::mutex index_lock;
+    // Four-query kernel for float32 L2 and inner product spaces, null for other spaces
+    BLOCK4FUNC block_func_{nullptr};
+    // Held shared by searches and exclusively while elements are added, moved or reallocated
+    mutable std::shared_mutex index_lock;
+    // Whether addPoint on a full index grows it instead of throwing
+    bool auto_grow_{false};
 
     std::unordered_map<labeltype, size_t > dict_external_to_internal;
 
@@ -45,11 +58,8 @@ class BruteforceSearch : public AlgorithmInterface<dist_t> {
 
     BruteforceSearch(SpaceInterface <dist_t> *s, size_t maxElements) {
         maxelements_ = maxElements;
-        data_size_ = s->get_data_size();
-        fstdistfunc_ = s->get_dist_func();
-        dist_func_param_ = s->get_dist_func_param();
-        size_per_element_ = data_size_ + sizeof(labeltype);
-        data_ = (char *) malloc(maxElements * size_per_element_);
+        setSpace(s);
+        data_ = (char *) malloc(std::max<size_t>(maxElements, 1) * size_per_element_);
         if (data_ == nullptr)
             throw std::runtime_error("Not enough memory: BruteforceSearch failed to allocate data");
         cur_element_count = 0;
@@ -61,113 +71,325 @@ class BruteforceSearch : public AlgorithmInterface<dist_t> {
     }
 
 
-    void addPoint(const void *datapoint, labeltype label, bool replace_deleted = false) {
-        int idx;
-        {
-            std::unique_lock<std::mutex> lock(index_lock);
+    void setSpace(SpaceInterface<dist_t> *s) {
+        data_size_ = s->get_data_size();
+        fstdistfunc_ = s->get_dist_func();
+        dist_func_param_ = s->get_dist_func_param();
+        size_per_element_ = data_size_ + sizeof(labeltype);
+        block_func_ = nullptr;
+        if (std::is_same<dist_t, float>::value) {
+            if (dynamic_cast<L2Space *>(s))
+                block_func_ = selectL2SqrBlock4Func();
+            else if (dynamic_cast<InnerProductSpace *>(s))
+                block_func_ = selectInnerProductDistanceBlock4Func();
+        }
+    }
+
+
+    void setAutoGrow(bool auto_grow) {
+        auto_grow_ = auto_grow;
+    }
+
+
+    void resizeIndex(size_t new_max_elements) {
+        std::unique_lock<std::shared_mutex> lock(index_lock);
+        resizeLocked(new_max_elements);
+    }
+
 
-            auto search = dict_external_to_internal.find(label);
-            if (search != dict_external_to_internal.end()) {
-                idx = search->second;
-            } else {
-                if (cur_element_count >= maxelements_) {
+    void addPoint(const void *datapoint, labeltype label, bool replace_deleted = false) {
+        std::unique_lock<std::shared_mutex> lock(index_lock);
+        size_t idx;
+        auto search = dict_external_to_internal.find(label);
+        if (search != dict_external_to_internal.end()) {
+            idx = search->second;
+        } else {
+            if (cur_element_count >= maxelements_) {
+                if (!auto_grow_)
                     throw std::runtime_error("The number of elements exceeds the specified limit\n");
-                }
-                idx = cur_element_count;
-                dict_external_to_internal[label] = idx;
-                cur_element_count++;
+                resizeLocked(std::max<size_t>(2 * maxelements_, 16));
             }
+            idx = cur_element_count;
+            dict_external_to_internal[label] = idx;
+            cur_element_count++;
         }
         memcpy(data_ + size_per_element_ * idx + data_size_, &label, sizeof(labeltype));
         memcpy(data_ + size_per_element_ * idx, datapoint, data_size_);
     }
 
 
-    void removePoint(labeltype cur_external) {
-        std::unique_lock<std::mutex> lock(index_lock);
+    // Removes label by moving the last element into its slot. Returns false if
+    // label is not in the index.
+    bool removePoint(labeltype cur_external) {
+        std::unique_lock<std::shared_mutex> lock(index_lock);
 
         auto found = dict_external_to_internal.find(cur_external);
         if (found == dict_external_to_internal.end()) {
-            return;
+            return false;
         }
 
+        size_t cur_c = found->second;
         dict_external_to_internal.erase(found);
 
-        size_t cur_c = found->second;
-        labeltype label = *((labeltype*)(data_ + size_per_element_ * (cur_element_count-1) + data_size_));
-        dict_external_to_internal[label] = cur_c;
-        memcpy(data_ + size_per_element_ * cur_c,
-                data_ + size_per_element_ * (cur_element_count-1),
-                data_size_+sizeof(labeltype));
+        if (cur_c != cur_element_count - 1) {
+            labeltype label = *((labeltype*)(data_ + size_per_element_ * (cur_element_count-1) + data_size_));
+            dict_external_to_internal[label] = cur_c;
+            memcpy(data_ + size_per_element_ * cur_c,
+                    data_ + size_per_element_ * (cur_element_count-1),
+                    data_size_+sizeof(labeltype));
+        }
         cur_element_count--;
+        return true;
+    }
+
+
+    size_t getCurrentElementCount() const {
+        std::shared_lock<std::shared_mutex> lock(index_lock);
+        return cur_element_count;
+    }
+
+
+    size_t getMaxElements() const {
+        std::shared_lock<std::shared_mutex> lock(index_lock);
+        return maxelements_;
+    }
+
+
+    // Copies the stored data of label to out; returns false if label is not in the index.
+    bool getDataByLabel(labeltype label, void *out) const {
+        std::shared_lock<std::shared_mutex> lock(index_lock);
+        auto found = dict_external_to_internal.find(label);
+        if (found == dict_external_to_internal.end())
+            return false;
+        memcpy(out, data_ + size_per_element_ * found->second, data_size_);
+        return true;
+    }
+
+
+    // Label and (when out is non-null) stored data of the element at position
+    // id < getCurrentElementCount(); positions are dense but change on removal.
+    bool getElement(size_t id, labeltype *label, void *out) const {
+        std::shared_lock<std::shared_mutex> lock(index_lock);
+        if (id >= cur_element_count)
+            return false;
+        *label = getExternalLabel(id);
+        if (out)
+            memcpy(out, data_ + size_per_element_ * id, data_size_);
+        return true;
     }
 
 
     std::priority_queue<std::pair<dist_t, labeltype >>
     searchKnn(const void *query_data, size_t k, BaseFilterFunctor* isIdAllowed = nullptr) const {
-        assert(k <= cur_element_count);
         std::priority_queue<std::pair<dist_t, labeltype >> topResults;
-        if (cur_element_count == 0) return topResults;
-        for (int i = 0; i < k; i++) {
-            dist_t dist = fstdistfunc_(query_data, data_ + size_per_element_ * i, dist_func_param_);
-            labeltype label = *((labeltype*) (data_ + size_per_element_ * i + data_size_));
-            if ((!isIdAllowed) || (*isIdAllowed)(label)) {
-                topResults.emplace(dist, label);
-            }
+        std::vector<dist_t> distances(k);
+        std::vector<labeltype> labels(k);
+        size_t n = searchKnnInto(query_data, k, distances.data(), labels.data(), isIdAllowed);
+        for (size_t i = 0; i < n; i++)
+            topResults.emplace(distances[i], labels[i]);
+        return topResults;
+    }
+
+
+    // Writes the k nearest neighbors of query_data closest first and returns their number.
+    size_t searchKnnInto(const void *query_data, size_t k, dist_t *distances, labeltype *labels,
+                         BaseFilterFunctor* isIdAllowed = nullptr, size_t num_threads = 1) const {
+        size_t count;
+        searchKnnBatch(query_data, 1, k, distances, labels, &count, num_threads, isIdAllowed);
+        return count;
+    }
+
+
+    /*
+    * k nearest neighbors of nq queries stored back to back (data_size_ bytes each),
+    * written closest first to distances/labels[q * k ..] with their number in
+    * counts[q]. Queries are scanned in groups of QUERY_GROUP against blocks of
+    * SCAN_BLOCK elements, so a block is reused by the whole group while it is in
+    * cache, and float32 L2 / inner product distances are computed four queries at
+    * a time so each element is loaded once per four queries. The groups run on up
+    * to num_threads executor threads; when there are fewer groups than threads the
+    * elements are split into ranges as well, whose results are merged per query.
+    * Top-k selection appends candidates below the current k-th distance and trims
+    * them back to k with nth_element when 2k accumulate.
+    */
+    void searchKnnBatch(const void *queries, size_t nq, size_t k, dist_t *distances, labeltype *labels,
+                        size_t *counts, size_t num_threads = 1, BaseFilterFunctor* isIdAllowed = nullptr) const {
+        if (nq == 0)
+            return;
+        std::shared_lock<std::shared_mutex> lock(index_lock);
+        size_t n = cur_element_count;
+        if (k == 0 || n == 0) {
+            std::fill(counts, counts + nq, 0);
+            return;
         }
-        dist_t lastdist = topResults.empty() ? std::numeric_limits<dist_t>::max() : topResults.top().first;
-        for (int i = k; i < cur_element_count; i++) {
-            dist_t dist = fstdistfunc_(query_data, data_ + size_per_element_ * i, dist_func_param_);
-            if (dist <= lastdist) {
-                labeltype label = *((labeltype *) (data_ + size_per_element_ * i + data_size_));
-                if ((!isIdAllowed) || (*isIdAllowed)(label)) {
-                    topResults.emplace(dist, label);
-                }
-                if (topResults.size() > k)
-                    topResults.pop();
 
-                if (!topResults.empty()) {
-                    lastdist = topResults.top().first;
-                }
+        size_t groups = (nq + QUERY_GROUP - 1) / QUERY_GROUP;
+        size_t ranges = 1;
+        if (num_threads > groups)
+            ranges = std::max<size_t>(1, std::min(num_threads / groups, n / MIN_SCAN_RANGE));
+        size_t range_size = (n + ranges - 1) / ranges;
+
+        std::vector<TopK> found(nq * ranges, TopK(k));
+        Executor::instance().parallelFor(0, groups * ranges, num_threads, [&](size_t item, size_t) {
+            size_t group = item / ranges, range = item % ranges;
+            size_t q_begin = group * QUERY_GROUP;
+            size_t begin = range * range_size;
+            scan((const char *) queries, q_begin, std::min(nq, q_begin + QUERY_GROUP),
+                 begin, std::min(n, begin + range_size), isIdAllowed, &found[0], ranges, range);
+        });
+
+        for (size_t q = 0; q < nq; q++) {
+            TopK &top = found[q * ranges];
+            for (size_t r = 1; r < ranges; r++) {
+                for (const auto &item : found[q * ranges + r].items)
+                    top.push(item.first, item.second);
+            }
+            top.finish();
+            counts[q] = top.items.size();
+            for (size_t i = 0; i < top.items.size(); i++) {
+                distances[q * k + i] = top.items[i].first;
+                labels[q * k + i] = getExternalLabel(top.items[i].second);
             }
         }
-        return topResults;
     }
 
 
+    // Copies the elements under the lock and writes them after releasing it, so
+    // adds only wait for the copy; the file replaces location atomically. Only
+    // the elements are written, so the loaded index has no spare capacity.
     void saveIndex(const std::string &location) {
-        std::ofstream output(location, std::ios::binary);
-        std::streampos position;
-
-        writeBinaryPOD(output, maxelements_);
-        writeBinaryPOD(output, size_per_element_);
-        writeBinaryPOD(output, cur_element_count);
-
-        output.write(data_, maxelements_ * size_per_element_);
-
-        output.close();
+        std::vector<char> data;
+        {
+            std::shared_lock<std::shared_mutex> lock(index_lock);
+            data.assign(data_, data_ + cur_element_count * size_per_element_);
+        }
+        size_t count = data.size() / size_per_element_;
+
+        AtomicFileWriter output(location);
+        output.writePOD(count);  // max elements
+        output.writePOD(size_per_element_);
+        output.writePOD(count);
+        output.write(data.data(), data.size());
+        output.commit();
     }
 
 
     void loadIndex(const std::string &location, SpaceInterface<dist_t> *s) {
         std::ifstream input(location, std::ios::binary);
+        if (!input.is_open())
+            throw std::runtime_error("Cannot open file");
         std::streampos position;
 
+        size_t stored_size_per_element;
         readBinaryPOD(input, maxelements_);
-        readBinaryPOD(input, size_per_element_);
+        readBinaryPOD(input, stored_size_per_element);
         readBinaryPOD(input, cur_element_count);
 
-        data_size_ = s->get_data_size();
-        fstdistfunc_ = s->get_dist_func();
-        dist_func_param_ = s->get_dist_func_param();
-        size_per_element_ = data_size_ + sizeof(labeltype);
-        data_ = (char *) malloc(maxelements_ * size_per_element_);
+        setSpace(s);
+        if (!input || stored_size_per_element != size_per_element_ || cur_element_count > maxelements_)
+            throw std::runtime_error("Index file does not match the space");
+        data_ = (char *) malloc(std::max<size_t>(maxelements_, 1) * size_per_element_);
         if (data_ == nullptr)
             throw std::runtime_error("Not enough memory: loadIndex failed to allocate data");
 
         input.read(data_, maxelements_ * size_per_element_);
+        if (!input)
+            throw std::runtime_error("Index file is truncated");
 
         input.close();
+
+        dict_external_to_internal.clear();
+        for (size_t i = 0; i < cur_element_count; i++)
+            dict_external_to_internal[getExternalLabel(i)] = i;
+    }
+
+ private:
+    // Smallest k distances pushed so far, with their element positions
+    struct TopK {
+        size_t k;
+        dist_t bound = std::numeric_limits<dist_t>::max();  // k-th distance once k are kept
+        std::vector<std::pair<dist_t, size_t>> items;
+
+        explicit TopK(size_t k) : k(k) {}
+
+        void push(dist_t dist, size_t id) {
+            if (dist >= bound)
+                return;
+            items.emplace_back(dist, id);
+            if (items.size() >= 2 * k)
+                trim();
+        }
+
+        void trim() {
+            if (items.size() <= k)
+                return;
+            std::nth_element(items.begin(), items.begin() + (k - 1), items.end());
+            items.resize(k);
+            bound = items[k - 1].first;
+        }
+
+        void finish() {
+            trim();
+            std::sort(items.begin(), items.end());
+        }
+    };
+
+    labeltype getExternalLabel(size_t id) const {
+        labeltype label;
+        memcpy(&label, data_ + size_per_element_ * id + data_size_, sizeof(labeltype));
+        return label;
+    }
+
+    void resizeLocked(size_t new_max_elements) {
+        if (new_max_elements < cur_element_count)
+            throw std::runtime_error("Cannot resize, max element is less than the current number of elements");
+        char *data_new = (char *) realloc(data_, new_max_elements * size_per_element_);
+        if (data_new == nullptr)
+            throw std::runtime_error("Not enough memory: resizeIndex failed to allocate data");
+        data_ = data_new;
+        maxelements_ = new_max_elements;
+    }
+
+    // Scans elements [begin, end) for queries [q_begin, q_end) into
+    // found[q * ranges + range].
+    void scan(const char *queries, size_t q_begin, size_t q_end, size_t begin, size_t end,
+              BaseFilterFunctor *isIdAllowed, TopK *found, size_t ranges, size_t range) const {
+        dist_t block_dists[4 * SCAN_BLOCK];
+        for (size_t b = begin; b < end; b += SCAN_BLOCK) {
+            size_t b_end = std::min(end, b + SCAN_BLOCK);
+            for (size_t q = q_begin; q < q_end; q += 4) {
+                size_t tile = std::min<size_t>(4, q_end - q);
+                const void *query[4];
+                for (size_t j = 0; j < 4; j++)
+                    query[j] = queries + data_size_ * (q + std::min(j, tile - 1));
+
+                if (block_func_) {
+                    float out[4];
+                    for (size_t i = b; i < b_end; i++) {
+                        block_func_((const float *) (data_ + size_per_element_ * i), (const float *const *) query,
+                                    *((size_t *) dist_func_param_), out);
+                        for (size_t j = 0; j < tile; j++)
+                            block_dists[j * SCAN_BLOCK + (i - b)] = out[j];
+                    }
+                } else {
+                    for (size_t i = b; i < b_end; i++) {
+                        const char *x = data_ + size_per_element_ * i;
+                        for (size_t j = 0; j < tile; j++)
+                            block_dists[j * SCAN_BLOCK + (i - b)] = fstdistfunc_(query[j], x, dist_func_param_);
+                    }
+                }
+
+                for (size_t j = 0; j < tile; j++) {
+                    TopK &top = found[(q + j) * ranges + range];
+                    const dist_t *dists = block_dists + j * SCAN_BLOCK;
+                    for (size_t i = b; i < b_end; i++) {
+                        dist_t dist = dists[i - b];
+                        if (dist < top.bound && (!isIdAllowed || (*isIdAllowed)(getExternalLabel(i))))
+                            top.push(dist, i);
+                    }
+                }
+            }
+        }
     }
 };
 }  // namespace hnswlib
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <stdlib.h>
+#include <vector>
+#include "numa.h"
+
+namespace hnswlib {
+///////////////////////////////////////////////////////////
+//
+// Per-element storage that grows without moving existing elements
+//
+// Elements live in fixed-size chunks of 2^chunk_shift elements, found through a
+// table of chunk pointers. Growing allocates new chunks and, when the table is
+// full, publishes a larger copy of it; replaced tables are kept until clear(), so
+// threads still reading through an old table stay valid. Growing and shrinking
+// must be serialized by the caller; reads may run concurrently with growing.
+//
+/////////////////////////////////////////////////////////
+
+template<typename Chunk>
+class ChunkTable {
+ protected:
+    size_t chunk_shift_{0};
+    size_t chunk_mask_{0};
+    size_t num_chunks_{0};
+    size_t table_capacity_{0};
+    std::atomic<Chunk *> table_{nullptr};
+    std::vector<std::unique_ptr<Chunk[]>> tables_;  // tables_.back() is current
+
+    Chunk *chunkTable() const {
+        return table_.load(std::memory_order_acquire);
+    }
+
+    void pushChunk(Chunk chunk) {
+        if (num_chunks_ == table_capacity_) {
+            size_t new_capacity = std::max<size_t>(8, 2 * table_capacity_);
+            std::unique_ptr<Chunk[]> table(new Chunk[new_capacity]());
+            for (size_t i = 0; i < num_chunks_; i++)
+                table[i] = table_.load(std::memory_order_relaxed)[i];
+            tables_.push_back(std::move(table));
+            table_capacity_ = new_capacity;
+        }
+        tables_.back()[num_chunks_] = chunk;
+        num_chunks_++;
+        table_.store(tables_.back().get(), std::memory_order_release);
+    }
+
+    Chunk popChunk() {
+        num_chunks_--;
+        return tables_.back()[num_chunks_];
+    }
+
+    void resetTables() {
+        tables_.clear();
+        table_.store(nullptr, std::memory_order_relaxed);
+        num_chunks_ = 0;
+        table_capacity_ = 0;
+    }
+
+ public:
+    void setChunkShift(size_t chunk_shift) {
+        chunk_shift_ = chunk_shift;
+        chunk_mask_ = (size_t(1) << chunk_shift) - 1;
+    }
+
+    size_t chunkElements() const {
+        return size_t(1) << chunk_shift_;
+    }
+
+    // Number of elements that can be stored without growing
+    size_t capacity() const {
+        return num_chunks_ << chunk_shift_;
+    }
+};
+
+
+// Array of default-constructed T (T need not be movable, e.g. std::mutex).
+template<typename T>
+class ChunkedArray : public ChunkTable<T *> {
+ public:
+    ChunkedArray() = default;
+    ChunkedArray(const ChunkedArray &) = delete;
+    ChunkedArray &operator=(const ChunkedArray &) = delete;
+
+    ~ChunkedArray() {
+        clear();
+    }
+
+    inline T &operator[](size_t i) const {
+        return this->chunkTable()[i >> this->chunk_shift_][i & this->chunk_mask_];
+    }
+
+    void grow(size_t n) {
+        while (this->capacity() < n)
+            this->pushChunk(new T[this->chunkElements()]());
+    }
+
+    // Frees the chunks no element below n lives in.
+    void shrink(size_t n) {
+        while (this->num_chunks_ > 0 && ((this->num_chunks_ - 1) << this->chunk_shift_) >= n)
+            delete[] this->popChunk();
+    }
+
+    void clear() {
+        shrink(0);
+        this->resetTables();
+    }
+};
+
+
+// Fixed-stride byte blocks, one per element, allocated uninitialized with malloc
+// and interleaved across NUMA nodes (see numaInterleave).
+class ChunkedBuffer : public ChunkTable<char *> {
+    size_t stride_{0};
+    bool owned_{true};
+
+ public:
+    ChunkedBuffer() = default;
+    ChunkedBuffer(const ChunkedBuffer &) = delete;
+    ChunkedBuffer &operator=(const ChunkedBuffer &) = delete;
+
+    ~ChunkedBuffer() {
+        clear();
+    }
+
+    void setStride(size_t stride) {
+        stride_ = stride;
+    }
+
+    inline char *operator[](size_t i) const {
+        return chunkTable()[i >> chunk_shift_] + (i & chunk_mask_) * stride_;
+    }
+
+    void grow(size_t n) {
+        while (capacity() < n) {
+            char *chunk = (char *) malloc(chunkElements() * stride_);
+            if (chunk == nullptr)
+                throw std::runtime_error("Not enough memory: failed to allocate storage chunk");
+            interleaveMemory(chunk, chunkElements() * stride_);
+            pushChunk(chunk);
+        }
+    }
+
+    void shrink(size_t n) {
+        while (num_chunks_ > 0 && ((num_chunks_ - 1) << chunk_shift_) >= n) {
+            char *chunk = popChunk();
+            if (owned_)
+                free(chunk);
+        }
+    }
+
+    // Serves n elements from external contiguous memory without copying or owning it.
+    void attach(char *data, size_t n) {
+        clear();
+        size_t shift = 0;
+        while ((size_t(1) << shift) < n)
+            shift++;
+        setChunkShift(shift);
+        owned_ = false;
+        pushChunk(data);
+    }
+
+    // Number of consecutive elements from i on that are stored contiguously
+    size_t contiguousRun(size_t i, size_t n) const {
+        size_t run = chunkElements() - (i & chunk_mask_);
+        return std::min(run, n - i);
+    }
+
+    void clear() {
+        shrink(0);
+        resetTables();
+        owned_ = true;
+    }
+};
+}  // namespace hnswlib
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if !defined(NO_MANUAL_VECTORIZATION) && defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define HNSWLIB_CRC32C_SSE42
+#include <nmmintrin.h>
+#endif
+
+namespace hnswlib {
+///////////////////////////////////////////////////////////
+//
+// CRC-32C (Castagnoli), the checksum of iSCSI, ext4 and RocksDB
+//
+// Uses the SSE4.2 crc32 instruction, eight bytes at a time, on x86-64 CPUs
+// that have it and a table, a byte at a time, elsewhere. crc32c(data, size,
+// crc) continues the checksum crc of the bytes before data, so a record can be
+// checksummed in pieces; crc32cCombine joins the checksums of two pieces
+// computed independently, so a large section can be checksummed in parallel.
+//
+/////////////////////////////////////////////////////////
+
+static const uint32_t CRC32C_POLY = 0x82F63B78u;  // reflected
+
+class CRC32CTable {
+ public:
+    uint32_t entries[256];
+    uint32_t powers[32];  // x^(2^k) mod P, for crc32cCombine
+
+    // a * b mod P, both reflected
+    static uint32_t multiply(uint32_t a, uint32_t b) {
+        uint32_t product = 0;
+        for (uint32_t bit = 1u << 31; bit != 0; bit >>= 1) {
+            if (a & bit)
+                product ^= b;
+            b = (b >> 1) ^ (CRC32C_POLY & (0u - (b & 1)));
+        }
+        return product;
+    }
+
+    CRC32CTable() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++)
+                crc = (crc >> 1) ^ (CRC32C_POLY & (0u - (crc & 1)));
+            entries[i] = crc;
+        }
+        uint32_t power = 1u << 30;  // x^1
+        for (int k = 0; k < 32; k++) {
+            powers[k] = power;
+            power = multiply(power, power);
+        }
+    }
+
+    static const CRC32CTable &instance() {
+        static const CRC32CTable table;
+        return table;
+    }
+};
+
+#if defined(HNSWLIB_CRC32C_SSE42)
+__attribute__((target("sse4.2")))
+static uint32_t crc32cHardware(const unsigned char *bytes, size_t size, uint32_t crc) {
+    uint64_t crc64 = crc;
+    for (; size >= 8; size -= 8, bytes += 8) {
+        uint64_t word;
+        memcpy(&word, bytes, 8);
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    crc = (uint32_t) crc64;
+    for (; size > 0; size--, bytes++)
+        crc = _mm_crc32_u8(crc, *bytes);
+    return crc;
+}
+
+static bool crc32cHardwareSupported() {
+    static const bool supported = __builtin_cpu_supports("sse4.2");
+    return supported;
+}
+#endif
+
+inline uint32_t crc32c(const void *data, size_t size, uint32_t crc = 0) {
+    const unsigned char *bytes = (const unsigned char *) data;
+    crc = ~crc;
+#if defined(HNSWLIB_CRC32C_SSE42)
+    if (crc32cHardwareSupported())
+        return ~crc32cHardware(bytes, size, crc);
+#endif
+    const CRC32CTable &table = CRC32CTable::instance();
+    for (size_t i = 0; i < size; i++)
+        crc = table.entries[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+// Checksum of A followed by B, given crc_a = crc32c(A) and crc_b = crc32c(B).
+inline uint32_t crc32cCombine(uint32_t crc_a, uint32_t crc_b, size_t size_b) {
+    const CRC32CTable &table = CRC32CTable::instance();
+    // shift crc_a past the 8 * size_b bits of B
+    uint32_t shift = 1u << 31;  // x^0
+    uint64_t bits = (uint64_t) size_b;
+    for (int k = 3; bits != 0; bits >>= 1, k++) {
+        if (bits & 1)
+            shift = CRC32CTable::multiply(table.powers[k & 31], shift);
+    }
+    return CRC32CTable::multiply(shift, crc_a) ^ crc_b;
+}
+}  // namespace hnswlib
@@ -0,0 +1,262 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "numa.h"
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace hnswlib {
+///////////////////////////////////////////////////////////
+//
+// Process-wide work-stealing thread pool
+//
+// Each worker owns a deque of tasks: it runs its own tasks newest first and,
+// when it has none, steals the oldest task of another worker. parallelFor
+// splits a loop into runner tasks that claim indices from a shared counter; the
+// calling thread runs one runner itself, so a loop always makes progress even
+// when every worker is busy with other loops, and only waits for runners that
+// actually started. Runners that start after the loop is exhausted do nothing,
+// which is what makes pending tasks safe to drop when the pool is resized.
+//
+/////////////////////////////////////////////////////////
+
+class Executor {
+    struct Worker {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    // State shared by the runners of one parallelFor call
+    struct Loop {
+        std::atomic<size_t> next;
+        size_t end;
+        std::atomic<int> in_flight{0};
+        std::mutex mutex;
+        std::condition_variable done_cv;
+        std::exception_ptr exception;
+
+        Loop(size_t start, size_t end) : next(start), end(end) {}
+    };
+
+    std::mutex config_mutex_;   // serializes resize()
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::atomic<size_t> num_workers_{0};
+    std::atomic<size_t> next_worker_{0};
+
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+    std::atomic<long> pending_{0};  // queued tasks; briefly negative while a push is being counted
+    bool stop_{false};
+
+    Executor() {
+        resize(0, false);
+    }
+
+    ~Executor() {
+        stopWorkers();
+    }
+
+    bool popTask(size_t self, std::function<void()> &task) {
+        size_t n = workers_.size();
+        for (size_t i = 0; i < n; i++) {
+            Worker &worker = *workers_[(self + i) % n];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            if (worker.tasks.empty())
+                continue;
+            if (i == 0) {
+                task = std::move(worker.tasks.back());
+                worker.tasks.pop_back();
+            } else {
+                task = std::move(worker.tasks.front());
+                worker.tasks.pop_front();
+            }
+            pending_--;
+            return true;
+        }
+        return false;
+    }
+
+    void work(size_t self) {
+        std::function<void()> task;
+        for (;;) {
+            if (popTask(self, task)) {
+                task();
+                task = nullptr;
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleep_mutex_);
+            sleep_cv_.wait(lock, [&] { return stop_ || pending_ > 0; });
+            if (stop_)
+                return;
+        }
+    }
+
+    void push(std::function<void()> task) {
+        size_t n = workers_.size();
+        Worker &worker = *workers_[next_worker_++ % n];
+        {
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            pending_++;
+        }
+        sleep_cv_.notify_one();
+    }
+
+    void stopWorkers() {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            stop_ = true;
+        }
+        sleep_cv_.notify_all();
+        for (auto &thread : threads_)
+            thread.join();
+        threads_.clear();
+        workers_.clear();
+        pending_ = 0;
+        stop_ = false;
+    }
+
+    static void pinToCore(std::thread &thread, size_t core) {
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core, &set);
+        pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#endif
+    }
+
+    // Claims and runs indices until the loop is exhausted. The first exception
+    // stops the loop and is kept for the caller.
+    template<class Function>
+    static void runLoop(Loop &loop, Function &fn, size_t runner) {
+        for (;;) {
+            size_t id = loop.next.fetch_add(1);
+            if (id >= loop.end)
+                break;
+            try {
+                fn(id, runner);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(loop.mutex);
+                if (!loop.exception)
+                    loop.exception = std::current_exception();
+                loop.next = loop.end;
+                break;
+            }
+        }
+    }
+
+ public:
+    static Executor &instance() {
+        static Executor executor;
+        return executor;
+    }
+
+    // Replaces the workers with num_threads new ones (<= 0 uses all hardware
+    // threads), pinned to cores 0, 1, ... when pin_threads is set (Linux only).
+    // Loops that are running finish on their calling threads.
+    void resize(int num_threads, bool pin_threads) {
+        std::lock_guard<std::mutex> lock(config_mutex_);
+        size_t n = num_threads > 0 ? (size_t) num_threads : std::thread::hardware_concurrency();
+        if (n == 0)
+            n = 1;
+        stopWorkers();
+        for (size_t i = 0; i < n; i++)
+            workers_.emplace_back(new Worker());
+        size_t cores = std::max(1u, std::thread::hardware_concurrency());
+        for (size_t i = 0; i < n; i++) {
+            threads_.emplace_back([this, i] { work(i); });
+            if (pin_threads)
+                pinToCore(threads_.back(), i % cores);
+        }
+        num_workers_ = n;
+    }
+
+    // Replaces the workers with num_threads new ones (<= 0 uses all cpus of the
+    // nodes), spread round-robin over the given NUMA nodes and each allowed to
+    // run only on its node's cpus (Linux only).
+    void resizeOnNodes(int num_threads, const std::vector<size_t> &nodes) {
+        if (nodes.empty())
+            throw std::runtime_error("No NUMA nodes given");
+        const NumaTopology &topology = NumaTopology::instance();
+        size_t n = num_threads > 0 ? (size_t) num_threads : 0;
+        for (size_t node : nodes) {
+            if (node >= topology.numNodes())
+                throw std::runtime_error("No such NUMA node");
+            if (num_threads <= 0)
+                n += topology.cpus(node).size();
+        }
+        std::lock_guard<std::mutex> lock(config_mutex_);
+        stopWorkers();
+        for (size_t i = 0; i < n; i++)
+            workers_.emplace_back(new Worker());
+        for (size_t i = 0; i < n; i++) {
+            threads_.emplace_back([this, i] { work(i); });
+            pinThreadToNode(threads_.back(), nodes[i % nodes.size()]);
+        }
+        num_workers_ = n;
+    }
+
+    size_t size() const {
+        return num_workers_;
+    }
+
+    // Runs fn(id, runner) for every id in [start, end) on up to num_threads
+    // threads, the calling thread included; runner < num_threads tells the
+    // concurrent runners apart. The first exception thrown by fn stops the loop
+    // and is rethrown to the caller.
+    template<class Function>
+    void parallelFor(size_t start, size_t end, size_t num_threads, Function fn) {
+        if (start >= end)
+            return;
+        size_t helpers = std::min(num_threads, end - start);
+        helpers = helpers > 0 ? helpers - 1 : 0;
+        if (helpers == 0) {
+            for (size_t id = start; id < end; id++)
+                fn(id, 0);
+            return;
+        }
+
+        auto loop = std::make_shared<Loop>(start, end);
+        {
+            std::lock_guard<std::mutex> lock(config_mutex_);
+            helpers = std::min(helpers, workers_.size());
+            for (size_t runner = 1; runner <= helpers; runner++) {
+                // fn lives on the caller's stack; runners only touch it while
+                // indices are left, and the caller waits for those.
+                push([loop, &fn, runner] {
+                    loop->in_flight++;
+                    runLoop(*loop, fn, runner);
+                    if (--loop->in_flight == 0) {
+                        std::lock_guard<std::mutex> lock(loop->mutex);
+                        loop->done_cv.notify_all();
+                    }
+                });
+            }
+        }
+
+        runLoop(*loop, fn, 0);
+        {
+            std::unique_lock<std::mutex> lock(loop->mutex);
+            loop->done_cv.wait(lock, [&] { return loop->in_flight == 0; });
+        }
+        if (loop->exception)
+            std::rethrow_exception(loop->exception);
+    }
+};
+}  // namespace hnswlib
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdexcept>
+#include <string>
+#if !defined(_WIN32)
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#include <mutex>
+#endif
+
+namespace hnswlib {
+///////////////////////////////////////////////////////////
+//
+// Positional reads of a file from several threads
+//
+// read(data, size, offset) does not move a shared file position, so threads
+// can each read their own part of the file at once. A read past the end of the
+// file throws, like any other failed read.
+//
+/////////////////////////////////////////////////////////
+
+class FileReader {
+    uint64_t size_{0};
+#if !defined(_WIN32)
+    int fd_{-1};
+#else
+    std::mutex mutex_;
+    std::ifstream input_;
+#endif
+
+    static void fail() {
+        throw std::runtime_error("Cannot read index file");
+    }
+
+ public:
+    explicit FileReader(const std::string &location) {
+#if !defined(_WIN32)
+        fd_ = open(location.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if (fd_ < 0 || fstat(fd_, &st) != 0) {
+            if (fd_ >= 0)
+                close(fd_);
+            throw std::runtime_error("Cannot open file");
+        }
+        size_ = st.st_size;
+#else
+        input_.open(location, std::ios::binary);
+        if (!input_.is_open())
+            throw std::runtime_error("Cannot open file");
+        input_.seekg(0, input_.end);
+        size_ = input_.tellg();
+#endif
+    }
+
+    FileReader(const FileReader &) = delete;
+    FileReader &operator=(const FileReader &) = delete;
+
+    ~FileReader() {
+#if !defined(_WIN32)
+        close(fd_);
+#endif
+    }
+
+    uint64_t size() const {
+        return size_;
+    }
+
+    void read(void *data, size_t size, uint64_t offset) {
+        if (offset > size_ || size > size_ - offset)
+            fail();
+        char *bytes = (char *) data;
+#if !defined(_WIN32)
+        while (size > 0) {
+            ssize_t got = pread(fd_, bytes, size, offset);
+            if (got < 0 && errno == EINTR)
+                continue;
+            if (got <= 0)
+                fail();
+            bytes += got;
+            offset += got;
+            size -= got;
+        }
+#else
+        std::lock_guard<std::mutex> lock(mutex_);
+        input_.seekg(offset, input_.beg);
+        input_.read(bytes, size);
+        if (!input_)
+            fail();
+#endif
+    }
+};
+}  // namespace hnswlib
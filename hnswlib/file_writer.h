@@ -0,0 +1,221 @@
+#pragma once
+
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include "id_tables.h"
+#if !defined(_WIN32)
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+namespace hnswlib {
+///////////////////////////////////////////////////////////
+//
+// Crash-safe replacement of a file
+//
+// Writes go to a temporary file of a unique name, <location>.tmp.XXXXXX, which
+// commit() flushes, fsyncs and renames over location, so readers and a crash
+// mid-save see either the old file or the whole new one, and two saves to the
+// same location never write into each other's file. Data is staged in a large aligned buffer and written with
+// O_DIRECT where the filesystem supports it, so saving a multi-gigabyte index
+// neither evicts the page cache serving searches nor leaves gigabytes of dirty
+// pages whose writeback stalls other I/O. The temporary file is removed if the
+// writer is destroyed without commit().
+//
+/////////////////////////////////////////////////////////
+
+class AtomicFileWriter {
+    static constexpr size_t ALIGN = 4096;
+    static constexpr size_t DEFAULT_BUFFER = size_t(4) << 20;
+
+    std::string location_;
+    std::string temp_;
+    char *buffer_{nullptr};
+    size_t capacity_{0};
+    size_t used_{0};
+    size_t size_{0};  // bytes written so far, including the buffered ones
+    bool committed_{false};
+#if !defined(_WIN32)
+    int fd_{-1};
+    bool direct_{false};
+#else
+    std::ofstream out_;
+#endif
+
+    static void fail() {
+        throw std::runtime_error("Cannot write index file");
+    }
+
+#if !defined(_WIN32)
+    void writeAll(const char *data, size_t size) {
+        while (size > 0) {
+            ssize_t written = ::write(fd_, data, size);
+            if (written < 0) {
+                if (errno == EINTR)
+                    continue;
+#ifdef O_DIRECT
+                // some filesystems accept O_DIRECT at open time but not on write
+                if (errno == EINVAL && direct_) {
+                    direct_ = false;
+                    if (fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) & ~O_DIRECT) == 0)
+                        continue;
+                }
+#endif
+                fail();
+            }
+            data += written;
+            size -= written;
+        }
+    }
+#else
+    void writeAll(const char *data, size_t size) {
+        out_.write(data, size);
+        if (!out_)
+            fail();
+    }
+#endif
+
+    // six characters that differ between calls, processes and runs
+    static std::string uniqueSuffix() {
+        static std::atomic<uint64_t> counter{0};
+        static const char digits[] = "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+        uint64_t seed = (uint64_t) std::chrono::steady_clock::now().time_since_epoch().count();
+        seed ^= (uint64_t) (uintptr_t) &counter;
+#if !defined(_WIN32)
+        seed ^= (uint64_t) getpid() << 32;
+#endif
+        seed += counter.fetch_add(1) * 0x9e3779b97f4a7c15ULL;
+        seed = mixHash(seed);
+        std::string suffix(6, '0');
+        for (char &c : suffix) {
+            c = digits[seed % 62];
+            seed /= 62;
+        }
+        return suffix;
+    }
+
+ public:
+    explicit AtomicFileWriter(const std::string &location, size_t buffer_size = DEFAULT_BUFFER)
+        : location_(location) {
+        capacity_ = (buffer_size + ALIGN - 1) / ALIGN * ALIGN;
+#if !defined(_WIN32)
+        void *buffer = nullptr;
+        if (posix_memalign(&buffer, ALIGN, capacity_) != 0)
+            throw std::runtime_error("Not enough memory: failed to allocate write buffer");
+        buffer_ = (char *) buffer;
+        // like mkstemp, but with the permissions and O_DIRECT of a plain open
+        int flags = O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC;
+        for (int attempt = 0; fd_ < 0 && attempt < 100; attempt++) {
+            temp_ = location + ".tmp." + uniqueSuffix();
+#ifdef O_DIRECT
+            fd_ = open(temp_.c_str(), flags | O_DIRECT, 0644);
+            direct_ = fd_ >= 0;
+            if (fd_ < 0 && errno != EEXIST)
+#endif
+                fd_ = open(temp_.c_str(), flags, 0644);
+            if (fd_ < 0 && errno != EEXIST)
+                break;
+        }
+        if (fd_ < 0) {
+            free(buffer_);
+            throw std::runtime_error("Cannot open file");
+        }
+#else
+        buffer_ = (char *) malloc(capacity_);
+        if (buffer_ == nullptr)
+            throw std::runtime_error("Not enough memory: failed to allocate write buffer");
+        temp_ = location + ".tmp." + uniqueSuffix();
+        out_.open(temp_, std::ios::binary | std::ios::trunc);
+        if (!out_.is_open()) {
+            free(buffer_);
+            throw std::runtime_error("Cannot open file");
+        }
+#endif
+    }
+
+    AtomicFileWriter(const AtomicFileWriter &) = delete;
+    AtomicFileWriter &operator=(const AtomicFileWriter &) = delete;
+
+    ~AtomicFileWriter() {
+#if !defined(_WIN32)
+        if (fd_ >= 0)
+            close(fd_);
+#else
+        out_.close();
+#endif
+        if (!committed_)
+            std::remove(temp_.c_str());
+        free(buffer_);
+    }
+
+    void write(const void *data, size_t size) {
+        const char *bytes = (const char *) data;
+        size_ += size;
+        while (size > 0) {
+            size_t chunk = std::min(size, capacity_ - used_);
+            memcpy(buffer_ + used_, bytes, chunk);
+            used_ += chunk;
+            bytes += chunk;
+            size -= chunk;
+            if (used_ == capacity_) {
+                writeAll(buffer_, capacity_);
+                used_ = 0;
+            }
+        }
+    }
+
+    template<typename T>
+    void writePOD(const T &value) {
+        write(&value, sizeof(T));
+    }
+
+    // Makes the written data durable and moves it to location.
+    void commit() {
+#if !defined(_WIN32)
+        // O_DIRECT writes whole blocks; the padding is cut off again
+        size_t tail = direct_ ? (used_ + ALIGN - 1) / ALIGN * ALIGN : used_;
+        memset(buffer_ + used_, 0, tail - used_);
+        writeAll(buffer_, tail);
+        if (tail != used_ && ftruncate(fd_, size_) != 0)
+            fail();
+        used_ = 0;
+        if (fsync(fd_) != 0 || close(fd_) != 0) {
+            fd_ = -1;
+            fail();
+        }
+        fd_ = -1;
+        if (rename(temp_.c_str(), location_.c_str()) != 0)
+            fail();
+        committed_ = true;
+        // persist the rename itself; failing to is not worth failing the save for
+        size_t slash = location_.find_last_of('/');
+        std::string dir = slash == std::string::npos ? "." : location_.substr(0, slash + 1);
+        int dir_fd = open(dir.c_str(), O_RDONLY | O_CLOEXEC);
+        if (dir_fd >= 0) {
+            fsync(dir_fd);
+            close(dir_fd);
+        }
+#else
+        writeAll(buffer_, used_);
+        used_ = 0;
+        out_.close();
+        if (!out_)
+            fail();
+        // rename does not replace an existing file on Windows
+        std::remove(location_.c_str());
+        if (std::rename(temp_.c_str(), location_.c_str()) != 0)
+            fail();
+        committed_ = true;
+#endif
+    }
+};
+}  // namespace hnswlib
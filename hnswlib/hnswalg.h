@@ -1,23 +1,61 @@
 #pragma once
 
 #include "visited_list_pool.h"
+#include "chunked_storage.h"
+#include "executor.h"
 #include "hnswlib.h"
+#include "id_tables.h"
+#include "link_arena.h"
 #include <atomic>
 #include <random>
+#include <stddef.h>
 #include <stdlib.h>
 #include <assert.h>
 #include <unordered_set>
 #include <list>
+#include <functional>
 #include <memory>
+#include <shared_mutex>
+#if !defined(_WIN32)
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace hnswlib {
 typedef unsigned int tableint;
 typedef unsigned int linklistsizeint;
 
+/*
+* Work done by the searches of the calling thread. The counters are thread-local
+* so the search loops update them with plain increments instead of atomic
+* read-modify-writes on cache lines shared by all threads; callers reset them
+* before a search and read them after it.
+*/
+struct SearchStats {
+    size_t hops{0};                   // nodes whose links were expanded, on all layers
+    size_t distance_computations{0};
+    size_t visited{0};                // base-layer nodes reached
+    size_t deleted_skipped{0};        // deleted base-layer nodes kept out of the results
+};
+
+inline SearchStats &threadSearchStats() {
+    static thread_local SearchStats stats;
+    return stats;
+}
+
 template<typename dist_t>
 class HierarchicalNSW : public AlgorithmInterface<dist_t> {
  public:
     static const tableint MAX_LABEL_OPERATION_LOCKS = 65536;
+    static constexpr size_t DEFAULT_PREFETCH_DISTANCE = 4;
+    static constexpr size_t MAX_PREFETCH_LINES = 8;
+    // Per-element storage is allocated in chunks of at most this many bytes of
+    // level 0 data, and of at least 2^MIN_STORAGE_CHUNK_SHIFT elements
+    static constexpr size_t STORAGE_CHUNK_BYTES = size_t(64) << 20;
+    static constexpr size_t MIN_STORAGE_CHUNK_SHIFT = 10;
     static const unsigned char DELETE_MARK = 0x01;
 
     size_t max_elements_{0};
@@ -40,24 +78,35 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
     mutable std::vector<std::mutex> label_op_locks_;
 
     std::mutex global;
-    std::vector<std::mutex> link_list_locks_;
+    ChunkedArray<std::mutex> link_list_locks_;
+    // Held shared by every insert of a new element and exclusively by saveIndex
+    // for the instant it takes the element count, so no insert is half done then.
+    // std::shared_mutex may let readers overtake a waiting writer forever, so
+    // saveIndex also holds snapshot_turnstile_ and raises snapshot_pending_ while
+    // it waits, and inserts that see the flag queue on the turnstile behind it.
+    std::shared_mutex snapshot_lock_;
+    std::mutex snapshot_turnstile_;
+    std::atomic<bool> snapshot_pending_{false};
 
     tableint enterpoint_node_{0};
 
     size_t size_links_level0_{0};
     size_t offsetData_{0}, offsetLevel0_{0}, label_offset_{ 0 };
 
-    char *data_level0_memory_{nullptr};
-    char **linkLists_{nullptr};
-    std::vector<int> element_levels_;  // keeps level of each element
+    // Element storage never moves when the index grows, so searches can run
+    // concurrently with resizeIndex and with inserts that grow the index
+    ChunkedBuffer data_level0_memory_;
+    ChunkedArray<char *> linkLists_;
+    ChunkedArray<int> element_levels_;  // keeps level of each element
+    LinkListArena link_arena_;  // owns every upper-level link list unless memory-mapped
 
     size_t data_size_{0};
 
     DISTFUNC<dist_t> fstdistfunc_;
     void *dist_func_param_{nullptr};
 
-    mutable std::mutex label_lookup_lock;  // lock for label_lookup_
-    std::unordered_map<labeltype, tableint> label_lookup_;
+    std::mutex element_count_lock_;  // serializes taking new internal ids with resizeIndex
+    StripedHashMap<labeltype, tableint> label_lookup_;  // locks each stripe itself
 
     std::default_random_engine level_generator_;
     std::default_random_engine update_probability_generator_;
@@ -68,7 +117,24 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
     bool allow_replace_deleted_ = false;  // flag to replace deleted elements (marked as deleted) during insertions
 
     std::mutex deleted_elements_lock;  // lock for deleted_elements
-    std::unordered_set<tableint> deleted_elements;  // contains internal ids of deleted elements
+    DenseIdSet<tableint> deleted_elements;  // contains internal ids of deleted elements
+
+    // How many candidates ahead of the distance loop searchBaseLayerST prefetches vectors
+    size_t prefetch_distance_{DEFAULT_PREFETCH_DISTANCE};
+
+    // Whether addPoint grows a full index by a storage chunk instead of throwing
+    bool auto_grow_{false};
+
+    // Next element repairDeletedLinks examines (see compactIndex)
+    size_t compact_cursor_{0};
+
+    // Set when the index is served read-only from a file mapping (see loadIndexMmap)
+    char *mmap_base_{nullptr};
+    size_t mmap_size_{0};
+    // Set when the mapped file stores the link lists packed (see getPackedList);
+    // the lists of element i then start at packed_links_ + packed_offsets_[i]
+    const uint32_t *packed_links_{nullptr};
+    const uint32_t *packed_offsets_{nullptr};
 
 
     HierarchicalNSW(SpaceInterface<dist_t> *s) {
@@ -94,8 +160,6 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
         size_t random_seed = 100,
         bool allow_replace_deleted = false)
         : label_op_locks_(MAX_LABEL_OPERATION_LOCKS),
-            link_list_locks_(max_elements),
-            element_levels_(max_elements),
             allow_replace_deleted_(allow_replace_deleted) {
         max_elements_ = max_elements;
         num_deleted_ = 0;
@@ -123,9 +187,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
         label_offset_ = size_links_level0_ + data_size_;
         offsetLevel0_ = 0;
 
-        data_level0_memory_ = (char *) malloc(max_elements_ * size_data_per_element_);
-        if (data_level0_memory_ == nullptr)
-            throw std::runtime_error("Not enough memory");
+        initStorage(max_elements_);
 
         cur_element_count = 0;
 
@@ -135,10 +197,8 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
         enterpoint_node_ = -1;
         maxlevel_ = -1;
 
-        linkLists_ = (char **) malloc(sizeof(void *) * max_elements_);
-        if (linkLists_ == nullptr)
-            throw std::runtime_error("Not enough memory: HierarchicalNSW failed to allocate linklists");
         size_links_per_element_ = maxM_ * sizeof(tableint) + sizeof(linklistsizeint);
+        link_arena_.setListSize(size_links_per_element_);
         mult_ = 1 / log(1.0 * M_);
         revSize_ = 1.0 / mult_;
     }
@@ -149,19 +209,31 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
     }
 
     void clear() {
-        free(data_level0_memory_);
-        data_level0_memory_ = nullptr;
-        for (tableint i = 0; i < cur_element_count; i++) {
-            if (element_levels_[i] > 0)
-                free(linkLists_[i]);
-        }
-        free(linkLists_);
-        linkLists_ = nullptr;
+        if (mmap_base_) {
+            // level 0 and the upper link lists point into the mapping
+#if !defined(_WIN32)
+            munmap(mmap_base_, mmap_size_);
+#endif
+            mmap_base_ = nullptr;
+            mmap_size_ = 0;
+            packed_links_ = nullptr;
+            packed_offsets_ = nullptr;
+        }
+        link_arena_.clear();
+        data_level0_memory_.clear();
+        linkLists_.clear();
+        element_levels_.clear();
+        link_list_locks_.clear();
         cur_element_count = 0;
         visited_list_pool_.reset(nullptr);
     }
 
 
+    void freeLinkList(tableint internal_id) {
+        link_arena_.release(linkLists_[internal_id], element_levels_[internal_id]);
+    }
+
+
     struct CompareByFirst {
         constexpr bool operator()(std::pair<dist_t, tableint> const& a,
             std::pair<dist_t, tableint> const& b) const noexcept {
@@ -169,6 +241,60 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
         }
     };
 
+    // Candidate queue that can be emptied without releasing its storage.
+    struct ReusableQueue : public std::priority_queue<std::pair<dist_t, tableint>, std::vector<std::pair<dist_t, tableint>>, CompareByFirst> {
+        void clear() {
+            this->c.clear();
+        }
+    };
+
+
+    // Sets up empty storage for max_elements elements; size_data_per_element_ must be known.
+    void initStorage(size_t max_elements) {
+        size_t shift = MIN_STORAGE_CHUNK_SHIFT;
+        while ((size_t(1) << shift) < max_elements &&
+               (size_t(2) << shift) * size_data_per_element_ <= STORAGE_CHUNK_BYTES)
+            shift++;
+        data_level0_memory_.setStride(size_data_per_element_);
+        data_level0_memory_.setChunkShift(shift);
+        linkLists_.setChunkShift(shift);
+        element_levels_.setChunkShift(shift);
+        link_list_locks_.setChunkShift(shift);
+        resizeStorage(max_elements);
+    }
+
+
+    // Adds or frees whole chunks so that exactly the chunks holding the first n elements remain.
+    void resizeStorage(size_t n) {
+        data_level0_memory_.grow(n);
+        linkLists_.grow(n);
+        element_levels_.grow(n);
+        link_list_locks_.grow(n);
+        data_level0_memory_.shrink(n);
+        linkLists_.shrink(n);
+        element_levels_.shrink(n);
+        link_list_locks_.shrink(n);
+    }
+
+
+    void setAutoGrow(bool auto_grow) {
+        auto_grow_ = auto_grow;
+    }
+
+
+    void setPrefetchDistance(size_t distance) {
+        prefetch_distance_ = distance;
+    }
+
+
+    // Prefetches the leading cache lines of an element's vector.
+    inline void prefetchData(tableint internal_id) const {
+        const char *ptr = getDataByInternalId(internal_id);
+        size_t lines = std::min((data_size_ + 63) / 64, MAX_PREFETCH_LINES);
+        for (size_t line = 0; line < lines; line++)
+            HNSWLIB_PREFETCH(ptr + line * 64);
+    }
+
 
     void setEf(size_t ef) {
         ef_ = ef;
@@ -176,31 +302,31 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
 
 
     inline std::mutex& getLabelOpMutex(labeltype label) const {
-        // calculate hash
-        size_t lock_id = label & (MAX_LABEL_OPERATION_LOCKS - 1);
+        // mixed like the label table, so strided labels do not share locks
+        size_t lock_id = mixHash(label) & (MAX_LABEL_OPERATION_LOCKS - 1);
         return label_op_locks_[lock_id];
     }
 
 
     inline labeltype getExternalLabel(tableint internal_id) const {
         labeltype return_label;
-        memcpy(&return_label, (data_level0_memory_ + internal_id * size_data_per_element_ + label_offset_), sizeof(labeltype));
+        memcpy(&return_label, (data_level0_memory_[internal_id] + label_offset_), sizeof(labeltype));
         return return_label;
     }
 
 
     inline void setExternalLabel(tableint internal_id, labeltype label) const {
-        memcpy((data_level0_memory_ + internal_id * size_data_per_element_ + label_offset_), &label, sizeof(labeltype));
+        memcpy((data_level0_memory_[internal_id] + label_offset_), &label, sizeof(labeltype));
     }
 
 
     inline labeltype *getExternalLabeLp(tableint internal_id) const {
-        return (labeltype *) (data_level0_memory_ + internal_id * size_data_per_element_ + label_offset_);
+        return (labeltype *) (data_level0_memory_[internal_id] + label_offset_);
     }
 
 
     inline char *getDataByInternalId(tableint internal_id) const {
-        return (data_level0_memory_ + internal_id * size_data_per_element_ + offsetData_);
+        return (data_level0_memory_[internal_id] + offsetData_);
     }
 
 
@@ -227,6 +353,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
         VisitedList *vl = visited_list_pool_->getFreeVisitedList();
         vl_type *visited_array = vl->mass;
         vl_type visited_array_tag = vl->curV;
+        tableint visited_limit = vl->numelements;
 
         std::priority_queue<std::pair<dist_t, tableint>, std::vector<std::pair<dist_t, tableint>>, CompareByFirst> top_candidates;
         std::priority_queue<std::pair<dist_t, tableint>, std::vector<std::pair<dist_t, tableint>>, CompareByFirst> candidateSet;
@@ -266,17 +393,24 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
 #ifdef USE_SSE
             _mm_prefetch((char *) (visited_array + *(data + 1)), _MM_HINT_T0);
             _mm_prefetch((char *) (visited_array + *(data + 1) + 64), _MM_HINT_T0);
-            _mm_prefetch(getDataByInternalId(*datal), _MM_HINT_T0);
-            _mm_prefetch(getDataByInternalId(*(datal + 1)), _MM_HINT_T0);
+            // ids past the end of the list are not valid element ids
+            if (size > 0)
+                _mm_prefetch(getDataByInternalId(*datal), _MM_HINT_T0);
+            if (size > 1)
+                _mm_prefetch(getDataByInternalId(*(datal + 1)), _MM_HINT_T0);
 #endif
 
             for (size_t j = 0; j < size; j++) {
                 tableint candidate_id = *(datal + j);
 //                    if (candidate_id == 0) continue;
 #ifdef USE_SSE
-                _mm_prefetch((char *) (visited_array + *(datal + j + 1)), _MM_HINT_T0);
-                _mm_prefetch(getDataByInternalId(*(datal + j + 1)), _MM_HINT_T0);
+                if (j + 1 < size) {
+                    _mm_prefetch((char *) (visited_array + *(datal + j + 1)), _MM_HINT_T0);
+                    _mm_prefetch(getDataByInternalId(*(datal + j + 1)), _MM_HINT_T0);
+                }
 #endif
+                // added after this search took its visited list, by an insert that grew the index
+                if (candidate_id >= visited_limit) continue;
                 if (visited_array[candidate_id] == visited_array_tag) continue;
                 visited_array[candidate_id] = visited_array_tag;
                 char *currObj1 = (getDataByInternalId(candidate_id));
@@ -314,12 +448,42 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
         size_t ef,
         BaseFilterFunctor* isIdAllowed = nullptr,
         BaseSearchStopCondition<dist_t>* stop_condition = nullptr) const {
+        std::priority_queue<std::pair<dist_t, tableint>, std::vector<std::pair<dist_t, tableint>>, CompareByFirst> top_candidates;
+        std::priority_queue<std::pair<dist_t, tableint>, std::vector<std::pair<dist_t, tableint>>, CompareByFirst> candidate_set;
+        searchBaseLayerSTInto<bare_bone_search, collect_metrics>(
+            ep_id, data_point, ef, top_candidates, candidate_set, isIdAllowed, stop_condition);
+        return top_candidates;
+    }
+
+
+    /*
+    * searchBaseLayerST with caller-provided (empty) queues, so their storage can
+    * be reused across searches; the results are left in top_candidates.
+    */
+    template <bool bare_bone_search = true, bool collect_metrics = false>
+    void searchBaseLayerSTInto(
+        tableint ep_id,
+        const void *data_point,
+        size_t ef,
+        std::priority_queue<std::pair<dist_t, tableint>, std::vector<std::pair<dist_t, tableint>>, CompareByFirst> &top_candidates,
+        std::priority_queue<std::pair<dist_t, tableint>, std::vector<std::pair<dist_t, tableint>>, CompareByFirst> &candidate_set,
+        BaseFilterFunctor* isIdAllowed = nullptr,
+        BaseSearchStopCondition<dist_t>* stop_condition = nullptr) const {
         VisitedList *vl = visited_list_pool_->getFreeVisitedList();
         vl_type *visited_array = vl->mass;
         vl_type visited_array_tag = vl->curV;
-
-        std::priority_queue<std::pair<dist_t, tableint>, std::vector<std::pair<dist_t, tableint>>, CompareByFirst> top_candidates;
-        std::priority_queue<std::pair<dist_t, tableint>, std::vector<std::pair<dist_t, tableint>>, CompareByFirst> candidate_set;
+        tableint visited_limit = vl->numelements;
+        SearchStats &stats = threadSearchStats();
+
+        // unvisited neighbors of the node being expanded and their distances
+        static thread_local std::vector<tableint> new_ids;
+        static thread_local std::vector<dist_t> new_dists;
+        static thread_local std::vector<tableint> unpacked;
+        if (new_ids.size() < maxM0_ + 1) {
+            new_ids.resize(maxM0_ + 1);
+            new_dists.resize(maxM0_ + 1);
+            unpacked.resize(maxM0_ + 1);
+        }
 
         dist_t lowerBound;
         if (bare_bone_search || 
@@ -332,12 +496,16 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
                 stop_condition->add_point_to_result(getExternalLabel(ep_id), ep_data, dist);
             }
             candidate_set.emplace(-dist, ep_id);
+            stats.distance_computations++;
         } else {
             lowerBound = std::numeric_limits<dist_t>::max();
             candidate_set.emplace(-lowerBound, ep_id);
+            if (isMarkedDeleted(ep_id))
+                stats.deleted_skipped++;
         }
 
         visited_array[ep_id] = visited_array_tag;
+        stats.visited++;
 
         while (!candidate_set.empty()) {
             std::pair<dist_t, tableint> current_node_pair = candidate_set.top();
@@ -359,84 +527,99 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
             candidate_set.pop();
 
             tableint current_node_id = current_node_pair.second;
-            int *data = (int *) get_linklist0(current_node_id);
-            size_t size = getListCount((linklistsizeint*)data);
+            size_t size;
+            const tableint *neighbors = getNeighbors(current_node_id, 0, size, unpacked.data());
 //                bool cur_node_deleted = isMarkedDeleted(current_node_id);
             if (collect_metrics) {
                 metric_hops++;
                 metric_distance_computations+=size;
             }
+            stats.hops++;
 
-#ifdef USE_SSE
-            _mm_prefetch((char *) (visited_array + *(data + 1)), _MM_HINT_T0);
-            _mm_prefetch((char *) (visited_array + *(data + 1) + 64), _MM_HINT_T0);
-            _mm_prefetch(data_level0_memory_ + (*(data + 1)) * size_data_per_element_ + offsetData_, _MM_HINT_T0);
-            _mm_prefetch((char *) (data + 2), _MM_HINT_T0);
-#endif
-
-            for (size_t j = 1; j <= size; j++) {
-                int candidate_id = *(data + j);
-//                    if (candidate_id == 0) continue;
-#ifdef USE_SSE
-                _mm_prefetch((char *) (visited_array + *(data + j + 1)), _MM_HINT_T0);
-                _mm_prefetch(data_level0_memory_ + (*(data + j + 1)) * size_data_per_element_ + offsetData_,
-                                _MM_HINT_T0);  ////////////
-#endif
+            // Collect the unvisited neighbors first, then compute their distances in
+            // one pass that prefetches vectors prefetch_distance_ candidates ahead.
+            size_t num_new = 0;
+            if (size > 0)
+                HNSWLIB_PREFETCH(visited_array + neighbors[0]);
+            for (size_t j = 0; j < size; j++) {
+                tableint candidate_id = neighbors[j];
+                if (j + 1 < size)
+                    HNSWLIB_PREFETCH(visited_array + neighbors[j + 1]);
+                // added after this search took its visited list, by an insert that grew the index
+                if (candidate_id >= visited_limit)
+                    continue;
                 if (!(visited_array[candidate_id] == visited_array_tag)) {
                     visited_array[candidate_id] = visited_array_tag;
+                    new_ids[num_new++] = candidate_id;
+                }
+            }
 
-                    char *currObj1 = (getDataByInternalId(candidate_id));
-                    dist_t dist = fstdistfunc_(data_point, currObj1, dist_func_param_);
+            stats.visited += num_new;
+            stats.distance_computations += num_new;
 
-                    bool flag_consider_candidate;
-                    if (!bare_bone_search && stop_condition) {
-                        flag_consider_candidate = stop_condition->should_consider_candidate(dist, lowerBound);
-                    } else {
-                        flag_consider_candidate = top_candidates.size() < ef || lowerBound > dist;
-                    }
+            size_t lookahead = std::min(prefetch_distance_, num_new);
+            for (size_t j = 0; j < lookahead; j++)
+                prefetchData(new_ids[j]);
+            for (size_t j = 0; j < num_new; j++) {
+                if (j + lookahead < num_new)
+                    prefetchData(new_ids[j + lookahead]);
+                new_dists[j] = fstdistfunc_(data_point, getDataByInternalId(new_ids[j]), dist_func_param_);
+            }
+
+            for (size_t j = 0; j < num_new; j++) {
+                tableint candidate_id = new_ids[j];
+                char *currObj1 = (getDataByInternalId(candidate_id));
+                dist_t dist = new_dists[j];
 
-                    if (flag_consider_candidate) {
-                        candidate_set.emplace(-dist, candidate_id);
+                bool flag_consider_candidate;
+                if (!bare_bone_search && stop_condition) {
+                    flag_consider_candidate = stop_condition->should_consider_candidate(dist, lowerBound);
+                } else {
+                    flag_consider_candidate = top_candidates.size() < ef || lowerBound > dist;
+                }
+
+                if (flag_consider_candidate) {
+                    candidate_set.emplace(-dist, candidate_id);
 #ifdef USE_SSE
-                        _mm_prefetch(data_level0_memory_ + candidate_set.top().second * size_data_per_element_ +
-                                        offsetLevel0_,  ///////////
-                                        _MM_HINT_T0);  ////////////////////////
+                    _mm_prefetch(data_level0_memory_[candidate_set.top().second] +
+                                    offsetLevel0_,  ///////////
+                                    _MM_HINT_T0);  ////////////////////////
 #endif
 
-                        if (bare_bone_search || 
-                            (!isMarkedDeleted(candidate_id) && ((!isIdAllowed) || (*isIdAllowed)(getExternalLabel(candidate_id))))) {
-                            top_candidates.emplace(dist, candidate_id);
-                            if (!bare_bone_search && stop_condition) {
-                                stop_condition->add_point_to_result(getExternalLabel(candidate_id), currObj1, dist);
-                            }
+                    if (bare_bone_search || 
+                        (!isMarkedDeleted(candidate_id) && ((!isIdAllowed) || (*isIdAllowed)(getExternalLabel(candidate_id))))) {
+                        top_candidates.emplace(dist, candidate_id);
+                        if (!bare_bone_search && stop_condition) {
+                            stop_condition->add_point_to_result(getExternalLabel(candidate_id), currObj1, dist);
                         }
+                    } else if (isMarkedDeleted(candidate_id)) {
+                        stats.deleted_skipped++;
+                    }
 
-                        bool flag_remove_extra = false;
+                    bool flag_remove_extra = false;
+                    if (!bare_bone_search && stop_condition) {
+                        flag_remove_extra = stop_condition->should_remove_extra();
+                    } else {
+                        flag_remove_extra = top_candidates.size() > ef;
+                    }
+                    while (flag_remove_extra) {
+                        tableint id = top_candidates.top().second;
+                        top_candidates.pop();
                         if (!bare_bone_search && stop_condition) {
+                            stop_condition->remove_point_from_result(getExternalLabel(id), getDataByInternalId(id), dist);
                             flag_remove_extra = stop_condition->should_remove_extra();
                         } else {
                             flag_remove_extra = top_candidates.size() > ef;
                         }
-                        while (flag_remove_extra) {
-                            tableint id = top_candidates.top().second;
-                            top_candidates.pop();
-                            if (!bare_bone_search && stop_condition) {
-                                stop_condition->remove_point_from_result(getExternalLabel(id), getDataByInternalId(id), dist);
-                                flag_remove_extra = stop_condition->should_remove_extra();
-                            } else {
-                                flag_remove_extra = top_candidates.size() > ef;
-                            }
-                        }
-
-                        if (!top_candidates.empty())
-                            lowerBound = top_candidates.top().first;
                     }
+
+                    if (!top_candidates.empty())
+                        lowerBound = top_candidates.top().first;
                 }
             }
         }
 
         visited_list_pool_->releaseVisitedList(vl);
-        return top_candidates;
     }
 
 
@@ -484,12 +667,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
 
 
     linklistsizeint *get_linklist0(tableint internal_id) const {
-        return (linklistsizeint *) (data_level0_memory_ + internal_id * size_data_per_element_ + offsetLevel0_);
-    }
-
-
-    linklistsizeint *get_linklist0(tableint internal_id, char *data_level0_memory_) const {
-        return (linklistsizeint *) (data_level0_memory_ + internal_id * size_data_per_element_ + offsetLevel0_);
+        return (linklistsizeint *) (data_level0_memory_[internal_id] + offsetLevel0_);
     }
 
 
@@ -503,6 +681,85 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
     }
 
 
+    /*
+    * Packed link lists, written by saveIndexMmap for read-only serving. A list is
+    * sorted and stored in 32-bit words:
+    *   word 0  count (bits 0-15), width (bits 16-21) and, on level 0, the flags
+    *           byte of the element (bits 24-31)
+    *   word 1  base, the smallest id
+    *   then    id - base of each id in width bits, least significant bit first
+    * The lists of an element follow each other from level 0 up. After reorderIndex
+    * neighbors have nearby ids, so width is usually far below 32 bits.
+    */
+    static size_t packedListWords(const uint32_t *list) {
+        size_t count = list[0] & 0xffff;
+        size_t width = (list[0] >> 16) & 0x3f;
+        return 2 + (count * width + 31) / 32;
+    }
+
+    const uint32_t *getPackedList(tableint internal_id, int level) const {
+        const uint32_t *list = packed_links_ + packed_offsets_[internal_id];
+        for (int l = 0; l < level; l++)
+            list += packedListWords(list);
+        return list;
+    }
+
+    // Decodes a packed list into out. Reads one word past the list, which the
+    // file always has.
+    static size_t unpackList(const uint32_t *list, tableint *out) {
+        size_t count = list[0] & 0xffff;
+        unsigned width = (list[0] >> 16) & 0x3f;
+        tableint base = list[1];
+        const uint32_t *bits = list + 2;
+        uint64_t mask = (uint64_t(1) << width) - 1;
+        size_t bit = 0;
+        for (size_t j = 0; j < count; j++, bit += width) {
+            uint64_t pair = bits[bit >> 5] | (uint64_t) bits[(bit >> 5) + 1] << 32;
+            out[j] = base + (tableint) ((pair >> (bit & 31)) & mask);
+        }
+        return count;
+    }
+
+    // Appends list ll, packed, to out; ids is scratch.
+    static void packList(const linklistsizeint *ll, uint32_t flags, std::vector<tableint> &ids,
+                         std::vector<uint32_t> &out) {
+        size_t count = *((const unsigned short int *) ll);
+        const tableint *list = (const tableint *) (ll + 1);
+        ids.assign(list, list + count);
+        std::sort(ids.begin(), ids.end());
+        tableint base = count ? ids[0] : 0;
+        unsigned width = 0;
+        while (count && width < 32 && ((ids[count - 1] - base) >> width) != 0)
+            width++;
+        out.push_back((uint32_t) count | width << 16 | flags << 24);
+        out.push_back(base);
+        size_t start = out.size();
+        out.resize(start + (count * width + 31) / 32, 0);
+        size_t bit = 0;
+        for (size_t j = 0; j < count; j++, bit += width) {
+            uint64_t value = (uint64_t) (ids[j] - base) << (bit & 31);
+            out[start + (bit >> 5)] |= (uint32_t) value;
+            if ((bit & 31) + width > 32)
+                out[start + (bit >> 5) + 1] |= (uint32_t) (value >> 32);
+        }
+    }
+
+
+    /*
+    * Neighbors of internal_id at level: a pointer into its list or, when the lists
+    * are packed, to scratch (room for maxM0_ ids) holding the decoded list.
+    */
+    const tableint *getNeighbors(tableint internal_id, int level, size_t &size, tableint *scratch) const {
+        if (packed_links_) {
+            size = unpackList(getPackedList(internal_id, level), scratch);
+            return scratch;
+        }
+        linklistsizeint *ll = get_linklist_at_level(internal_id, level);
+        size = getListCount(ll);
+        return (const tableint *) (ll + 1);
+    }
+
+
     tableint mutuallyConnectNewElement(
         const void *data_point,
         tableint cur_c,
@@ -631,28 +888,257 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
 
 
     void resizeIndex(size_t new_max_elements) {
+        checkWritable();
+        // serializes with inserts that grow the index; existing elements never move,
+        // so searches continue meanwhile
+        std::unique_lock <std::mutex> lock_count(element_count_lock_);
         if (new_max_elements < cur_element_count)
             throw std::runtime_error("Cannot resize, max element is less than the current number of elements");
+        resizeStorage(new_max_elements);
+        visited_list_pool_->resize(new_max_elements);
+        max_elements_ = new_max_elements;
+    }
 
-        visited_list_pool_.reset(new VisitedListPool(1, new_max_elements));
 
-        element_levels_.resize(new_max_elements);
+    /*
+    * Renumbers internal ids in breadth-first order of the base layer, starting at
+    * the entry point, so that elements which are traversed together are stored
+    * together. Elements not reachable from the entry point follow in insertion
+    * order, each starting a new traversal. Labels, links, levels and delete marks
+    * are carried over, so search results are unchanged.
+    * Must not run concurrently with any other operation on the index.
+    */
+    void reorderIndex() {
+        checkWritable();
+        size_t n = cur_element_count;
+        if (n < 2)
+            return;
+
+        std::vector<tableint> new_to_old;
+        new_to_old.reserve(n);
+        std::vector<tableint> old_to_new(n, (tableint) -1);
+        std::vector<tableint> starts;
+        starts.push_back(enterpoint_node_);
+        for (tableint i = 0; i < n; i++)
+            starts.push_back(i);
+        for (tableint start : starts) {
+            if (old_to_new[start] != (tableint) -1)
+                continue;
+            size_t head = new_to_old.size();
+            old_to_new[start] = (tableint) new_to_old.size();
+            new_to_old.push_back(start);
+            while (head < new_to_old.size()) {
+                linklistsizeint *ll = get_linklist0(new_to_old[head++]);
+                size_t size = getListCount(ll);
+                tableint *links = (tableint *) (ll + 1);
+                for (size_t j = 0; j < size; j++) {
+                    if (old_to_new[links[j]] != (tableint) -1)
+                        continue;
+                    old_to_new[links[j]] = (tableint) new_to_old.size();
+                    new_to_old.push_back(links[j]);
+                }
+            }
+        }
 
-        std::vector<std::mutex>(new_max_elements).swap(link_list_locks_);
+        char *data_level0_copy = (char *) malloc(n * size_data_per_element_);
+        if (data_level0_copy == nullptr)
+            throw std::runtime_error("Not enough memory: reorderIndex failed to allocate base layer");
+        std::vector<char *> link_lists_copy(n);
+        std::vector<int> element_levels_copy(n);
+        for (tableint i = 0; i < n; i++) {
+            memcpy(data_level0_copy + i * size_data_per_element_, data_level0_memory_[i], size_data_per_element_);
+            link_lists_copy[i] = linkLists_[i];
+            element_levels_copy[i] = element_levels_[i];
+        }
+        for (tableint i = 0; i < n; i++) {
+            tableint old_id = new_to_old[i];
+            memcpy(data_level0_memory_[i], data_level0_copy + old_id * size_data_per_element_, size_data_per_element_);
+            linkLists_[i] = link_lists_copy[old_id];
+            element_levels_[i] = element_levels_copy[old_id];
+        }
+        free(data_level0_copy);
+
+        for (tableint i = 0; i < n; i++) {
+            for (int level = 0; level <= element_levels_[i]; level++) {
+                linklistsizeint *ll = get_linklist_at_level(i, level);
+                size_t size = getListCount(ll);
+                tableint *links = (tableint *) (ll + 1);
+                for (size_t j = 0; j < size; j++)
+                    links[j] = old_to_new[links[j]];
+            }
+        }
 
-        // Reallocate base layer
-        char * data_level0_memory_new = (char *) realloc(data_level0_memory_, new_max_elements * size_data_per_element_);
-        if (data_level0_memory_new == nullptr)
-            throw std::runtime_error("Not enough memory: resizeIndex failed to allocate base layer");
-        data_level0_memory_ = data_level0_memory_new;
+        label_lookup_.remap([&](tableint id) { return old_to_new[id]; });
+        DenseIdSet<tableint> deleted_elements_new;
+        for (tableint id : deleted_elements.ids())
+            deleted_elements_new.insert(old_to_new[id]);
+        deleted_elements = std::move(deleted_elements_new);
+        enterpoint_node_ = old_to_new[enterpoint_node_];
+    }
 
-        // Reallocate all other layers
-        char ** linkLists_new = (char **) realloc(linkLists_, sizeof(void *) * new_max_elements);
-        if (linkLists_new == nullptr)
-            throw std::runtime_error("Not enough memory: resizeIndex failed to allocate other layers");
-        linkLists_ = linkLists_new;
 
-        max_elements_ = new_max_elements;
+    // Default for_each of repairDeletedLinks and compactIndex
+    static void serialForEach(size_t begin, size_t end, const std::function<void(size_t)> &fn) {
+        for (size_t id = begin; id < end; id++)
+            fn(id);
+    }
+
+
+    /*
+    * Rebuilds the link lists of element internal_id that point at deleted elements.
+    * Candidates are its live neighbors plus the live neighbors of its deleted ones,
+    * pruned with getNeighborsByHeuristic2 as on insertion.
+    */
+    void repairLinksOfElement(tableint internal_id) {
+        const char *data_point = getDataByInternalId(internal_id);
+        for (int level = 0; level <= element_levels_[internal_id]; level++) {
+            std::unique_lock <std::mutex> lock(link_list_locks_[internal_id]);
+            linklistsizeint *ll = get_linklist_at_level(internal_id, level);
+            size_t size = getListCount(ll);
+            tableint *links = (tableint *) (ll + 1);
+            bool has_deleted = false;
+            for (size_t j = 0; j < size && !has_deleted; j++)
+                has_deleted = isMarkedDeleted(links[j]);
+            if (!has_deleted)
+                continue;
+
+            std::unordered_set<tableint> candidates;
+            for (size_t j = 0; j < size; j++) {
+                if (!isMarkedDeleted(links[j])) {
+                    candidates.insert(links[j]);
+                    continue;
+                }
+                linklistsizeint *ll_deleted = get_linklist_at_level(links[j], level);
+                size_t size_deleted = getListCount(ll_deleted);
+                tableint *links_deleted = (tableint *) (ll_deleted + 1);
+                for (size_t k = 0; k < size_deleted; k++) {
+                    if (links_deleted[k] != internal_id && !isMarkedDeleted(links_deleted[k]))
+                        candidates.insert(links_deleted[k]);
+                }
+            }
+
+            std::priority_queue<std::pair<dist_t, tableint>, std::vector<std::pair<dist_t, tableint>>, CompareByFirst> top_candidates;
+            for (tableint candidate : candidates)
+                top_candidates.emplace(
+                    fstdistfunc_(data_point, getDataByInternalId(candidate), dist_func_param_), candidate);
+            size_t Mcurmax = level ? maxM_ : maxM0_;
+            getNeighborsByHeuristic2(top_candidates, Mcurmax);
+            while (top_candidates.size() > Mcurmax)
+                top_candidates.pop();
+
+            // write the ids before the count so unlocked readers only see valid ids
+            size_t new_size = top_candidates.size();
+            for (size_t j = new_size; j > 0; j--) {
+                links[j - 1] = top_candidates.top().second;
+                top_candidates.pop();
+            }
+            setListCount(ll, new_size);
+        }
+    }
+
+
+    /*
+    * First, incremental phase of compactIndex: repairs the links of up to
+    * max_elements live elements so that they no longer route through deleted ones.
+    * Searches may run concurrently; inserts, deletes and other compaction calls
+    * may not. Returns the number of elements still to be examined.
+    * for_each(begin, end, fn) must call fn(id) for every id in [begin, end); the
+    * calls may run in parallel, since each one only rewrites the lists of id.
+    */
+    template<class ForEach>
+    size_t repairDeletedLinks(size_t max_elements, ForEach for_each) {
+        checkWritable();
+        size_t n = cur_element_count;
+        size_t end = std::min(n, compact_cursor_ + max_elements);
+        for_each(compact_cursor_, end, [this](size_t id) {
+            if (!isMarkedDeleted(id))
+                repairLinksOfElement(id);
+        });
+        compact_cursor_ = end;
+        return n - compact_cursor_;
+    }
+
+    size_t repairDeletedLinks(size_t max_elements) {
+        return repairDeletedLinks(max_elements, serialForEach);
+    }
+
+
+    /*
+    * Physically removes deleted elements: finishes repairing links, renumbers the
+    * survivors densely (keeping their relative order), frees the removed vectors and
+    * link lists and shrinks max_elements_ to the number of survivors.
+    * Must not run concurrently with any other operation on the index. Links are
+    * repaired through for_each, as in repairDeletedLinks.
+    */
+    template<class ForEach>
+    void compactIndex(ForEach for_each) {
+        checkWritable();
+        compact_cursor_ = 0;
+        repairDeletedLinks(cur_element_count, for_each);
+        compact_cursor_ = 0;
+
+        size_t n = cur_element_count;
+        std::vector<tableint> old_to_new(n, (tableint) -1);
+        size_t new_count = 0;
+        int new_maxlevel = -1;
+        tableint new_enterpoint = (tableint) -1;
+        for (tableint i = 0; i < n; i++) {
+            if (isMarkedDeleted(i))
+                continue;
+            old_to_new[i] = (tableint) new_count++;
+            if (element_levels_[i] > new_maxlevel) {
+                new_maxlevel = element_levels_[i];
+                new_enterpoint = old_to_new[i];
+            }
+        }
+        if (n > 0 && !isMarkedDeleted(enterpoint_node_)) {
+            new_maxlevel = maxlevel_;
+            new_enterpoint = old_to_new[enterpoint_node_];
+        }
+
+        for (tableint i = 0; i < n; i++) {
+            tableint new_id = old_to_new[i];
+            if (new_id == (tableint) -1) {
+                if (element_levels_[i] > 0)
+                    freeLinkList(i);
+                continue;
+            }
+            // new ids never exceed old ones, so moving forward in place is safe
+            if (new_id != i)
+                memcpy(data_level0_memory_[new_id], data_level0_memory_[i], size_data_per_element_);
+            linkLists_[new_id] = linkLists_[i];
+            element_levels_[new_id] = element_levels_[i];
+        }
+
+        for (tableint i = 0; i < new_count; i++) {
+            for (int level = 0; level <= element_levels_[i]; level++) {
+                linklistsizeint *ll = get_linklist_at_level(i, level);
+                size_t size = getListCount(ll);
+                tableint *links = (tableint *) (ll + 1);
+                size_t kept = 0;
+                for (size_t j = 0; j < size; j++) {
+                    if (old_to_new[links[j]] != (tableint) -1)
+                        links[kept++] = old_to_new[links[j]];
+                }
+                setListCount(ll, kept);
+            }
+        }
+
+        // removed elements map to -1, which drops their labels
+        label_lookup_.remap([&](tableint id) { return old_to_new[id]; });
+        deleted_elements.clear();
+        num_deleted_ = 0;
+        enterpoint_node_ = new_enterpoint;
+        maxlevel_ = new_maxlevel;
+        cur_element_count = new_count;
+
+        resizeStorage(new_count);
+        max_elements_ = new_count;
+    }
+
+
+    void compactIndex() {
+        compactIndex(serialForEach);
     }
 
     size_t indexFileSize() const {
@@ -682,38 +1168,299 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
         return size;
     }
 
+    // Drops the links of a copied link list that point at or past n.
+    void dropLinksFrom(linklistsizeint *list, size_t n) const {
+        tableint *links = (tableint *) (list + 1);
+        size_t size = getListCount(list), kept = 0;
+        for (size_t j = 0; j < size; j++) {
+            if (links[j] < n)
+                links[kept++] = links[j];
+        }
+        setListCount(list, kept);
+    }
+
+    /*
+    * Layout written by saveIndex: a FileHeader, three sections back to back and a
+    * FileDirectory ending the file.
+    *   level0  cur_element_count * size_data_per_element_ bytes, as in memory
+    *   levels  one int32 per element
+    *   links   upper-level link lists back to back in internal id order, element i
+    *           taking levels[i] * size_links_per_element_ bytes
+    * The directory holds the offset, size and CRC32C of each section, so loadIndex
+    * can read and check them in parallel; it comes last because the checksums are
+    * known only once the sections are written. Files in the original hnswlib
+    * layout, which starts with offsetLevel0_ rather than FILE_MAGIC, still load.
+    */
+    static const uint64_t FILE_MAGIC = 0x3258444957534e48ULL;  // "HNSWIDX2"
+    static const uint32_t FILE_VERSION = 2;
+    static const size_t FILE_READ_BLOCK = size_t(8) << 20;
+
+    enum FileSectionId { SECTION_LEVEL0, SECTION_LEVELS, SECTION_LINKS, NUM_FILE_SECTIONS };
+
+    struct FileHeader {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t enterpoint_node;
+        int64_t maxlevel;
+        uint64_t cur_element_count;
+        uint64_t max_elements;
+        uint64_t size_data_per_element;
+        uint64_t offset_level0;
+        uint64_t label_offset;
+        uint64_t offset_data;
+        uint64_t max_m;
+        uint64_t max_m0;
+        uint64_t m;
+        uint64_t ef_construction;
+        double mult;
+        uint32_t reserved;
+        uint32_t crc;  // of the bytes before it
+    };
+
+    struct FileSection {
+        uint64_t offset;
+        uint64_t size;
+        uint32_t crc;
+        uint32_t reserved;
+    };
+
+    struct FileDirectory {
+        FileSection sections[NUM_FILE_SECTIONS];
+        uint64_t magic;
+        uint32_t reserved;
+        uint32_t crc;  // of the bytes before it
+    };
+
+    /*
+    * Writes the index while inserts, updates and deletes continue. Inserts are
+    * held off only for the instant the element count, entry point and top level
+    * are read, so every element below that count is complete; each of them is
+    * then copied under its link-list lock, without the links to elements added
+    * since, so the file holds a valid graph of the elements present when the
+    * save began. The file replaces location atomically (see AtomicFileWriter).
+    */
     void saveIndex(const std::string &location) {
-        std::ofstream output(location, std::ios::binary);
-        std::streampos position;
-
-        writeBinaryPOD(output, offsetLevel0_);
-        writeBinaryPOD(output, max_elements_);
-        writeBinaryPOD(output, cur_element_count);
-        writeBinaryPOD(output, size_data_per_element_);
-        writeBinaryPOD(output, label_offset_);
-        writeBinaryPOD(output, offsetData_);
-        writeBinaryPOD(output, maxlevel_);
-        writeBinaryPOD(output, enterpoint_node_);
-        writeBinaryPOD(output, maxM_);
-
-        writeBinaryPOD(output, maxM0_);
-        writeBinaryPOD(output, M_);
-        writeBinaryPOD(output, mult_);
-        writeBinaryPOD(output, ef_construction_);
-
-        output.write(data_level0_memory_, cur_element_count * size_data_per_element_);
+        if (packed_links_)
+            throw std::runtime_error("Index with packed link lists cannot be saved");
+        size_t n;
+        int maxlevel;
+        tableint enterpoint;
+        {
+            std::unique_lock <std::mutex> turnstile(snapshot_turnstile_);
+            snapshot_pending_.store(true, std::memory_order_relaxed);
+            std::unique_lock <std::shared_mutex> freeze(snapshot_lock_);
+            n = cur_element_count;
+            maxlevel = maxlevel_;
+            enterpoint = enterpoint_node_;
+            snapshot_pending_.store(false, std::memory_order_relaxed);
+        }
 
-        for (size_t i = 0; i < cur_element_count; i++) {
-            unsigned int linkListSize = element_levels_[i] > 0 ? size_links_per_element_ * element_levels_[i] : 0;
-            writeBinaryPOD(output, linkListSize);
-            if (linkListSize)
-                output.write(linkLists_[i], linkListSize);
+        AtomicFileWriter output(location);
+        FileHeader header = {};
+        header.magic = FILE_MAGIC;
+        header.version = FILE_VERSION;
+        header.enterpoint_node = enterpoint;
+        header.maxlevel = maxlevel;
+        header.cur_element_count = n;
+        header.max_elements = max_elements_;
+        header.size_data_per_element = size_data_per_element_;
+        header.offset_level0 = offsetLevel0_;
+        header.label_offset = label_offset_;
+        header.offset_data = offsetData_;
+        header.max_m = maxM_;
+        header.max_m0 = maxM0_;
+        header.m = M_;
+        header.ef_construction = ef_construction_;
+        header.mult = mult_;
+        header.crc = crc32c(&header, offsetof(FileHeader, crc));
+        output.writePOD(header);
+
+        FileDirectory directory = {};
+        directory.magic = FILE_MAGIC;
+        FileSection *sections = directory.sections;
+        sections[SECTION_LEVEL0].offset = sizeof(header);
+        auto put = [&](FileSectionId id, const void *data, size_t size) {
+            output.write(data, size);
+            sections[id].crc = crc32c(data, size, sections[id].crc);
+            sections[id].size += size;
+        };
+
+        std::vector<char> element(size_data_per_element_);
+        for (size_t i = 0; i < n; i++) {
+            {
+                std::unique_lock <std::mutex> lock(link_list_locks_[i]);
+                memcpy(element.data(), data_level0_memory_[i], size_data_per_element_);
+            }
+            dropLinksFrom((linklistsizeint *) (element.data() + offsetLevel0_), n);
+            put(SECTION_LEVEL0, element.data(), size_data_per_element_);
         }
-        output.close();
+
+        sections[SECTION_LEVELS].offset = sections[SECTION_LEVEL0].offset + sections[SECTION_LEVEL0].size;
+        std::vector<int32_t> levels(n);
+        for (size_t i = 0; i < n; i++)
+            levels[i] = element_levels_[i];
+        put(SECTION_LEVELS, levels.data(), n * sizeof(int32_t));
+
+        sections[SECTION_LINKS].offset = sections[SECTION_LEVELS].offset + sections[SECTION_LEVELS].size;
+        std::vector<char> links;
+        for (size_t i = 0; i < n; i++) {
+            size_t linkListSize = size_links_per_element_ * levels[i];
+            if (!linkListSize)
+                continue;
+            links.resize(linkListSize);
+            {
+                std::unique_lock <std::mutex> lock(link_list_locks_[i]);
+                memcpy(links.data(), linkLists_[i], linkListSize);
+            }
+            for (int level = 0; level < levels[i]; level++)
+                dropLinksFrom((linklistsizeint *) (links.data() + level * size_links_per_element_), n);
+            put(SECTION_LINKS, links.data(), linkListSize);
+        }
+
+        directory.crc = crc32c(&directory, offsetof(FileDirectory, crc));
+        output.writePOD(directory);
+        output.commit();
     }
 
 
     void loadIndex(const std::string &location, SpaceInterface<dist_t> *s, size_t max_elements_i = 0) {
+        {
+            FileReader reader(location);
+            uint64_t magic = 0;
+            if (reader.size() >= sizeof(magic))
+                reader.read(&magic, sizeof(magic), 0);
+            if (magic == FILE_MAGIC) {
+                loadIndexSections(reader, s, max_elements_i);
+                return;
+            }
+        }
+        loadIndexLegacy(location, s, max_elements_i);
+    }
+
+
+    /*
+    * Reads a file written by saveIndex. The sections are read in blocks of up to
+    * FILE_READ_BLOCK bytes on the executor threads, straight into level 0 storage
+    * and into one block for all upper link lists, and each block is checksummed
+    * by the thread that read it while it is still in cache.
+    */
+    void loadIndexSections(FileReader &reader, SpaceInterface<dist_t> *s, size_t max_elements_i) {
+        const char *corrupted = "Index seems to be corrupted or unsupported";
+        FileHeader header;
+        FileDirectory directory;
+        if (reader.size() < sizeof(header) + sizeof(directory))
+            throw std::runtime_error(corrupted);
+        reader.read(&header, sizeof(header), 0);
+        reader.read(&directory, sizeof(directory), reader.size() - sizeof(directory));
+        if (header.version != FILE_VERSION || header.crc != crc32c(&header, offsetof(FileHeader, crc)) ||
+            directory.magic != FILE_MAGIC || directory.crc != crc32c(&directory, offsetof(FileDirectory, crc)))
+            throw std::runtime_error(corrupted);
+
+        const FileSection *sections = directory.sections;
+        uint64_t end = sizeof(header);
+        for (int id = 0; id < NUM_FILE_SECTIONS; id++) {
+            if (sections[id].offset != end || sections[id].size > reader.size() - sizeof(directory) - end)
+                throw std::runtime_error(corrupted);
+            end += sections[id].size;
+        }
+        size_t n = header.cur_element_count;
+        if (end + sizeof(directory) != reader.size() || header.size_data_per_element == 0 ||
+            sections[SECTION_LEVEL0].size / header.size_data_per_element != n ||
+            sections[SECTION_LEVEL0].size % header.size_data_per_element != 0 ||
+            sections[SECTION_LEVELS].size != n * sizeof(int32_t) ||
+            (n > 0 && header.enterpoint_node >= n))
+            throw std::runtime_error(corrupted);
+
+        clear();
+        offsetLevel0_ = header.offset_level0;
+        max_elements_ = std::max<size_t>(header.max_elements, n);
+        if (max_elements_i >= n)
+            max_elements_ = max_elements_i;
+        size_data_per_element_ = header.size_data_per_element;
+        label_offset_ = header.label_offset;
+        offsetData_ = header.offset_data;
+        maxlevel_ = header.maxlevel;
+        enterpoint_node_ = header.enterpoint_node;
+        maxM_ = header.max_m;
+        maxM0_ = header.max_m0;
+        M_ = header.m;
+        ef_construction_ = header.ef_construction;
+        mult_ = header.mult;
+
+        data_size_ = s->get_data_size();
+        fstdistfunc_ = s->get_dist_func();
+        dist_func_param_ = s->get_dist_func_param();
+        size_links_per_element_ = maxM_ * sizeof(tableint) + sizeof(linklistsizeint);
+        link_arena_.setListSize(size_links_per_element_);
+        size_links_level0_ = maxM0_ * sizeof(tableint) + sizeof(linklistsizeint);
+
+        initStorage(max_elements_);
+        size_t links_size = sections[SECTION_LINKS].size;
+        char *links = links_size > 0 ? link_arena_.allocateBlock(links_size) : nullptr;
+        std::vector<int32_t> levels(n);
+
+        struct Block {
+            char *data;
+            size_t size;
+            uint64_t offset;
+            FileSectionId section;
+            uint32_t crc;
+        };
+        std::vector<Block> blocks;
+        auto addBlocks = [&](FileSectionId id, char *data, size_t size, uint64_t offset) {
+            for (size_t done = 0; done < size; done += FILE_READ_BLOCK)
+                blocks.push_back({data + done, std::min(size - done, (size_t) FILE_READ_BLOCK), offset + done, id, 0});
+        };
+        for (size_t i = 0; i < n; i += data_level0_memory_.contiguousRun(i, n)) {
+            addBlocks(SECTION_LEVEL0, data_level0_memory_[i], data_level0_memory_.contiguousRun(i, n) * size_data_per_element_,
+                      sections[SECTION_LEVEL0].offset + i * size_data_per_element_);
+        }
+        addBlocks(SECTION_LEVELS, (char *) levels.data(), sections[SECTION_LEVELS].size, sections[SECTION_LEVELS].offset);
+        addBlocks(SECTION_LINKS, links, links_size, sections[SECTION_LINKS].offset);
+
+        Executor &executor = Executor::instance();
+        executor.parallelFor(0, blocks.size(), executor.size() + 1, [&](size_t b, size_t) {
+            reader.read(blocks[b].data, blocks[b].size, blocks[b].offset);
+            blocks[b].crc = crc32c(blocks[b].data, blocks[b].size);
+        });
+        uint32_t crcs[NUM_FILE_SECTIONS] = {};
+        for (const Block &block : blocks)
+            crcs[block.section] = crc32cCombine(crcs[block.section], block.crc, block.size);
+        for (int id = 0; id < NUM_FILE_SECTIONS; id++) {
+            if (crcs[id] != sections[id].crc)
+                throw std::runtime_error("Index file is corrupted: checksum mismatch");
+        }
+
+        size_t links_pos = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (levels[i] < 0 || levels[i] > maxlevel_ ||
+                (size_t) levels[i] * size_links_per_element_ > links_size - links_pos)
+                throw std::runtime_error(corrupted);
+            element_levels_[i] = levels[i];
+            linkLists_[i] = levels[i] > 0 ? links + links_pos : nullptr;
+            links_pos += levels[i] * size_links_per_element_;
+        }
+        if (links_pos != links_size)
+            throw std::runtime_error(corrupted);
+        cur_element_count = n;
+
+        std::vector<std::mutex>(MAX_LABEL_OPERATION_LOCKS).swap(label_op_locks_);
+        visited_list_pool_.reset(new VisitedListPool(1, max_elements_));
+        revSize_ = 1.0 / mult_;
+        ef_ = 10;
+        label_lookup_.reserve(n);
+        for (size_t i = 0; i < n; i++) {
+            label_lookup_.insert(getExternalLabel(i), i);
+            if (isMarkedDeleted(i)) {
+                num_deleted_ += 1;
+                if (allow_replace_deleted_) deleted_elements.insert(i);
+            }
+        }
+    }
+
+
+    // Reads a file in the original hnswlib layout, as saveIndex wrote it before FILE_MAGIC.
+    void loadIndexLegacy(const std::string &location, SpaceInterface<dist_t> *s, size_t max_elements_i) {
         std::ifstream input(location, std::ios::binary);
 
         if (!input.is_open())
@@ -774,37 +1521,32 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
 
         input.seekg(pos, input.beg);
 
-        data_level0_memory_ = (char *) malloc(max_elements * size_data_per_element_);
-        if (data_level0_memory_ == nullptr)
-            throw std::runtime_error("Not enough memory: loadIndex failed to allocate level0");
-        input.read(data_level0_memory_, cur_element_count * size_data_per_element_);
+        initStorage(max_elements);
+        for (size_t i = 0; i < cur_element_count; i += data_level0_memory_.contiguousRun(i, cur_element_count))
+            input.read(data_level0_memory_[i], data_level0_memory_.contiguousRun(i, cur_element_count) * size_data_per_element_);
 
         size_links_per_element_ = maxM_ * sizeof(tableint) + sizeof(linklistsizeint);
+        link_arena_.setListSize(size_links_per_element_);
 
         size_links_level0_ = maxM0_ * sizeof(tableint) + sizeof(linklistsizeint);
-        std::vector<std::mutex>(max_elements).swap(link_list_locks_);
         std::vector<std::mutex>(MAX_LABEL_OPERATION_LOCKS).swap(label_op_locks_);
 
         visited_list_pool_.reset(new VisitedListPool(1, max_elements));
 
-        linkLists_ = (char **) malloc(sizeof(void *) * max_elements);
-        if (linkLists_ == nullptr)
-            throw std::runtime_error("Not enough memory: loadIndex failed to allocate linklists");
-        element_levels_ = std::vector<int>(max_elements);
         revSize_ = 1.0 / mult_;
         ef_ = 10;
         for (size_t i = 0; i < cur_element_count; i++) {
-            label_lookup_[getExternalLabel(i)] = i;
+            label_lookup_.insert(getExternalLabel(i), i);
             unsigned int linkListSize;
             readBinaryPOD(input, linkListSize);
             if (linkListSize == 0) {
                 element_levels_[i] = 0;
                 linkLists_[i] = nullptr;
             } else {
+                if (linkListSize % size_links_per_element_ != 0)
+                    throw std::runtime_error("Index seems to be corrupted or unsupported");
                 element_levels_[i] = linkListSize / size_links_per_element_;
-                linkLists_[i] = (char *) malloc(linkListSize);
-                if (linkLists_[i] == nullptr)
-                    throw std::runtime_error("Not enough memory: loadIndex failed to allocate linklist");
+                linkLists_[i] = link_arena_.allocate(element_levels_[i]);
                 input.read(linkLists_[i], linkListSize);
             }
         }
@@ -822,18 +1564,378 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
     }
 
 
+    /*
+    * Layout written by saveIndexMmap: a header followed by sections that each start
+    * on a MMAP_SECTION_ALIGN boundary, so the file can be mapped and used in place.
+    *   level0  cur_element_count * size_data_per_element_ bytes, as in memory
+    *   labels  one labeltype per element, used to rebuild label_lookup_ without
+    *           touching level 0
+    *   levels  one int per element
+    *   links   upper-level link lists back to back in internal id order, element i
+    *           taking levels[i] * size_links_per_element_ bytes
+    * Version 2 files keep the links packed (see getPackedList) instead: level 0
+    * holds only the vector and label of each element, and the links section one
+    * uint32 word offset per element followed by the packed lists and a zero word.
+    */
+    static const uint64_t MMAP_MAGIC = 0x50414d4d57534e48ULL;  // "HNSWMMAP"
+    static const uint32_t MMAP_VERSION = 1;
+    static const uint32_t MMAP_VERSION_PACKED = 2;
+    static const size_t MMAP_SECTION_ALIGN = 4096;
+
+    struct MmapHeader {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t enterpoint_node;
+        int64_t maxlevel;
+        uint64_t cur_element_count;
+        uint64_t num_deleted;
+        uint64_t size_data_per_element;
+        uint64_t label_offset;
+        uint64_t offset_data;
+        uint64_t max_m;
+        uint64_t max_m0;
+        uint64_t m;
+        uint64_t ef_construction;
+        double mult;
+        uint64_t level0_offset, labels_offset, levels_offset, links_offset, file_size;
+    };
+
+    static size_t alignSection(size_t offset) {
+        return (offset + MMAP_SECTION_ALIGN - 1) / MMAP_SECTION_ALIGN * MMAP_SECTION_ALIGN;
+    }
+
+    bool isReadOnly() const {
+        return mmap_base_ != nullptr;
+    }
+
+    void checkWritable() const {
+        if (mmap_base_)
+            throw std::runtime_error("Index is memory-mapped read-only");
+    }
+
+    /*
+    * pack_links writes the link lists packed, which typically takes a third to
+    * two thirds of their memory, at the cost of decoding each list a search
+    * expands. Packing suits indexes renumbered by reorderIndex best.
+    * Like saveIndex, this runs while inserts, updates and deletes continue, holds
+    * inserts off only while the snapshot is taken and replaces location
+    * atomically, so processes mapping the previous file keep reading it intact.
+    */
+    void saveIndexMmap(const std::string &location, bool pack_links = false) {
+        if (packed_links_)
+            throw std::runtime_error("Index with packed link lists cannot be saved");
+        size_t n;
+        int maxlevel;
+        tableint enterpoint;
+        {
+            std::unique_lock <std::mutex> turnstile(snapshot_turnstile_);
+            snapshot_pending_.store(true, std::memory_order_relaxed);
+            std::unique_lock <std::shared_mutex> freeze(snapshot_lock_);
+            n = cur_element_count;
+            maxlevel = maxlevel_;
+            enterpoint = enterpoint_node_;
+            snapshot_pending_.store(false, std::memory_order_relaxed);
+        }
+
+        // the deleted marks are read once, so the count in the header matches them
+        std::vector<char> deleted(n);
+        size_t num_deleted = 0;
+        for (size_t i = 0; i < n; i++) {
+            deleted[i] = isMarkedDeleted(i);
+            num_deleted += deleted[i];
+        }
+
+        MmapHeader header;
+        memset(&header, 0, sizeof(header));
+        header.magic = MMAP_MAGIC;
+        header.version = pack_links ? MMAP_VERSION_PACKED : MMAP_VERSION;
+        header.enterpoint_node = enterpoint;
+        header.maxlevel = maxlevel;
+        header.cur_element_count = n;
+        header.num_deleted = num_deleted;
+        header.size_data_per_element = size_data_per_element_;
+        header.label_offset = label_offset_;
+        header.offset_data = offsetData_;
+        header.max_m = maxM_;
+        header.max_m0 = maxM0_;
+        header.m = M_;
+        header.ef_construction = ef_construction_;
+        header.mult = mult_;
+
+        // element offsets, then the lists
+        std::vector<uint32_t> packed;
+        size_t element_size = size_data_per_element_;
+        size_t links_size = 0;
+        if (pack_links) {
+            header.size_data_per_element = element_size = data_size_ + sizeof(labeltype);
+            header.label_offset = data_size_;
+            header.offset_data = 0;
+            packed.resize(n);
+            std::vector<tableint> ids;
+            std::vector<char> lists;
+            for (size_t i = 0; i < n; i++) {
+                int levels = element_levels_[i];
+                lists.resize(size_links_level0_ + size_links_per_element_ * levels);
+                {
+                    std::unique_lock <std::mutex> lock(link_list_locks_[i]);
+                    memcpy(lists.data(), get_linklist0(i), size_links_level0_);
+                    if (levels > 0)
+                        memcpy(lists.data() + size_links_level0_, linkLists_[i], size_links_per_element_ * levels);
+                }
+                packed[i] = (uint32_t) (packed.size() - n);
+                for (int level = 0; level <= levels; level++) {
+                    // a packed list takes at most two words more than its links
+                    if (packed.size() - n + 2 + maxM0_ > UINT32_MAX)
+                        throw std::runtime_error("Link lists too large to pack");
+                    linklistsizeint *ll = (linklistsizeint *) (level == 0 ? lists.data() :
+                        lists.data() + size_links_level0_ + (level - 1) * size_links_per_element_);
+                    dropLinksFrom(ll, n);
+                    packList(ll, level == 0 && deleted[i] ? DELETE_MARK : 0, ids, packed);
+                }
+            }
+            packed.push_back(0);
+            links_size = packed.size() * sizeof(uint32_t);
+        } else {
+            for (size_t i = 0; i < n; i++)
+                links_size += size_links_per_element_ * element_levels_[i];
+        }
+        header.level0_offset = alignSection(sizeof(header));
+        header.labels_offset = alignSection(header.level0_offset + n * element_size);
+        header.levels_offset = alignSection(header.labels_offset + n * sizeof(labeltype));
+        header.links_offset = alignSection(header.levels_offset + n * sizeof(int));
+        header.file_size = header.links_offset + links_size;
+
+        AtomicFileWriter output(location);
+        size_t written = 0;
+        auto put = [&output, &written](const void *data, size_t size) {
+            output.write(data, size);
+            written += size;
+        };
+        auto padTo = [&put, &written](size_t offset) {
+            static const char zeros[MMAP_SECTION_ALIGN] = {};
+            put(zeros, offset - written);
+        };
+
+        put(&header, sizeof(header));
+        padTo(header.level0_offset);
+        // labels are taken from the same copy as the element, so the two agree
+        std::vector<labeltype> labels(n);
+        std::vector<char> element(size_data_per_element_);
+        for (size_t i = 0; i < n; i++) {
+            {
+                std::unique_lock <std::mutex> lock(link_list_locks_[i]);
+                memcpy(element.data(), data_level0_memory_[i], size_data_per_element_);
+            }
+            memcpy(&labels[i], element.data() + label_offset_, sizeof(labeltype));
+            if (pack_links) {
+                put(element.data() + offsetData_, data_size_);
+                put(&labels[i], sizeof(labeltype));
+            } else {
+                linklistsizeint *ll = (linklistsizeint *) (element.data() + offsetLevel0_);
+                dropLinksFrom(ll, n);
+                unsigned char *flags = (unsigned char *) ll + 2;
+                *flags = deleted[i] ? *flags | DELETE_MARK : *flags & ~DELETE_MARK;
+                put(element.data(), size_data_per_element_);
+            }
+        }
+        padTo(header.labels_offset);
+        put(labels.data(), n * sizeof(labeltype));
+        padTo(header.levels_offset);
+        for (size_t i = 0; i < n; i++) {
+            int level = element_levels_[i];
+            put(&level, sizeof(level));
+        }
+        padTo(header.links_offset);
+        if (pack_links) {
+            put(packed.data(), links_size);
+        } else {
+            std::vector<char> links;
+            for (size_t i = 0; i < n; i++) {
+                int levels = element_levels_[i];
+                if (levels == 0)
+                    continue;
+                links.resize(size_links_per_element_ * levels);
+                {
+                    std::unique_lock <std::mutex> lock(link_list_locks_[i]);
+                    memcpy(links.data(), linkLists_[i], links.size());
+                }
+                for (int level = 0; level < levels; level++)
+                    dropLinksFrom((linklistsizeint *) (links.data() + level * size_links_per_element_), n);
+                put(links.data(), links.size());
+            }
+        }
+        output.commit();
+    }
+
+
+    // Points the packed lists into the links section of the mapping, checking
+    // that every list lies inside it and fits the decode buffers of searches.
+    void loadPackedLinks(size_t links_offset, size_t n) {
+        size_t words = (mmap_size_ - links_offset) / sizeof(uint32_t);
+        if (links_offset % sizeof(uint32_t) != 0 || words < n + 1)
+            throw std::runtime_error("Index seems to be corrupted or unsupported");
+        packed_offsets_ = (const uint32_t *) (mmap_base_ + links_offset);
+        packed_links_ = packed_offsets_ + n;
+        size_t list_words = words - n - 1;  // without the trailing zero word
+        for (size_t i = 0; i < n; i++) {
+            linkLists_[i] = nullptr;
+            size_t pos = packed_offsets_[i];
+            for (int level = 0; level <= element_levels_[i]; level++) {
+                if (pos + 2 > list_words ||
+                    (packed_links_[pos] & 0xffff) > (level == 0 ? maxM0_ : maxM_) ||
+                    ((packed_links_[pos] >> 16) & 0x3f) > 32)
+                    throw std::runtime_error("Index seems to be corrupted or unsupported");
+                pos += packedListWords(packed_links_ + pos);
+                if (pos > list_words)
+                    throw std::runtime_error("Index seems to be corrupted or unsupported");
+            }
+        }
+    }
+
+
+    /*
+    * Maps a file written by saveIndexMmap read-only and serves level 0 and the upper
+    * link lists straight from the mapping, so loading costs only the label table and
+    * processes mapping the same file share its pages. Any mutation throws.
+    * With node >= 0 the file is instead read into private memory placed on that
+    * NUMA node, for a per-node replica of the index.
+    */
+    void loadIndexMmap(const std::string &location, SpaceInterface<dist_t> *s, int node = -1) {
+#if defined(_WIN32)
+        throw std::runtime_error("Memory-mapped loading is not supported on this platform");
+#else
+        int fd = open(location.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("Cannot open file");
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(MmapHeader)) {
+            close(fd);
+            throw std::runtime_error("Index seems to be corrupted or unsupported");
+        }
+        void *base;
+        if (node < 0) {
+            base = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        } else {
+            base = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (base != MAP_FAILED) {
+                bindMemoryToNode(base, st.st_size, node);
+                size_t done = 0;
+                while (done < (size_t) st.st_size) {
+                    ssize_t got = pread(fd, (char *) base + done, st.st_size - done, done);
+                    if (got < 0 && errno == EINTR)
+                        continue;
+                    if (got <= 0)
+                        break;
+                    done += got;
+                }
+                if (done < (size_t) st.st_size || mprotect(base, st.st_size, PROT_READ) != 0) {
+                    munmap(base, st.st_size);
+                    close(fd);
+                    throw std::runtime_error("Cannot read index file");
+                }
+            }
+        }
+        close(fd);
+        if (base == MAP_FAILED)
+            throw std::runtime_error("Cannot map index file");
+
+        clear();
+        mmap_base_ = (char *) base;
+        mmap_size_ = st.st_size;
+
+        MmapHeader header;
+        memcpy(&header, mmap_base_, sizeof(header));
+        bool packed = header.version == MMAP_VERSION_PACKED;
+        if (header.magic != MMAP_MAGIC || (header.version != MMAP_VERSION && !packed) ||
+            header.file_size != mmap_size_)
+            throw std::runtime_error("Index seems to be corrupted or unsupported");
+
+        data_size_ = s->get_data_size();
+        fstdistfunc_ = s->get_dist_func();
+        dist_func_param_ = s->get_dist_func_param();
+
+        size_t n = header.cur_element_count;
+        maxM_ = header.max_m;
+        maxM0_ = header.max_m0;
+        M_ = header.m;
+        ef_construction_ = header.ef_construction;
+        mult_ = header.mult;
+        revSize_ = 1.0 / mult_;
+        ef_ = 10;
+        maxlevel_ = header.maxlevel;
+        enterpoint_node_ = header.enterpoint_node;
+        size_data_per_element_ = header.size_data_per_element;
+        label_offset_ = header.label_offset;
+        offsetData_ = header.offset_data;
+        offsetLevel0_ = 0;
+        size_links_per_element_ = maxM_ * sizeof(tableint) + sizeof(linklistsizeint);
+        link_arena_.setListSize(size_links_per_element_);
+        size_links_level0_ = maxM0_ * sizeof(tableint) + sizeof(linklistsizeint);
+        size_t element_size = packed ? data_size_ + sizeof(labeltype) : size_links_level0_ + data_size_ + sizeof(labeltype);
+        if (size_data_per_element_ != element_size ||
+            header.links_offset > mmap_size_ ||
+            header.levels_offset + n * sizeof(int) > header.links_offset ||
+            header.labels_offset + n * sizeof(labeltype) > header.levels_offset ||
+            header.level0_offset + n * size_data_per_element_ > header.labels_offset)
+            throw std::runtime_error("Index seems to be corrupted or unsupported");
+
+        data_level0_memory_.setStride(size_data_per_element_);
+        data_level0_memory_.attach(mmap_base_ + header.level0_offset, n);
+        linkLists_.setChunkShift(MIN_STORAGE_CHUNK_SHIFT);
+        linkLists_.grow(n);
+        element_levels_.setChunkShift(MIN_STORAGE_CHUNK_SHIFT);
+        element_levels_.grow(n);
+        max_elements_ = n;
+        cur_element_count = n;
+        num_deleted_ = header.num_deleted;
+
+        const int *levels = (const int *) (mmap_base_ + header.levels_offset);
+        for (size_t i = 0; i < n; i++)
+            element_levels_[i] = levels[i];
+        if (packed) {
+            loadPackedLinks(header.links_offset, n);
+        } else {
+            size_t links_pos = header.links_offset;
+            for (size_t i = 0; i < n; i++) {
+                if (element_levels_[i] > 0) {
+                    linkLists_[i] = mmap_base_ + links_pos;
+                    links_pos += size_links_per_element_ * element_levels_[i];
+                } else {
+                    linkLists_[i] = nullptr;
+                }
+            }
+            if (links_pos != mmap_size_)
+                throw std::runtime_error("Index seems to be corrupted or unsupported");
+        }
+
+        const labeltype *labels = (const labeltype *) (mmap_base_ + header.labels_offset);
+        label_lookup_.reserve(n);
+        for (size_t i = 0; i < n; i++)
+            label_lookup_.insert(labels[i], i);
+
+        std::vector<std::mutex>(MAX_LABEL_OPERATION_LOCKS).swap(label_op_locks_);
+        visited_list_pool_.reset(new VisitedListPool(1, n));
+#endif
+    }
+
+
+    /*
+    * Internal id of a live element; throws if the label is unknown or marked deleted.
+    */
+    tableint getInternalIdByLabel(labeltype label) const {
+        tableint internalId;
+        if (!label_lookup_.find(label, internalId) || isMarkedDeleted(internalId)) {
+            throw std::runtime_error("Label not found");
+        }
+        return internalId;
+    }
+
+
     template<typename data_t>
     std::vector<data_t> getDataByLabel(labeltype label) const {
         // lock all operations with element by label
         std::unique_lock <std::mutex> lock_label(getLabelOpMutex(label));
-        
-        std::unique_lock <std::mutex> lock_table(label_lookup_lock);
-        auto search = label_lookup_.find(label);
-        if (search == label_lookup_.end() || isMarkedDeleted(search->second)) {
-            throw std::runtime_error("Label not found");
-        }
-        tableint internalId = search->second;
-        lock_table.unlock();
+        tableint internalId = getInternalIdByLabel(label);
 
         char* data_ptrv = getDataByInternalId(internalId);
         size_t dim = *((size_t *) dist_func_param_);
@@ -854,13 +1956,10 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
         // lock all operations with element by label
         std::unique_lock <std::mutex> lock_label(getLabelOpMutex(label));
 
-        std::unique_lock <std::mutex> lock_table(label_lookup_lock);
-        auto search = label_lookup_.find(label);
-        if (search == label_lookup_.end()) {
+        tableint internalId;
+        if (!label_lookup_.find(label, internalId)) {
             throw std::runtime_error("Label not found");
         }
-        tableint internalId = search->second;
-        lock_table.unlock();
 
         markDeletedInternal(internalId);
     }
@@ -871,6 +1970,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
     * whereas maxM0_ has to be limited to the lower 16 bits, however, still large enough in almost all cases.
     */
     void markDeletedInternal(tableint internalId) {
+        checkWritable();
         assert(internalId < cur_element_count);
         if (!isMarkedDeleted(internalId)) {
             unsigned char *ll_cur = ((unsigned char *)get_linklist0(internalId))+2;
@@ -896,13 +1996,10 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
         // lock all operations with element by label
         std::unique_lock <std::mutex> lock_label(getLabelOpMutex(label));
 
-        std::unique_lock <std::mutex> lock_table(label_lookup_lock);
-        auto search = label_lookup_.find(label);
-        if (search == label_lookup_.end()) {
+        tableint internalId;
+        if (!label_lookup_.find(label, internalId)) {
             throw std::runtime_error("Label not found");
         }
-        tableint internalId = search->second;
-        lock_table.unlock();
 
         unmarkDeletedInternal(internalId);
     }
@@ -913,6 +2010,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
     * Remove the deleted mark of the node.
     */
     void unmarkDeletedInternal(tableint internalId) {
+        checkWritable();
         assert(internalId < cur_element_count);
         if (isMarkedDeleted(internalId)) {
             unsigned char *ll_cur = ((unsigned char *)get_linklist0(internalId)) + 2;
@@ -932,6 +2030,8 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
     * Checks the first 16 bits of the memory to see if the element is marked deleted.
     */
     bool isMarkedDeleted(tableint internalId) const {
+        if (packed_links_)
+            return (packed_links_[packed_offsets_[internalId]] >> 24) & DELETE_MARK;
         unsigned char *ll_cur = ((unsigned char*)get_linklist0(internalId)) + 2;
         return *ll_cur & DELETE_MARK;
     }
@@ -952,6 +2052,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
     * If replacement of deleted elements is enabled: replaces previously deleted point if any, updating it with new point
     */
     void addPoint(const void *data_point, labeltype label, bool replace_deleted = false) {
+        checkWritable();
         if ((allow_replace_deleted_ == false) && (replace_deleted == true)) {
             throw std::runtime_error("Replacement of deleted elements is disabled in constructor");
         }
@@ -962,14 +2063,30 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
             addPoint(data_point, label, -1);
             return;
         }
+        // an existing label is updated in its own slot, even if that slot was deleted,
+        // so that replacement never leaves two elements with the same label
+        tableint existing_internal_id;
+        if (label_lookup_.find(label, existing_internal_id)) {
+            bool reusable = !isMarkedDeleted(existing_internal_id);
+            if (!reusable) {
+                std::unique_lock <std::mutex> lock_deleted_elements(deleted_elements_lock);
+                // the slot may just have been taken over by another label
+                reusable = deleted_elements.erase(existing_internal_id);
+                lock_deleted_elements.unlock();
+                if (reusable)
+                    unmarkDeletedInternal(existing_internal_id);
+            }
+            if (reusable) {
+                updatePoint(data_point, existing_internal_id, 1.0);
+                return;
+            }
+        }
         // check if there is vacant place
         tableint internal_id_replaced;
         std::unique_lock <std::mutex> lock_deleted_elements(deleted_elements_lock);
         bool is_vacant_place = !deleted_elements.empty();
-        if (is_vacant_place) {
-            internal_id_replaced = *deleted_elements.begin();
-            deleted_elements.erase(internal_id_replaced);
-        }
+        if (is_vacant_place)
+            internal_id_replaced = deleted_elements.pop();
         lock_deleted_elements.unlock();
 
         // if there is no vacant place then add or update point
@@ -979,12 +2096,13 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
         } else {
             // we assume that there are no concurrent operations on deleted element
             labeltype label_replaced = getExternalLabel(internal_id_replaced);
-            setExternalLabel(internal_id_replaced, label);
+            {
+                std::unique_lock <std::mutex> lock_el(link_list_locks_[internal_id_replaced]);
+                setExternalLabel(internal_id_replaced, label);
+            }
 
-            std::unique_lock <std::mutex> lock_table(label_lookup_lock);
             label_lookup_.erase(label_replaced);
-            label_lookup_[label] = internal_id_replaced;
-            lock_table.unlock();
+            label_lookup_.insert(label, internal_id_replaced);
 
             unmarkDeletedInternal(internal_id_replaced);
             updatePoint(data_point, internal_id_replaced, 1.0);
@@ -993,8 +2111,12 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
 
 
     void updatePoint(const void *dataPoint, tableint internalId, float updateNeighborProbability) {
-        // update the feature vector associated with existing point with new vector
-        memcpy(getDataByInternalId(internalId), dataPoint, data_size_);
+        // update the feature vector associated with existing point with new vector,
+        // under the link-list lock that saveIndex copies the element under
+        {
+            std::unique_lock <std::mutex> lock_el(link_list_locks_[internalId]);
+            memcpy(getDataByInternalId(internalId), dataPoint, data_size_);
+        }
 
         int maxLevelCopy = maxlevel_;
         tableint entryPointCopy = enterpoint_node_;
@@ -1090,11 +2212,13 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
                     int size = getListCount(data);
                     tableint *datal = (tableint *) (data + 1);
 #ifdef USE_SSE
-                    _mm_prefetch(getDataByInternalId(*datal), _MM_HINT_T0);
+                    if (size > 0)
+                        _mm_prefetch(getDataByInternalId(*datal), _MM_HINT_T0);
 #endif
                     for (int i = 0; i < size; i++) {
 #ifdef USE_SSE
-                        _mm_prefetch(getDataByInternalId(*(datal + i + 1)), _MM_HINT_T0);
+                        if (i + 1 < size)
+                            _mm_prefetch(getDataByInternalId(*(datal + i + 1)), _MM_HINT_T0);
 #endif
                         tableint cand = datal[i];
                         dist_t d = fstdistfunc_(dataPoint, getDataByInternalId(cand), dist_func_param_);
@@ -1140,31 +2264,37 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
 
 
     std::vector<tableint> getConnectionsWithLock(tableint internalId, int level) {
-        std::unique_lock <std::mutex> lock(link_list_locks_[internalId]);
-        unsigned int *data = get_linklist_at_level(internalId, level);
-        int size = getListCount(data);
-        std::vector<tableint> result(size);
-        tableint *ll = (tableint *) (data + 1);
-        memcpy(result.data(), ll, size * sizeof(tableint));
+        // a mapped index has no link-list locks, and nothing that modifies lists
+        std::unique_lock <std::mutex> lock;
+        if (!isReadOnly())
+            lock = std::unique_lock <std::mutex>(link_list_locks_[internalId]);
+        std::vector<tableint> result(maxM0_ + 1);
+        size_t size;
+        const tableint *ll = getNeighbors(internalId, level, size, result.data());
+        if (ll != result.data())
+            memcpy(result.data(), ll, size * sizeof(tableint));
+        result.resize(size);
         return result;
     }
 
 
     tableint addPoint(const void *data_point, labeltype label, int level) {
+        checkWritable();
+        if (snapshot_pending_.load(std::memory_order_relaxed))
+            std::lock_guard <std::mutex> wait_for_snapshot(snapshot_turnstile_);
+        std::shared_lock <std::shared_mutex> snapshot_gate(snapshot_lock_);
         tableint cur_c = 0;
         {
             // Checking if the element with the same label already exists
             // if so, updating it *instead* of creating a new element.
-            std::unique_lock <std::mutex> lock_table(label_lookup_lock);
-            auto search = label_lookup_.find(label);
-            if (search != label_lookup_.end()) {
-                tableint existingInternalId = search->second;
+            // callers hold the label's operation lock, so it cannot be added twice
+            tableint existingInternalId;
+            if (label_lookup_.find(label, existingInternalId)) {
                 if (allow_replace_deleted_) {
                     if (isMarkedDeleted(existingInternalId)) {
                         throw std::runtime_error("Can't use addPoint to update deleted elements if replacement of deleted elements is enabled.");
                     }
                 }
-                lock_table.unlock();
 
                 if (isMarkedDeleted(existingInternalId)) {
                     unmarkDeletedInternal(existingInternalId);
@@ -1174,13 +2304,22 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
                 return existingInternalId;
             }
 
+            std::unique_lock <std::mutex> lock_count(element_count_lock_);
             if (cur_element_count >= max_elements_) {
-                throw std::runtime_error("The number of elements exceeds the specified limit");
+                if (!auto_grow_)
+                    throw std::runtime_error("The number of elements exceeds the specified limit");
+                // grow to the end of the next storage chunk; nothing is copied
+                size_t chunk = data_level0_memory_.chunkElements();
+                size_t new_max_elements = (cur_element_count / chunk + 1) * chunk;
+                resizeStorage(new_max_elements);
+                visited_list_pool_->resize(new_max_elements);
+                max_elements_ = new_max_elements;
             }
 
             cur_c = cur_element_count;
             cur_element_count++;
-            label_lookup_[label] = cur_c;
+            lock_count.unlock();
+            label_lookup_.insert(label, cur_c);
         }
 
         std::unique_lock <std::mutex> lock_el(link_list_locks_[cur_c]);
@@ -1197,18 +2336,14 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
         tableint currObj = enterpoint_node_;
         tableint enterpoint_copy = enterpoint_node_;
 
-        memset(data_level0_memory_ + cur_c * size_data_per_element_ + offsetLevel0_, 0, size_data_per_element_);
+        memset(data_level0_memory_[cur_c] + offsetLevel0_, 0, size_data_per_element_);
 
         // Initialisation of the data and label
         memcpy(getExternalLabeLp(cur_c), &label, sizeof(labeltype));
         memcpy(getDataByInternalId(cur_c), data_point, data_size_);
 
-        if (curlevel) {
-            linkLists_[cur_c] = (char *) malloc(size_links_per_element_ * curlevel + 1);
-            if (linkLists_[cur_c] == nullptr)
-                throw std::runtime_error("Not enough memory: addPoint failed to allocate linklist");
-            memset(linkLists_[cur_c], 0, size_links_per_element_ * curlevel + 1);
-        }
+        if (curlevel)
+            linkLists_[cur_c] = link_arena_.allocate(curlevel);
 
         if ((signed)currObj != -1) {
             if (curlevel < maxlevelcopy) {
@@ -1269,25 +2404,50 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
 
     std::priority_queue<std::pair<dist_t, labeltype >>
     searchKnn(const void *query_data, size_t k, BaseFilterFunctor* isIdAllowed = nullptr) const {
+        return searchKnn(query_data, k, isIdAllowed, 0);
+    }
+
+
+    /*
+    * searchKnn with the size of the dynamic candidate list given per call (ef = 0
+    * uses ef_), so concurrent searches can trade recall for latency differently
+    * without writing the shared ef_.
+    */
+    std::priority_queue<std::pair<dist_t, labeltype >>
+    searchKnn(const void *query_data, size_t k, BaseFilterFunctor* isIdAllowed, size_t ef) const {
         std::priority_queue<std::pair<dist_t, labeltype >> result;
-        if (cur_element_count == 0) return result;
+        auto top_candidates = searchKnnInternal(query_data, k, isIdAllowed, ef);
+        while (top_candidates.size() > 0) {
+            std::pair<dist_t, tableint> rez = top_candidates.top();
+            result.push(std::pair<dist_t, labeltype>(rez.first, getExternalLabel(rez.second)));
+            top_candidates.pop();
+        }
+        return result;
+    }
+
 
+    /*
+    * Greedy descent through the upper layers; returns the level 0 entry point for query_data.
+    */
+    tableint searchUpperLayers(const void *query_data) const {
+        SearchStats &stats = threadSearchStats();
         tableint currObj = enterpoint_node_;
         dist_t curdist = fstdistfunc_(query_data, getDataByInternalId(enterpoint_node_), dist_func_param_);
+        stats.distance_computations++;
+        static thread_local std::vector<tableint> unpacked;
+        if (unpacked.size() < maxM0_ + 1)
+            unpacked.resize(maxM0_ + 1);
 
         for (int level = maxlevel_; level > 0; level--) {
             bool changed = true;
             while (changed) {
                 changed = false;
-                unsigned int *data;
-
-                data = (unsigned int *) get_linklist(currObj, level);
-                int size = getListCount(data);
-                metric_hops++;
-                metric_distance_computations+=size;
+                size_t size;
+                const tableint *datal = getNeighbors(currObj, level, size, unpacked.data());
+                stats.hops++;
+                stats.distance_computations += size;
 
-                tableint *datal = (tableint *) (data + 1);
-                for (int i = 0; i < size; i++) {
+                for (size_t i = 0; i < size; i++) {
                     tableint cand = datal[i];
                     if (cand < 0 || cand > max_elements_)
                         throw std::runtime_error("cand error");
@@ -1301,26 +2461,76 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
                 }
             }
         }
+        return currObj;
+    }
+
+
+    /*
+    * Same as searchKnn, but writes the results closest first into caller buffers
+    * (distances and, when non-null, labels and internal ids) and keeps its working
+    * queues in per-thread storage that is reused across calls, so a warm search
+    * does not allocate. Returns the number of results written. ef = 0 uses ef_.
+    */
+    size_t searchKnnInto(const void *query_data, size_t k, dist_t *distances, labeltype *labels,
+                         BaseFilterFunctor* isIdAllowed = nullptr, tableint *ids = nullptr, size_t ef = 0) const {
+        if (cur_element_count == 0 || k == 0) return 0;
+        if (ef == 0) ef = ef_;
 
+        static thread_local ReusableQueue top_candidates;
+        static thread_local ReusableQueue candidate_set;
+        top_candidates.clear();
+        candidate_set.clear();
+
+        tableint currObj = searchUpperLayers(query_data);
+        bool bare_bone_search = !num_deleted_ && !isIdAllowed;
+        if (bare_bone_search) {
+            searchBaseLayerSTInto<true>(
+                    currObj, query_data, std::max(ef, k), top_candidates, candidate_set, isIdAllowed);
+        } else {
+            searchBaseLayerSTInto<false>(
+                    currObj, query_data, std::max(ef, k), top_candidates, candidate_set, isIdAllowed);
+        }
+
+        while (top_candidates.size() > k) {
+            top_candidates.pop();
+        }
+        size_t n = top_candidates.size();
+        for (size_t i = n; i > 0; i--) {
+            const std::pair<dist_t, tableint> &rez = top_candidates.top();
+            distances[i - 1] = rez.first;
+            if (labels) labels[i - 1] = getExternalLabel(rez.second);
+            if (ids) ids[i - 1] = rez.second;
+            top_candidates.pop();
+        }
+        return n;
+    }
+
+
+    /*
+    * Same as searchKnn, but keeps internal ids (furthest on top) so callers can
+    * look at the stored data of the results, e.g. to rerank them.
+    */
+    std::priority_queue<std::pair<dist_t, tableint>, std::vector<std::pair<dist_t, tableint>>, CompareByFirst>
+    searchKnnInternal(const void *query_data, size_t k, BaseFilterFunctor* isIdAllowed = nullptr, size_t ef = 0) const {
         std::priority_queue<std::pair<dist_t, tableint>, std::vector<std::pair<dist_t, tableint>>, CompareByFirst> top_candidates;
+        if (cur_element_count == 0) return top_candidates;
+        if (ef == 0) ef = ef_;
+
+        tableint currObj = searchUpperLayers(query_data);
+
         bool bare_bone_search = !num_deleted_ && !isIdAllowed;
         if (bare_bone_search) {
             top_candidates = searchBaseLayerST<true>(
-                    currObj, query_data, std::max(ef_, k), isIdAllowed);
+                    currObj, query_data, std::max(ef, k), isIdAllowed);
         } else {
             top_candidates = searchBaseLayerST<false>(
-                    currObj, query_data, std::max(ef_, k), isIdAllowed);
+                    currObj, query_data, std::max(ef, k), isIdAllowed);
         }
 
         while (top_candidates.size() > k) {
             top_candidates.pop();
         }
-        while (top_candidates.size() > 0) {
-            std::pair<dist_t, tableint> rez = top_candidates.top();
-            result.push(std::pair<dist_t, labeltype>(rez.first, getExternalLabel(rez.second)));
-            top_candidates.pop();
-        }
-        return result;
+        return top_candidates;
     }
 
 
@@ -1332,35 +2542,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
         std::vector<std::pair<dist_t, labeltype >> result;
         if (cur_element_count == 0) return result;
 
-        tableint currObj = enterpoint_node_;
-        dist_t curdist = fstdistfunc_(query_data, getDataByInternalId(enterpoint_node_), dist_func_param_);
-
-        for (int level = maxlevel_; level > 0; level--) {
-            bool changed = true;
-            while (changed) {
-                changed = false;
-                unsigned int *data;
-
-                data = (unsigned int *) get_linklist(currObj, level);
-                int size = getListCount(data);
-                metric_hops++;
-                metric_distance_computations+=size;
-
-                tableint *datal = (tableint *) (data + 1);
-                for (int i = 0; i < size; i++) {
-                    tableint cand = datal[i];
-                    if (cand < 0 || cand > max_elements_)
-                        throw std::runtime_error("cand error");
-                    dist_t d = fstdistfunc_(query_data, getDataByInternalId(cand), dist_func_param_);
-
-                    if (d < curdist) {
-                        curdist = d;
-                        currObj = cand;
-                        changed = true;
-                    }
-                }
-            }
-        }
+        tableint currObj = searchUpperLayers(query_data);
 
         std::priority_queue<std::pair<dist_t, tableint>, std::vector<std::pair<dist_t, tableint>>, CompareByFirst> top_candidates;
         top_candidates = searchBaseLayerST<false>(currObj, query_data, 0, isIdAllowed, &stop_condition);
@@ -1368,7 +2550,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
         size_t sz = top_candidates.size();
         result.resize(sz);
         while (!top_candidates.empty()) {
-            result[--sz] = top_candidates.top();
+            result[--sz] = std::make_pair(top_candidates.top().first, getExternalLabel(top_candidates.top().second));
             top_candidates.pop();
         }
 
@@ -1381,13 +2563,13 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
     void checkIntegrity() {
         int connections_checked = 0;
         std::vector <int > inbound_connections_num(cur_element_count, 0);
+        std::vector<tableint> unpacked(maxM0_ + 1);
         for (int i = 0; i < cur_element_count; i++) {
             for (int l = 0; l <= element_levels_[i]; l++) {
-                linklistsizeint *ll_cur = get_linklist_at_level(i, l);
-                int size = getListCount(ll_cur);
-                tableint *data = (tableint *) (ll_cur + 1);
+                size_t size;
+                const tableint *data = getNeighbors(i, l, size, unpacked.data());
                 std::unordered_set<tableint> s;
-                for (int j = 0; j < size; j++) {
+                for (size_t j = 0; j < size; j++) {
                     assert(data[j] < cur_element_count);
                     assert(data[j] != i);
                     inbound_connections_num[data[j]]++;
@@ -8,9 +8,24 @@
   #define HNSWERR HNSWLIB_ERR_OVERRIDE
 #endif
 
+// Build flag used by the Go bindings; kept as an alias so either spelling disables SIMD.
+#if defined(HNSWLIB_NO_MANUAL_VECTORIZATION) && !defined(NO_MANUAL_VECTORIZATION)
+#define NO_MANUAL_VECTORIZATION
+#endif
+
 #ifndef NO_MANUAL_VECTORIZATION
 #if (defined(__SSE__) || _M_IX86_FP > 0 || defined(_M_AMD64) || defined(_M_X64))
 #define USE_SSE
+#if defined(__GNUC__) || defined(__clang__)
+// AVX2/AVX-512 kernels are compiled with function-level target attributes and
+// selected at runtime (see AVX2FMACapable/AVX512Capable), so the binary does not
+// depend on the -m flags of the machine that built it.
+#define USE_AVX
+#define USE_AVX512
+#define HNSWLIB_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define HNSWLIB_TARGET_AVX2_F16C __attribute__((target("avx2,fma,f16c")))
+#define HNSWLIB_TARGET_AVX512 __attribute__((target("avx512f")))
+#else
 #ifdef __AVX__
 #define USE_AVX
 #ifdef __AVX512F__
@@ -18,6 +33,20 @@
 #endif
 #endif
 #endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+// NEON is part of the aarch64 baseline, no runtime check is needed.
+#define USE_NEON
+#endif
+#endif
+
+#ifndef HNSWLIB_TARGET_AVX2
+#define HNSWLIB_TARGET_AVX2
+#endif
+#ifndef HNSWLIB_TARGET_AVX2_F16C
+#define HNSWLIB_TARGET_AVX2_F16C
+#endif
+#ifndef HNSWLIB_TARGET_AVX512
+#define HNSWLIB_TARGET_AVX512
 #endif
 
 #if defined(USE_AVX) || defined(USE_SSE)
@@ -44,17 +73,7 @@ static uint64_t xgetbv(unsigned int index) {
 }
 #endif
 
-#if defined(USE_AVX512)
 #include <immintrin.h>
-#endif
-
-#if defined(__GNUC__)
-#define PORTABLE_ALIGN32 __attribute__((aligned(32)))
-#define PORTABLE_ALIGN64 __attribute__((aligned(64)))
-#else
-#define PORTABLE_ALIGN32 __declspec(align(32))
-#define PORTABLE_ALIGN64 __declspec(align(64))
-#endif
 
 // Adapted from https://github.com/Mysticial/FeatureDetector
 #define _XCR_XFEATURE_ENABLED_MASK  0
@@ -114,8 +133,104 @@ static bool AVX512Capable() {
     }
     return HW_AVX512F && avx512Supported;
 }
+
+static bool AVX2FMACapable() {
+    if (!AVXCapable()) return false;
+
+    int cpuInfo[4];
+
+    cpuid(cpuInfo, 0, 0);
+    int nIds = cpuInfo[0];
+
+    bool HW_AVX2 = false;
+    if (nIds >= 0x00000007) {
+        cpuid(cpuInfo, 0x00000007, 0);
+        HW_AVX2 = (cpuInfo[1] & ((int)1 << 5)) != 0;
+    }
+
+    cpuid(cpuInfo, 1, 0);
+    bool HW_FMA = (cpuInfo[2] & ((int)1 << 12)) != 0;
+
+    return HW_AVX2 && HW_FMA;
+}
+
+static bool F16CCapable() {
+    if (!AVXCapable()) return false;
+
+    int cpuInfo[4];
+    cpuid(cpuInfo, 1, 0);
+    return (cpuInfo[2] & ((int)1 << 29)) != 0;
+}
+#endif
+
+#if defined(USE_NEON)
+#include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__)
+#define PORTABLE_ALIGN32 __attribute__((aligned(32)))
+#define PORTABLE_ALIGN64 __attribute__((aligned(64)))
+#else
+#define PORTABLE_ALIGN32 __declspec(align(32))
+#define PORTABLE_ALIGN64 __declspec(align(64))
 #endif
 
+// Read prefetch into all cache levels; a no-op where no intrinsic is available.
+#if defined(USE_SSE)
+#define HNSWLIB_PREFETCH(ptr) _mm_prefetch((const char *) (ptr), _MM_HINT_T0)
+#elif defined(__GNUC__)
+#define HNSWLIB_PREFETCH(ptr) __builtin_prefetch((ptr), 0, 3)
+#else
+#define HNSWLIB_PREFETCH(ptr) ((void) 0)
+#endif
+
+namespace hnswlib {
+// Instruction set of the distance kernels picked by the spaces on this CPU.
+enum SimdLevel {
+    SIMD_NONE = 0,
+    SIMD_SSE = 1,
+    SIMD_AVX2 = 2,
+    SIMD_AVX512 = 3,
+    SIMD_NEON = 4,
+};
+
+static int detectSimdLevel() {
+#if defined(USE_AVX512)
+    if (AVX512Capable()) return SIMD_AVX512;
+#endif
+#if defined(USE_AVX)
+    if (AVX2FMACapable()) return SIMD_AVX2;
+#endif
+#if defined(USE_SSE)
+    return SIMD_SSE;
+#elif defined(USE_NEON)
+    return SIMD_NEON;
+#else
+    return SIMD_NONE;
+#endif
+}
+
+static int getSimdLevel() {
+    static const int level = detectSimdLevel();
+    return level;
+}
+
+#if defined(USE_AVX512)
+// Sum of the 16 lanes. Spelled out rather than _mm512_reduce_add_ps, whose
+// expansion in GCC 12 warns about uninitialized values under target attributes.
+HNSWLIB_TARGET_AVX512
+static inline float reduceAddAVX512(__m512 v) {
+    __m512d wide = _mm512_castps_pd(v);
+    __m256 half = _mm256_add_ps(_mm256_castpd_ps(_mm512_mask_extractf64x4_pd(_mm256_setzero_pd(), 0xff, wide, 0)),
+                                _mm256_castpd_ps(_mm512_mask_extractf64x4_pd(_mm256_setzero_pd(), 0xff, wide, 1)));
+    __m128 quarter = _mm_add_ps(_mm256_castps256_ps128(half), _mm256_extractf128_ps(half, 1));
+    quarter = _mm_add_ps(quarter, _mm_movehl_ps(quarter, quarter));
+    quarter = _mm_add_ss(quarter, _mm_movehdup_ps(quarter));
+    return _mm_cvtss_f32(quarter);
+}
+#endif
+}  // namespace hnswlib
+
 #include <queue>
 #include <vector>
 #include <iostream>
@@ -170,6 +285,11 @@ static void readBinaryPOD(std::istream &in, T &podRef) {
 template<typename MTYPE>
 using DISTFUNC = MTYPE(*)(const void *, const void *, const void *);
 
+// Distances from one vector x to four queries at once (out[j] for queries[j]), so
+// each load of x is shared by four accumulators; the inner kernel of the blocked
+// brute-force scan.
+typedef void (*BLOCK4FUNC)(const float *x, const float *const *queries, size_t dim, float *out);
+
 template<typename MTYPE>
 class SpaceInterface {
  public:
@@ -223,6 +343,10 @@ AlgorithmInterface<dist_t>::searchKnnCloserFirst(const void* query_data, size_t
 
 #include "space_l2.h"
 #include "space_ip.h"
+#include "space_sq.h"
 #include "stop_condition.h"
+#include "file_writer.h"
+#include "file_reader.h"
+#include "crc32c.h"
 #include "bruteforce.h"
 #include "hnswalg.h"
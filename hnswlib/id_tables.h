@@ -0,0 +1,251 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace hnswlib {
+///////////////////////////////////////////////////////////
+//
+// Label and id bookkeeping without per-entry allocations
+//
+// StripedHashMap maps keys to values in open-addressing tables with linear
+// probing. Keys are spread over STRIPES independent tables, each behind its
+// own lock, so threads touching different keys rarely wait on each other, and
+// a table that grows rehashes only its own stripe. Erasing shifts the entries
+// behind it back, so no tombstones build up. The all-ones value marks an empty
+// slot and cannot be stored.
+//
+// DenseIdSet holds a set of ids in a vector, plus the position of each id, so
+// inserting, erasing and taking an arbitrary member are all O(1).
+//
+/////////////////////////////////////////////////////////
+
+// splitmix64 finalizer: spreads sequential or strided keys over all bits
+inline uint64_t mixHash(uint64_t key) {
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebULL;
+    key ^= key >> 31;
+    return key;
+}
+
+template<typename key_t, typename value_t>
+class StripedHashMap {
+ public:
+    static constexpr size_t STRIPES = 64;
+    static constexpr value_t EMPTY = ~value_t(0);
+
+ private:
+    static constexpr int STRIPE_SHIFT = 58;  // top six hash bits pick the stripe
+    static constexpr size_t MIN_CAPACITY = 16;
+
+    // packed, so a 64-bit key and 32-bit value take 12 bytes instead of 16
+#pragma pack(push, 4)
+    struct Slot {
+        key_t key;
+        value_t value;
+    };
+#pragma pack(pop)
+
+    struct alignas(64) Stripe {
+        mutable std::mutex mutex;
+        std::vector<Slot> slots;  // empty or a power of two long
+        size_t size{0};
+    };
+
+    Stripe stripes_[STRIPES];
+
+    // Slot holding key, or the empty slot ending its probe sequence.
+    static size_t probe(const Stripe &stripe, key_t key, uint64_t hash) {
+        size_t mask = stripe.slots.size() - 1;
+        size_t pos = hash & mask;
+        while (stripe.slots[pos].value != EMPTY && stripe.slots[pos].key != key)
+            pos = (pos + 1) & mask;
+        return pos;
+    }
+
+    static void rehash(Stripe &stripe, size_t capacity) {
+        std::vector<Slot> old(capacity, Slot{key_t(), EMPTY});
+        old.swap(stripe.slots);
+        for (const Slot &slot : old) {
+            if (slot.value != EMPTY)
+                stripe.slots[probe(stripe, slot.key, mixHash(slot.key))] = slot;
+        }
+    }
+
+    static void put(Stripe &stripe, key_t key, value_t value, uint64_t hash) {
+        // keep the load factor at or below 0.7
+        if ((stripe.size + 1) * 10 > stripe.slots.size() * 7)
+            rehash(stripe, std::max(MIN_CAPACITY, 2 * stripe.slots.size()));
+        size_t pos = probe(stripe, key, hash);
+        if (stripe.slots[pos].value == EMPTY)
+            stripe.size++;
+        stripe.slots[pos] = Slot{key, value};
+    }
+
+    static void remove(Stripe &stripe, size_t pos) {
+        size_t mask = stripe.slots.size() - 1;
+        stripe.slots[pos].value = EMPTY;
+        stripe.size--;
+        // move back later entries of the probe run that could no longer be found
+        for (size_t next = (pos + 1) & mask; stripe.slots[next].value != EMPTY; next = (next + 1) & mask) {
+            size_t home = mixHash(stripe.slots[next].key) & mask;
+            bool stays = pos <= next ? (pos < home && home <= next) : (pos < home || home <= next);
+            if (stays)
+                continue;
+            stripe.slots[pos] = stripe.slots[next];
+            stripe.slots[next].value = EMPTY;
+            pos = next;
+        }
+    }
+
+ public:
+    bool find(key_t key, value_t &value) const {
+        uint64_t hash = mixHash(key);
+        const Stripe &stripe = stripes_[hash >> STRIPE_SHIFT];
+        std::lock_guard<std::mutex> lock(stripe.mutex);
+        if (stripe.size == 0)
+            return false;
+        const Slot &slot = stripe.slots[probe(stripe, key, hash)];
+        if (slot.value == EMPTY)
+            return false;
+        value = slot.value;
+        return true;
+    }
+
+    // Inserts key or replaces its value.
+    void insert(key_t key, value_t value) {
+        uint64_t hash = mixHash(key);
+        Stripe &stripe = stripes_[hash >> STRIPE_SHIFT];
+        std::lock_guard<std::mutex> lock(stripe.mutex);
+        put(stripe, key, value, hash);
+    }
+
+    bool erase(key_t key) {
+        uint64_t hash = mixHash(key);
+        Stripe &stripe = stripes_[hash >> STRIPE_SHIFT];
+        std::lock_guard<std::mutex> lock(stripe.mutex);
+        if (stripe.size == 0)
+            return false;
+        size_t pos = probe(stripe, key, hash);
+        if (stripe.slots[pos].value == EMPTY)
+            return false;
+        remove(stripe, pos);
+        return true;
+    }
+
+    size_t size() const {
+        size_t total = 0;
+        for (const Stripe &stripe : stripes_) {
+            std::lock_guard<std::mutex> lock(stripe.mutex);
+            total += stripe.size;
+        }
+        return total;
+    }
+
+    // Sizes the tables for n keys spread evenly over the stripes.
+    void reserve(size_t n) {
+        size_t per_stripe = n / STRIPES + 1;
+        size_t capacity = MIN_CAPACITY;
+        while (capacity * 7 < per_stripe * 10)
+            capacity *= 2;
+        for (Stripe &stripe : stripes_) {
+            std::lock_guard<std::mutex> lock(stripe.mutex);
+            if (capacity > stripe.slots.size())
+                rehash(stripe, capacity);
+        }
+    }
+
+    void clear() {
+        for (Stripe &stripe : stripes_) {
+            std::lock_guard<std::mutex> lock(stripe.mutex);
+            std::vector<Slot>().swap(stripe.slots);
+            stripe.size = 0;
+        }
+    }
+
+    // Replaces the value of every entry with fn(value), dropping the entries it
+    // maps to EMPTY. Not for use concurrently with other calls.
+    template<typename Function>
+    void remap(Function fn) {
+        for (Stripe &stripe : stripes_) {
+            std::lock_guard<std::mutex> lock(stripe.mutex);
+            std::vector<Slot> old;
+            old.swap(stripe.slots);
+            stripe.slots.assign(old.size(), Slot{key_t(), EMPTY});
+            stripe.size = 0;
+            for (const Slot &slot : old) {
+                if (slot.value == EMPTY)
+                    continue;
+                value_t value = fn(slot.value);
+                if (value != EMPTY)
+                    put(stripe, slot.key, value, mixHash(slot.key));
+            }
+        }
+    }
+};
+
+
+template<typename id_t>
+class DenseIdSet {
+    static constexpr uint32_t ABSENT = ~uint32_t(0);
+
+    std::vector<id_t> ids_;
+    std::vector<uint32_t> positions_;  // index of each id in ids_, or ABSENT
+
+ public:
+    bool empty() const {
+        return ids_.empty();
+    }
+
+    size_t size() const {
+        return ids_.size();
+    }
+
+    const std::vector<id_t> &ids() const {
+        return ids_;
+    }
+
+    bool contains(id_t id) const {
+        return id < positions_.size() && positions_[id] != ABSENT;
+    }
+
+    bool insert(id_t id) {
+        if (contains(id))
+            return false;
+        if (id >= positions_.size())
+            positions_.resize(std::max<size_t>((size_t) id + 1, 2 * positions_.size()), ABSENT);
+        positions_[id] = ids_.size();
+        ids_.push_back(id);
+        return true;
+    }
+
+    bool erase(id_t id) {
+        if (!contains(id))
+            return false;
+        uint32_t pos = positions_[id];
+        ids_[pos] = ids_.back();
+        positions_[ids_[pos]] = pos;
+        ids_.pop_back();
+        positions_[id] = ABSENT;
+        return true;
+    }
+
+    // Removes and returns some member; the set must not be empty.
+    id_t pop() {
+        id_t id = ids_.back();
+        ids_.pop_back();
+        positions_[id] = ABSENT;
+        return id;
+    }
+
+    void clear() {
+        std::vector<id_t>().swap(ids_);
+        std::vector<uint32_t>().swap(positions_);
+    }
+};
+}  // namespace hnswlib
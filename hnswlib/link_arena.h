@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+#include "numa.h"
+
+namespace hnswlib {
+///////////////////////////////////////////////////////////
+//
+// Slab allocator for the upper-level link lists of a graph
+//
+// An element with L upper levels takes L lists of list_size bytes each. Lists
+// are carved back to back out of large slabs, so they carry no per-allocation
+// header and neighboring elements' lists share cache lines and pages. A
+// released list goes onto a free list of its level count, threaded through the
+// list memory itself, and is reused by the next element with as many levels.
+// Memory goes back to the system only in clear(). allocate and release may be
+// called from several threads.
+//
+/////////////////////////////////////////////////////////
+
+class LinkListArena {
+    static constexpr size_t SLAB_BYTES = size_t(1) << 20;
+
+    std::mutex mutex_;
+    size_t list_size_{0};
+    std::vector<char *> blocks_;  // every block owned, freed by clear()
+    std::vector<char *> free_;    // free_[levels]: head of the released lists of that many levels
+    char *next_{nullptr};         // unused end of the newest slab
+    size_t left_{0};
+
+ public:
+    LinkListArena() = default;
+    LinkListArena(const LinkListArena &) = delete;
+    LinkListArena &operator=(const LinkListArena &) = delete;
+
+    ~LinkListArena() {
+        clear();
+    }
+
+    // Bytes of one level's list; must be at least sizeof(char *) and only set while empty.
+    void setListSize(size_t list_size) {
+        list_size_ = list_size;
+    }
+
+    // Zeroed storage for the lists of an element with the given number of levels (> 0).
+    char *allocate(int levels) {
+        size_t size = list_size_ * levels;
+        char *list = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if ((size_t) levels < free_.size() && free_[levels] != nullptr) {
+                list = free_[levels];
+                memcpy(&free_[levels], list, sizeof(char *));
+            } else {
+                if (size > left_) {
+                    size_t slab = std::max(SLAB_BYTES, size);
+                    char *block = (char *) malloc(slab);
+                    if (block == nullptr)
+                        throw std::runtime_error("Not enough memory: failed to allocate linklist");
+                    interleaveMemory(block, slab);
+                    blocks_.push_back(block);
+                    next_ = block;
+                    left_ = slab;
+                }
+                list = next_;
+                next_ += size;
+                left_ -= size;
+            }
+        }
+        memset(list, 0, size);
+        return list;
+    }
+
+    // Makes the lists of an element with that many levels available for reuse.
+    void release(char *list, int levels) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if ((size_t) levels >= free_.size())
+            free_.resize(levels + 1, nullptr);
+        memcpy(list, &free_[levels], sizeof(char *));
+        free_[levels] = list;
+    }
+
+    // A block of size bytes, owned by the arena, that the caller divides into lists
+    // itself, e.g. to read the lists of a whole file in one go.
+    char *allocateBlock(size_t size) {
+        char *block = (char *) malloc(std::max<size_t>(size, 1));
+        if (block == nullptr)
+            throw std::runtime_error("Not enough memory: failed to allocate linklists");
+        interleaveMemory(block, size);
+        std::lock_guard<std::mutex> lock(mutex_);
+        blocks_.push_back(block);
+        return block;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (char *block : blocks_)
+            free(block);
+        blocks_.clear();
+        free_.clear();
+        next_ = nullptr;
+        left_ = 0;
+    }
+};
+}  // namespace hnswlib
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace hnswlib {
+///////////////////////////////////////////////////////////
+//
+// NUMA topology and memory placement
+//
+// Nodes are numbered densely from 0 in the order the kernel lists them. Memory
+// placement goes through the mbind system call directly, so nothing beyond the
+// C library is needed; where it is unavailable (other platforms, or a sandbox
+// that forbids it) placement silently falls back to the kernel's first touch,
+// and a host without NUMA information is treated as a single node.
+//
+/////////////////////////////////////////////////////////
+
+class NumaTopology {
+    std::vector<std::vector<int>> cpus_;  // cpus of each node
+    std::vector<int> node_ids_;           // kernel id of each node
+    std::vector<int> node_of_cpu_;
+
+    // Parses a kernel cpu or node list such as "0-3,8,10-11".
+    static std::vector<int> parseList(const std::string &path) {
+        std::vector<int> items;
+        std::ifstream input(path);
+        std::string list;
+        if (!std::getline(input, list))
+            return items;
+        size_t pos = 0;
+        while (pos < list.size()) {
+            size_t end = list.find(',', pos);
+            if (end == std::string::npos)
+                end = list.size();
+            std::string range = list.substr(pos, end - pos);
+            size_t dash = range.find('-');
+            try {
+                int first = std::stoi(range);
+                int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+                for (int i = first; i <= last; i++)
+                    items.push_back(i);
+            } catch (...) {
+                return std::vector<int>();
+            }
+            pos = end + 1;
+        }
+        return items;
+    }
+
+    NumaTopology() {
+        std::string base = "/sys/devices/system/node/";
+        for (int node : parseList(base + "online")) {
+            std::vector<int> cpus = parseList(base + "node" + std::to_string(node) + "/cpulist");
+            if (cpus.empty())
+                continue;  // memory-only node; searches never run there
+            node_ids_.push_back(node);
+            cpus_.push_back(cpus);
+        }
+        if (cpus_.empty()) {
+            node_ids_.assign(1, 0);
+            cpus_.assign(1, std::vector<int>());
+            for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); cpu++)
+                cpus_[0].push_back(cpu);
+        }
+        for (size_t node = 0; node < cpus_.size(); node++) {
+            for (int cpu : cpus_[node]) {
+                if ((size_t) cpu >= node_of_cpu_.size())
+                    node_of_cpu_.resize(cpu + 1, 0);
+                node_of_cpu_[cpu] = node;
+            }
+        }
+    }
+
+ public:
+    static const NumaTopology &instance() {
+        static const NumaTopology topology;
+        return topology;
+    }
+
+    size_t numNodes() const {
+        return cpus_.size();
+    }
+
+    const std::vector<int> &cpus(size_t node) const {
+        return cpus_[node];
+    }
+
+    int nodeId(size_t node) const {
+        return node_ids_[node];
+    }
+
+    // Node the calling thread runs on right now; threads pinned to a node stay there.
+    size_t currentNode() const {
+        if (cpus_.size() == 1)
+            return 0;
+#if defined(__linux__)
+        int cpu = sched_getcpu();
+        if (cpu >= 0 && (size_t) cpu < node_of_cpu_.size())
+            return node_of_cpu_[cpu];
+#endif
+        return 0;
+    }
+};
+
+
+// Whether storage allocated by indexes is interleaved across all nodes, so a
+// graph searched from every socket is not served from one socket's memory.
+// On by default; only takes effect on hosts with several nodes.
+inline std::atomic<bool> &numaInterleave() {
+    static std::atomic<bool> enabled{true};
+    return enabled;
+}
+
+namespace numa_detail {
+static const int MPOL_PREFERRED_MODE = 1;
+static const int MPOL_INTERLEAVE_MODE = 3;
+static const unsigned MPOL_MF_MOVE_FLAG = 1u << 1;  // also migrate pages already touched
+static const size_t MAX_NODES = 1024;
+
+// Sets the policy of the whole pages inside [data, data + size).
+inline void bind(void *data, size_t size, int mode, const std::vector<int> &nodes) {
+#if defined(__linux__) && defined(SYS_mbind)
+    const size_t page = 4096;
+    uintptr_t begin = ((uintptr_t) data + page - 1) / page * page;
+    uintptr_t end = ((uintptr_t) data + size) / page * page;
+    if (end <= begin)
+        return;
+    unsigned long mask[MAX_NODES / (8 * sizeof(unsigned long))] = {};
+    const size_t bits = 8 * sizeof(unsigned long);
+    for (int node : nodes) {
+        if (node >= 0 && (size_t) node < MAX_NODES)
+            mask[node / bits] |= 1ul << (node % bits);
+    }
+    syscall(SYS_mbind, (void *) begin, end - begin, mode, mask, MAX_NODES, MPOL_MF_MOVE_FLAG);
+#endif
+}
+}  // namespace numa_detail
+
+// Spreads the pages of [data, data + size) round-robin over all nodes when
+// numaInterleave() is on. Call before the memory is first written.
+inline void interleaveMemory(void *data, size_t size) {
+    const NumaTopology &topology = NumaTopology::instance();
+    if (topology.numNodes() < 2 || !numaInterleave())
+        return;
+    std::vector<int> nodes;
+    for (size_t node = 0; node < topology.numNodes(); node++)
+        nodes.push_back(topology.nodeId(node));
+    numa_detail::bind(data, size, numa_detail::MPOL_INTERLEAVE_MODE, nodes);
+}
+
+// Places the pages of [data, data + size) on node, or elsewhere when it is full.
+inline void bindMemoryToNode(void *data, size_t size, size_t node) {
+    const NumaTopology &topology = NumaTopology::instance();
+    if (topology.numNodes() < 2)
+        return;
+    numa_detail::bind(data, size, numa_detail::MPOL_PREFERRED_MODE, {topology.nodeId(node)});
+}
+
+// Lets thread run on the cpus of node only.
+inline void pinThreadToNode(std::thread &thread, size_t node) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : NumaTopology::instance().cpus(node))
+        CPU_SET(cpu, &set);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#endif
+}
+}  // namespace hnswlib
@@ -1,5 +1,6 @@
 #pragma once
 #include "hnswlib.h"
+#include <cmath>
 
 namespace hnswlib {
 
@@ -20,9 +21,9 @@ InnerProductDistance(const void *pVect1, const void *pVect2, const void *qty_ptr
 
 #if defined(USE_AVX)
 
-// Favor using AVX if available.
-static float
-InnerProductSIMD4ExtAVX(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
+// Favor using AVX2 + FMA if available.
+HNSWLIB_TARGET_AVX2 static float
+InnerProductSIMD4ExtAVX2(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
     float PORTABLE_ALIGN32 TmpRes[8];
     float *pVect1 = (float *) pVect1v;
     float *pVect2 = (float *) pVect2v;
@@ -43,13 +44,13 @@ InnerProductSIMD4ExtAVX(const void *pVect1v, const void *pVect2v, const void *qt
         pVect1 += 8;
         __m256 v2 = _mm256_loadu_ps(pVect2);
         pVect2 += 8;
-        sum256 = _mm256_add_ps(sum256, _mm256_mul_ps(v1, v2));
+        sum256 = _mm256_fmadd_ps(v1, v2, sum256);
 
         v1 = _mm256_loadu_ps(pVect1);
         pVect1 += 8;
         v2 = _mm256_loadu_ps(pVect2);
         pVect2 += 8;
-        sum256 = _mm256_add_ps(sum256, _mm256_mul_ps(v1, v2));
+        sum256 = _mm256_fmadd_ps(v1, v2, sum256);
     }
 
     __m128 v1, v2;
@@ -69,8 +70,8 @@ InnerProductSIMD4ExtAVX(const void *pVect1v, const void *pVect2v, const void *qt
 }
 
 static float
-InnerProductDistanceSIMD4ExtAVX(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
-    return 1.0f - InnerProductSIMD4ExtAVX(pVect1v, pVect2v, qty_ptr);
+InnerProductDistanceSIMD4ExtAVX2(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
+    return 1.0f - InnerProductSIMD4ExtAVX2(pVect1v, pVect2v, qty_ptr);
 }
 
 #endif
@@ -143,9 +144,8 @@ InnerProductDistanceSIMD4ExtSSE(const void *pVect1v, const void *pVect2v, const
 
 #if defined(USE_AVX512)
 
-static float
+HNSWLIB_TARGET_AVX512 static float
 InnerProductSIMD16ExtAVX512(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
-    float PORTABLE_ALIGN64 TmpRes[16];
     float *pVect1 = (float *) pVect1v;
     float *pVect2 = (float *) pVect2v;
     size_t qty = *((size_t *) qty_ptr);
@@ -194,7 +194,7 @@ InnerProductSIMD16ExtAVX512(const void *pVect1v, const void *pVect2v, const void
         sum512 = _mm512_fmadd_ps(v1, v2, sum512);
     }
 
-    float sum = _mm512_reduce_add_ps(sum512);
+    float sum = reduceAddAVX512(sum512);
     return sum;
 }
 
@@ -207,8 +207,8 @@ InnerProductDistanceSIMD16ExtAVX512(const void *pVect1v, const void *pVect2v, co
 
 #if defined(USE_AVX)
 
-static float
-InnerProductSIMD16ExtAVX(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
+HNSWLIB_TARGET_AVX2 static float
+InnerProductSIMD16ExtAVX2(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
     float PORTABLE_ALIGN32 TmpRes[8];
     float *pVect1 = (float *) pVect1v;
     float *pVect2 = (float *) pVect2v;
@@ -228,13 +228,13 @@ InnerProductSIMD16ExtAVX(const void *pVect1v, const void *pVect2v, const void *q
         pVect1 += 8;
         __m256 v2 = _mm256_loadu_ps(pVect2);
         pVect2 += 8;
-        sum256 = _mm256_add_ps(sum256, _mm256_mul_ps(v1, v2));
+        sum256 = _mm256_fmadd_ps(v1, v2, sum256);
 
         v1 = _mm256_loadu_ps(pVect1);
         pVect1 += 8;
         v2 = _mm256_loadu_ps(pVect2);
         pVect2 += 8;
-        sum256 = _mm256_add_ps(sum256, _mm256_mul_ps(v1, v2));
+        sum256 = _mm256_fmadd_ps(v1, v2, sum256);
     }
 
     _mm256_store_ps(TmpRes, sum256);
@@ -244,8 +244,8 @@ InnerProductSIMD16ExtAVX(const void *pVect1v, const void *pVect2v, const void *q
 }
 
 static float
-InnerProductDistanceSIMD16ExtAVX(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
-    return 1.0f - InnerProductSIMD16ExtAVX(pVect1v, pVect2v, qty_ptr);
+InnerProductDistanceSIMD16ExtAVX2(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
+    return 1.0f - InnerProductSIMD16ExtAVX2(pVect1v, pVect2v, qty_ptr);
 }
 
 #endif
@@ -304,11 +304,78 @@ InnerProductDistanceSIMD16ExtSSE(const void *pVect1v, const void *pVect2v, const
 
 #endif
 
-#if defined(USE_SSE) || defined(USE_AVX) || defined(USE_AVX512)
+#if defined(USE_NEON)
+
+static float
+InnerProductSIMD16ExtNEON(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
+    float *pVect1 = (float *) pVect1v;
+    float *pVect2 = (float *) pVect2v;
+    size_t qty = *((size_t *) qty_ptr);
+
+    size_t qty16 = qty / 16;
+
+    const float *pEnd1 = pVect1 + 16 * qty16;
+
+    float32x4_t sum0 = vdupq_n_f32(0);
+    float32x4_t sum1 = vdupq_n_f32(0);
+
+    while (pVect1 < pEnd1) {
+        sum0 = vfmaq_f32(sum0, vld1q_f32(pVect1), vld1q_f32(pVect2));
+        sum1 = vfmaq_f32(sum1, vld1q_f32(pVect1 + 4), vld1q_f32(pVect2 + 4));
+        sum0 = vfmaq_f32(sum0, vld1q_f32(pVect1 + 8), vld1q_f32(pVect2 + 8));
+        sum1 = vfmaq_f32(sum1, vld1q_f32(pVect1 + 12), vld1q_f32(pVect2 + 12));
+        pVect1 += 16;
+        pVect2 += 16;
+    }
+
+    return vaddvq_f32(vaddq_f32(sum0, sum1));
+}
+
+static float
+InnerProductDistanceSIMD16ExtNEON(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
+    return 1.0f - InnerProductSIMD16ExtNEON(pVect1v, pVect2v, qty_ptr);
+}
+
+static float
+InnerProductSIMD4ExtNEON(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
+    float *pVect1 = (float *) pVect1v;
+    float *pVect2 = (float *) pVect2v;
+    size_t qty = *((size_t *) qty_ptr);
+
+    size_t qty4 = qty / 4;
+
+    const float *pEnd1 = pVect1 + 4 * qty4;
+
+    float32x4_t sum = vdupq_n_f32(0);
+
+    while (pVect1 < pEnd1) {
+        sum = vfmaq_f32(sum, vld1q_f32(pVect1), vld1q_f32(pVect2));
+        pVect1 += 4;
+        pVect2 += 4;
+    }
+
+    return vaddvq_f32(sum);
+}
+
+static float
+InnerProductDistanceSIMD4ExtNEON(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
+    return 1.0f - InnerProductSIMD4ExtNEON(pVect1v, pVect2v, qty_ptr);
+}
+
+#endif
+
+#if defined(USE_SSE) || defined(USE_AVX) || defined(USE_AVX512) || defined(USE_NEON)
+#if defined(USE_NEON)
+static DISTFUNC<float> InnerProductSIMD16Ext = InnerProductSIMD16ExtNEON;
+static DISTFUNC<float> InnerProductSIMD4Ext = InnerProductSIMD4ExtNEON;
+static DISTFUNC<float> InnerProductDistanceSIMD16Ext = InnerProductDistanceSIMD16ExtNEON;
+static DISTFUNC<float> InnerProductDistanceSIMD4Ext = InnerProductDistanceSIMD4ExtNEON;
+#else
 static DISTFUNC<float> InnerProductSIMD16Ext = InnerProductSIMD16ExtSSE;
 static DISTFUNC<float> InnerProductSIMD4Ext = InnerProductSIMD4ExtSSE;
 static DISTFUNC<float> InnerProductDistanceSIMD16Ext = InnerProductDistanceSIMD16ExtSSE;
 static DISTFUNC<float> InnerProductDistanceSIMD4Ext = InnerProductDistanceSIMD4ExtSSE;
+#endif
 
 static float
 InnerProductDistanceSIMD16ExtResiduals(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
@@ -339,45 +406,252 @@ InnerProductDistanceSIMD4ExtResiduals(const void *pVect1v, const void *pVect2v,
 }
 #endif
 
-class InnerProductSpace : public SpaceInterface<float> {
-    DISTFUNC<float> fstdistfunc_;
-    size_t data_size_;
-    size_t dim_;
-
- public:
-    InnerProductSpace(size_t dim) {
-        fstdistfunc_ = InnerProductDistance;
-#if defined(USE_AVX) || defined(USE_SSE) || defined(USE_AVX512)
+// Picks the fastest inner product distance kernel for this CPU and dimension.
+static DISTFUNC<float> selectInnerProductDistanceFunc(size_t dim) {
+    DISTFUNC<float> fstdistfunc = InnerProductDistance;
+#if defined(USE_AVX) || defined(USE_SSE) || defined(USE_AVX512) || defined(USE_NEON)
     #if defined(USE_AVX512)
-        if (AVX512Capable()) {
-            InnerProductSIMD16Ext = InnerProductSIMD16ExtAVX512;
-            InnerProductDistanceSIMD16Ext = InnerProductDistanceSIMD16ExtAVX512;
-        } else if (AVXCapable()) {
-            InnerProductSIMD16Ext = InnerProductSIMD16ExtAVX;
-            InnerProductDistanceSIMD16Ext = InnerProductDistanceSIMD16ExtAVX;
-        }
+    if (getSimdLevel() == SIMD_AVX512) {
+        InnerProductSIMD16Ext = InnerProductSIMD16ExtAVX512;
+        InnerProductDistanceSIMD16Ext = InnerProductDistanceSIMD16ExtAVX512;
+    } else if (getSimdLevel() == SIMD_AVX2) {
+        InnerProductSIMD16Ext = InnerProductSIMD16ExtAVX2;
+        InnerProductDistanceSIMD16Ext = InnerProductDistanceSIMD16ExtAVX2;
+    }
     #elif defined(USE_AVX)
-        if (AVXCapable()) {
-            InnerProductSIMD16Ext = InnerProductSIMD16ExtAVX;
-            InnerProductDistanceSIMD16Ext = InnerProductDistanceSIMD16ExtAVX;
-        }
+    if (getSimdLevel() == SIMD_AVX2) {
+        InnerProductSIMD16Ext = InnerProductSIMD16ExtAVX2;
+        InnerProductDistanceSIMD16Ext = InnerProductDistanceSIMD16ExtAVX2;
+    }
     #endif
     #if defined(USE_AVX)
-        if (AVXCapable()) {
-            InnerProductSIMD4Ext = InnerProductSIMD4ExtAVX;
-            InnerProductDistanceSIMD4Ext = InnerProductDistanceSIMD4ExtAVX;
-        }
+    if (getSimdLevel() >= SIMD_AVX2) {
+        InnerProductSIMD4Ext = InnerProductSIMD4ExtAVX2;
+        InnerProductDistanceSIMD4Ext = InnerProductDistanceSIMD4ExtAVX2;
+    }
     #endif
 
-        if (dim % 16 == 0)
-            fstdistfunc_ = InnerProductDistanceSIMD16Ext;
-        else if (dim % 4 == 0)
-            fstdistfunc_ = InnerProductDistanceSIMD4Ext;
-        else if (dim > 16)
-            fstdistfunc_ = InnerProductDistanceSIMD16ExtResiduals;
-        else if (dim > 4)
-            fstdistfunc_ = InnerProductDistanceSIMD4ExtResiduals;
+    if (dim % 16 == 0)
+        fstdistfunc = InnerProductDistanceSIMD16Ext;
+    else if (dim % 4 == 0)
+        fstdistfunc = InnerProductDistanceSIMD4Ext;
+    else if (dim > 16)
+        fstdistfunc = InnerProductDistanceSIMD16ExtResiduals;
+    else if (dim > 4)
+        fstdistfunc = InnerProductDistanceSIMD4ExtResiduals;
+#endif
+    return fstdistfunc;
+}
+
+// Scales a vector to unit length, for spaces where inner product is used as
+// cosine distance. out may be the same array as in; the 1e-15 keeps a zero
+// vector at zero instead of dividing by zero.
+typedef void (*NORMFUNC)(const float *in, float *out, size_t dim);
+
+static void
+NormalizeVector(const float *in, float *out, size_t dim) {
+    float norm = 0;
+    for (size_t i = 0; i < dim; i++)
+        norm += in[i] * in[i];
+    float scale = 1.0f / (std::sqrt(norm) + 1e-15f);
+    for (size_t i = 0; i < dim; i++)
+        out[i] = in[i] * scale;
+}
+
+#if defined(USE_AVX512)
+
+HNSWLIB_TARGET_AVX512 static void
+NormalizeVectorAVX512(const float *in, float *out, size_t dim) {
+    size_t dim16 = dim >> 4 << 4;
+    __m512 sum512 = _mm512_set1_ps(0);
+    for (size_t i = 0; i < dim16; i += 16) {
+        __m512 v = _mm512_loadu_ps(in + i);
+        sum512 = _mm512_fmadd_ps(v, v, sum512);
+    }
+    float norm = reduceAddAVX512(sum512);
+    for (size_t i = dim16; i < dim; i++)
+        norm += in[i] * in[i];
+
+    float scale = 1.0f / (std::sqrt(norm) + 1e-15f);
+    __m512 scale512 = _mm512_set1_ps(scale);
+    for (size_t i = 0; i < dim16; i += 16)
+        _mm512_storeu_ps(out + i, _mm512_mul_ps(_mm512_loadu_ps(in + i), scale512));
+    for (size_t i = dim16; i < dim; i++)
+        out[i] = in[i] * scale;
+}
+
+#endif
+
+#if defined(USE_AVX)
+
+HNSWLIB_TARGET_AVX2 static void
+NormalizeVectorAVX2(const float *in, float *out, size_t dim) {
+    float PORTABLE_ALIGN32 TmpRes[8];
+    size_t dim8 = dim >> 3 << 3;
+    __m256 sum256 = _mm256_set1_ps(0);
+    for (size_t i = 0; i < dim8; i += 8) {
+        __m256 v = _mm256_loadu_ps(in + i);
+        sum256 = _mm256_fmadd_ps(v, v, sum256);
+    }
+    _mm256_store_ps(TmpRes, sum256);
+    float norm = TmpRes[0] + TmpRes[1] + TmpRes[2] + TmpRes[3] + TmpRes[4] + TmpRes[5] + TmpRes[6] + TmpRes[7];
+    for (size_t i = dim8; i < dim; i++)
+        norm += in[i] * in[i];
+
+    float scale = 1.0f / (std::sqrt(norm) + 1e-15f);
+    __m256 scale256 = _mm256_set1_ps(scale);
+    for (size_t i = 0; i < dim8; i += 8)
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_loadu_ps(in + i), scale256));
+    for (size_t i = dim8; i < dim; i++)
+        out[i] = in[i] * scale;
+}
+
+#endif
+
+#if defined(USE_SSE)
+
+static void
+NormalizeVectorSSE(const float *in, float *out, size_t dim) {
+    float PORTABLE_ALIGN32 TmpRes[8];
+    size_t dim4 = dim >> 2 << 2;
+    __m128 sum = _mm_set1_ps(0);
+    for (size_t i = 0; i < dim4; i += 4) {
+        __m128 v = _mm_loadu_ps(in + i);
+        sum = _mm_add_ps(sum, _mm_mul_ps(v, v));
+    }
+    _mm_store_ps(TmpRes, sum);
+    float norm = TmpRes[0] + TmpRes[1] + TmpRes[2] + TmpRes[3];
+    for (size_t i = dim4; i < dim; i++)
+        norm += in[i] * in[i];
+
+    float scale = 1.0f / (std::sqrt(norm) + 1e-15f);
+    __m128 scale128 = _mm_set1_ps(scale);
+    for (size_t i = 0; i < dim4; i += 4)
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(in + i), scale128));
+    for (size_t i = dim4; i < dim; i++)
+        out[i] = in[i] * scale;
+}
+
+#endif
+
+#if defined(USE_NEON)
+
+static void
+NormalizeVectorNEON(const float *in, float *out, size_t dim) {
+    size_t dim4 = dim >> 2 << 2;
+    float32x4_t sum = vdupq_n_f32(0);
+    for (size_t i = 0; i < dim4; i += 4) {
+        float32x4_t v = vld1q_f32(in + i);
+        sum = vfmaq_f32(sum, v, v);
+    }
+    float norm = vaddvq_f32(sum);
+    for (size_t i = dim4; i < dim; i++)
+        norm += in[i] * in[i];
+
+    float scale = 1.0f / (std::sqrt(norm) + 1e-15f);
+    for (size_t i = 0; i < dim4; i += 4)
+        vst1q_f32(out + i, vmulq_n_f32(vld1q_f32(in + i), scale));
+    for (size_t i = dim4; i < dim; i++)
+        out[i] = in[i] * scale;
+}
+
+#endif
+
+// Picks the fastest normalization kernel for this CPU; below 4 dimensions, as
+// for the distance kernels, the scalar loop is used.
+static inline NORMFUNC selectNormalizeFunc(size_t dim) {
+    if (dim < 4) return NormalizeVector;
+#if defined(USE_AVX512)
+    if (getSimdLevel() == SIMD_AVX512) return NormalizeVectorAVX512;
+#endif
+#if defined(USE_AVX)
+    if (getSimdLevel() >= SIMD_AVX2) return NormalizeVectorAVX2;
+#endif
+#if defined(USE_SSE)
+    return NormalizeVectorSSE;
+#elif defined(USE_NEON)
+    return NormalizeVectorNEON;
+#else
+    return NormalizeVector;
+#endif
+}
+
+// Four-query inner product distances (1 - dot), see BLOCK4FUNC.
+static void
+InnerProductDistanceBlock4(const float *x, const float *const *q, size_t dim, float *out) {
+    float s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    for (size_t i = 0; i < dim; i++) {
+        s0 += x[i] * q[0][i];
+        s1 += x[i] * q[1][i];
+        s2 += x[i] * q[2][i];
+        s3 += x[i] * q[3][i];
+    }
+    out[0] = 1.0f - s0;
+    out[1] = 1.0f - s1;
+    out[2] = 1.0f - s2;
+    out[3] = 1.0f - s3;
+}
+
+#if defined(USE_AVX512)
+HNSWLIB_TARGET_AVX512 static void
+InnerProductDistanceBlock4AVX512(const float *x, const float *const *q, size_t dim, float *out) {
+    __m512 s0 = _mm512_setzero_ps(), s1 = _mm512_setzero_ps(), s2 = _mm512_setzero_ps(), s3 = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= dim; i += 16) {
+        __m512 v = _mm512_loadu_ps(x + i);
+        s0 = _mm512_fmadd_ps(v, _mm512_loadu_ps(q[0] + i), s0);
+        s1 = _mm512_fmadd_ps(v, _mm512_loadu_ps(q[1] + i), s1);
+        s2 = _mm512_fmadd_ps(v, _mm512_loadu_ps(q[2] + i), s2);
+        s3 = _mm512_fmadd_ps(v, _mm512_loadu_ps(q[3] + i), s3);
+    }
+    float r[4] = {reduceAddAVX512(s0), reduceAddAVX512(s1), reduceAddAVX512(s2),
+                  reduceAddAVX512(s3)};
+    for (; i < dim; i++) {
+        for (int j = 0; j < 4; j++) r[j] += x[i] * q[j][i];
+    }
+    for (int j = 0; j < 4; j++) out[j] = 1.0f - r[j];
+}
+#endif
+
+#if defined(USE_AVX)
+HNSWLIB_TARGET_AVX2 static void
+InnerProductDistanceBlock4AVX2(const float *x, const float *const *q, size_t dim, float *out) {
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps(), s2 = _mm256_setzero_ps(), s3 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= dim; i += 8) {
+        __m256 v = _mm256_loadu_ps(x + i);
+        s0 = _mm256_fmadd_ps(v, _mm256_loadu_ps(q[0] + i), s0);
+        s1 = _mm256_fmadd_ps(v, _mm256_loadu_ps(q[1] + i), s1);
+        s2 = _mm256_fmadd_ps(v, _mm256_loadu_ps(q[2] + i), s2);
+        s3 = _mm256_fmadd_ps(v, _mm256_loadu_ps(q[3] + i), s3);
+    }
+    float r[4] = {HorizontalSumAVX2(s0), HorizontalSumAVX2(s1), HorizontalSumAVX2(s2), HorizontalSumAVX2(s3)};
+    for (; i < dim; i++) {
+        for (int j = 0; j < 4; j++) r[j] += x[i] * q[j][i];
+    }
+    for (int j = 0; j < 4; j++) out[j] = 1.0f - r[j];
+}
+#endif
+
+// Picks the fastest four-query inner product kernel for this CPU.
+static BLOCK4FUNC selectInnerProductDistanceBlock4Func() {
+#if defined(USE_AVX512)
+    if (getSimdLevel() == SIMD_AVX512) return InnerProductDistanceBlock4AVX512;
+#endif
+#if defined(USE_AVX)
+    if (getSimdLevel() >= SIMD_AVX2) return InnerProductDistanceBlock4AVX2;
 #endif
+    return InnerProductDistanceBlock4;
+}
+
+class InnerProductSpace : public SpaceInterface<float> {
+    DISTFUNC<float> fstdistfunc_;
+    size_t data_size_;
+    size_t dim_;
+
+ public:
+    InnerProductSpace(size_t dim) {
+        fstdistfunc_ = selectInnerProductDistanceFunc(dim);
         dim_ = dim;
         data_size_ = dim * sizeof(float);
     }
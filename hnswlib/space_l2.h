@@ -22,7 +22,7 @@ L2Sqr(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
 #if defined(USE_AVX512)
 
 // Favor using AVX512 if available.
-static float
+HNSWLIB_TARGET_AVX512 static float
 L2SqrSIMD16ExtAVX512(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
     float *pVect1 = (float *) pVect1v;
     float *pVect2 = (float *) pVect2v;
@@ -41,8 +41,7 @@ L2SqrSIMD16ExtAVX512(const void *pVect1v, const void *pVect2v, const void *qty_p
         v2 = _mm512_loadu_ps(pVect2);
         pVect2 += 16;
         diff = _mm512_sub_ps(v1, v2);
-        // sum = _mm512_fmadd_ps(diff, diff, sum);
-        sum = _mm512_add_ps(sum, _mm512_mul_ps(diff, diff));
+        sum = _mm512_fmadd_ps(diff, diff, sum);
     }
 
     _mm512_store_ps(TmpRes, sum);
@@ -56,9 +55,9 @@ L2SqrSIMD16ExtAVX512(const void *pVect1v, const void *pVect2v, const void *qty_p
 
 #if defined(USE_AVX)
 
-// Favor using AVX if available.
-static float
-L2SqrSIMD16ExtAVX(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
+// Favor using AVX2 + FMA if available.
+HNSWLIB_TARGET_AVX2 static float
+L2SqrSIMD16ExtAVX2(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
     float *pVect1 = (float *) pVect1v;
     float *pVect2 = (float *) pVect2v;
     size_t qty = *((size_t *) qty_ptr);
@@ -76,14 +75,14 @@ L2SqrSIMD16ExtAVX(const void *pVect1v, const void *pVect2v, const void *qty_ptr)
         v2 = _mm256_loadu_ps(pVect2);
         pVect2 += 8;
         diff = _mm256_sub_ps(v1, v2);
-        sum = _mm256_add_ps(sum, _mm256_mul_ps(diff, diff));
+        sum = _mm256_fmadd_ps(diff, diff, sum);
 
         v1 = _mm256_loadu_ps(pVect1);
         pVect1 += 8;
         v2 = _mm256_loadu_ps(pVect2);
         pVect2 += 8;
         diff = _mm256_sub_ps(v1, v2);
-        sum = _mm256_add_ps(sum, _mm256_mul_ps(diff, diff));
+        sum = _mm256_fmadd_ps(diff, diff, sum);
     }
 
     _mm256_store_ps(TmpRes, sum);
@@ -143,27 +142,9 @@ L2SqrSIMD16ExtSSE(const void *pVect1v, const void *pVect2v, const void *qty_ptr)
 }
 #endif
 
-#if defined(USE_SSE) || defined(USE_AVX) || defined(USE_AVX512)
-static DISTFUNC<float> L2SqrSIMD16Ext = L2SqrSIMD16ExtSSE;
-
-static float
-L2SqrSIMD16ExtResiduals(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
-    size_t qty = *((size_t *) qty_ptr);
-    size_t qty16 = qty >> 4 << 4;
-    float res = L2SqrSIMD16Ext(pVect1v, pVect2v, &qty16);
-    float *pVect1 = (float *) pVect1v + qty16;
-    float *pVect2 = (float *) pVect2v + qty16;
-
-    size_t qty_left = qty - qty16;
-    float res_tail = L2Sqr(pVect1, pVect2, &qty_left);
-    return (res + res_tail);
-}
-#endif
-
-
 #if defined(USE_SSE)
 static float
-L2SqrSIMD4Ext(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
+L2SqrSIMD4ExtSSE(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
     float PORTABLE_ALIGN32 TmpRes[8];
     float *pVect1 = (float *) pVect1v;
     float *pVect2 = (float *) pVect2v;
@@ -189,6 +170,83 @@ L2SqrSIMD4Ext(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
     return TmpRes[0] + TmpRes[1] + TmpRes[2] + TmpRes[3];
 }
 
+static DISTFUNC<float> L2SqrSIMD4Ext = L2SqrSIMD4ExtSSE;
+#endif
+
+#if defined(USE_NEON)
+
+static float
+L2SqrSIMD16ExtNEON(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
+    float *pVect1 = (float *) pVect1v;
+    float *pVect2 = (float *) pVect2v;
+    size_t qty = *((size_t *) qty_ptr);
+    size_t qty16 = qty >> 4;
+
+    const float *pEnd1 = pVect1 + (qty16 << 4);
+
+    float32x4_t sum0 = vdupq_n_f32(0);
+    float32x4_t sum1 = vdupq_n_f32(0);
+
+    while (pVect1 < pEnd1) {
+        float32x4_t diff0 = vsubq_f32(vld1q_f32(pVect1), vld1q_f32(pVect2));
+        float32x4_t diff1 = vsubq_f32(vld1q_f32(pVect1 + 4), vld1q_f32(pVect2 + 4));
+        float32x4_t diff2 = vsubq_f32(vld1q_f32(pVect1 + 8), vld1q_f32(pVect2 + 8));
+        float32x4_t diff3 = vsubq_f32(vld1q_f32(pVect1 + 12), vld1q_f32(pVect2 + 12));
+        sum0 = vfmaq_f32(sum0, diff0, diff0);
+        sum1 = vfmaq_f32(sum1, diff1, diff1);
+        sum0 = vfmaq_f32(sum0, diff2, diff2);
+        sum1 = vfmaq_f32(sum1, diff3, diff3);
+        pVect1 += 16;
+        pVect2 += 16;
+    }
+
+    return vaddvq_f32(vaddq_f32(sum0, sum1));
+}
+
+static float
+L2SqrSIMD4ExtNEON(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
+    float *pVect1 = (float *) pVect1v;
+    float *pVect2 = (float *) pVect2v;
+    size_t qty = *((size_t *) qty_ptr);
+    size_t qty4 = qty >> 2;
+
+    const float *pEnd1 = pVect1 + (qty4 << 2);
+
+    float32x4_t sum = vdupq_n_f32(0);
+
+    while (pVect1 < pEnd1) {
+        float32x4_t diff = vsubq_f32(vld1q_f32(pVect1), vld1q_f32(pVect2));
+        sum = vfmaq_f32(sum, diff, diff);
+        pVect1 += 4;
+        pVect2 += 4;
+    }
+
+    return vaddvq_f32(sum);
+}
+
+#endif
+
+#if defined(USE_SSE) || defined(USE_AVX) || defined(USE_AVX512) || defined(USE_NEON)
+#if defined(USE_NEON)
+static DISTFUNC<float> L2SqrSIMD16Ext = L2SqrSIMD16ExtNEON;
+static DISTFUNC<float> L2SqrSIMD4Ext = L2SqrSIMD4ExtNEON;
+#else
+static DISTFUNC<float> L2SqrSIMD16Ext = L2SqrSIMD16ExtSSE;
+#endif
+
+static float
+L2SqrSIMD16ExtResiduals(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
+    size_t qty = *((size_t *) qty_ptr);
+    size_t qty16 = qty >> 4 << 4;
+    float res = L2SqrSIMD16Ext(pVect1v, pVect2v, &qty16);
+    float *pVect1 = (float *) pVect1v + qty16;
+    float *pVect2 = (float *) pVect2v + qty16;
+
+    size_t qty_left = qty - qty16;
+    float res_tail = L2Sqr(pVect1, pVect2, &qty_left);
+    return (res + res_tail);
+}
+
 static float
 L2SqrSIMD4ExtResiduals(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
     size_t qty = *((size_t *) qty_ptr);
@@ -205,6 +263,123 @@ L2SqrSIMD4ExtResiduals(const void *pVect1v, const void *pVect2v, const void *qty
 }
 #endif
 
+
+static void
+L2SqrBlock4(const float *x, const float *const *q, size_t dim, float *out) {
+    float s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    for (size_t i = 0; i < dim; i++) {
+        float d0 = x[i] - q[0][i], d1 = x[i] - q[1][i], d2 = x[i] - q[2][i], d3 = x[i] - q[3][i];
+        s0 += d0 * d0;
+        s1 += d1 * d1;
+        s2 += d2 * d2;
+        s3 += d3 * d3;
+    }
+    out[0] = s0;
+    out[1] = s1;
+    out[2] = s2;
+    out[3] = s3;
+}
+
+#if defined(USE_AVX512)
+HNSWLIB_TARGET_AVX512 static void
+L2SqrBlock4AVX512(const float *x, const float *const *q, size_t dim, float *out) {
+    __m512 s0 = _mm512_setzero_ps(), s1 = _mm512_setzero_ps(), s2 = _mm512_setzero_ps(), s3 = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= dim; i += 16) {
+        __m512 v = _mm512_loadu_ps(x + i);
+        __m512 d0 = _mm512_sub_ps(v, _mm512_loadu_ps(q[0] + i));
+        __m512 d1 = _mm512_sub_ps(v, _mm512_loadu_ps(q[1] + i));
+        __m512 d2 = _mm512_sub_ps(v, _mm512_loadu_ps(q[2] + i));
+        __m512 d3 = _mm512_sub_ps(v, _mm512_loadu_ps(q[3] + i));
+        s0 = _mm512_fmadd_ps(d0, d0, s0);
+        s1 = _mm512_fmadd_ps(d1, d1, s1);
+        s2 = _mm512_fmadd_ps(d2, d2, s2);
+        s3 = _mm512_fmadd_ps(d3, d3, s3);
+    }
+    float r[4] = {reduceAddAVX512(s0), reduceAddAVX512(s1), reduceAddAVX512(s2),
+                  reduceAddAVX512(s3)};
+    for (; i < dim; i++) {
+        for (int j = 0; j < 4; j++) {
+            float d = x[i] - q[j][i];
+            r[j] += d * d;
+        }
+    }
+    memcpy(out, r, sizeof(r));
+}
+#endif
+
+#if defined(USE_AVX)
+HNSWLIB_TARGET_AVX2 static inline float
+HorizontalSumAVX2(__m256 v) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_hadd_ps(s, s);
+    s = _mm_hadd_ps(s, s);
+    return _mm_cvtss_f32(s);
+}
+
+HNSWLIB_TARGET_AVX2 static void
+L2SqrBlock4AVX2(const float *x, const float *const *q, size_t dim, float *out) {
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps(), s2 = _mm256_setzero_ps(), s3 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= dim; i += 8) {
+        __m256 v = _mm256_loadu_ps(x + i);
+        __m256 d0 = _mm256_sub_ps(v, _mm256_loadu_ps(q[0] + i));
+        __m256 d1 = _mm256_sub_ps(v, _mm256_loadu_ps(q[1] + i));
+        __m256 d2 = _mm256_sub_ps(v, _mm256_loadu_ps(q[2] + i));
+        __m256 d3 = _mm256_sub_ps(v, _mm256_loadu_ps(q[3] + i));
+        s0 = _mm256_fmadd_ps(d0, d0, s0);
+        s1 = _mm256_fmadd_ps(d1, d1, s1);
+        s2 = _mm256_fmadd_ps(d2, d2, s2);
+        s3 = _mm256_fmadd_ps(d3, d3, s3);
+    }
+    float r[4] = {HorizontalSumAVX2(s0), HorizontalSumAVX2(s1), HorizontalSumAVX2(s2), HorizontalSumAVX2(s3)};
+    for (; i < dim; i++) {
+        for (int j = 0; j < 4; j++) {
+            float d = x[i] - q[j][i];
+            r[j] += d * d;
+        }
+    }
+    memcpy(out, r, sizeof(r));
+}
+#endif
+
+// Picks the fastest four-query L2 kernel for this CPU.
+static BLOCK4FUNC selectL2SqrBlock4Func() {
+#if defined(USE_AVX512)
+    if (getSimdLevel() == SIMD_AVX512) return L2SqrBlock4AVX512;
+#endif
+#if defined(USE_AVX)
+    if (getSimdLevel() >= SIMD_AVX2) return L2SqrBlock4AVX2;
+#endif
+    return L2SqrBlock4;
+}
+
+// Picks the fastest L2 kernel for this CPU and dimension.
+static DISTFUNC<float> selectL2SqrFunc(size_t dim) {
+    DISTFUNC<float> fstdistfunc = L2Sqr;
+#if defined(USE_SSE) || defined(USE_AVX) || defined(USE_AVX512) || defined(USE_NEON)
+    #if defined(USE_AVX512)
+    if (getSimdLevel() == SIMD_AVX512)
+        L2SqrSIMD16Ext = L2SqrSIMD16ExtAVX512;
+    else if (getSimdLevel() == SIMD_AVX2)
+        L2SqrSIMD16Ext = L2SqrSIMD16ExtAVX2;
+    #elif defined(USE_AVX)
+    if (getSimdLevel() == SIMD_AVX2)
+        L2SqrSIMD16Ext = L2SqrSIMD16ExtAVX2;
+    #endif
+
+    if (dim % 16 == 0)
+        fstdistfunc = L2SqrSIMD16Ext;
+    else if (dim % 4 == 0)
+        fstdistfunc = L2SqrSIMD4Ext;
+    else if (dim > 16)
+        fstdistfunc = L2SqrSIMD16ExtResiduals;
+    else if (dim > 4)
+        fstdistfunc = L2SqrSIMD4ExtResiduals;
+#endif
+    return fstdistfunc;
+}
+
 class L2Space : public SpaceInterface<float> {
     DISTFUNC<float> fstdistfunc_;
     size_t data_size_;
@@ -212,27 +387,7 @@ class L2Space : public SpaceInterface<float> {
 
  public:
     L2Space(size_t dim) {
-        fstdistfunc_ = L2Sqr;
-#if defined(USE_SSE) || defined(USE_AVX) || defined(USE_AVX512)
-    #if defined(USE_AVX512)
-        if (AVX512Capable())
-            L2SqrSIMD16Ext = L2SqrSIMD16ExtAVX512;
-        else if (AVXCapable())
-            L2SqrSIMD16Ext = L2SqrSIMD16ExtAVX;
-    #elif defined(USE_AVX)
-        if (AVXCapable())
-            L2SqrSIMD16Ext = L2SqrSIMD16ExtAVX;
-    #endif
-
-        if (dim % 16 == 0)
-            fstdistfunc_ = L2SqrSIMD16Ext;
-        else if (dim % 4 == 0)
-            fstdistfunc_ = L2SqrSIMD4Ext;
-        else if (dim > 16)
-            fstdistfunc_ = L2SqrSIMD16ExtResiduals;
-        else if (dim > 4)
-            fstdistfunc_ = L2SqrSIMD4ExtResiduals;
-#endif
+        fstdistfunc_ = selectL2SqrFunc(dim);
         dim_ = dim;
         data_size_ = dim * sizeof(float);
     }
@@ -0,0 +1,656 @@
+#pragma once
+#include "hnswlib.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace hnswlib {
+
+// A space whose vectors are stored in a compressed encoding. Both indexed
+// vectors and queries must go through encode() before reaching the graph, so
+// that in-graph distances compare two encoded vectors; decode() reconstructs
+// an approximate float32 vector.
+class QuantizedSpace : public SpaceInterface<float> {
+ public:
+    virtual size_t get_dim() const = 0;
+
+    virtual void encode(const float *in, void *out) const = 0;
+
+    virtual void decode(const void *in, float *out) const = 0;
+
+    // Distance between a float32 query and an encoded vector, used to rerank
+    // candidates found with the encoded query.
+    virtual float asymmetric_dist(const float *query, const void *encoded) const = 0;
+
+    virtual bool is_trained() const { return true; }
+
+    virtual void train(const float *, size_t) {}
+
+    // Encoding parameters that must be persisted alongside the index.
+    virtual bool has_params() const { return false; }
+
+    virtual void save_params(std::ostream &) const {}
+
+    virtual void load_params(std::istream &) {}
+
+    virtual ~QuantizedSpace() {}
+};
+
+// Parameters of the 8-bit scalar quantizer: component i is stored as
+// round((x - vmin[i]) / scale[i]) clamped to [0, 255].
+struct SQ8Params {
+    size_t dim;  // must stay first, the index reads the dimension through the param pointer
+    std::vector<float> vmin;
+    std::vector<float> scale;
+    std::vector<float> scale2;  // scale squared, used by the L2 kernels
+};
+
+static float
+SQ8L2Sqr(const void *pVect1v, const void *pVect2v, const void *param) {
+    const SQ8Params *p = (const SQ8Params *) param;
+    const uint8_t *a = (const uint8_t *) pVect1v;
+    const uint8_t *b = (const uint8_t *) pVect2v;
+    float res = 0;
+    for (size_t i = 0; i < p->dim; i++) {
+        float t = (float) a[i] - (float) b[i];
+        res += t * t * p->scale2[i];
+    }
+    return res;
+}
+
+static float
+SQ8InnerProductDistance(const void *pVect1v, const void *pVect2v, const void *param) {
+    const SQ8Params *p = (const SQ8Params *) param;
+    const uint8_t *a = (const uint8_t *) pVect1v;
+    const uint8_t *b = (const uint8_t *) pVect2v;
+    float res = 0;
+    for (size_t i = 0; i < p->dim; i++) {
+        res += (p->vmin[i] + a[i] * p->scale[i]) * (p->vmin[i] + b[i] * p->scale[i]);
+    }
+    return 1.0f - res;
+}
+
+#if defined(USE_AVX)
+
+HNSWLIB_TARGET_AVX2 static float
+SQ8L2SqrAVX2(const void *pVect1v, const void *pVect2v, const void *param) {
+    const SQ8Params *p = (const SQ8Params *) param;
+    const uint8_t *a = (const uint8_t *) pVect1v;
+    const uint8_t *b = (const uint8_t *) pVect2v;
+    const float *scale2 = p->scale2.data();
+    size_t dim = p->dim;
+    size_t dim8 = dim / 8 * 8;
+    float PORTABLE_ALIGN32 TmpRes[8];
+
+    __m256 sum = _mm256_setzero_ps();
+    for (size_t i = 0; i < dim8; i += 8) {
+        __m256 va = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (a + i))));
+        __m256 vb = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (b + i))));
+        __m256 diff = _mm256_sub_ps(va, vb);
+        sum = _mm256_fmadd_ps(_mm256_mul_ps(diff, diff), _mm256_loadu_ps(scale2 + i), sum);
+    }
+    _mm256_store_ps(TmpRes, sum);
+    float res = TmpRes[0] + TmpRes[1] + TmpRes[2] + TmpRes[3] + TmpRes[4] + TmpRes[5] + TmpRes[6] + TmpRes[7];
+    for (size_t i = dim8; i < dim; i++) {
+        float t = (float) a[i] - (float) b[i];
+        res += t * t * scale2[i];
+    }
+    return res;
+}
+
+HNSWLIB_TARGET_AVX2 static float
+SQ8InnerProductDistanceAVX2(const void *pVect1v, const void *pVect2v, const void *param) {
+    const SQ8Params *p = (const SQ8Params *) param;
+    const uint8_t *a = (const uint8_t *) pVect1v;
+    const uint8_t *b = (const uint8_t *) pVect2v;
+    const float *vmin = p->vmin.data();
+    const float *scale = p->scale.data();
+    size_t dim = p->dim;
+    size_t dim8 = dim / 8 * 8;
+    float PORTABLE_ALIGN32 TmpRes[8];
+
+    __m256 sum = _mm256_setzero_ps();
+    for (size_t i = 0; i < dim8; i += 8) {
+        __m256 vs = _mm256_loadu_ps(scale + i);
+        __m256 vm = _mm256_loadu_ps(vmin + i);
+        __m256 va = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (a + i))));
+        __m256 vb = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (b + i))));
+        sum = _mm256_fmadd_ps(_mm256_fmadd_ps(va, vs, vm), _mm256_fmadd_ps(vb, vs, vm), sum);
+    }
+    _mm256_store_ps(TmpRes, sum);
+    float res = TmpRes[0] + TmpRes[1] + TmpRes[2] + TmpRes[3] + TmpRes[4] + TmpRes[5] + TmpRes[6] + TmpRes[7];
+    for (size_t i = dim8; i < dim; i++) {
+        res += (vmin[i] + a[i] * scale[i]) * (vmin[i] + b[i] * scale[i]);
+    }
+    return 1.0f - res;
+}
+
+#endif
+
+#if defined(USE_AVX512)
+
+HNSWLIB_TARGET_AVX512 static float
+SQ8L2SqrAVX512(const void *pVect1v, const void *pVect2v, const void *param) {
+    const SQ8Params *p = (const SQ8Params *) param;
+    const uint8_t *a = (const uint8_t *) pVect1v;
+    const uint8_t *b = (const uint8_t *) pVect2v;
+    const float *scale2 = p->scale2.data();
+    size_t dim = p->dim;
+    size_t dim16 = dim / 16 * 16;
+
+    __m512 sum = _mm512_setzero_ps();
+    for (size_t i = 0; i < dim16; i += 16) {
+        __m512 va = _mm512_maskz_cvtepi32_ps(0xffff, _mm512_maskz_cvtepu8_epi32(0xffff, _mm_loadu_si128((const __m128i *) (a + i))));
+        __m512 vb = _mm512_maskz_cvtepi32_ps(0xffff, _mm512_maskz_cvtepu8_epi32(0xffff, _mm_loadu_si128((const __m128i *) (b + i))));
+        __m512 diff = _mm512_sub_ps(va, vb);
+        sum = _mm512_fmadd_ps(_mm512_mul_ps(diff, diff), _mm512_loadu_ps(scale2 + i), sum);
+    }
+    float res = reduceAddAVX512(sum);
+    for (size_t i = dim16; i < dim; i++) {
+        float t = (float) a[i] - (float) b[i];
+        res += t * t * scale2[i];
+    }
+    return res;
+}
+
+HNSWLIB_TARGET_AVX512 static float
+SQ8InnerProductDistanceAVX512(const void *pVect1v, const void *pVect2v, const void *param) {
+    const SQ8Params *p = (const SQ8Params *) param;
+    const uint8_t *a = (const uint8_t *) pVect1v;
+    const uint8_t *b = (const uint8_t *) pVect2v;
+    const float *vmin = p->vmin.data();
+    const float *scale = p->scale.data();
+    size_t dim = p->dim;
+    size_t dim16 = dim / 16 * 16;
+
+    __m512 sum = _mm512_setzero_ps();
+    for (size_t i = 0; i < dim16; i += 16) {
+        __m512 vs = _mm512_loadu_ps(scale + i);
+        __m512 vm = _mm512_loadu_ps(vmin + i);
+        __m512 va = _mm512_maskz_cvtepi32_ps(0xffff, _mm512_maskz_cvtepu8_epi32(0xffff, _mm_loadu_si128((const __m128i *) (a + i))));
+        __m512 vb = _mm512_maskz_cvtepi32_ps(0xffff, _mm512_maskz_cvtepu8_epi32(0xffff, _mm_loadu_si128((const __m128i *) (b + i))));
+        sum = _mm512_fmadd_ps(_mm512_fmadd_ps(va, vs, vm), _mm512_fmadd_ps(vb, vs, vm), sum);
+    }
+    float res = reduceAddAVX512(sum);
+    for (size_t i = dim16; i < dim; i++) {
+        res += (vmin[i] + a[i] * scale[i]) * (vmin[i] + b[i] * scale[i]);
+    }
+    return 1.0f - res;
+}
+
+#endif
+
+#if defined(USE_NEON)
+
+static inline void
+SQ8LoadNEON(const uint8_t *p, float32x4_t &lo, float32x4_t &hi) {
+    uint16x8_t v = vmovl_u8(vld1_u8(p));
+    lo = vcvtq_f32_u32(vmovl_u16(vget_low_u16(v)));
+    hi = vcvtq_f32_u32(vmovl_u16(vget_high_u16(v)));
+}
+
+static float
+SQ8L2SqrNEON(const void *pVect1v, const void *pVect2v, const void *param) {
+    const SQ8Params *p = (const SQ8Params *) param;
+    const uint8_t *a = (const uint8_t *) pVect1v;
+    const uint8_t *b = (const uint8_t *) pVect2v;
+    const float *scale2 = p->scale2.data();
+    size_t dim = p->dim;
+    size_t dim8 = dim / 8 * 8;
+
+    float32x4_t sum = vdupq_n_f32(0);
+    for (size_t i = 0; i < dim8; i += 8) {
+        float32x4_t alo, ahi, blo, bhi;
+        SQ8LoadNEON(a + i, alo, ahi);
+        SQ8LoadNEON(b + i, blo, bhi);
+        float32x4_t dlo = vsubq_f32(alo, blo);
+        float32x4_t dhi = vsubq_f32(ahi, bhi);
+        sum = vfmaq_f32(sum, vmulq_f32(dlo, dlo), vld1q_f32(scale2 + i));
+        sum = vfmaq_f32(sum, vmulq_f32(dhi, dhi), vld1q_f32(scale2 + i + 4));
+    }
+    float res = vaddvq_f32(sum);
+    for (size_t i = dim8; i < dim; i++) {
+        float t = (float) a[i] - (float) b[i];
+        res += t * t * scale2[i];
+    }
+    return res;
+}
+
+static float
+SQ8InnerProductDistanceNEON(const void *pVect1v, const void *pVect2v, const void *param) {
+    const SQ8Params *p = (const SQ8Params *) param;
+    const uint8_t *a = (const uint8_t *) pVect1v;
+    const uint8_t *b = (const uint8_t *) pVect2v;
+    const float *vmin = p->vmin.data();
+    const float *scale = p->scale.data();
+    size_t dim = p->dim;
+    size_t dim8 = dim / 8 * 8;
+
+    float32x4_t sum = vdupq_n_f32(0);
+    for (size_t i = 0; i < dim8; i += 8) {
+        float32x4_t alo, ahi, blo, bhi;
+        SQ8LoadNEON(a + i, alo, ahi);
+        SQ8LoadNEON(b + i, blo, bhi);
+        float32x4_t slo = vld1q_f32(scale + i), shi = vld1q_f32(scale + i + 4);
+        float32x4_t mlo = vld1q_f32(vmin + i), mhi = vld1q_f32(vmin + i + 4);
+        sum = vfmaq_f32(sum, vfmaq_f32(mlo, alo, slo), vfmaq_f32(mlo, blo, slo));
+        sum = vfmaq_f32(sum, vfmaq_f32(mhi, ahi, shi), vfmaq_f32(mhi, bhi, shi));
+    }
+    float res = vaddvq_f32(sum);
+    for (size_t i = dim8; i < dim; i++) {
+        res += (vmin[i] + a[i] * scale[i]) * (vmin[i] + b[i] * scale[i]);
+    }
+    return 1.0f - res;
+}
+
+#endif
+
+// 8-bit scalar quantization with per-dimension min/max trained on a sample.
+// Vectors take dim bytes instead of 4 * dim.
+class SQ8Space : public QuantizedSpace {
+    DISTFUNC<float> fstdistfunc_;
+    DISTFUNC<float> floatdistfunc_;
+    bool trained_;
+    SQ8Params params_;
+    size_t dim_;
+
+ public:
+    SQ8Space(size_t dim, bool inner_product) : trained_(false), dim_(dim) {
+        params_.dim = dim;
+        params_.vmin.assign(dim, 0.0f);
+        params_.scale.assign(dim, 0.0f);
+        params_.scale2.assign(dim, 0.0f);
+
+        fstdistfunc_ = inner_product ? SQ8InnerProductDistance : SQ8L2Sqr;
+#if defined(USE_AVX512)
+        if (getSimdLevel() == SIMD_AVX512)
+            fstdistfunc_ = inner_product ? SQ8InnerProductDistanceAVX512 : SQ8L2SqrAVX512;
+#endif
+#if defined(USE_AVX)
+        if (getSimdLevel() == SIMD_AVX2)
+            fstdistfunc_ = inner_product ? SQ8InnerProductDistanceAVX2 : SQ8L2SqrAVX2;
+#endif
+#if defined(USE_NEON)
+        if (getSimdLevel() == SIMD_NEON)
+            fstdistfunc_ = inner_product ? SQ8InnerProductDistanceNEON : SQ8L2SqrNEON;
+#endif
+        floatdistfunc_ = inner_product ? selectInnerProductDistanceFunc(dim) : selectL2SqrFunc(dim);
+    }
+
+    size_t get_data_size() {
+        return dim_;
+    }
+
+    DISTFUNC<float> get_dist_func() {
+        return fstdistfunc_;
+    }
+
+    void *get_dist_func_param() {
+        return &params_;
+    }
+
+    size_t get_dim() const {
+        return dim_;
+    }
+
+    bool is_trained() const {
+        return trained_;
+    }
+
+    void train(const float *data, size_t n) {
+        if (n == 0) throw std::runtime_error("Cannot train quantizer on an empty sample");
+        std::vector<float> vmax(data, data + dim_);
+        params_.vmin.assign(data, data + dim_);
+        for (size_t r = 1; r < n; r++) {
+            const float *row = data + r * dim_;
+            for (size_t i = 0; i < dim_; i++) {
+                params_.vmin[i] = std::min(params_.vmin[i], row[i]);
+                vmax[i] = std::max(vmax[i], row[i]);
+            }
+        }
+        for (size_t i = 0; i < dim_; i++) {
+            params_.scale[i] = (vmax[i] - params_.vmin[i]) / 255.0f;
+            params_.scale2[i] = params_.scale[i] * params_.scale[i];
+        }
+        trained_ = true;
+    }
+
+    void encode(const float *in, void *out) const {
+        uint8_t *codes = (uint8_t *) out;
+        for (size_t i = 0; i < dim_; i++) {
+            float scale = params_.scale[i];
+            float q = scale > 0 ? std::round((in[i] - params_.vmin[i]) / scale) : 0.0f;
+            codes[i] = (uint8_t) std::min(255.0f, std::max(0.0f, q));
+        }
+    }
+
+    void decode(const void *in, float *out) const {
+        const uint8_t *codes = (const uint8_t *) in;
+        for (size_t i = 0; i < dim_; i++) {
+            out[i] = params_.vmin[i] + codes[i] * params_.scale[i];
+        }
+    }
+
+    float asymmetric_dist(const float *query, const void *encoded) const {
+        static thread_local std::vector<float> decoded;
+        decoded.resize(dim_);
+        decode(encoded, decoded.data());
+        return floatdistfunc_(query, decoded.data(), &dim_);
+    }
+
+    bool has_params() const {
+        return true;
+    }
+
+    void save_params(std::ostream &output) const {
+        writeBinaryPOD(output, dim_);
+        writeBinaryPOD(output, trained_);
+        output.write((const char *) params_.vmin.data(), dim_ * sizeof(float));
+        output.write((const char *) params_.scale.data(), dim_ * sizeof(float));
+    }
+
+    void load_params(std::istream &input) {
+        size_t dim;
+        readBinaryPOD(input, dim);
+        if (dim != dim_) throw std::runtime_error("Quantizer parameters do not match the index dimension");
+        readBinaryPOD(input, trained_);
+        input.read((char *) params_.vmin.data(), dim_ * sizeof(float));
+        input.read((char *) params_.scale.data(), dim_ * sizeof(float));
+        if (!input) throw std::runtime_error("Truncated quantizer parameters");
+        for (size_t i = 0; i < dim_; i++) {
+            params_.scale2[i] = params_.scale[i] * params_.scale[i];
+        }
+    }
+
+    ~SQ8Space() {}
+};
+
+// IEEE 754 binary16 <-> binary32 conversion, rounding to nearest even.
+static inline float
+halfToFloat(uint16_t h) {
+    uint32_t sign = (uint32_t) (h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1f;
+    uint32_t mant = h & 0x3ff;
+    uint32_t bits;
+    if (exp == 0x1f) {
+        bits = sign | 0x7f800000 | (mant << 13);
+    } else if (exp != 0) {
+        bits = sign | ((exp + 127 - 15) << 23) | (mant << 13);
+    } else if (mant == 0) {
+        bits = sign;
+    } else {
+        // Subnormal half: renormalize into a float exponent.
+        exp = 127 - 15 + 1;
+        while (!(mant & 0x400)) {
+            mant <<= 1;
+            exp--;
+        }
+        bits = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+    }
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+static inline uint16_t
+floatToHalf(float f) {
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+    uint16_t sign = (x >> 16) & 0x8000;
+    uint32_t absx = x & 0x7fffffff;
+    if (absx >= 0x7f800000)  // inf or nan
+        return sign | 0x7c00 | (absx > 0x7f800000 ? 0x200 : 0);
+    if (absx >= 0x477ff000)  // rounds past the largest half
+        return sign | 0x7c00;
+    if (absx < 0x38800000) {  // subnormal half or zero
+        if (absx < 0x33000000)
+            return sign;
+        uint32_t e = absx >> 23;
+        uint32_t m = (absx & 0x7fffff) | 0x800000;
+        uint32_t shift = 126 - e;
+        uint32_t hm = m >> shift;
+        uint32_t rem = m & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rem > halfway || (rem == halfway && (hm & 1)))
+            hm++;
+        return sign | hm;
+    }
+    uint32_t hbits = (absx >> 13) - ((127 - 15) << 10);
+    uint32_t rem = absx & 0x1fff;
+    if (rem > 0x1000 || (rem == 0x1000 && (hbits & 1)))
+        hbits++;
+    return sign | hbits;
+}
+
+static float
+FP16L2Sqr(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
+    size_t qty = *((size_t *) qty_ptr);
+    const uint16_t *a = (const uint16_t *) pVect1v;
+    const uint16_t *b = (const uint16_t *) pVect2v;
+    float res = 0;
+    for (size_t i = 0; i < qty; i++) {
+        float t = halfToFloat(a[i]) - halfToFloat(b[i]);
+        res += t * t;
+    }
+    return res;
+}
+
+static float
+FP16InnerProductDistance(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
+    size_t qty = *((size_t *) qty_ptr);
+    const uint16_t *a = (const uint16_t *) pVect1v;
+    const uint16_t *b = (const uint16_t *) pVect2v;
+    float res = 0;
+    for (size_t i = 0; i < qty; i++) {
+        res += halfToFloat(a[i]) * halfToFloat(b[i]);
+    }
+    return 1.0f - res;
+}
+
+#if defined(USE_AVX)
+
+HNSWLIB_TARGET_AVX2_F16C static float
+FP16L2SqrAVX2(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
+    size_t qty = *((size_t *) qty_ptr);
+    const uint16_t *a = (const uint16_t *) pVect1v;
+    const uint16_t *b = (const uint16_t *) pVect2v;
+    size_t qty8 = qty / 8 * 8;
+    float PORTABLE_ALIGN32 TmpRes[8];
+
+    __m256 sum = _mm256_setzero_ps();
+    for (size_t i = 0; i < qty8; i += 8) {
+        __m256 va = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *) (a + i)));
+        __m256 vb = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *) (b + i)));
+        __m256 diff = _mm256_sub_ps(va, vb);
+        sum = _mm256_fmadd_ps(diff, diff, sum);
+    }
+    _mm256_store_ps(TmpRes, sum);
+    float res = TmpRes[0] + TmpRes[1] + TmpRes[2] + TmpRes[3] + TmpRes[4] + TmpRes[5] + TmpRes[6] + TmpRes[7];
+    for (size_t i = qty8; i < qty; i++) {
+        float t = halfToFloat(a[i]) - halfToFloat(b[i]);
+        res += t * t;
+    }
+    return res;
+}
+
+HNSWLIB_TARGET_AVX2_F16C static float
+FP16InnerProductDistanceAVX2(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
+    size_t qty = *((size_t *) qty_ptr);
+    const uint16_t *a = (const uint16_t *) pVect1v;
+    const uint16_t *b = (const uint16_t *) pVect2v;
+    size_t qty8 = qty / 8 * 8;
+    float PORTABLE_ALIGN32 TmpRes[8];
+
+    __m256 sum = _mm256_setzero_ps();
+    for (size_t i = 0; i < qty8; i += 8) {
+        __m256 va = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *) (a + i)));
+        __m256 vb = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *) (b + i)));
+        sum = _mm256_fmadd_ps(va, vb, sum);
+    }
+    _mm256_store_ps(TmpRes, sum);
+    float res = TmpRes[0] + TmpRes[1] + TmpRes[2] + TmpRes[3] + TmpRes[4] + TmpRes[5] + TmpRes[6] + TmpRes[7];
+    for (size_t i = qty8; i < qty; i++) {
+        res += halfToFloat(a[i]) * halfToFloat(b[i]);
+    }
+    return 1.0f - res;
+}
+
+#endif
+
+#if defined(USE_AVX512)
+
+HNSWLIB_TARGET_AVX512 static float
+FP16L2SqrAVX512(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
+    size_t qty = *((size_t *) qty_ptr);
+    const uint16_t *a = (const uint16_t *) pVect1v;
+    const uint16_t *b = (const uint16_t *) pVect2v;
+    size_t qty16 = qty / 16 * 16;
+
+    __m512 sum = _mm512_setzero_ps();
+    for (size_t i = 0; i < qty16; i += 16) {
+        __m512 va = _mm512_maskz_cvtph_ps(0xffff, _mm256_loadu_si256((const __m256i *) (a + i)));
+        __m512 vb = _mm512_maskz_cvtph_ps(0xffff, _mm256_loadu_si256((const __m256i *) (b + i)));
+        __m512 diff = _mm512_sub_ps(va, vb);
+        sum = _mm512_fmadd_ps(diff, diff, sum);
+    }
+    float res = reduceAddAVX512(sum);
+    for (size_t i = qty16; i < qty; i++) {
+        float t = halfToFloat(a[i]) - halfToFloat(b[i]);
+        res += t * t;
+    }
+    return res;
+}
+
+HNSWLIB_TARGET_AVX512 static float
+FP16InnerProductDistanceAVX512(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
+    size_t qty = *((size_t *) qty_ptr);
+    const uint16_t *a = (const uint16_t *) pVect1v;
+    const uint16_t *b = (const uint16_t *) pVect2v;
+    size_t qty16 = qty / 16 * 16;
+
+    __m512 sum = _mm512_setzero_ps();
+    for (size_t i = 0; i < qty16; i += 16) {
+        __m512 va = _mm512_maskz_cvtph_ps(0xffff, _mm256_loadu_si256((const __m256i *) (a + i)));
+        __m512 vb = _mm512_maskz_cvtph_ps(0xffff, _mm256_loadu_si256((const __m256i *) (b + i)));
+        sum = _mm512_fmadd_ps(va, vb, sum);
+    }
+    float res = reduceAddAVX512(sum);
+    for (size_t i = qty16; i < qty; i++) {
+        res += halfToFloat(a[i]) * halfToFloat(b[i]);
+    }
+    return 1.0f - res;
+}
+
+#endif
+
+#if defined(USE_NEON)
+
+static float
+FP16L2SqrNEON(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
+    size_t qty = *((size_t *) qty_ptr);
+    const uint16_t *a = (const uint16_t *) pVect1v;
+    const uint16_t *b = (const uint16_t *) pVect2v;
+    size_t qty4 = qty / 4 * 4;
+
+    float32x4_t sum = vdupq_n_f32(0);
+    for (size_t i = 0; i < qty4; i += 4) {
+        float32x4_t va = vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(a + i)));
+        float32x4_t vb = vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(b + i)));
+        float32x4_t diff = vsubq_f32(va, vb);
+        sum = vfmaq_f32(sum, diff, diff);
+    }
+    float res = vaddvq_f32(sum);
+    for (size_t i = qty4; i < qty; i++) {
+        float t = halfToFloat(a[i]) - halfToFloat(b[i]);
+        res += t * t;
+    }
+    return res;
+}
+
+static float
+FP16InnerProductDistanceNEON(const void *pVect1v, const void *pVect2v, const void *qty_ptr) {
+    size_t qty = *((size_t *) qty_ptr);
+    const uint16_t *a = (const uint16_t *) pVect1v;
+    const uint16_t *b = (const uint16_t *) pVect2v;
+    size_t qty4 = qty / 4 * 4;
+
+    float32x4_t sum = vdupq_n_f32(0);
+    for (size_t i = 0; i < qty4; i += 4) {
+        float32x4_t va = vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(a + i)));
+        float32x4_t vb = vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(b + i)));
+        sum = vfmaq_f32(sum, va, vb);
+    }
+    float res = vaddvq_f32(sum);
+    for (size_t i = qty4; i < qty; i++) {
+        res += halfToFloat(a[i]) * halfToFloat(b[i]);
+    }
+    return 1.0f - res;
+}
+
+#endif
+
+// Half-precision storage; needs no training and halves vector memory.
+class FP16Space : public QuantizedSpace {
+    DISTFUNC<float> fstdistfunc_;
+    DISTFUNC<float> floatdistfunc_;
+    size_t dim_;
+
+ public:
+    FP16Space(size_t dim, bool inner_product) : dim_(dim) {
+        fstdistfunc_ = inner_product ? FP16InnerProductDistance : FP16L2Sqr;
+#if defined(USE_AVX512)
+        if (getSimdLevel() == SIMD_AVX512)
+            fstdistfunc_ = inner_product ? FP16InnerProductDistanceAVX512 : FP16L2SqrAVX512;
+#endif
+#if defined(USE_AVX)
+        if (getSimdLevel() == SIMD_AVX2 && F16CCapable())
+            fstdistfunc_ = inner_product ? FP16InnerProductDistanceAVX2 : FP16L2SqrAVX2;
+#endif
+#if defined(USE_NEON)
+        if (getSimdLevel() == SIMD_NEON)
+            fstdistfunc_ = inner_product ? FP16InnerProductDistanceNEON : FP16L2SqrNEON;
+#endif
+        floatdistfunc_ = inner_product ? selectInnerProductDistanceFunc(dim) : selectL2SqrFunc(dim);
+    }
+
+    size_t get_data_size() {
+        return dim_ * sizeof(uint16_t);
+    }
+
+    DISTFUNC<float> get_dist_func() {
+        return fstdistfunc_;
+    }
+
+    void *get_dist_func_param() {
+        return &dim_;
+    }
+
+    size_t get_dim() const {
+        return dim_;
+    }
+
+    void encode(const float *in, void *out) const {
+        uint16_t *halves = (uint16_t *) out;
+        for (size_t i = 0; i < dim_; i++) {
+            halves[i] = floatToHalf(in[i]);
+        }
+    }
+
+    void decode(const void *in, float *out) const {
+        const uint16_t *halves = (const uint16_t *) in;
+        for (size_t i = 0; i < dim_; i++) {
+            out[i] = halfToFloat(halves[i]);
+        }
+    }
+
+    float asymmetric_dist(const float *query, const void *encoded) const {
+        static thread_local std::vector<float> decoded;
+        decoded.resize(dim_);
+        decode(encoded, decoded.data());
+        return floatdistfunc_(query, decoded.data(), &dim_);
+    }
+
+    ~FP16Space() {}
+};
+
+}  // namespace hnswlib
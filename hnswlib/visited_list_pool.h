@@ -1,8 +1,12 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
 #include <mutex>
 #include <string.h>
 #include <deque>
+#include <thread>
 
 namespace hnswlib {
 typedef unsigned short int vl_type;
@@ -33,41 +37,94 @@ class VisitedList {
 //
 // Class for multi-threaded pool-management of VisitedLists
 //
+// Free lists are parked in a fixed array of atomic slots. Each thread starts
+// probing at its own slot, so in steady state a search takes back the list it
+// released last without touching shared state. The mutex-guarded deque is only
+// used when every slot is empty (or full, on release).
+//
 /////////////////////////////////////////////////////////
 
 class VisitedListPool {
+    size_t num_slots;
+    std::unique_ptr<std::atomic<VisitedList *>[]> slots;
     std::deque<VisitedList *> pool;
     std::mutex poolguard;
-    int numelements;
+    std::atomic<int> numelements;
+    std::atomic<size_t> contention{0};
+
+    static size_t threadSlot() {
+        static std::atomic<size_t> next_slot{0};
+        static thread_local size_t slot = next_slot.fetch_add(1);
+        return slot;
+    }
 
  public:
-    VisitedListPool(int initmaxpools, int numelements1) {
-        numelements = numelements1;
+    VisitedListPool(int initmaxpools, int numelements1) : numelements(numelements1) {
+        num_slots = std::max<size_t>(64, 2 * std::thread::hardware_concurrency());
+        slots.reset(new std::atomic<VisitedList *>[num_slots]);
+        for (size_t i = 0; i < num_slots; i++)
+            slots[i].store(nullptr, std::memory_order_relaxed);
         for (int i = 0; i < initmaxpools; i++)
-            pool.push_front(new VisitedList(numelements));
+            pool.push_front(new VisitedList(numelements1));
     }
 
     VisitedList *getFreeVisitedList() {
-        VisitedList *rez;
-        {
+        VisitedList *rez = nullptr;
+        size_t start = threadSlot() % num_slots;
+        for (size_t i = 0; i < num_slots && rez == nullptr; i++) {
+            std::atomic<VisitedList *> &slot = slots[(start + i) % num_slots];
+            if (slot.load(std::memory_order_relaxed) != nullptr)
+                rez = slot.exchange(nullptr, std::memory_order_acquire);
+        }
+        if (rez == nullptr) {
+            contention.fetch_add(1, std::memory_order_relaxed);
             std::unique_lock <std::mutex> lock(poolguard);
             if (pool.size() > 0) {
                 rez = pool.front();
                 pool.pop_front();
-            } else {
-                rez = new VisitedList(numelements);
             }
         }
+
+        int size = numelements.load(std::memory_order_relaxed);
+        if (rez != nullptr && rez->numelements < (unsigned int) size) {
+            // allocated before the index grew
+            delete rez;
+            rez = nullptr;
+        }
+        if (rez == nullptr)
+            rez = new VisitedList(size);
         rez->reset();
         return rez;
     }
 
     void releaseVisitedList(VisitedList *vl) {
+        size_t start = threadSlot() % num_slots;
+        for (size_t i = 0; i < num_slots; i++) {
+            VisitedList *expected = nullptr;
+            if (slots[(start + i) % num_slots].compare_exchange_strong(
+                    expected, vl, std::memory_order_release, std::memory_order_relaxed))
+                return;
+        }
         std::unique_lock <std::mutex> lock(poolguard);
         pool.push_front(vl);
     }
 
+    /*
+    * Makes lists handed out from now on cover numelements1 elements. Cached lists
+    * that are too small are replaced lazily when they are next acquired.
+    */
+    void resize(int numelements1) {
+        numelements.store(numelements1, std::memory_order_relaxed);
+    }
+
+    // Number of acquisitions that found no list in the lock-free slots.
+    size_t getContention() const {
+        return contention.load(std::memory_order_relaxed);
+    }
+
     ~VisitedListPool() {
+        for (size_t i = 0; i < num_slots; i++)
+            delete slots[i].load(std::memory_order_relaxed);
         while (pool.size()) {
             VisitedList *rez = pool.front();
             pool.pop_front();